@@ -0,0 +1,559 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        main.c
+ *
+ */
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * trace
+ */
+#define TB_TRACE_MODULE_NAME            "vm86_bench"
+#define TB_TRACE_MODULE_DEBUG           (0)
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "vm86/vm86.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * macros
+ */
+
+// the copies count of the instruction form in the loop body
+#define VM86_BENCH_UNROLL               (16)
+
+// the maximum size of the generated code
+#define VM86_BENCH_CODE_MAXN            (16384)
+
+// the maximum repetitions count
+#define VM86_BENCH_REPEAT_MAXN          (1024)
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+/* the instruction form case type
+ *
+ * the code (and .data) of each copy is a format string of the copy index, e.g. "jmp short l%lu\nl%lu:",
+ * and the copies are executed in the loop which is counted down by edi.
+ *
+ * the registers in the loop:
+ *
+ * - esi: the address of buf (dd 7, 3, 3, 0)
+ * - ebx: 0, the index of the jump tables
+ * - ecx: 3, the shift count
+ * - eax, edx: the scratch registers
+ */
+typedef struct __vm86_bench_form_t
+{
+    // the case name
+    tb_char_t const*        name;
+
+    // the handler table
+    tb_char_t const*        table;
+
+    // the .data of each copy, optional
+    tb_char_t const*        data;
+
+    // the code of each copy
+    tb_char_t const*        code;
+
+    // the instructions count of each copy
+    tb_size_t               count;
+
+}vm86_bench_form_t;
+
+// the end-to-end proc case type
+typedef struct __vm86_bench_proc_t
+{
+    // the case name
+    tb_char_t const*        name;
+
+    // the code
+    tb_char_t const*        code;
+
+    // the executed instructions count of each call
+    tb_size_t               count;
+
+    // the arguments: eax, edx and ecx
+    tb_uint32_t             eax;
+    tb_uint32_t             edx;
+    tb_uint32_t             ecx;
+
+}vm86_bench_proc_t;
+
+// the benchmark options type
+typedef struct __vm86_bench_option_t
+{
+    // the loop iterations or the calls count of each repetition
+    tb_size_t               iterations;
+
+    // the repetitions count
+    tb_size_t               repetitions;
+
+    // the warm-up repetitions count
+    tb_size_t               warmups;
+
+    // enable the jit tier?
+    tb_bool_t               jit;
+
+    // the case name filter
+    tb_char_t const*        filter;
+
+    // the results count
+    tb_size_t               results;
+
+}vm86_bench_option_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * globals
+ */
+
+// the instruction forms of all handler tables
+static vm86_bench_form_t const g_forms[] =
+{
+    // xxx func
+    { "call",                   "xxx_func",                     tb_null,                    "call stub\n",                                  1 }
+
+    // xxx r0
+,   { "jmp_r0",                 "xxx_r0",                       tb_null,                    "mov edx, offset lr%lu\njmp edx\nlr%lu:\n",     2 }
+,   { "not_r0",                 "xxx_r0",                       tb_null,                    "not eax\n",                                    1 }
+,   { "push_r0_pop_r0",         "xxx_r0",                       tb_null,                    "push eax\npop edx\n",                          2 }
+
+    // xxx v0
+,   { "jmp_v0",                 "xxx_v0",                       tb_null,                    "jmp short lj%lu\nlj%lu:\n",                    1 }
+,   { "jz_v0",                  "xxx_v0",                       tb_null,                    "jz short lz%lu\nlz%lu:\n",                     1 }
+,   { "push_v0_pop_r0",         "xxx_v0",                       tb_null,                    "push 1\npop edx\n",                            2 }
+
+    // xxx r0, r1
+,   { "add_r0_r1_8",            "xxx_r0_r1",                    tb_null,                    "add al, dl\n",                                 1 }
+,   { "add_r0_r1_16",           "xxx_r0_r1",                    tb_null,                    "add ax, dx\n",                                 1 }
+,   { "add_r0_r1_32",           "xxx_r0_r1",                    tb_null,                    "add eax, edx\n",                               1 }
+,   { "and_r0_r1_8",            "xxx_r0_r1",                    tb_null,                    "and al, dl\n",                                 1 }
+,   { "and_r0_r1_16",           "xxx_r0_r1",                    tb_null,                    "and ax, dx\n",                                 1 }
+,   { "and_r0_r1_32",           "xxx_r0_r1",                    tb_null,                    "and eax, edx\n",                               1 }
+,   { "cmp_r0_r1_8",            "xxx_r0_r1",                    tb_null,                    "cmp al, dl\n",                                 1 }
+,   { "cmp_r0_r1_16",           "xxx_r0_r1",                    tb_null,                    "cmp ax, dx\n",                                 1 }
+,   { "cmp_r0_r1_32",           "xxx_r0_r1",                    tb_null,                    "cmp eax, edx\n",                               1 }
+,   { "mov_r0_r1_8",            "xxx_r0_r1",                    tb_null,                    "mov al, dl\n",                                 1 }
+,   { "mov_r0_r1_16",           "xxx_r0_r1",                    tb_null,                    "mov ax, dx\n",                                 1 }
+,   { "mov_r0_r1_32",           "xxx_r0_r1",                    tb_null,                    "mov eax, edx\n",                               1 }
+,   { "movzx_r0_r1",            "xxx_r0_r1",                    tb_null,                    "movzx eax, dl\n",                              1 }
+,   { "sar_r0_r1",              "xxx_r0_r1",                    tb_null,                    "sar eax, cl\n",                                1 }
+,   { "shl_r0_r1",              "xxx_r0_r1",                    tb_null,                    "shl eax, cl\n",                                1 }
+,   { "shr_r0_r1",              "xxx_r0_r1",                    tb_null,                    "shr eax, cl\n",                                1 }
+,   { "sub_r0_r1_8",            "xxx_r0_r1",                    tb_null,                    "sub al, dl\n",                                 1 }
+,   { "sub_r0_r1_16",           "xxx_r0_r1",                    tb_null,                    "sub ax, dx\n",                                 1 }
+,   { "sub_r0_r1_32",           "xxx_r0_r1",                    tb_null,                    "sub eax, edx\n",                               1 }
+,   { "xor_r0_r1_8",            "xxx_r0_r1",                    tb_null,                    "xor al, dl\n",                                 1 }
+,   { "xor_r0_r1_16",           "xxx_r0_r1",                    tb_null,                    "xor ax, dx\n",                                 1 }
+,   { "xor_r0_r1_32",           "xxx_r0_r1",                    tb_null,                    "xor eax, edx\n",                               1 }
+
+    // xxx r0, r1, r2
+,   { "shrd_r0_r1_r2",          "xxx_r0_r1_r2",                 tb_null,                    "shrd eax, edx, cl\n",                          1 }
+
+    // xxx r0, v0
+,   { "add_r0_v0_8",            "xxx_r0_v0",                    tb_null,                    "add al, 3\n",                                  1 }
+,   { "add_r0_v0_16",           "xxx_r0_v0",                    tb_null,                    "add ax, 3\n",                                  1 }
+,   { "add_r0_v0_32",           "xxx_r0_v0",                    tb_null,                    "add eax, 3\n",                                 1 }
+,   { "and_r0_v0_8",            "xxx_r0_v0",                    tb_null,                    "and al, 7Fh\n",                                1 }
+,   { "and_r0_v0_16",           "xxx_r0_v0",                    tb_null,                    "and ax, 7FFFh\n",                              1 }
+,   { "and_r0_v0_32",           "xxx_r0_v0",                    tb_null,                    "and eax, 7FFFFFFFh\n",                         1 }
+,   { "cmp_r0_v0_8",            "xxx_r0_v0",                    tb_null,                    "cmp al, 3\n",                                  1 }
+,   { "cmp_r0_v0_16",           "xxx_r0_v0",                    tb_null,                    "cmp ax, 3\n",                                  1 }
+,   { "cmp_r0_v0_32",           "xxx_r0_v0",                    tb_null,                    "cmp eax, 3\n",                                 1 }
+,   { "mov_r0_v0_8",            "xxx_r0_v0",                    tb_null,                    "mov al, 3\n",                                  1 }
+,   { "mov_r0_v0_16",           "xxx_r0_v0",                    tb_null,                    "mov ax, 3\n",                                  1 }
+,   { "mov_r0_v0_32",           "xxx_r0_v0",                    tb_null,                    "mov eax, 3\n",                                 1 }
+,   { "or_r0_v0",               "xxx_r0_v0",                    tb_null,                    "or eax, 1\n",                                  1 }
+,   { "sar_r0_v0",              "xxx_r0_v0",                    tb_null,                    "sar eax, 3\n",                                 1 }
+,   { "shl_r0_v0",              "xxx_r0_v0",                    tb_null,                    "shl eax, 3\n",                                 1 }
+,   { "shr_r0_v0",              "xxx_r0_v0",                    tb_null,                    "shr eax, 3\n",                                 1 }
+,   { "sub_r0_v0_8",            "xxx_r0_v0",                    tb_null,                    "sub al, 3\n",                                  1 }
+,   { "sub_r0_v0_16",           "xxx_r0_v0",                    tb_null,                    "sub ax, 3\n",                                  1 }
+,   { "sub_r0_v0_32",           "xxx_r0_v0",                    tb_null,                    "sub eax, 3\n",                                 1 }
+,   { "xor_r0_v0_8",            "xxx_r0_v0",                    tb_null,                    "xor al, 5\n",                                  1 }
+,   { "xor_r0_v0_16",           "xxx_r0_v0",                    tb_null,                    "xor ax, 5\n",                                  1 }
+,   { "xor_r0_v0_32",           "xxx_r0_v0",                    tb_null,                    "xor eax, 5\n",                                 1 }
+
+    // xxx r0, [r1 + v0]
+,   { "add_r0_$r1_add_v0$",     "xxx_r0_$r1_add_v0$",           tb_null,                    "add eax, [esi+8]\n",                           1 }
+,   { "and_r0_$r1_add_v0$",     "xxx_r0_$r1_add_v0$",           tb_null,                    "and eax, [esi+8]\n",                           1 }
+,   { "cmp_r0_$r1_add_v0$",     "xxx_r0_$r1_add_v0$",           tb_null,                    "cmp eax, [esi+8]\n",                           1 }
+,   { "imul_r0_$r1_add_v0$",    "xxx_r0_$r1_add_v0$",           tb_null,                    "imul eax, [esi+8]\n",                          1 }
+,   { "mov_r0_$r1_add_v0$",     "xxx_r0_$r1_add_v0$",           tb_null,                    "mov eax, [esi+8]\n",                           1 }
+,   { "or_r0_$r1_add_v0$",      "xxx_r0_$r1_add_v0$",           tb_null,                    "or eax, [esi+8]\n",                            1 }
+,   { "sub_r0_$r1_add_v0$",     "xxx_r0_$r1_add_v0$",           tb_null,                    "sub eax, [esi+8]\n",                           1 }
+,   { "xor_r0_$r1_add_v0$",     "xxx_r0_$r1_add_v0$",           tb_null,                    "xor eax, [esi+8]\n",                           1 }
+
+    // xxx r0, [r1 + r2 op v0]
+,   { "lea_r0_$r1_add_r2_mul_v0$", "xxx_r0_$r1_add_r2_op_v0$",  tb_null,                    "lea eax, [esi+ebx*4]\n",                       1 }
+,   { "lea_r0_$r1_add_r2_add_v0$", "xxx_r0_$r1_add_r2_op_v0$",  tb_null,                    "lea eax, [esi+ebx+10h]\n",                     1 }
+
+    // xxx v0[r0 * v1]
+,   { "jmp_v0$r0_mul_v1$",      "xxx_v0$r0_mul_v1$",            "tbl%lu dd offset lt%lu\n", "jmp ds:tbl%lu[ebx*4]\nlt%lu:\n",               1 }
+
+    // xxx [r0 + v0]
+,   { "div_$r0_add_v0$",        "xxx_$r0_add_v0$",              tb_null,                    "mov edx, 0\ndiv [esi+4]\n",                    2 }
+,   { "mul_$r0_add_v0$",        "xxx_$r0_add_v0$",              tb_null,                    "mul [esi+8]\n",                                1 }
+
+    // xxx [r0 + v0], r1
+,   { "cmp_$r0_add_v0$_r1",     "xxx_$r0_add_v0$_r1",           tb_null,                    "cmp [esi+12], eax\n",                          1 }
+,   { "mov_$r0_add_v0$_r1",     "xxx_$r0_add_v0$_r1",           tb_null,                    "mov [esi+12], eax\n",                          1 }
+
+    // xxx [r0 + v0], v1
+,   { "cmp_$r0_add_v0$_v1",     "xxx_$r0_add_v0$_v1",           tb_null,                    "cmp [esi+12], 5\n",                            1 }
+,   { "mov_$r0_add_v0$_v1",     "xxx_$r0_add_v0$_v1",           tb_null,                    "mov [esi+12], 5\n",                            1 }
+};
+
+// the end-to-end procs, sub_6B2B40(0x12300000321, 8) takes the shrd path
+static vm86_bench_proc_t const g_procs[] =
+{
+    {   "leave"
+    ,   "bench_leave proc near\n push ebp\n mov ebp, esp\n leave\nbench_leave endp\n"
+    ,   3
+    ,   0, 0, 0
+    }
+,   {   "retn"
+    ,   "bench_retn proc near\n retn\nbench_retn endp\n"
+    ,   1
+    ,   0, 0, 0
+    }
+,   {   "sub_6B2B40"
+    ,   "sub_6B2B40 proc near\n\
+ cmp cl, 40h\n\
+ jnb short loc_6B2B5A\n\
+ cmp cl, 20h\n\
+ jnb short loc_6B2B50\n\
+ shrd eax, edx, cl\n\
+ shr edx, cl\n\
+ retn\n\
+loc_6B2B50:\n\
+ mov eax, edx\n\
+ xor edx, edx\n\
+ and cl, 1Fh\n\
+ shr eax, cl\n\
+ retn\n\
+loc_6B2B5A:\n\
+ xor eax, eax\n\
+ xor edx, edx\n\
+ retn\n\
+sub_6B2B40 endp\n"
+    ,   7
+    ,   0x321, 0x123, 8
+    }
+,   {   "sub_hello"
+    ,   "sub_hello proc near\n\
+arg_0 = dword ptr 8\n\
+.data\n\
+ format db \"hello: %x\", 0ah, 0dh, 0\n\
+off_5A74B0 dd offset loc_6B2B50\n\
+ dd offset loc_58A945\n\
+.code\n\
+ push ebp\n\
+ mov ebp, esp\n\
+loc_6B2B50:\n\
+ push eax\n\
+ mov eax, [ebp+arg_0]\n\
+ push eax\n\
+ mov eax, offset format\n\
+ push eax\n\
+ call printf\n\
+ add esp, 4\n\
+ pop eax\n\
+ mov ecx, 1\n\
+ jmp ds:off_5A74B0[ecx*4]\n\
+loc_58A945:\n\
+ push eax\n\
+ mov eax, [ebp+arg_0]\n\
+ push eax\n\
+ mov eax, offset format\n\
+ push eax\n\
+ call printf\n\
+ add esp, 4\n\
+ pop eax\n\
+ mov esp, ebp\n\
+ pop ebp\n\
+ retn\n\
+sub_hello endp\n"
+    ,   23
+    ,   0, 0, 0
+    }
+};
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * private implementation
+ */
+static tb_void_t vm86_bench_func_stub(vm86_context_ref_t context)
+{
+    // the host functions are stubbed out
+    tb_used(context);
+}
+static tb_size_t vm86_bench_form_code(vm86_bench_form_t const* form, tb_char_t* code, tb_size_t maxn)
+{
+    // the prologue and the .data
+    tb_size_t size = tb_snprintf(code, maxn, "bench proc near\n.data\nbuf dd 7, 3, 3, 0\n");
+    tb_size_t i = 0;
+    for (i = 0; form->data && i < VM86_BENCH_UNROLL && size < maxn; i++)
+        size += tb_snprintf(code + size, maxn - size, form->data, i, i, i, i);
+
+    // init the registers, edi is the loop counter and it has been set by the host
+    if (size < maxn) size += tb_snprintf(code + size, maxn - size, ".code\n mov esi, offset buf\n mov ebx, 0\n mov ecx, 3\n mov eax, 1\n mov edx, 2\nbench_loop:\n");
+
+    // the copies of the instruction form
+    for (i = 0; i < VM86_BENCH_UNROLL && size < maxn; i++)
+        size += tb_snprintf(code + size, maxn - size, form->code, i, i, i, i);
+
+    // the epilogue
+    if (size < maxn) size += tb_snprintf(code + size, maxn - size, " sub edi, 1\n jnz short bench_loop\n retn\nbench endp\n");
+
+    // ok?
+    return size < maxn? size + 1 : 0;
+}
+static tb_void_t vm86_bench_report(vm86_bench_option_t* option, tb_char_t const* name, tb_char_t const* table, tb_hize_t count, tb_double_t* samples, tb_size_t n)
+{
+    // the mean
+    tb_size_t   i = 0;
+    tb_double_t sum = 0;
+    for (i = 0; i < n; i++) sum += samples[i];
+    tb_double_t mean = sum / n;
+
+    // the standard deviation
+    tb_double_t var = 0;
+    for (i = 0; i < n; i++) var += (samples[i] - mean) * (samples[i] - mean);
+    tb_double_t stddev = n > 1? tb_sqrt(var / (n - 1)) : 0;
+
+    // the median, the samples are sorted in place
+    for (i = 1; i < n; i++)
+    {
+        tb_double_t sample = samples[i];
+        tb_size_t   j = i;
+        for (; j > 0 && samples[j - 1] > sample; j--) samples[j] = samples[j - 1];
+        samples[j] = sample;
+    }
+    tb_double_t median = (n & 1)? samples[n >> 1] : (samples[(n >> 1) - 1] + samples[n >> 1]) / 2;
+
+    // report it, the times are ns per guest instruction
+    tb_printf("  %s{ \"name\": \"%s\", \"table\": \"%s\", \"instructions\": %llu, \"mean\": %.3f, \"median\": %.3f, \"min\": %.3f, \"max\": %.3f, \"stddev\": %.3f, \"cv\": %.2f }\n"
+        ,   option->results? ", " : "  "
+        ,   name
+        ,   table
+        ,   count
+        ,   mean
+        ,   median
+        ,   samples[0]
+        ,   samples[n - 1]
+        ,   stddev
+        ,   mean > 0? stddev * 100 / mean : 0);
+    option->results++;
+}
+static tb_bool_t vm86_bench_form(vm86_bench_option_t* option, vm86_bench_form_t const* form)
+{
+    // done
+    tb_bool_t           ok = tb_false;
+    vm86_machine_ref_t  machine = tb_null;
+    do
+    {
+        // init a new machine for each case, so the .data and the compiled procs are not shared
+        machine = vm86_machine_init(1024, 1024);
+        tb_assert_and_check_break(machine);
+
+        // init the host functions and the jit tier
+        vm86_machine_function_set(machine, "stub", vm86_bench_func_stub);
+        vm86_machine_jit_threshold_set(machine, option->jit? 1 : 0);
+
+        // make code
+        static tb_char_t code[VM86_BENCH_CODE_MAXN];
+        tb_size_t size = vm86_bench_form_code(form, code, sizeof(code));
+        tb_assert_and_check_break(size);
+
+        // compile it
+        vm86_proc_ref_t proc = vm86_text_compile(vm86_machine_text(machine), code, size);
+        tb_assert_and_check_break(proc);
+
+        // the executed instructions count of each repetition, the loop is "sub edi, 1; jnz" and the prologue is 6 instructions
+        tb_hize_t count = 6 + (tb_hize_t)option->iterations * (VM86_BENCH_UNROLL * form->count + 2);
+
+        // done the warm-up and the timed repetitions
+        static tb_double_t samples[VM86_BENCH_REPEAT_MAXN];
+        vm86_registers_ref_t registers = vm86_machine_registers(machine);
+        tb_size_t i = 0;
+        for (i = 0; i < option->warmups + option->repetitions; i++)
+        {
+            // done it
+            registers[VM86_REGISTER_EDI].u32 = (tb_uint32_t)option->iterations;
+            tb_hong_t time = tb_uclock();
+            vm86_proc_done(proc, tb_null);
+            time = tb_uclock() - time;
+
+            // save the ns per instruction
+            if (i >= option->warmups) samples[i - option->warmups] = (tb_double_t)time * 1000 / count;
+        }
+
+        // report it
+        vm86_bench_report(option, form->name, form->table, count, samples, option->repetitions);
+
+        // ok
+        ok = tb_true;
+
+    } while (0);
+
+    // failed?
+    if (!ok) tb_trace_e("bench %s failed!", form->name);
+
+    // exit machine
+    if (machine) vm86_machine_exit(machine);
+    machine = tb_null;
+
+    // ok?
+    return ok;
+}
+static tb_bool_t vm86_bench_proc(vm86_bench_option_t* option, vm86_bench_proc_t const* item)
+{
+    // done
+    tb_bool_t           ok = tb_false;
+    vm86_machine_ref_t  machine = tb_null;
+    do
+    {
+        // init a new machine for each case
+        machine = vm86_machine_init(1024, 1024);
+        tb_assert_and_check_break(machine);
+
+        // init the host functions and the jit tier
+        vm86_machine_function_set(machine, "printf", vm86_bench_func_stub);
+        vm86_machine_jit_threshold_set(machine, option->jit? 1 : 0);
+
+        // compile it
+        vm86_proc_ref_t proc = vm86_text_compile(vm86_machine_text(machine), item->code, tb_strlen(item->code) + 1);
+        tb_assert_and_check_break(proc);
+
+        // init the arguments
+        vm86_registers_ref_t registers = vm86_machine_registers(machine);
+        registers[VM86_REGISTER_EAX].u32 = item->eax;
+        registers[VM86_REGISTER_EDX].u32 = item->edx;
+        registers[VM86_REGISTER_ECX].u32 = item->ecx;
+
+        // the executed instructions count of each repetition
+        tb_hize_t count = (tb_hize_t)option->iterations * item->count;
+
+        // done the warm-up and the timed repetitions
+        static tb_double_t samples[VM86_BENCH_REPEAT_MAXN];
+        tb_uint32_t esp = registers[VM86_REGISTER_ESP].u32;
+        tb_size_t i = 0;
+        for (i = 0; i < option->warmups + option->repetitions; i++)
+        {
+            // call it, the stack is restored for leave which does not pop the return address
+            tb_size_t   n = option->iterations;
+            tb_hong_t   time = tb_uclock();
+            while (n--)
+            {
+                vm86_proc_done(proc, tb_null);
+                registers[VM86_REGISTER_ESP].u32 = esp;
+            }
+            time = tb_uclock() - time;
+
+            // save the ns per instruction
+            if (i >= option->warmups) samples[i - option->warmups] = (tb_double_t)time * 1000 / count;
+        }
+
+        // report it
+        vm86_bench_report(option, item->name, "proc", count, samples, option->repetitions);
+
+        // ok
+        ok = tb_true;
+
+    } while (0);
+
+    // failed?
+    if (!ok) tb_trace_e("bench %s failed!", item->name);
+
+    // exit machine
+    if (machine) vm86_machine_exit(machine);
+    machine = tb_null;
+
+    // ok?
+    return ok;
+}
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * main
+ */
+tb_int_t main(tb_int_t argc, tb_char_t** argv)
+{
+    // init options
+    vm86_bench_option_t option;
+    tb_memset(&option, 0, sizeof(option));
+    option.iterations   = 100000;
+    option.repetitions  = 10;
+    option.warmups      = 3;
+
+    // parse options
+    tb_int_t i = 0;
+    for (i = 1; i < argc; i++)
+    {
+        if (!tb_strcmp(argv[i], "-n") && i + 1 < argc) option.iterations = tb_atoi(argv[++i]);
+        else if (!tb_strcmp(argv[i], "-r") && i + 1 < argc) option.repetitions = tb_atoi(argv[++i]);
+        else if (!tb_strcmp(argv[i], "-w") && i + 1 < argc) option.warmups = tb_atoi(argv[++i]);
+        else if (!tb_strcmp(argv[i], "-j")) option.jit = tb_true;
+        else if (argv[i][0] != '-') option.filter = argv[i];
+        else
+        {
+            tb_printf("usage: vm86_bench [-n iterations] [-r repetitions] [-w warmups] [-j] [filter]\n");
+            tb_printf("    report ns per guest instruction of each instruction form and the demo procs as json\n");
+            return -1;
+        }
+    }
+    if (!option.iterations || !option.repetitions || option.repetitions > VM86_BENCH_REPEAT_MAXN)
+    {
+        tb_printf("invalid options!\n");
+        return -1;
+    }
+
+    // init tbox
+    if (!tb_init(tb_null, tb_null)) return -1;
+
+    // the header, the keys are in a fixed order so the reports can be compared by the text diff
+    tb_printf("{\n  \"iterations\": %lu,\n  \"unroll\": %d,\n  \"warmups\": %lu,\n  \"repetitions\": %lu,\n  \"jit\": %s,\n  \"results\":\n  [\n"
+        ,   option.iterations
+        ,   VM86_BENCH_UNROLL
+        ,   option.warmups
+        ,   option.repetitions
+        ,   option.jit? "true" : "false");
+
+    // done the instruction forms
+    tb_bool_t ok = tb_true;
+    tb_size_t j = 0;
+    for (j = 0; j < tb_arrayn(g_forms); j++)
+    {
+        if (option.filter && !tb_strstr(g_forms[j].name, option.filter)) continue;
+        if (!vm86_bench_form(&option, &g_forms[j])) ok = tb_false;
+    }
+
+    // done the procs
+    for (j = 0; j < tb_arrayn(g_procs); j++)
+    {
+        if (option.filter && !tb_strstr(g_procs[j].name, option.filter)) continue;
+        if (!vm86_bench_proc(&option, &g_procs[j])) ok = tb_false;
+    }
+
+    // the tail
+    tb_printf("  ]\n}\n");
+
+    // exit tbox
+    tb_exit();
+    return ok? 0 : -1;
+}
@@ -6,13 +6,13 @@
 /* //////////////////////////////////////////////////////////////////////////////////////
  * test
  */
-static tb_void_t vm86_demo_proc_func_printf(vm86_machine_ref_t machine)
+static tb_void_t vm86_demo_proc_func_printf(vm86_context_ref_t context)
 {
     // check
-    tb_assert(machine);
+    tb_assert(context);
 
     // the stack
-    vm86_stack_ref_t stack = vm86_machine_stack(machine);
+    vm86_stack_ref_t stack = vm86_context_stack(context);
     tb_assert(stack);
 
     // get the format
@@ -25,7 +25,7 @@ static tb_void_t vm86_demo_proc_func_printf(vm86_machine_ref_t machine)
     vm86_stack_top(stack, &value, 1);
 
     // done it
-    tb_printf((tb_char_t const*)format, value);
+    tb_printf((tb_char_t const*)vm86_memory_ptr(format), value);
 }
 static tb_void_t vm86_demo_proc_exec_hello(tb_uint32_t value)
 {
@@ -100,7 +100,7 @@ sub_hello    endp \n\
             vm86_stack_push(stack, value);
 
             // done proc
-            vm86_proc_done(proc);
+            vm86_proc_done(proc, tb_null);
 
             // restore stack
             vm86_stack_pop(stack, tb_null);
@@ -113,12 +113,10 @@ sub_hello    endp \n\
         tb_spinlock_leave(lock);
     } 
 }
-static tb_void_t vm86_demo_proc_exec_sub_6B2B40(tb_uint64_t a1, tb_uint8_t a2)
+// the code of sub_6B2B40
+static tb_char_t const s_code_sub_6B2B40[] = 
 {
-    // the code
-    static tb_char_t const s_code_sub_6B2B40[] = 
-    {
-        "\n\
+    "\n\
             ; ... \n\
     sub_6B2B40	proc near		; CODE XREF: sub_6B2B40+E83p\n\
                         ; sub_526E70+3C7Ap ...\n\
@@ -145,18 +143,13 @@ static tb_void_t vm86_demo_proc_exec_sub_6B2B40(tb_uint64_t a1, tb_uint8_t a2)
             retn\n\
     sub_6B2B40	endp\n\
     "
-    };
-
-    // the machine
-    vm86_machine_ref_t machine = vm86_machine();
+};
+static tb_void_t vm86_demo_proc_exec_sub_6B2B40(vm86_machine_pool_ref_t pool, tb_uint64_t a1, tb_uint8_t a2)
+{
+    // the machine of the current thread, no lock
+    vm86_machine_ref_t machine = vm86_machine_pool_local(pool);
     if (machine)
     {
-        // the lock
-        tb_spinlock_ref_t lock = vm86_machine_lock(machine);
-
-        // enter
-        tb_spinlock_enter(lock);
-
         // the registers
         vm86_registers_ref_t registers = vm86_machine_registers(machine);
 
@@ -170,17 +163,68 @@ static tb_void_t vm86_demo_proc_exec_sub_6B2B40(tb_uint64_t a1, tb_uint8_t a2)
             registers[VM86_REGISTER_ECX].u8[0] = a2;
 
             // done proc
-            vm86_proc_done(proc);
+            vm86_proc_done(proc, tb_null);
 
             // the result
             tb_uint64_t result = ((tb_uint64_t)registers[VM86_REGISTER_EDX].u32 << 32) | registers[VM86_REGISTER_EAX].u32;
 
             // trace
             tb_trace_i("sub_6B2B40(%llx, %u): %llx", a1, a2, result);
+
+            // trace the compile cache
+            tb_size_t hits = 0;
+            tb_size_t misses = 0;
+            vm86_text_cache_stat(vm86_machine_text(machine), &hits, &misses);
+            tb_trace_i("compile cache: hits: %lu, misses: %lu", hits, misses);
         }
+    } 
+}
+static tb_void_t vm86_demo_proc_exec_sub_6B2B40_batch(vm86_machine_pool_ref_t pool, tb_uint64_t a1)
+{
+    // the layout: uint64_t sub_6B2B40(uint64_t edx:eax, uint8_t cl)
+    static vm86_proc_slot_t const s_inputs[] = 
+    {
+        {VM86_PROC_SLOT_REGISTER, VM86_REGISTER_EAX}
+    ,   {VM86_PROC_SLOT_REGISTER, VM86_REGISTER_EDX}
+    ,   {VM86_PROC_SLOT_REGISTER, VM86_REGISTER_ECX | VM86_REGISTER_CL}
+    };
+    static vm86_proc_slot_t const s_outputs[] = 
+    {
+        {VM86_PROC_SLOT_REGISTER, VM86_REGISTER_EAX}
+    ,   {VM86_PROC_SLOT_REGISTER, VM86_REGISTER_EDX}
+    };
+    vm86_proc_layout_t layout = {s_inputs, tb_arrayn(s_inputs), s_outputs, tb_arrayn(s_outputs)};
 
-        // leave
-        tb_spinlock_leave(lock);
+    // the machine of the current thread, no lock
+    vm86_machine_ref_t machine = vm86_machine_pool_local(pool);
+    if (machine)
+    {
+        // compile proc
+        vm86_proc_ref_t proc = vm86_text_compile(vm86_machine_text(machine), s_code_sub_6B2B40, sizeof(s_code_sub_6B2B40));
+        if (proc)
+        {
+            // init arguments, shift it by 0 .. 63
+            tb_size_t   i = 0;
+            tb_uint32_t inputs[64 * 3];
+            tb_uint32_t outputs[64 * 2];
+            for (i = 0; i < 64; i++)
+            {
+                inputs[i * 3 + 0] = (tb_uint32_t)a1;
+                inputs[i * 3 + 1] = (tb_uint32_t)(a1 >> 32);
+                inputs[i * 3 + 2] = (tb_uint32_t)i;
+            }
+
+            // done proc for all arguments
+            if (vm86_proc_done_batch(proc, tb_null, inputs, outputs, 64, &layout))
+            {
+                // trace the results
+                for (i = 0; i < 64; i += 8)
+                {
+                    tb_uint64_t result = ((tb_uint64_t)outputs[i * 2 + 1] << 32) | outputs[i * 2];
+                    tb_trace_i("sub_6B2B40(%llx, %lu): %llx", a1, i, result);
+                }
+            }
+        }
     } 
 }
 
@@ -192,11 +236,20 @@ tb_int_t main(tb_int_t argc, tb_char_t** argv)
     // init tbox
     if (!tb_init(tb_null, tb_null)) return 0;
 
-    // done
-    vm86_demo_proc_exec_hello(0x31415926);
-    vm86_demo_proc_exec_sub_6B2B40((0x123ULL << 32) | 0x321, 8);
-    vm86_demo_proc_exec_sub_6B2B40((0x123ULL << 32) | 0x321, 16);
-    vm86_demo_proc_exec_sub_6B2B40((0x123ULL << 32) | 0x321, 32);
+    // init machine pool
+    vm86_machine_pool_ref_t pool = vm86_machine_pool_init(1, 2048, 2048, tb_null, tb_null);
+    if (pool)
+    {
+        // done
+        vm86_demo_proc_exec_hello(0x31415926);
+        vm86_demo_proc_exec_sub_6B2B40(pool, (0x123ULL << 32) | 0x321, 8);
+        vm86_demo_proc_exec_sub_6B2B40(pool, (0x123ULL << 32) | 0x321, 16);
+        vm86_demo_proc_exec_sub_6B2B40(pool, (0x123ULL << 32) | 0x321, 32);
+        vm86_demo_proc_exec_sub_6B2B40_batch(pool, (0x123ULL << 32) | 0x321);
+
+        // exit machine pool
+        vm86_machine_pool_exit(pool);
+    }
 
     // exit tbox
     tb_exit();
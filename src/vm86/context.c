@@ -0,0 +1,175 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * 
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        context.c
+ *
+ */
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "machine.h"
+#include "impl/context.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * macros
+ */
+
+// the cache line size
+#define VM86_CONTEXT_CACHE_LINE     (64)
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * implementation
+ */
+vm86_context_ref_t vm86_context_init(vm86_machine_ref_t machine, tb_size_t stack_size)
+{
+    // check
+    tb_assert_and_check_return_val(machine && stack_size, tb_null);
+
+    // make context
+    vm86_context_t* context = (vm86_context_t*)tb_align_malloc0(sizeof(vm86_context_t), VM86_CONTEXT_CACHE_LINE);
+    tb_assert_and_check_return_val(context, tb_null);
+
+    // attach context and reserve its stack
+    if (!vm86_context_attach(context, machine, stack_size))
+    {
+        tb_align_free(context);
+        return tb_null;
+    }
+
+    // ok
+    return (vm86_context_ref_t)context;
+}
+tb_bool_t vm86_context_attach(vm86_context_t* context, vm86_machine_ref_t machine, tb_size_t stack_size)
+{
+    // check
+    tb_assert_and_check_return_val(context && machine && stack_size, tb_false);
+
+    // save machine
+    context->machine = machine;
+
+    // the trace is disabled by default
+    context->trace = tb_null;
+
+    // init registers
+    vm86_registers_clear(context->registers);
+
+    // init flags, the eflags register is up-to-date
+    tb_memset(&context->flags, 0, sizeof(vm86_flags_t));
+
+    // init stack
+    return vm86_stack_attach(&context->stack, stack_size, &context->registers[VM86_REGISTER_ESP].u32);
+}
+tb_void_t vm86_context_detach(vm86_context_t* context)
+{
+    // check
+    tb_assert_and_check_return(context);
+
+    // exit trace
+    if (context->trace) vm86_trace_exit(context->trace);
+    context->trace = tb_null;
+
+    // release stack
+    vm86_stack_detach(&context->stack);
+}
+tb_void_t vm86_context_exit(vm86_context_ref_t self)
+{
+    // check
+    vm86_context_t* context = (vm86_context_t*)self;
+    tb_assert_and_check_return(context);
+
+    // detach context and release its stack
+    vm86_context_detach(context);
+
+    // exit it
+    tb_align_free(context);
+}
+vm86_machine_ref_t vm86_context_machine(vm86_context_ref_t self)
+{
+    // check
+    vm86_context_t* context = (vm86_context_t*)self;
+    tb_assert_and_check_return_val(context, tb_null);
+
+    // the machine
+    return context->machine;
+}
+vm86_stack_ref_t vm86_context_stack(vm86_context_ref_t self)
+{
+    // check
+    vm86_context_t* context = (vm86_context_t*)self;
+    tb_assert_and_check_return_val(context, tb_null);
+
+    // the stack
+    return (vm86_stack_ref_t)&context->stack;
+}
+vm86_registers_ref_t vm86_context_registers(vm86_context_ref_t self)
+{
+    // check
+    vm86_context_t* context = (vm86_context_t*)self;
+    tb_assert_and_check_return_val(context, tb_null);
+
+    // the registers
+    return context->registers;
+}
+tb_uint32_t vm86_context_eflags(vm86_context_ref_t self)
+{
+    // check
+    vm86_context_t* context = (vm86_context_t*)self;
+    tb_assert_and_check_return_val(context, 0);
+
+    // compute the lazy flags and save them to the eflags register
+    return vm86_flags_eflags(&context->flags, &context->registers[VM86_REGISTER_EFLAGS].u32);
+}
+tb_bool_t vm86_context_trace_set(vm86_context_ref_t self, tb_size_t maxn)
+{
+    // check
+    vm86_context_t* context = (vm86_context_t*)self;
+    tb_assert_and_check_return_val(context, tb_false);
+
+    // exit the previous trace
+    if (context->trace) vm86_trace_exit(context->trace);
+    context->trace = tb_null;
+
+    // disable it?
+    tb_check_return_val(maxn, tb_true);
+
+    // init trace
+    context->trace = vm86_trace_init(maxn);
+
+    // ok?
+    return context->trace != tb_null;
+}
+tb_size_t vm86_context_trace_read(vm86_context_ref_t self, vm86_trace_record_t* records, tb_size_t maxn)
+{
+    // check
+    vm86_context_t* context = (vm86_context_t*)self;
+    tb_assert_and_check_return_val(context && records, 0);
+
+    // no trace?
+    tb_check_return_val(context->trace, 0);
+
+    // read records
+    return vm86_trace_read(context->trace, records, maxn);
+}
+tb_bool_t vm86_context_trace_save(vm86_context_ref_t self, tb_char_t const* path)
+{
+    // check
+    vm86_context_t* context = (vm86_context_t*)self;
+    tb_assert_and_check_return_val(context && context->trace && path, tb_false);
+
+    // save records
+    return vm86_trace_save(context->trace, path);
+}
@@ -0,0 +1,135 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * 
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        context.h
+ *
+ */
+#ifndef VM86_CONTEXT_H
+#define VM86_CONTEXT_H
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "stack.h"
+#include "register.h"
+#include "trace.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_enter__
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * interfaces
+ */
+
+/*! init context
+ *
+ * the context only holds the mutable execution state (registers and stack), 
+ * so the procs compiled by the machine can be done on many contexts at the same time.
+ *
+ * @param machine               the machine
+ * @param stack_size            the minimum stack size, only the used pages will be committed
+ *
+ * @return                      the context
+ */
+vm86_context_ref_t              vm86_context_init(vm86_machine_ref_t machine, tb_size_t stack_size);
+
+/*! exit context 
+ *
+ * @param context               the context
+ */
+tb_void_t                       vm86_context_exit(vm86_context_ref_t context);
+
+/*! the context machine
+ *
+ * @param context               the context
+ *
+ * @return                      the machine
+ */
+vm86_machine_ref_t              vm86_context_machine(vm86_context_ref_t context);
+
+/*! the context stack
+ *
+ * @param context               the context
+ *
+ * @return                      the stack
+ */
+vm86_stack_ref_t                vm86_context_stack(vm86_context_ref_t context);
+
+/*! the context registers
+ *
+ * @param context               the context
+ *
+ * @return                      the registers
+ */
+vm86_registers_ref_t            vm86_context_registers(vm86_context_ref_t context);
+
+/*! the context eflags
+ *
+ * the flags are evaluated lazily while executing, 
+ * this will compute them and update the eflags register.
+ *
+ * @param context               the context
+ *
+ * @return                      the eflags
+ */
+tb_uint32_t                     vm86_context_eflags(vm86_context_ref_t context);
+
+/*! enable or disable the execution trace of the context
+ *
+ * the procs done on this context will record one vm86_trace_record_t for each executed instruction
+ * into a ring buffer, only the newest records are kept. 
+ *
+ * @note the trace is switched at the proc boundary, so only call it when no proc is running on this context.
+ *
+ * @param context               the context
+ * @param maxn                  the maximum records count, it will be aligned to the power of 2, 0: disable it
+ *
+ * @return                      tb_true or tb_false
+ */
+tb_bool_t                       vm86_context_trace_set(vm86_context_ref_t context, tb_size_t maxn);
+
+/*! read the newest trace records from the oldest to the newest
+ *
+ * it can be called from the other thread while the procs are running on this context.
+ *
+ * @param context               the context
+ * @param records               the records
+ * @param maxn                  the maximum records count
+ *
+ * @return                      the records count
+ */
+tb_size_t                       vm86_context_trace_read(vm86_context_ref_t context, vm86_trace_record_t* records, tb_size_t maxn);
+
+/*! save the newest trace records to the given file, it can be decoded by vm86trace
+ *
+ * @param context               the context
+ * @param path                  the file path
+ *
+ * @return                      tb_true or tb_false
+ */
+tb_bool_t                       vm86_context_trace_save(vm86_context_ref_t context, tb_char_t const* path);
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_leave__
+
+#endif
+
+
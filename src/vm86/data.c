@@ -22,38 +22,7 @@
  * includes
  */
 #include "machine.h"
-
-/* //////////////////////////////////////////////////////////////////////////////////////
- * types
- */
-
-// the machine data chunk type
-typedef struct __vm86_data_chunk_t
-{
-    // the offset
-    tb_uint32_t                     offset;
-
-    // the size
-    tb_uint32_t                     size;
-
-}vm86_data_chunk_t, *vm86_data_chunk_ref_t;
-
-// the machine data data type
-typedef struct __vm86_data_t
-{
-    // the data
-    tb_byte_t*                      data;
-
-    // the size
-    tb_uint32_t                     size;
-
-    // the base
-    tb_uint32_t                     base;
-
-    // the labels
-    tb_hash_map_ref_t               labels;
-
-}vm86_data_t;
+#include "impl/data.h"
 
 /* //////////////////////////////////////////////////////////////////////////////////////
  * implementation
@@ -72,17 +41,8 @@ vm86_data_ref_t vm86_data_init(tb_size_t size)
         data = tb_malloc0_type(vm86_data_t);
         tb_assert_and_check_break(data);
 
-        // make data
-        data->data = tb_malloc0_bytes(size);
-        tb_assert_and_check_break(data->data);
-
-        // init labels
-        data->labels = tb_hash_map_init(8, tb_element_str(tb_true), tb_element_mem(sizeof(vm86_data_chunk_t), tb_null, tb_null));
-        tb_assert_and_check_break(data->labels);
-
-        // init data
-        data->size  = size;
-        data->base  = 0;
+        // attach data and reserve its pages
+        if (!vm86_data_attach(data, size)) break;
     
         // ok
         ok = tb_true;
@@ -106,16 +66,61 @@ tb_void_t vm86_data_exit(vm86_data_ref_t self)
     vm86_data_t* data = (vm86_data_t*)self;
     tb_assert_and_check_return(data);
 
-    // exit data
-    if (data->data) tb_free(data->data);
-    data->data = tb_null;
+    // detach data and release its pages
+    vm86_data_detach(data);
+
+    // exit it
+    tb_free(data);
+}
+tb_bool_t vm86_data_attach(vm86_data_t* data, tb_size_t size)
+{
+    // check
+    tb_assert_and_check_return_val(data && size, tb_false);
+
+    // init labels
+    data->labels = tb_hash_map_init(8, tb_element_str(tb_true), tb_element_mem(sizeof(vm86_data_chunk_t), tb_null, tb_null));
+    tb_assert_and_check_return_val(data->labels, tb_false);
+
+    // init relocations
+    data->relocs = tb_vector_init(0, tb_element_mem(sizeof(vm86_data_reloc_t), tb_null, tb_null));
+    tb_assert_and_check_return_val(data->relocs, tb_false);
+
+    /* reserve pages
+     *
+     * the addresses of the .data are stored in the compiled instructions, so it cannot be moved,
+     * we reserve a large range and it grows in place, only the used pages will be committed.
+     */
+    size = tb_align(tb_max(size, VM86_DATA_MAXN), VM86_MEMORY_PAGE_SIZE);
+    data->data = (tb_byte_t*)vm86_memory_reserve(size);
+    tb_assert_and_check_return_val(data->data, tb_false);
+
+    // init data
+    data->size  = (tb_uint32_t)size;
+    data->base  = 0;
+
+    // ok
+    return tb_true;
+}
+tb_void_t vm86_data_detach(vm86_data_t* data)
+{
+    // check
+    tb_assert_and_check_return(data);
 
     // exit labels
     if (data->labels) tb_hash_map_exit(data->labels);
     data->labels = tb_null;
 
-    // exit it
-    tb_free(data);
+    // exit relocations
+    if (data->relocs) tb_vector_exit(data->relocs);
+    data->relocs = tb_null;
+
+    // release pages
+    if (data->data) vm86_memory_release(data->data, data->size);
+
+    // clear data
+    data->data = tb_null;
+    data->size = 0;
+    data->base = 0;
 }
 tb_bool_t vm86_data_is(vm86_data_ref_t self, tb_char_t const* name)
 {
@@ -139,14 +144,29 @@ tb_uint32_t vm86_data_get(vm86_data_ref_t self, tb_char_t const* name, tb_size_t
     // save size
     if (psize) *psize = chunk->size;
 
-    // the data offset
-    return tb_p2u32(data->data + chunk->offset);
+    // the data address
+    return vm86_memory_addr(data->data + chunk->offset);
 }
-tb_void_t vm86_data_add(vm86_data_ref_t self, tb_char_t const* name, tb_byte_t const* buff, tb_size_t size)
+tb_uint32_t vm86_data_add(vm86_data_ref_t self, tb_char_t const* name, tb_byte_t const* buff, tb_size_t size)
 {
     // check
     vm86_data_t* data = (vm86_data_t*)self;
-    tb_assert_and_check_return(data && data->labels && name);
+    tb_assert_and_check_return_val(data && data->labels && name, 0);
+
+    // the offset of the added data
+    tb_uint32_t offset = data->base;
+
+    // no enough space? the data size of the machine need be increased
+    if (data->base + size > data->size)
+    {
+        // trace
+        tb_trace_e("no enough .data space: %u + %lu > %u", data->base, size, data->size);
+        tb_assert(0);
+        return offset;
+    }
+
+    // advise the huge pages for the large table
+    if (size >= VM86_MEMORY_HUGEPAGE_SIZE) vm86_memory_hugepage(data->data + data->base, size);
 
     // get the data chunk
     vm86_data_chunk_ref_t chunk = (vm86_data_chunk_ref_t)tb_hash_map_get(data->labels, name);
@@ -155,35 +175,35 @@ tb_void_t vm86_data_add(vm86_data_ref_t self, tb_char_t const* name, tb_byte_t c
         // must be the last chunk
         tb_assert(chunk->offset + chunk->size == data->base);
 
-        // check
-        tb_assert(data->base + size <= data->size);
-
-        // add data
-        if (buff && size) tb_memcpy(data->data + data->base, buff, size);
-
         // update size
         chunk->size += size;
-
-        // update base
-        data->base += size;
     }
     else
     {
-        // check
-        tb_assert(data->base + size <= data->size);
-
         // init chunk
         vm86_data_chunk_t item = {data->base, size};
 
         // add chunk
         tb_hash_map_insert(data->labels, name, &item);
+    }
 
-        // add data
-        if (buff && size) tb_memcpy(data->data + data->base, buff, size);
+    // add data, the pages are committed when they are written at the first time
+    if (buff && size) tb_memcpy(data->data + data->base, buff, size);
 
-        // update base
-        data->base += size;
-    }
+    // update base
+    data->base += size;
+
+    // ok
+    return offset;
+}
+tb_void_t vm86_data_reloc_add(vm86_data_t* data, tb_uint32_t offset, tb_size_t type)
+{
+    // check
+    tb_assert_and_check_return(data && data->relocs && offset + 4 <= data->base && type != VM86_RELOC_NONE);
+
+    // add relocation
+    vm86_data_reloc_t reloc = {offset, (tb_uint32_t)type};
+    tb_vector_insert_tail(data->relocs, &reloc);
 }
 #ifdef __vm_debug__
 tb_void_t vm86_data_dump(vm86_data_ref_t self)
@@ -81,8 +81,10 @@ tb_uint32_t                 vm86_data_get(vm86_data_ref_t data, tb_char_t const*
  * @param name              the data name
  * @param buff              the data buff
  * @param size              the data size
+ *
+ * @return                  the offset of the added data
  */
-tb_void_t                   vm86_data_add(vm86_data_ref_t data, tb_char_t const* name, tb_byte_t const* buff, tb_size_t size);
+tb_uint32_t                 vm86_data_add(vm86_data_ref_t data, tb_char_t const* name, tb_byte_t const* buff, tb_size_t size);
 
 #ifdef __vm_debug__
 /*! dump data 
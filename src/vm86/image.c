@@ -0,0 +1,908 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * 
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        image.c
+ *
+ */
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * trace
+ */
+#define TB_TRACE_MODULE_NAME            "machine_image"
+#define TB_TRACE_MODULE_DEBUG           (0)
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "image.h"
+#include "machine.h"
+#include "impl/proc.h"
+#include "impl/text.h"
+#include "impl/data.h"
+#include "impl/image.h"
+#include "impl/machine.h"
+#ifdef TB_CONFIG_POSIX_HAVE_MMAP
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+// the loaded image type
+typedef struct __vm86_image_t
+{
+    // the image data
+    tb_byte_t const*                data;
+
+    // the image size
+    tb_size_t                       size;
+
+    // is mapped?
+    tb_bool_t                       mapped;
+
+    // the header
+    vm86_image_header_t const*      header;
+
+    // the strings
+    tb_char_t const*                strings;
+
+}vm86_image_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * saver implementation
+ */
+static tb_uint32_t vm86_image_save_string(tb_buffer_ref_t strings, tb_char_t const* cstr)
+{
+    // check
+    tb_assert(strings && cstr);
+
+    // the string offset
+    tb_uint32_t offset = (tb_uint32_t)tb_buffer_size(strings);
+
+    // append string with '\0'
+    tb_buffer_memncat(strings, (tb_byte_t const*)cstr, tb_strlen(cstr) + 1);
+
+    // ok
+    return offset;
+}
+static tb_bool_t vm86_image_save_value(vm86_proc_t* proc, vm86_data_t* data, tb_uint32_t value, tb_size_t reloc, tb_uint32_t* result)
+{
+    // check
+    tb_assert(proc && data && result);
+
+    // save the instruction index
+    if (reloc == VM86_RELOC_CODE)
+    {
+        tb_uint32_t base = vm86_memory_addr(proc->instructions);
+        tb_check_return_val(value >= base && value < base + proc->instructions_count * sizeof(vm86_instruction_t), tb_false);
+        *result = (value - base) / sizeof(vm86_instruction_t);
+    }
+    // save the .data offset
+    else if (reloc == VM86_RELOC_DATA)
+    {
+        tb_uint32_t base = vm86_memory_addr(data->data);
+        tb_check_return_val(value >= base && value < base + data->base, tb_false);
+        *result = value - base;
+    }
+    // save the value directly
+    else *result = value;
+
+    // ok
+    return tb_true;
+}
+static tb_bool_t vm86_image_save_proc(vm86_proc_t* proc, vm86_data_t* data, tb_buffer_ref_t image, tb_buffer_ref_t strings, tb_size_t index)
+{
+    // check
+    tb_assert(proc && data && image && strings);
+
+    // init proc
+    vm86_image_proc_t item;
+    tb_memset(&item, 0, sizeof(item));
+    item.hash_low               = (tb_uint32_t)proc->hash;
+    item.hash_high              = (tb_uint32_t)(proc->hash >> 32);
+    item.size                   = (tb_uint32_t)proc->size;
+    item.name                   = vm86_image_save_string(strings, proc->name);
+    item.instructions_count     = (tb_uint32_t)proc->instructions_count;
+    item.instructions_offset    = (tb_uint32_t)tb_buffer_size(image);
+
+    // save instructions
+    tb_size_t i = 0;
+    tb_uint32_t tables_count = 0;
+    for (i = 0; i < proc->instructions_count; i++)
+    {
+        // the instruction
+        vm86_instruction_ref_t instruction = &proc->instructions[i];
+
+        // the loader only accepts the checked instructions, e.g. the indirect jump by the register is not supported
+        if (!vm86_instruction_check(instruction))
+        {
+            // trace
+            tb_trace_e("%s: unsupported instruction in the image at %lu", proc->name, i);
+            return tb_false;
+        }
+
+        // init instruction
+        vm86_image_instruction_t inst;
+        tb_memset(&inst, 0, sizeof(inst));
+        inst.opcode     = instruction->opcode;
+        inst.r0         = instruction->r0;
+        inst.r1         = instruction->r1;
+        inst.r2         = instruction->r2;
+        inst.op         = instruction->op;
+        inst.hint[0]    = instruction->hint[0];
+        inst.hint[1]    = instruction->hint[1];
+        inst.hint[2]    = instruction->hint[2];
+        inst.flags      = VM86_IMAGE_FLAG_V0_RELOC(instruction->v0_reloc) | VM86_IMAGE_FLAG_V1_RELOC(instruction->v1_reloc) | VM86_IMAGE_FLAG_COND(instruction->cond) | VM86_IMAGE_FLAG_FUSED(instruction->fused);
+
+        // save v0
+        if (instruction->is_cstr)
+        {
+            inst.flags |= VM86_IMAGE_FLAG_CSTR;
+            inst.v0 = vm86_image_save_string(strings, instruction->v0.cstr);
+        }
+        else if (!vm86_image_save_value(proc, data, instruction->v0.u32, instruction->v0_reloc, &inst.v0)) 
+        {
+            // trace
+            tb_trace_e("%s: invalid v0 address: %#x at %lu", proc->name, instruction->v0.u32, i);
+            return tb_false;
+        }
+
+        // save the index of the dispatch table, the tables are saved after the labels
+        if (instruction->opcode == VM86_OPCODE_JXX_TABLE_R0)
+        {
+            inst.v1 = tables_count;
+            tables_count += ((tb_uint32_t const*)vm86_memory_ptr(instruction->v1.u32))[0] + 1;
+        }
+        // save v1
+        else if (!vm86_image_save_value(proc, data, instruction->v1.u32, instruction->v1_reloc, &inst.v1)) 
+        {
+            // trace
+            tb_trace_e("%s: invalid v1 address: %#x at %lu", proc->name, instruction->v1.u32, i);
+            return tb_false;
+        }
+
+        // save it
+        tb_buffer_memncat(image, (tb_byte_t const*)&inst, sizeof(inst));
+    }
+
+    // save labels
+    item.labels_offset = (tb_uint32_t)tb_buffer_size(image);
+    tb_for_all_if (tb_hash_map_item_t*, label, proc->labels, label)
+    {
+        // init label
+        vm86_image_label_t entry;
+        entry.name = vm86_image_save_string(strings, (tb_char_t const*)label->name);
+        if (!vm86_image_save_value(proc, data, tb_p2u32(label->data), VM86_RELOC_CODE, &entry.index)) return tb_false;
+
+        // save it
+        tb_buffer_memncat(image, (tb_byte_t const*)&entry, sizeof(entry));
+        item.labels_count++;
+    }
+
+    // save the dispatch tables in the order of the jumps
+    item.tables_offset  = (tb_uint32_t)tb_buffer_size(image);
+    item.tables_count   = tables_count;
+    for (i = 0; i < proc->instructions_count; i++)
+    {
+        // the jump by the table?
+        vm86_instruction_ref_t instruction = &proc->instructions[i];
+        tb_check_continue(instruction->opcode == VM86_OPCODE_JXX_TABLE_R0);
+
+        // save it
+        tb_uint32_t const* table = (tb_uint32_t const*)vm86_memory_ptr(instruction->v1.u32);
+        tb_buffer_memncat(image, (tb_byte_t const*)table, (table[0] + 1) * sizeof(tb_uint32_t));
+    }
+
+    // update proc
+    tb_buffer_memncpyp(image, sizeof(vm86_image_header_t) + index * sizeof(vm86_image_proc_t), (tb_byte_t const*)&item, sizeof(item));
+
+    // ok
+    return tb_true;
+}
+static tb_bool_t vm86_image_save_data(vm86_data_t* data, tb_vector_ref_t procs, vm86_image_header_t* header, tb_buffer_ref_t image, tb_buffer_ref_t strings)
+{
+    // check
+    tb_assert(data && data->labels && data->relocs && procs && header && image && strings);
+
+    // save chunks and sort them by offset, the chunks are contiguous in the .data
+    header->chunks_offset = (tb_uint32_t)tb_buffer_size(image);
+    tb_for_all_if (tb_hash_map_item_t*, item, data->labels, item && item->data)
+    {
+        // the chunk
+        vm86_data_chunk_ref_t chunk = (vm86_data_chunk_ref_t)item->data;
+
+        // save it
+        vm86_image_chunk_t entry;
+        entry.name      = vm86_image_save_string(strings, (tb_char_t const*)item->name);
+        entry.offset    = chunk->offset;
+        entry.size      = chunk->size;
+        tb_buffer_memncat(image, (tb_byte_t const*)&entry, sizeof(entry));
+        header->chunks_count++;
+
+        // sort it by the insertion sort
+        vm86_image_chunk_t* chunks = (vm86_image_chunk_t*)(tb_buffer_data(image) + header->chunks_offset);
+        tb_size_t i = header->chunks_count - 1;
+        while (i && chunks[i - 1].offset > entry.offset)
+        {
+            chunks[i] = chunks[i - 1];
+            i--;
+        }
+        chunks[i] = entry;
+    }
+
+    // copy the .data, we need to patch the addresses in it
+    tb_byte_t* buff = tb_null;
+    if (data->base)
+    {
+        buff = tb_malloc_bytes(data->base);
+        tb_assert_and_check_return_val(buff, tb_false);
+        tb_memcpy(buff, data->data, data->base);
+    }
+
+    // save relocations
+    tb_bool_t ok = tb_true;
+    header->relocs_offset = (tb_uint32_t)tb_buffer_size(image);
+    tb_for_all_if (vm86_data_reloc_ref_t, reloc, data->relocs, reloc && ok)
+    {
+        // the address
+        tb_uint32_t address = tb_bits_get_u32_ne(buff + reloc->offset);
+
+        // init relocation
+        vm86_image_reloc_t entry;
+        entry.offset    = reloc->offset;
+        entry.type      = reloc->type;
+        entry.proc      = 0;
+
+        // the instruction address? find the proc of it
+        ok = tb_false;
+        if (reloc->type == VM86_RELOC_CODE)
+        {
+            tb_size_t index = 0;
+            tb_for_all_if (vm86_proc_t*, proc, procs, proc && !ok)
+            {
+                // save the proc and instruction index
+                tb_uint32_t value = 0;
+                if (vm86_image_save_value(proc, data, address, VM86_RELOC_CODE, &value))
+                {
+                    tb_bits_set_u32_ne(buff + reloc->offset, value);
+                    entry.proc = (tb_uint32_t)index;
+                    ok = tb_true;
+                }
+                index++;
+            }
+        }
+        // the .data address? save the offset
+        else if (reloc->type == VM86_RELOC_DATA && address >= vm86_memory_addr(data->data) && address < vm86_memory_addr(data->data) + data->base)
+        {
+            tb_bits_set_u32_ne(buff + reloc->offset, address - vm86_memory_addr(data->data));
+            ok = tb_true;
+        }
+
+        // invalid address?
+        if (!ok)
+        {
+            // trace
+            tb_trace_e("invalid .data address: %#x at %u", address, reloc->offset);
+            break;
+        }
+
+        // save it
+        tb_buffer_memncat(image, (tb_byte_t const*)&entry, sizeof(entry));
+        header->relocs_count++;
+    }
+
+    // save the .data
+    if (ok)
+    {
+        header->data_offset = (tb_uint32_t)tb_buffer_size(image);
+        header->data_size   = data->base;
+        if (buff) tb_buffer_memncat(image, buff, data->base);
+    }
+
+    // exit buffer
+    if (buff) tb_free(buff);
+    buff = tb_null;
+
+    // ok?
+    return ok;
+}
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * loader implementation
+ */
+static tb_bool_t vm86_image_map(vm86_image_t* image, tb_char_t const* path)
+{
+    // check
+    tb_assert(image && path);
+
+#ifdef TB_CONFIG_POSIX_HAVE_MMAP
+    // open file
+    tb_int_t fd = open(path, O_RDONLY);
+    if (fd >= 0)
+    {
+        // map it, the file pages can be shared by multiple processes, the instructions are copied and relocated from them
+        struct stat st;
+        if (!fstat(fd, &st) && st.st_size > 0)
+        {
+            tb_pointer_t data = mmap(tb_null, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                image->data     = (tb_byte_t const*)data;
+                image->size     = (tb_size_t)st.st_size;
+                image->mapped   = tb_true;
+            }
+        }
+
+        // close file
+        close(fd);
+    }
+    if (image->mapped) return tb_true;
+#endif
+
+    // read the whole file
+    tb_bool_t       ok = tb_false;
+    tb_byte_t*      data = tb_null;
+    tb_file_ref_t   file = tb_file_init(path, TB_FILE_MODE_RO | TB_FILE_MODE_BINARY);
+    do
+    {
+        // check
+        tb_check_break(file);
+
+        // the file size
+        tb_size_t size = (tb_size_t)tb_file_size(file);
+        tb_check_break(size);
+
+        // make data
+        data = tb_malloc_bytes(size);
+        tb_assert_and_check_break(data);
+
+        // read data
+        tb_size_t read = 0;
+        while (read < size)
+        {
+            tb_long_t real = tb_file_read(file, data + read, size - read);
+            if (real > 0) read += real;
+            else break;
+        }
+        tb_check_break(read == size);
+
+        // save data
+        image->data = data;
+        image->size = size;
+        data = tb_null;
+
+        // ok
+        ok = tb_true;
+
+    } while (0);
+
+    // exit data
+    if (data) tb_free(data);
+    data = tb_null;
+
+    // exit file
+    if (file) tb_file_exit(file);
+    file = tb_null;
+
+    // ok?
+    return ok;
+}
+static tb_void_t vm86_image_unmap(vm86_image_t* image)
+{
+    // check
+    tb_assert(image);
+
+    // exit data
+    if (image->data)
+    {
+#ifdef TB_CONFIG_POSIX_HAVE_MMAP
+        if (image->mapped) munmap((tb_pointer_t)image->data, image->size);
+        else
+#endif
+        tb_free((tb_pointer_t)image->data);
+    }
+    tb_memset(image, 0, sizeof(vm86_image_t));
+}
+static tb_pointer_t vm86_image_section(vm86_image_t* image, tb_uint32_t offset, tb_uint32_t count, tb_size_t size)
+{
+    // check
+    tb_assert(image);
+
+    // the section is out of the image?
+    tb_check_return_val(offset <= image->size && count <= (image->size - offset) / size, tb_null);
+
+    // the section must be aligned
+    tb_check_return_val(!(offset & 3), tb_null);
+
+    // ok
+    return (tb_pointer_t)(image->data + offset);
+}
+static tb_char_t const* vm86_image_string(vm86_image_t* image, tb_uint32_t offset)
+{
+    // check
+    tb_assert(image && image->header && image->strings);
+
+    // the string is out of the strings?
+    tb_check_return_val(offset < image->header->strings_size, tb_null);
+
+    // must be end with '\0'
+    tb_check_return_val(tb_strnlen(image->strings + offset, image->header->strings_size - offset) < image->header->strings_size - offset, tb_null);
+
+    // ok
+    return image->strings + offset;
+}
+static tb_bool_t vm86_image_load_value(vm86_proc_t* proc, tb_byte_t* data, tb_uint32_t data_size, tb_uint32_t value, tb_size_t reloc, tb_uint32_t* result)
+{
+    // check
+    tb_assert(proc && data && result);
+
+    // relocate the instruction index
+    if (reloc == VM86_RELOC_CODE)
+    {
+        tb_check_return_val(value < proc->instructions_count, tb_false);
+        *result = vm86_memory_addr(proc->instructions + value);
+    }
+    // relocate the .data offset
+    else if (reloc == VM86_RELOC_DATA)
+    {
+        tb_check_return_val(value < data_size, tb_false);
+        *result = vm86_memory_addr(data + value);
+    }
+    // load the value directly
+    else if (reloc == VM86_RELOC_NONE) *result = value;
+    else return tb_false;
+
+    // ok
+    return tb_true;
+}
+static vm86_proc_t* vm86_image_load_proc(vm86_image_t* image, vm86_machine_ref_t machine, vm86_image_proc_t const* item, tb_byte_t* data, tb_uint32_t data_size)
+{
+    // check
+    tb_assert(image && machine && item && data);
+
+    // done
+    tb_bool_t       ok = tb_false;
+    vm86_proc_t*    proc = tb_null;
+    do
+    {
+        // get the name
+        tb_char_t const* name = vm86_image_string(image, item->name);
+        tb_assert_and_check_break(name && item->instructions_count);
+
+        // get the instructions and labels
+        vm86_image_instruction_t const* insts = (vm86_image_instruction_t const*)vm86_image_section(image, item->instructions_offset, item->instructions_count, sizeof(vm86_image_instruction_t));
+        vm86_image_label_t const* labels = (vm86_image_label_t const*)vm86_image_section(image, item->labels_offset, item->labels_count, sizeof(vm86_image_label_t));
+        tb_uint32_t const* tables = (tb_uint32_t const*)vm86_image_section(image, item->tables_offset, item->tables_count, sizeof(tb_uint32_t));
+        tb_assert_and_check_break(insts && labels && tables);
+
+        // make proc
+        proc = tb_malloc0_type(vm86_proc_t);
+        tb_assert_and_check_break(proc);
+
+        // init proc
+        proc->machine   = machine;
+        proc->hash      = ((tb_uint64_t)item->hash_high << 32) | item->hash_low;
+        proc->size      = item->size;
+        proc->name      = tb_strdup(name);
+        tb_assert_and_check_break(proc->name);
+
+        // init labels
+        proc->labels = tb_hash_map_init(8, tb_element_str(tb_true), tb_element_uint32());
+        tb_assert_and_check_break(proc->labels);
+
+        // init locals
+        proc->locals = tb_hash_map_init(8, tb_element_str(tb_true), tb_element_uint32());
+        tb_assert_and_check_break(proc->locals);
+
+        // make instructions
+        proc->instructions_count    = item->instructions_count;
+        proc->instructions          = vm86_memory_nalloc0_type(proc->instructions_count, vm86_instruction_t);
+        tb_assert_and_check_break(proc->instructions);
+
+        // make the dispatch tables
+        if (item->tables_count)
+        {
+            proc->tables = vm86_memory_nalloc0_type(item->tables_count, tb_uint32_t);
+            tb_assert_and_check_break(proc->tables);
+            tb_memcpy(proc->tables, tables, item->tables_count * sizeof(tb_uint32_t));
+        }
+
+        // load instructions
+        tb_size_t i = 0;
+        for (i = 0; i < proc->instructions_count; i++)
+        {
+            // the instruction
+            vm86_instruction_ref_t          instruction = &proc->instructions[i];
+            vm86_image_instruction_t const* inst = &insts[i];
+
+            // init instruction
+            instruction->opcode     = inst->opcode;
+            instruction->r0         = inst->r0;
+            instruction->r1         = inst->r1;
+            instruction->r2         = inst->r2;
+            instruction->op         = inst->op;
+            instruction->hint[0]    = inst->hint[0];
+            instruction->hint[1]    = inst->hint[1];
+            instruction->hint[2]    = inst->hint[2];
+            instruction->v0_reloc   = VM86_IMAGE_FLAG_V0_RELOC_GET(inst->flags);
+            instruction->v1_reloc   = VM86_IMAGE_FLAG_V1_RELOC_GET(inst->flags);
+            instruction->cond       = VM86_IMAGE_FLAG_COND_GET(inst->flags);
+            instruction->fused      = VM86_IMAGE_FLAG_FUSED_GET(inst->flags);
+            instruction->done       = vm86_instruction_done(inst->opcode);
+            tb_check_break(instruction->done);
+
+            // check the instructions of the superinstruction
+            tb_check_break(i + instruction->fused <= proc->instructions_count);
+
+            // load v0
+            if (inst->flags & VM86_IMAGE_FLAG_CSTR)
+            {
+                tb_char_t const* cstr = vm86_image_string(image, inst->v0);
+                tb_check_break(cstr);
+
+                instruction->is_cstr = 1;
+                instruction->v0.cstr = tb_strdup(cstr);
+                tb_assert_and_check_break(instruction->v0.cstr);
+            }
+            else if (!vm86_image_load_value(proc, data, data_size, inst->v0, instruction->v0_reloc, &instruction->v0.u32)) break;
+
+            // load v1
+            if (!vm86_image_load_value(proc, data, data_size, inst->v1, instruction->v1_reloc, &instruction->v1.u32)) break;
+
+            // check the registers and the jump targets, the image may be crafted
+            tb_check_break(vm86_instruction_check(instruction));
+
+            // load the dispatch table of the jump, the table must be loaded with it and all entries must be in this proc
+            if (instruction->opcode == VM86_OPCODE_JXX_TABLE_R0)
+            {
+                tb_uint32_t index = instruction->v1.u32;
+                tb_check_break(instruction->v1_reloc == VM86_RELOC_NONE && index < item->tables_count);
+
+                tb_uint32_t const*  table = proc->tables + index;
+                tb_uint32_t         j = 0;
+                tb_check_break(table[0] && table[0] < item->tables_count - index);
+                for (j = 1; j <= table[0]; j++)
+                {
+                    tb_sint64_t target = (tb_sint64_t)i + (tb_sint32_t)table[j];
+                    tb_check_break(target >= 0 && target < (tb_sint64_t)proc->instructions_count);
+                }
+                tb_check_break(j > table[0]);
+
+                instruction->v1.u32 = vm86_memory_addr(table);
+            }
+
+            // relink the function slot of this machine
+            if (instruction->is_cstr)
+            {
+                tb_size_t slot = vm86_machine_function_slot((vm86_machine_t*)machine, instruction->v0.cstr);
+                tb_assert_and_check_break(slot != (tb_size_t)-1);
+                instruction->v1.u32 = (tb_uint32_t)slot;
+            }
+        }
+        tb_check_break(i == proc->instructions_count);
+
+        // count the loaded superinstructions
+        proc->fusions = vm86_instruction_fuse(proc->instructions, proc->instructions_count);
+
+        // load labels
+        for (i = 0; i < item->labels_count; i++)
+        {
+            // the label name
+            tb_char_t const* label = vm86_image_string(image, labels[i].name);
+            tb_check_break(label);
+
+            // the label address
+            tb_uint32_t address = 0;
+            if (!vm86_image_load_value(proc, data, data_size, labels[i].index, VM86_RELOC_CODE, &address)) break;
+
+            // save label
+            tb_hash_map_insert(proc->labels, label, tb_u2p(address));
+        }
+        tb_check_break(i == item->labels_count);
+
+        // ok
+        ok = tb_true;
+
+    } while (0);
+
+    // failed?
+    if (!ok)
+    {
+        // exit it
+        if (proc) vm86_proc_exit((vm86_proc_ref_t)proc);
+        proc = tb_null;
+    }
+
+    // ok?
+    return proc;
+}
+static tb_bool_t vm86_image_load_data(vm86_image_t* image, vm86_data_t* data, tb_vector_ref_t procs)
+{
+    // check
+    tb_assert(image && image->header && data && procs);
+
+    // the header
+    vm86_image_header_t const* header = image->header;
+
+    // get the chunks, relocations and data
+    vm86_image_chunk_t const* chunks = (vm86_image_chunk_t const*)vm86_image_section(image, header->chunks_offset, header->chunks_count, sizeof(vm86_image_chunk_t));
+    vm86_image_reloc_t const* relocs = (vm86_image_reloc_t const*)vm86_image_section(image, header->relocs_offset, header->relocs_count, sizeof(vm86_image_reloc_t));
+    tb_byte_t const* buff = (tb_byte_t const*)vm86_image_section(image, header->data_offset, header->data_size, 1);
+    tb_assert_and_check_return_val(chunks && relocs && buff, tb_false);
+
+    // the .data base of the image
+    tb_uint32_t base = data->base;
+
+    // check the chunks, they must be contiguous and not exist in the .data
+    tb_size_t i = 0;
+    tb_uint32_t offset = 0;
+    for (i = 0; i < header->chunks_count; i++)
+    {
+        tb_char_t const* name = vm86_image_string(image, chunks[i].name);
+        tb_check_break(name && chunks[i].offset == offset && !vm86_data_is((vm86_data_ref_t)data, name));
+        offset += chunks[i].size;
+    }
+    tb_check_return_val(i == header->chunks_count && offset == header->data_size, tb_false);
+
+    // check the relocations
+    for (i = 0; i < header->relocs_count; i++)
+    {
+        vm86_image_reloc_t const* reloc = &relocs[i];
+        tb_check_break(reloc->offset + 4 <= header->data_size);
+        tb_check_break(reloc->type != VM86_RELOC_CODE || reloc->proc < tb_vector_size(procs));
+        tb_check_break(reloc->type == VM86_RELOC_CODE || reloc->type == VM86_RELOC_DATA);
+    }
+    tb_check_return_val(i == header->relocs_count, tb_false);
+
+    // no enough space?
+    if (base + header->data_size > data->size)
+    {
+        // trace
+        tb_trace_e("no enough .data space: %u + %u > %u", base, header->data_size, data->size);
+        return tb_false;
+    }
+
+    // add chunks
+    for (i = 0; i < header->chunks_count; i++)
+        vm86_data_add((vm86_data_ref_t)data, vm86_image_string(image, chunks[i].name), buff + chunks[i].offset, chunks[i].size);
+
+    // relocate addresses
+    for (i = 0; i < header->relocs_count; i++)
+    {
+        // the relocation
+        vm86_image_reloc_t const* reloc = &relocs[i];
+
+        // the address
+        tb_byte_t*  p = data->data + base + reloc->offset;
+        tb_uint32_t value = tb_bits_get_u32_ne(p);
+        tb_uint32_t address = 0;
+
+        // relocate it
+        vm86_proc_t* proc = (vm86_proc_t*)tb_iterator_item(procs, reloc->proc);
+        if (!vm86_image_load_value(proc, data->data + base, header->data_size, value, reloc->type, &address)) 
+        {
+            // trace
+            tb_trace_e("invalid .data address: %#x at %u", value, reloc->offset);
+            return tb_false;
+        }
+        tb_bits_set_u32_ne(p, address);
+
+        // save relocation
+        vm86_data_reloc_add(data, base + reloc->offset, reloc->type);
+    }
+
+    // ok
+    return tb_true;
+}
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * implementation
+ */
+tb_bool_t vm86_image_save(vm86_machine_ref_t machine, tb_char_t const* path)
+{
+    // check
+    tb_assert_and_check_return_val(machine && path, tb_false);
+
+    // the text and data
+    vm86_text_t* text = (vm86_text_t*)vm86_machine_text(machine);
+    vm86_data_t* data = (vm86_data_t*)vm86_machine_data(machine);
+    tb_assert_and_check_return_val(text && text->procs && data, tb_false);
+
+    // done
+    tb_bool_t       ok = tb_false;
+    tb_file_ref_t   file = tb_null;
+    tb_vector_ref_t procs = tb_null;
+    tb_buffer_t     image;
+    tb_buffer_t     strings;
+    tb_buffer_init(&image);
+    tb_buffer_init(&strings);
+    do
+    {
+        // init procs, we need the proc index
+        procs = tb_vector_init(0, tb_element_ptr(tb_null, tb_null));
+        tb_assert_and_check_break(procs);
+
+        // save procs
+        tb_for_all_if (tb_hash_map_item_t*, item, text->procs, item && item->data)
+        {
+            tb_vector_insert_tail(procs, item->data);
+        }
+
+        // init header
+        vm86_image_header_t header;
+        tb_memset(&header, 0, sizeof(header));
+        header.magic        = VM86_IMAGE_MAGIC;
+        header.version      = VM86_IMAGE_VERSION;
+        header.procs_offset = sizeof(vm86_image_header_t);
+        header.procs_count  = (tb_uint32_t)tb_vector_size(procs);
+
+        // reserve the header and procs
+        tb_buffer_memnsetp(&image, 0, 0, header.procs_offset + header.procs_count * sizeof(vm86_image_proc_t));
+
+        // save procs
+        tb_size_t index = 0;
+        tb_for_all_if (vm86_proc_t*, proc, procs, proc)
+        {
+            if (!vm86_image_save_proc(proc, data, &image, &strings, index)) break;
+            index++;
+        }
+        tb_check_break(index == header.procs_count);
+
+        // save the .data
+        if (!vm86_image_save_data(data, procs, &header, &image, &strings)) break;
+
+        // save strings
+        header.strings_offset   = (tb_uint32_t)tb_align4(tb_buffer_size(&image));
+        header.strings_size     = (tb_uint32_t)tb_buffer_size(&strings);
+        tb_buffer_memnsetp(&image, tb_buffer_size(&image), 0, header.strings_offset - tb_buffer_size(&image));
+        tb_buffer_memncat(&image, tb_buffer_data(&strings), tb_buffer_size(&strings));
+
+        // save header
+        tb_buffer_memncpyp(&image, 0, (tb_byte_t const*)&header, sizeof(header));
+
+        // write image
+        file = tb_file_init(path, TB_FILE_MODE_WO | TB_FILE_MODE_CREAT | TB_FILE_MODE_TRUNC | TB_FILE_MODE_BINARY);
+        tb_assert_and_check_break(file);
+
+        tb_byte_t const*    p = tb_buffer_data(&image);
+        tb_byte_t const*    e = p + tb_buffer_size(&image);
+        while (p < e)
+        {
+            tb_long_t real = tb_file_writ(file, p, e - p);
+            if (real > 0) p += real;
+            else break;
+        }
+        tb_check_break(p == e);
+
+        // trace
+        tb_trace_d("save: %s, procs: %u, data: %u, size: %lu", path, header.procs_count, header.data_size, tb_buffer_size(&image));
+
+        // ok
+        ok = tb_true;
+
+    } while (0);
+
+    // exit file
+    if (file) tb_file_exit(file);
+    file = tb_null;
+
+    // exit procs
+    if (procs) tb_vector_exit(procs);
+    procs = tb_null;
+
+    // exit buffers
+    tb_buffer_exit(&strings);
+    tb_buffer_exit(&image);
+
+    // ok?
+    return ok;
+}
+tb_bool_t vm86_image_load(vm86_machine_ref_t machine, tb_char_t const* path)
+{
+    // check
+    tb_assert_and_check_return_val(machine && path, tb_false);
+
+    // the text and data
+    vm86_text_t* text = (vm86_text_t*)vm86_machine_text(machine);
+    vm86_data_t* data = (vm86_data_t*)vm86_machine_data(machine);
+    tb_assert_and_check_return_val(text && data && data->data, tb_false);
+
+    // done
+    tb_bool_t       ok = tb_false;
+    tb_vector_ref_t procs = tb_null;
+    vm86_image_t    image;
+    tb_memset(&image, 0, sizeof(image));
+    do
+    {
+        // map image
+        if (!vm86_image_map(&image, path)) 
+        {
+            // trace
+            tb_trace_e("cannot open image: %s", path);
+            break;
+        }
+
+        // get header
+        vm86_image_header_t const* header = (vm86_image_header_t const*)vm86_image_section(&image, 0, 1, sizeof(vm86_image_header_t));
+        tb_check_break(header);
+        image.header = header;
+
+        // check header
+        if (header->magic != VM86_IMAGE_MAGIC || header->version != VM86_IMAGE_VERSION)
+        {
+            // trace
+            tb_trace_e("invalid image: %s, magic: %#x, version: %u", path, header->magic, header->version);
+            break;
+        }
+
+        // get procs and strings
+        vm86_image_proc_t const* items = (vm86_image_proc_t const*)vm86_image_section(&image, header->procs_offset, header->procs_count, sizeof(vm86_image_proc_t));
+        image.strings = (tb_char_t const*)vm86_image_section(&image, header->strings_offset, header->strings_size, 1);
+        tb_check_break(items && image.strings);
+
+        // init procs
+        procs = tb_vector_init(0, tb_element_ptr(tb_null, tb_null));
+        tb_assert_and_check_break(procs);
+
+        // load procs, the .data will be placed at the current base
+        tb_size_t i = 0;
+        for (i = 0; i < header->procs_count; i++)
+        {
+            vm86_proc_t* proc = vm86_image_load_proc(&image, machine, &items[i], data->data + data->base, header->data_size);
+            tb_check_break(proc);
+            tb_vector_insert_tail(procs, proc);
+        }
+        tb_check_break(i == header->procs_count);
+
+        // load the .data
+        if (!vm86_image_load_data(&image, data, procs)) break;
+
+        // save procs to the text, the text will own them
+        tb_for_all_if (vm86_proc_t*, proc, procs, proc)
+        {
+            vm86_text_insert(text, (vm86_proc_ref_t)proc, tb_null, proc->size);
+        }
+        tb_vector_clear(procs);
+
+        // trace
+        tb_trace_d("load: %s, procs: %u, data: %u", path, header->procs_count, header->data_size);
+
+        // ok
+        ok = tb_true;
+
+    } while (0);
+
+    // exit procs if failed
+    if (procs)
+    {
+        tb_for_all_if (vm86_proc_t*, proc, procs, proc)
+        {
+            vm86_proc_exit((vm86_proc_ref_t)proc);
+        }
+        tb_vector_exit(procs);
+    }
+    procs = tb_null;
+
+    // unmap image
+    vm86_image_unmap(&image);
+
+    // ok?
+    return ok;
+}
@@ -0,0 +1,74 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * 
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        image.h
+ *
+ */
+#ifndef VM86_IMAGE_H
+#define VM86_IMAGE_H
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "prefix.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_enter__
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * interfaces
+ */
+
+/*! save all compiled procs and the .data of the machine to the image file
+ *
+ * the image contains the compiled instructions, the labels, the .data chunks 
+ * and the relocations of all addresses, so it can be loaded without parsing the code.
+ *
+ * the proc with the indirect jump by the register (e.g. jmp eax) cannot be saved, because the loader cannot check its target.
+ *
+ * @param machine           the machine
+ * @param path              the image file path
+ *
+ * @return                  tb_true or tb_false
+ */
+tb_bool_t                   vm86_image_save(vm86_machine_ref_t machine, tb_char_t const* path);
+
+/*! load the image file to the machine
+ *
+ * the image file will be mapped (or read if mmap is not supported), 
+ * the .data will be appended to the machine .data and all addresses will be relocated.
+ *
+ * the instructions are checked and copied to the guest space of this process to be relocated,
+ * so only the mapped file pages are shared by the processes, not the loaded instructions.
+ *
+ * @note the .data names in the image must not exist in the machine
+ *
+ * @param machine           the machine
+ * @param path              the image file path
+ *
+ * @return                  tb_true or tb_false
+ */
+tb_bool_t                   vm86_image_load(vm86_machine_ref_t machine, tb_char_t const* path);
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_leave__
+
+#endif
@@ -0,0 +1,88 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * 
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        context.h
+ *
+ */
+#ifndef VM86_IMPL_CONTEXT_H
+#define VM86_IMPL_CONTEXT_H
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "../context.h"
+#include "stack.h"
+#include "flags.h"
+#include "trace.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_enter__
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+// the machine context type
+typedef struct __vm86_context_t
+{
+    // the registers
+    vm86_registers_t        registers;
+
+    // the stack
+    vm86_stack_t            stack;
+
+    // the lazy flags of the eflags register
+    vm86_flags_t            flags;
+
+    // the machine
+    vm86_machine_ref_t      machine;
+
+    // the trace ring, null if the tracing is disabled
+    vm86_trace_t*           trace;
+
+}vm86_context_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * interfaces
+ */
+
+/* attach the context and reserve its stack
+ *
+ * @param context           the context
+ * @param machine           the machine
+ * @param stack_size        the minimum stack size
+ *
+ * @return                  tb_true or tb_false
+ */
+tb_bool_t                   vm86_context_attach(vm86_context_t* context, vm86_machine_ref_t machine, tb_size_t stack_size);
+
+/* detach the context and release its stack
+ *
+ * @param context           the context
+ */
+tb_void_t                   vm86_context_detach(vm86_context_t* context);
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_leave__
+
+#endif
+
+
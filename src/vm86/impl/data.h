@@ -0,0 +1,132 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * 
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        data.h
+ *
+ */
+#ifndef VM86_IMPL_DATA_H
+#define VM86_IMPL_DATA_H
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "../data.h"
+#include "../memory.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * macros
+ */
+
+/* the reserved size of the .data
+ *
+ * only the virtual range is reserved and the pages are committed when they are used,
+ * the given data size will be used if it is larger than it.
+ */
+#ifdef __vm_small__
+#   define VM86_DATA_MAXN                   (1 << 20)
+#elif TB_CPU_BIT64
+#   define VM86_DATA_MAXN                   (1 << 26)
+#else
+#   define VM86_DATA_MAXN                   (1 << 24)
+#endif
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_enter__
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+// the machine data chunk type
+typedef struct __vm86_data_chunk_t
+{
+    // the offset
+    tb_uint32_t                     offset;
+
+    // the size
+    tb_uint32_t                     size;
+
+}vm86_data_chunk_t, *vm86_data_chunk_ref_t;
+
+// the machine data relocation type
+typedef struct __vm86_data_reloc_t
+{
+    // the offset of the address in the data
+    tb_uint32_t                     offset;
+
+    // the relocation type, vm86_reloc_e
+    tb_uint32_t                     type;
+
+}vm86_data_reloc_t, *vm86_data_reloc_ref_t;
+
+// the machine data type
+typedef struct __vm86_data_t
+{
+    // the data
+    tb_byte_t*                      data;
+
+    // the reserved size
+    tb_uint32_t                     size;
+
+    // the base
+    tb_uint32_t                     base;
+
+    // the labels
+    tb_hash_map_ref_t               labels;
+
+    // the relocations of the addresses stored in the data
+    tb_vector_ref_t                 relocs;
+
+}vm86_data_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * interfaces
+ */
+
+/* attach the data and reserve its pages
+ *
+ * @param data              the data
+ * @param size              the minimum data size
+ *
+ * @return                  tb_true or tb_false
+ */
+tb_bool_t                   vm86_data_attach(vm86_data_t* data, tb_size_t size);
+
+/* detach the data and release its pages
+ *
+ * @param data              the data
+ */
+tb_void_t                   vm86_data_detach(vm86_data_t* data);
+
+/* add the relocation of the address stored in the data
+ *
+ * @param data              the data
+ * @param offset            the offset of the address in the data
+ * @param type              the relocation type, vm86_reloc_e
+ */
+tb_void_t                   vm86_data_reloc_add(vm86_data_t* data, tb_uint32_t offset, tb_size_t type);
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_leave__
+
+#endif
+
+
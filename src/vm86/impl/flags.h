@@ -0,0 +1,299 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * 
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        flags.h
+ *
+ */
+#ifndef VM86_IMPL_FLAGS_H
+#define VM86_IMPL_FLAGS_H
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "../prefix.h"
+#include "../register.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * macros
+ */
+
+// the arithmetic flags of eflags
+#define VM86_FLAGS_MASK     (VM86_REGISTER_EFLAG_CF | VM86_REGISTER_EFLAG_PF | VM86_REGISTER_EFLAG_AF | VM86_REGISTER_EFLAG_ZF | VM86_REGISTER_EFLAG_SF | VM86_REGISTER_EFLAG_OF)
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_enter__
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+// the flags operation enum, the last operation which has written the flags
+typedef enum __vm86_flags_op_e
+{
+    VM86_FLAGS_OP_NONE      = 0     //!< the eflags register is up-to-date
+,   VM86_FLAGS_OP_ADD       = 1     //!< add
+,   VM86_FLAGS_OP_SUB       = 2     //!< sub, cmp
+,   VM86_FLAGS_OP_LOGIC     = 3     //!< and, or, xor
+,   VM86_FLAGS_OP_SHL       = 4     //!< shl, src: count
+,   VM86_FLAGS_OP_SHR       = 5     //!< shr, src: count
+,   VM86_FLAGS_OP_SAR       = 6     //!< sar, src: count
+,   VM86_FLAGS_OP_SHRD      = 7     //!< shrd, src: count
+,   VM86_FLAGS_OP_MUL       = 8     //!< mul, imul, src: is overflow?
+
+}vm86_flags_op_e;
+
+// the condition code enum, the same as the tttn encoding of the x86 jcc
+typedef enum __vm86_flags_cond_e
+{
+    VM86_FLAGS_COND_O       = 0     //!< jo
+,   VM86_FLAGS_COND_NO      = 1     //!< jno
+,   VM86_FLAGS_COND_B       = 2     //!< jb, jc, jnae
+,   VM86_FLAGS_COND_NB      = 3     //!< jnb, jnc, jae
+,   VM86_FLAGS_COND_Z       = 4     //!< jz, je
+,   VM86_FLAGS_COND_NZ      = 5     //!< jnz, jne
+,   VM86_FLAGS_COND_BE      = 6     //!< jbe, jna
+,   VM86_FLAGS_COND_A       = 7     //!< ja, jnbe
+,   VM86_FLAGS_COND_S       = 8     //!< js
+,   VM86_FLAGS_COND_NS      = 9     //!< jns
+,   VM86_FLAGS_COND_P       = 10    //!< jp, jpe
+,   VM86_FLAGS_COND_NP      = 11    //!< jnp, jpo
+,   VM86_FLAGS_COND_L       = 12    //!< jl, jnge
+,   VM86_FLAGS_COND_GE      = 13    //!< jge, jnl
+,   VM86_FLAGS_COND_LE      = 14    //!< jle, jng
+,   VM86_FLAGS_COND_G       = 15    //!< jg, jnle
+,   VM86_FLAGS_COND_ALWAYS  = 16    //!< jmp
+
+}vm86_flags_cond_e;
+
+/* the lazy flags type
+ *
+ * only record the last flags operation and its operands and result,
+ * the eflags will be computed when it is read (jxx, call host function, ...)
+ */
+typedef struct __vm86_flags_t
+{
+    // the operation, vm86_flags_op_e
+    tb_uint32_t             op;
+
+    // the operand bits: 8, 16 or 32
+    tb_uint32_t             bits;
+
+    // the destination operand
+    tb_uint32_t             dst;
+
+    // the source operand
+    tb_uint32_t             src;
+
+    // the result
+    tb_uint32_t             result;
+
+}vm86_flags_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * inlines
+ */
+
+/* the sign-extended value of the given bits
+ *
+ * @param value             the value
+ * @param bits              the value bits
+ *
+ * @return                  the signed value
+ */
+static __tb_inline__ tb_sint32_t vm86_flags_sext(tb_uint32_t value, tb_uint32_t bits)
+{
+    return bits < 32? ((tb_sint32_t)(value << (32 - bits)) >> (32 - bits)) : (tb_sint32_t)value;
+}
+
+/* record the flags operation
+ *
+ * @param flags             the flags
+ * @param op                the operation
+ * @param bits              the operand bits
+ * @param dst               the destination operand
+ * @param src               the source operand
+ * @param result            the result
+ */
+static __tb_inline__ tb_void_t vm86_flags_set(vm86_flags_t* flags, tb_uint32_t op, tb_uint32_t bits, tb_uint32_t dst, tb_uint32_t src, tb_uint32_t result)
+{
+    flags->op       = op;
+    flags->bits     = bits;
+    flags->dst      = dst;
+    flags->src      = src;
+    flags->result   = result;
+}
+
+/* compute the arithmetic flags of the last operation
+ *
+ * @param flags             the flags, it must be not VM86_FLAGS_OP_NONE
+ *
+ * @return                  the arithmetic flags of eflags
+ */
+static __tb_inline__ tb_uint32_t vm86_flags_compute(vm86_flags_t const* flags)
+{
+    // the operands
+    tb_uint32_t bits    = flags->bits;
+    tb_uint32_t mask    = bits < 32? ((1u << bits) - 1) : 0xffffffff;
+    tb_uint32_t sign    = 1 << (bits - 1);
+    tb_uint32_t dst     = flags->dst & mask;
+    tb_uint32_t src     = flags->src;
+    tb_uint32_t result  = flags->result & mask;
+
+    // compute zf, sf and pf from the result, pf: the low byte has an even number of set bits
+    tb_uint32_t eflags = 0;
+    if (!result) eflags |= VM86_REGISTER_EFLAG_ZF;
+    if (result & sign) eflags |= VM86_REGISTER_EFLAG_SF;
+    if (!((0x6996 >> ((result ^ (result >> 4)) & 0xf)) & 1)) eflags |= VM86_REGISTER_EFLAG_PF;
+
+    // compute cf, of and af from the operation
+    switch (flags->op)
+    {
+    case VM86_FLAGS_OP_ADD:
+        src &= mask;
+        if (result < dst) eflags |= VM86_REGISTER_EFLAG_CF;
+        if ((dst ^ result) & (src ^ result) & sign) eflags |= VM86_REGISTER_EFLAG_OF;
+        if ((dst ^ src ^ result) & 0x10) eflags |= VM86_REGISTER_EFLAG_AF;
+        break;
+    case VM86_FLAGS_OP_SUB:
+        src &= mask;
+        if (dst < src) eflags |= VM86_REGISTER_EFLAG_CF;
+        if ((dst ^ src) & (dst ^ result) & sign) eflags |= VM86_REGISTER_EFLAG_OF;
+        if ((dst ^ src ^ result) & 0x10) eflags |= VM86_REGISTER_EFLAG_AF;
+        break;
+    case VM86_FLAGS_OP_SHL:
+        // cf: the last bit shifted out, of: msb(result) ^ cf (only defined if count == 1)
+        if (src <= bits && ((dst >> (bits - src)) & 1)) eflags |= VM86_REGISTER_EFLAG_CF;
+        if (!(eflags & VM86_REGISTER_EFLAG_CF) != !(result & sign)) eflags |= VM86_REGISTER_EFLAG_OF;
+        break;
+    case VM86_FLAGS_OP_SHR:
+        // cf: the last bit shifted out, of: msb(dst)
+        if (src <= bits && ((dst >> (src - 1)) & 1)) eflags |= VM86_REGISTER_EFLAG_CF;
+        if (dst & sign) eflags |= VM86_REGISTER_EFLAG_OF;
+        break;
+    case VM86_FLAGS_OP_SAR:
+        // cf: the last bit shifted out, of: 0
+        if ((vm86_flags_sext(dst, bits) >> (src < bits? src - 1 : bits - 1)) & 1) eflags |= VM86_REGISTER_EFLAG_CF;
+        break;
+    case VM86_FLAGS_OP_SHRD:
+        // cf: the last bit shifted out, of: the sign is changed
+        if ((dst >> (src - 1)) & 1) eflags |= VM86_REGISTER_EFLAG_CF;
+        if ((dst ^ result) & sign) eflags |= VM86_REGISTER_EFLAG_OF;
+        break;
+    case VM86_FLAGS_OP_MUL:
+        // cf and of: the high part of the result is significant
+        if (src) eflags |= VM86_REGISTER_EFLAG_CF | VM86_REGISTER_EFLAG_OF;
+        break;
+    default:
+        // logic: cf = of = 0
+        break;
+    }
+
+    // ok
+    return eflags;
+}
+
+/* get the eflags, compute it from the last operation if be not up-to-date
+ *
+ * @param flags             the flags
+ * @param eflags            the eflags register
+ *
+ * @return                  the eflags
+ */
+static __tb_inline__ tb_uint32_t vm86_flags_eflags(vm86_flags_t* flags, tb_uint32_t* eflags)
+{
+    // compute it and save it to the eflags register
+    if (flags->op != VM86_FLAGS_OP_NONE)
+    {
+        *eflags = (*eflags & ~VM86_FLAGS_MASK) | vm86_flags_compute(flags);
+        flags->op = VM86_FLAGS_OP_NONE;
+    }
+
+    // ok
+    return *eflags;
+}
+
+/* test the condition code
+ *
+ * @param flags             the flags
+ * @param eflags            the eflags register
+ * @param cond              the condition code
+ *
+ * @return                  tb_true or tb_false
+ */
+static __tb_inline_force__ tb_bool_t vm86_flags_cond(vm86_flags_t* flags, tb_uint32_t* eflags, tb_size_t cond)
+{
+    // jmp?
+    if (cond == VM86_FLAGS_COND_ALWAYS) return tb_true;
+
+    // compare the operands of cmp or sub directly, most of the conditional jumps are after them
+    if (flags->op == VM86_FLAGS_OP_SUB)
+    {
+        tb_uint32_t bits    = flags->bits;
+        tb_uint32_t mask    = bits < 32? ((1u << bits) - 1) : 0xffffffff;
+        tb_uint32_t dst     = flags->dst & mask;
+        tb_uint32_t src     = flags->src & mask;
+        switch (cond)
+        {
+        case VM86_FLAGS_COND_B:     return dst < src;
+        case VM86_FLAGS_COND_NB:    return dst >= src;
+        case VM86_FLAGS_COND_Z:     return dst == src;
+        case VM86_FLAGS_COND_NZ:    return dst != src;
+        case VM86_FLAGS_COND_BE:    return dst <= src;
+        case VM86_FLAGS_COND_A:     return dst > src;
+        case VM86_FLAGS_COND_L:     return vm86_flags_sext(dst, bits) < vm86_flags_sext(src, bits);
+        case VM86_FLAGS_COND_GE:    return vm86_flags_sext(dst, bits) >= vm86_flags_sext(src, bits);
+        case VM86_FLAGS_COND_LE:    return vm86_flags_sext(dst, bits) <= vm86_flags_sext(src, bits);
+        case VM86_FLAGS_COND_G:     return vm86_flags_sext(dst, bits) > vm86_flags_sext(src, bits);
+        default:                    break;
+        }
+    }
+
+    // get the eflags
+    tb_uint32_t e   = vm86_flags_eflags(flags, eflags);
+    tb_bool_t   cf  = !!(e & VM86_REGISTER_EFLAG_CF);
+    tb_bool_t   zf  = !!(e & VM86_REGISTER_EFLAG_ZF);
+    tb_bool_t   sf  = !!(e & VM86_REGISTER_EFLAG_SF);
+    tb_bool_t   of  = !!(e & VM86_REGISTER_EFLAG_OF);
+    tb_bool_t   pf  = !!(e & VM86_REGISTER_EFLAG_PF);
+
+    // test it, the odd condition code is the negation of the even one
+    tb_bool_t ok = tb_false;
+    switch (cond >> 1)
+    {
+    case 0: ok = of;                    break;
+    case 1: ok = cf;                    break;
+    case 2: ok = zf;                    break;
+    case 3: ok = cf || zf;              break;
+    case 4: ok = sf;                    break;
+    case 5: ok = pf;                    break;
+    case 6: ok = sf != of;              break;
+    case 7: ok = zf || (sf != of);      break;
+    default:
+        tb_assert(0);
+        break;
+    }
+    return (cond & 1)? !ok : ok;
+}
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_leave__
+
+#endif
@@ -0,0 +1,222 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * 
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        hash.h
+ *
+ */
+#ifndef VM86_IMPL_HASH_H
+#define VM86_IMPL_HASH_H
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "../prefix.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * macros
+ */
+
+// the fnv-1a 64bits offset basis
+#define VM86_HASH_FNV64_OFFSET          (0xcbf29ce484222325ULL)
+
+// the fnv-1a 64bits prime
+#define VM86_HASH_FNV64_PRIME           (0x100000001b3ULL)
+
+// the slots bits of the perfect hash
+#define VM86_HASH_PERFECT_BITS          (10)
+
+// the maximum keys count of the perfect hash
+#define VM86_HASH_PERFECT_MAXN          (255)
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+/* the perfect hash type of the short names, e.g. the mnemonics and the registers
+ *
+ * the name of at most 8 chars is packed to a 64bits key and the key is mapped to the slot by a multiplier,
+ * the multiplier is searched when it is made so that no two keys share the same slot,
+ * so the lookup is only one multiplication and one comparison.
+ */
+typedef struct __vm86_hash_perfect_t
+{
+    // the multiplier
+    tb_uint64_t             mul;
+
+    // the keys count
+    tb_size_t               count;
+
+    // the keys
+    tb_uint64_t             keys[VM86_HASH_PERFECT_MAXN];
+
+    // the key index + 1 of each slot, 0: empty
+    tb_uint8_t              slots[1 << VM86_HASH_PERFECT_BITS];
+
+}vm86_hash_perfect_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_enter__
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * inlines
+ */
+
+/* update the fnv-1a 64bits hash
+ *
+ * @param hash              the previous hash, starts from VM86_HASH_FNV64_OFFSET
+ * @param data              the data
+ * @param size              the data size
+ *
+ * @return                  the new hash
+ */
+static __tb_inline__ tb_uint64_t vm86_hash_fnv64_update(tb_uint64_t hash, tb_byte_t const* data, tb_size_t size)
+{
+    // done
+    tb_byte_t const* e = data + size;
+    while (data < e)
+    {
+        hash ^= *data++;
+        hash *= VM86_HASH_FNV64_PRIME;
+    }
+
+    // ok
+    return hash;
+}
+
+/* make the fnv-1a 64bits hash
+ *
+ * @param data              the data
+ * @param size              the data size
+ *
+ * @return                  the hash
+ */
+static __tb_inline__ tb_uint64_t vm86_hash_fnv64(tb_byte_t const* data, tb_size_t size)
+{
+    return vm86_hash_fnv64_update(VM86_HASH_FNV64_OFFSET, data, size);
+}
+
+/* pack the short name to the case-insensitive key of the perfect hash
+ *
+ * @param name              the name
+ * @param size              the name size
+ *
+ * @return                  the key, return 0 if the name is empty or longer than 8 chars
+ */
+static __tb_inline__ tb_uint64_t vm86_hash_perfect_key(tb_char_t const* name, tb_size_t size)
+{
+    // check
+    tb_check_return_val(size && size <= 8, 0);
+
+    // pack the lower chars
+    tb_size_t   i = 0;
+    tb_uint64_t key = 0;
+    for (i = 0; i < size; i++) key |= (tb_uint64_t)(tb_byte_t)tb_tolower(name[i]) << (i << 3);
+
+    // ok
+    return key;
+}
+
+/* add the key to the perfect hash before making it
+ *
+ * @param hash              the hash
+ * @param key               the key
+ *
+ * @return                  the key index, return -1 if failed
+ */
+static __tb_inline__ tb_size_t vm86_hash_perfect_add(vm86_hash_perfect_t* hash, tb_uint64_t key)
+{
+    // check
+    tb_assert_and_check_return_val(hash && key, (tb_size_t)-1);
+
+    // exists?
+    tb_size_t i = 0;
+    for (i = 0; i < hash->count; i++)
+        if (hash->keys[i] == key) return i;
+
+    // add it
+    tb_assert_and_check_return_val(hash->count < VM86_HASH_PERFECT_MAXN, (tb_size_t)-1);
+    hash->keys[hash->count] = key;
+    return hash->count++;
+}
+
+/* make the perfect hash of the added keys
+ *
+ * the multipliers are tried in a fixed order, so the slots are the same for the same keys.
+ *
+ * @param hash              the hash
+ *
+ * @return                  tb_true or tb_false
+ */
+static __tb_inline__ tb_bool_t vm86_hash_perfect_make(vm86_hash_perfect_t* hash)
+{
+    // check
+    tb_assert_and_check_return_val(hash && hash->count, tb_false);
+
+    // try the multipliers
+    tb_size_t   tries = 0;
+    tb_uint64_t mul = 0x9e3779b97f4a7c15ULL;
+    for (tries = 0; tries < 4096; tries++)
+    {
+        // place the keys
+        tb_size_t i = 0;
+        tb_memset(hash->slots, 0, sizeof(hash->slots));
+        for (i = 0; i < hash->count; i++)
+        {
+            tb_size_t slot = (tb_size_t)((hash->keys[i] * mul) >> (64 - VM86_HASH_PERFECT_BITS));
+            if (hash->slots[slot]) break;
+            hash->slots[slot] = (tb_uint8_t)(i + 1);
+        }
+
+        // no collision? ok
+        if (i == hash->count)
+        {
+            hash->mul = mul;
+            return tb_true;
+        }
+
+        // the next odd multiplier
+        mul = (mul * 6364136223846793005ULL + 1442695040888963407ULL) | 1;
+    }
+
+    // failed
+    return tb_false;
+}
+
+/* find the key index in the perfect hash
+ *
+ * @param hash              the hash
+ * @param key               the key
+ *
+ * @return                  the key index, return -1 if not found
+ */
+static __tb_inline__ tb_size_t vm86_hash_perfect_find(vm86_hash_perfect_t const* hash, tb_uint64_t key)
+{
+    // the key index + 1 of the slot
+    tb_size_t index = hash->slots[(tb_size_t)((key * hash->mul) >> (64 - VM86_HASH_PERFECT_BITS))];
+
+    // the slot may be taken by the other key
+    return (index && hash->keys[index - 1] == key)? index - 1 : (tb_size_t)-1;
+}
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_leave__
+
+#endif
@@ -0,0 +1,216 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * 
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        image.h
+ *
+ */
+#ifndef VM86_IMPL_IMAGE_H
+#define VM86_IMPL_IMAGE_H
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "../prefix.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * macros
+ */
+
+// the image magic: "vm86"
+#define VM86_IMAGE_MAGIC                (0x36386d76)
+
+// the image version, increase it if the image format or the opcodes are changed
+#define VM86_IMAGE_VERSION              (6)
+
+// the instruction flag: is cstr?
+#define VM86_IMAGE_FLAG_CSTR            (1 << 0)
+
+// the instruction flag: the relocation type of v0 and v1
+#define VM86_IMAGE_FLAG_V0_RELOC(t)     (((t) & 3) << 1)
+#define VM86_IMAGE_FLAG_V1_RELOC(t)     (((t) & 3) << 3)
+#define VM86_IMAGE_FLAG_V0_RELOC_GET(f) (((f) >> 1) & 3)
+#define VM86_IMAGE_FLAG_V1_RELOC_GET(f) (((f) >> 3) & 3)
+
+// the instruction flag: the condition code of jxx
+#define VM86_IMAGE_FLAG_COND(c)         (((c) & 0x1f) << 5)
+#define VM86_IMAGE_FLAG_COND_GET(f)     (((f) >> 5) & 0x1f)
+
+// the instruction flag: the instructions count of the superinstruction
+#define VM86_IMAGE_FLAG_FUSED(n)        (((n) & 0xff) << 10)
+#define VM86_IMAGE_FLAG_FUSED_GET(f)    (((f) >> 10) & 0xff)
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_enter__
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+/* the image header type
+ *
+ * all offsets are relative to the image head and all names are the offsets in the strings section,
+ * the addresses are stored as the instruction index (VM86_RELOC_CODE) or the .data offset (VM86_RELOC_DATA)
+ * and will be relocated when loading.
+ *
+ * layout:
+ *
+ * header
+ * procs:           vm86_image_proc_t[procs_count]
+ * instructions:    vm86_image_instruction_t[...]
+ * labels:          vm86_image_label_t[...]
+ * tables:          tb_uint32_t[...], the dispatch tables of the jxx_table_r0 instructions
+ * chunks:          vm86_image_chunk_t[chunks_count], sorted by offset
+ * relocs:          vm86_image_reloc_t[relocs_count]
+ * data:            tb_byte_t[data_size]
+ * strings:         tb_char_t[strings_size]
+ */
+typedef struct __vm86_image_header_t
+{
+    // the magic
+    tb_uint32_t                     magic;
+
+    // the version
+    tb_uint32_t                     version;
+
+    // the procs
+    tb_uint32_t                     procs_offset;
+    tb_uint32_t                     procs_count;
+
+    // the .data chunks
+    tb_uint32_t                     chunks_offset;
+    tb_uint32_t                     chunks_count;
+
+    // the .data relocations
+    tb_uint32_t                     relocs_offset;
+    tb_uint32_t                     relocs_count;
+
+    // the .data
+    tb_uint32_t                     data_offset;
+    tb_uint32_t                     data_size;
+
+    // the strings
+    tb_uint32_t                     strings_offset;
+    tb_uint32_t                     strings_size;
+
+}vm86_image_header_t;
+
+// the image proc type
+typedef struct __vm86_image_proc_t
+{
+    // the hash of the proc code
+    tb_uint32_t                     hash_low;
+    tb_uint32_t                     hash_high;
+
+    // the size of the proc code
+    tb_uint32_t                     size;
+
+    // the name
+    tb_uint32_t                     name;
+
+    // the instructions
+    tb_uint32_t                     instructions_offset;
+    tb_uint32_t                     instructions_count;
+
+    // the labels
+    tb_uint32_t                     labels_offset;
+    tb_uint32_t                     labels_count;
+
+    /* the dispatch tables, the entries count and the instruction offsets relative to the jump of each table,
+     * v1 of the jxx_table_r0 instruction is the index of its table in them
+     */
+    tb_uint32_t                     tables_offset;
+    tb_uint32_t                     tables_count;
+
+}vm86_image_proc_t;
+
+// the image instruction type
+typedef struct __vm86_image_instruction_t
+{
+    // the opcode
+    tb_uint8_t                      opcode;
+
+    // the registers
+    tb_uint8_t                      r0;
+    tb_uint8_t                      r1;
+    tb_uint8_t                      r2;
+
+    // the op
+    tb_char_t                       op;
+
+    // the hint
+    tb_char_t                       hint[3];
+
+    // the flags
+    tb_uint32_t                     flags;
+
+    // the values, the string offset of v0 if it is cstr
+    tb_uint32_t                     v0;
+    tb_uint32_t                     v1;
+
+}vm86_image_instruction_t;
+
+// the image label type
+typedef struct __vm86_image_label_t
+{
+    // the name
+    tb_uint32_t                     name;
+
+    // the instruction index
+    tb_uint32_t                     index;
+
+}vm86_image_label_t;
+
+// the image .data chunk type
+typedef struct __vm86_image_chunk_t
+{
+    // the name
+    tb_uint32_t                     name;
+
+    // the offset
+    tb_uint32_t                     offset;
+
+    // the size
+    tb_uint32_t                     size;
+
+}vm86_image_chunk_t;
+
+/* the image .data relocation type
+ *
+ * the address at the offset is the instruction index of the given proc (VM86_RELOC_CODE)
+ * or the .data offset (VM86_RELOC_DATA).
+ */
+typedef struct __vm86_image_reloc_t
+{
+    // the offset of the address in the .data
+    tb_uint32_t                     offset;
+
+    // the relocation type, vm86_reloc_e
+    tb_uint32_t                     type;
+
+    // the proc index if it is code address
+    tb_uint32_t                     proc;
+
+}vm86_image_reloc_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_leave__
+
+#endif
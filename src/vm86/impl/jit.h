@@ -0,0 +1,97 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * 
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        jit.h
+ *
+ */
+#ifndef VM86_IMPL_JIT_H
+#define VM86_IMPL_JIT_H
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "../prefix.h"
+#include "../instruction.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * macros
+ */
+
+// the default executions count of the proc before switching to the jit tier
+#define VM86_JIT_THRESHOLD              (16)
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_enter__
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+/* the jit code type
+ *
+ * the native x86-64 code translated from the compiled instructions of a proc,
+ * it returns the instruction to continue in the interpreter or tb_null if the proc is finished.
+ */
+typedef struct __vm86_jit_t
+{
+    // the native code, its indirect jump table and the native jump tables, executable and read-only
+    tb_byte_t*                  code;
+
+    // the mapped size
+    tb_size_t                   size;
+
+}vm86_jit_t, *vm86_jit_ref_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * interfaces
+ */
+
+/* translate the instructions to the native code
+ *
+ * the guest registers are mapped to the host registers and the guest eflags are kept in the host eflags,
+ * because the host executes the same x86 operations, and the host functions are called through a trampoline.
+ *
+ * @param instructions      the instructions of the proc
+ * @param count             the instructions count
+ *
+ * @return                  the jit code, return tb_null if there are unsupported instructions
+ */
+vm86_jit_ref_t              vm86_jit_init(vm86_instruction_ref_t instructions, tb_size_t count);
+
+/* exit the jit code
+ *
+ * @param jit               the jit code
+ */
+tb_void_t                   vm86_jit_exit(vm86_jit_ref_t jit);
+
+/* execute the jit code
+ *
+ * @param jit               the jit code
+ * @param context           the execution context
+ *
+ * @return                  the instruction to continue in the interpreter, return tb_null if it is finished
+ */
+vm86_instruction_ref_t      vm86_jit_done(vm86_jit_ref_t jit, vm86_context_ref_t context);
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_leave__
+
+#endif
@@ -0,0 +1,139 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * 
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        machine.h
+ *
+ */
+#ifndef VM86_IMPL_MACHINE_H
+#define VM86_IMPL_MACHINE_H
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "../machine.h"
+#include "context.h"
+#include "data.h"
+#include "snapshot.h"
+#include "jit.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * macros
+ */
+
+// the slots count of each chunk of the function table
+#define VM86_MACHINE_FUNCS_CHUNK            (256)
+
+// the chunks maxn of the function table
+#define VM86_MACHINE_FUNCS_CHUNK_MAXN       (256)
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_enter__
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+/* the machine machine type
+ *
+ * the stack data of the default context and the data buffer are reserved in the guest space,
+ * and their pages are committed when they are used.
+ */
+typedef struct __vm86_machine_t
+{
+    // the default context
+    vm86_context_t          context;
+
+    // the data
+    vm86_data_t             data;
+
+    // the snapshot of the default context and the data
+    vm86_snapshot_t         snapshot;
+
+    // the text
+    vm86_text_ref_t         text;
+
+    // the function slots, name => slot index
+    tb_hash_map_ref_t       functions;
+
+    /* the function table, index: slot
+     *
+     * the call instruction is linked to the slot at compile time,
+     * the function will be bound to it when it is set (maybe after compiling).
+     *
+     * the slots are stored in the fixed chunks, which are never moved until the machine exits,
+     * so the executing procs read them without the lock while the other procs add the slots.
+     */
+    vm86_machine_func_t*    funcs[VM86_MACHINE_FUNCS_CHUNK_MAXN];
+
+    // the function table count
+    tb_size_t               funcs_count;
+
+    // the executions count of the proc before switching to the jit tier, 0: disabled
+    tb_size_t               jit_threshold;
+
+    // the optimizer passes of the compiled procs, vm86_proc_optimize_e
+    tb_size_t               optimize;
+
+    // the lock
+    tb_spinlock_t           lock;
+
+    // the lock of the function slots map and the chunks, the slots may be added by the procs compiled in parallel
+    tb_spinlock_t           functions_lock;
+
+}vm86_machine_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * interfaces
+ */
+
+/* get the function slot of the given name, add an unbound slot if not exists
+ *
+ * @param machine           the machine
+ * @param name              the function name
+ *
+ * @return                  the slot index, return -1 if failed
+ */
+tb_size_t                   vm86_machine_function_slot(vm86_machine_t* machine, tb_char_t const* name);
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * inlines
+ */
+
+/* get the function of the given slot
+ *
+ * @param machine           the machine
+ * @param slot              the slot index
+ *
+ * @return                  the function, return tb_null if it is not bound now
+ */
+static __tb_inline__ vm86_machine_func_t vm86_machine_function_at(vm86_machine_t* machine, tb_size_t slot)
+{
+    // check
+    tb_assert(machine && slot < machine->funcs_count);
+
+    // the function
+    return machine->funcs[slot / VM86_MACHINE_FUNCS_CHUNK][slot % VM86_MACHINE_FUNCS_CHUNK];
+}
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_leave__
+
+#endif
@@ -0,0 +1,100 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        optimizer.h
+ *
+ */
+#ifndef VM86_IMPL_OPTIMIZER_H
+#define VM86_IMPL_OPTIMIZER_H
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "../prefix.h"
+#include "../proc.h"
+#include "../instruction.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * macros
+ */
+
+// the passes count, the statistics index of the pass is its bit index in vm86_proc_optimize_e
+#define VM86_OPTIMIZER_PASSES           (4)
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_enter__
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+/* the code of the optimized proc
+ *
+ * it is optimized before linking, so the jump targets of the instructions are still the label ids,
+ * and the labels are moved to the next kept instructions if their instructions are deleted.
+ */
+typedef struct __vm86_optimizer_code_t
+{
+    // the instructions
+    vm86_instruction_ref_t      instructions;
+
+    // the source line number of each instruction
+    tb_uint32_t*                lines;
+
+    // the instructions count, it is updated after deleting the instructions
+    tb_size_t                   count;
+
+    // the instruction index of each label id
+    tb_uint32_t*                labels;
+
+    // the labels count
+    tb_size_t                   labels_count;
+
+    // the label ids whose addresses are saved to the .data, e.g. the jump tables
+    tb_uint32_t const*          taken;
+
+    // the taken labels count
+    tb_size_t                   taken_count;
+
+    // the resolved jump tables, the jxx_table_r0 instruction refers to the entries count and the label ids at v1
+    tb_uint32_t const*          tables;
+
+}vm86_optimizer_code_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * interfaces
+ */
+
+/* optimize the compiled instructions of the proc
+ *
+ * the control-flow graph is built from the labels and the jumps, the taken labels and the entry are the roots,
+ * and the indirect jumps may go to any root or leave this proc, so all registers are live at them.
+ *
+ * @param code              the code
+ * @param passes            the enabled passes, vm86_proc_optimize_e
+ * @param stats             the deleted, folded or rewritten instructions count of each pass
+ */
+tb_void_t                   vm86_optimizer_done(vm86_optimizer_code_t* code, tb_size_t passes, tb_size_t stats[VM86_OPTIMIZER_PASSES]);
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_leave__
+
+#endif
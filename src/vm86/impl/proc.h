@@ -0,0 +1,120 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * 
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        proc.h
+ *
+ */
+#ifndef VM86_IMPL_PROC_H
+#define VM86_IMPL_PROC_H
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "../proc.h"
+#include "../instruction.h"
+#include "jit.h"
+#include "optimizer.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_enter__
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+// the machine proc proc type
+typedef struct __vm86_proc_t
+{
+    // the name
+    tb_char_t*                  name;
+
+    // the hash of the proc code
+    tb_uint64_t                 hash;
+
+    // the size of the proc code
+    tb_size_t                   size;
+
+    // the labels
+    tb_hash_map_ref_t           labels;
+
+    // the locals
+    tb_hash_map_ref_t           locals;
+
+    // the machine
+    vm86_machine_ref_t          machine;
+
+    // the instructions
+    vm86_instruction_ref_t      instructions;
+
+    // the instruction count
+    tb_size_t                   instructions_count;
+
+    // the dispatch tables of the resolved jump tables, the entries count and the instruction offsets relative to the jump
+    tb_uint32_t*                tables;
+
+    // the superinstruction fusions count
+    tb_size_t                   fusions;
+
+    // the deleted or folded instructions count of each optimizer pass
+    tb_size_t                   optimized[VM86_OPTIMIZER_PASSES];
+
+#ifdef __vm_spmd__
+    // the spmd state of the batch execution, vm86_spmd_state_e, it is checked at the first batch and saved by tb_atomic_set()
+    tb_atomic_t                 spmd;
+#endif
+
+#ifdef __vm_jit__
+    // the executions count in the interpreter, it is counted by the multiple contexts
+    tb_atomic_t                 jit_count;
+
+    // the instructions cannot be translated? keep it in the interpreter
+    tb_bool_t                   jit_failed;
+
+    // the jit code (vm86_jit_ref_t), it is published by tb_atomic_set() after it has been translated
+    tb_atomic_t                 jit;
+#endif
+
+    // the source line number of each instruction, the line of "xxx proc near" is 1, it is null if loaded from the image
+    tb_uint32_t*                lines;
+
+#ifdef __vm_profile__
+    // the proc code from the line of "xxx proc near"
+    tb_char_t*                  code;
+
+    // the executions count of each instruction, it is allocated if the proc is profiled
+    tb_hize_t*                  profile_counts;
+
+    // the accumulated tsc cycles of each instruction, it is allocated if the cycles are profiled
+    tb_hize_t*                  profile_cycles;
+#endif
+
+    // the relocations of the current compiling data
+    tb_vector_ref_t             data_relocs;
+
+    // the last data name
+    tb_char_t                   last_data_name[8192];
+
+}vm86_proc_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_leave__
+
+#endif
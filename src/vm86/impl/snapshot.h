@@ -0,0 +1,122 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * 
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        snapshot.h
+ *
+ */
+#ifndef VM86_IMPL_SNAPSHOT_H
+#define VM86_IMPL_SNAPSHOT_H
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "../prefix.h"
+#include "context.h"
+#include "data.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_enter__
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+/* the machine snapshot type
+ *
+ * the used .data pages and the used stack pages (from the page of esp to the stack top) are captured.
+ *
+ * on linux, the captured pages are saved to a memory file and mapped back as the private copy-on-write pages,
+ * so the kernel tracks the dirty pages for us and restoring only drops the pages modified by the last run.
+ *
+ * otherwise, the captured pages are copied and restoring only copies back the pages which are different.
+ */
+typedef struct __vm86_snapshot_t
+{
+    // the registers
+    vm86_registers_t        registers;
+
+    // the lazy flags
+    vm86_flags_t            flags;
+
+    // the captured .data pages
+    tb_byte_t*              data;
+    tb_size_t               data_size;
+
+    // the .data base when capturing
+    tb_uint32_t             data_base;
+
+    // the captured stack pages
+    tb_byte_t*              stack;
+    tb_size_t               stack_size;
+
+    // the memory file of the copy-on-write pages, -1 if it is not used
+    tb_int_t                fd;
+
+    // the copies of the captured pages if the memory file is not used
+    tb_byte_t*              pages;
+
+    // is captured?
+    tb_bool_t               captured;
+
+}vm86_snapshot_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * interfaces
+ */
+
+/* init the snapshot
+ *
+ * @param snapshot          the snapshot
+ */
+tb_void_t                   vm86_snapshot_init(vm86_snapshot_t* snapshot);
+
+/* capture the registers, the stack and the .data
+ *
+ * the previous snapshot will be replaced
+ *
+ * @param snapshot          the snapshot
+ * @param context           the context
+ * @param data              the data
+ *
+ * @return                  tb_true or tb_false
+ */
+tb_bool_t                   vm86_snapshot_capture(vm86_snapshot_t* snapshot, vm86_context_t* context, vm86_data_t* data);
+
+/* restore the registers, the stack and the .data
+ *
+ * @param snapshot          the snapshot
+ * @param context           the context
+ * @param data              the data
+ *
+ * @return                  tb_true or tb_false
+ */
+tb_bool_t                   vm86_snapshot_restore(vm86_snapshot_t* snapshot, vm86_context_t* context, vm86_data_t* data);
+
+/* exit the snapshot, the captured pages will be turned back to the anonymous pages
+ *
+ * @param snapshot          the snapshot
+ */
+tb_void_t                   vm86_snapshot_exit(vm86_snapshot_t* snapshot);
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_leave__
+
+#endif
@@ -0,0 +1,99 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        spmd.h
+ *
+ */
+#ifndef VM86_IMPL_SPMD_H
+#define VM86_IMPL_SPMD_H
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "../prefix.h"
+#include "../proc.h"
+#include "../instruction.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * macros
+ */
+
+/* the lanes count of the spmd executor
+ *
+ * the registers of all lanes are kept in one vector for each register, 
+ * so it is 16 lanes for avx-512 and 8 lanes for avx2 (or two sse registers).
+ */
+#ifdef __AVX512F__
+#   define VM86_SPMD_LANES              (16)
+#else
+#   define VM86_SPMD_LANES              (8)
+#endif
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_enter__
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+// the spmd state of the proc
+typedef enum __vm86_spmd_state_e
+{
+    VM86_SPMD_STATE_UNKNOWN         = 0     //!< not checked
+,   VM86_SPMD_STATE_SUPPORTED       = 1     //!< only the register instructions and the direct jumps in this proc
+,   VM86_SPMD_STATE_UNSUPPORTED     = 2     //!< there are the memory, stack or call instructions, keep it scalar
+
+}vm86_spmd_state_e;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * interfaces
+ */
+
+/* check whether the instructions can be executed in the spmd lanes
+ *
+ * @param instructions      the instructions of the proc
+ * @param count             the instructions count
+ *
+ * @return                  VM86_SPMD_STATE_SUPPORTED or VM86_SPMD_STATE_UNSUPPORTED
+ */
+tb_size_t                   vm86_spmd_check(vm86_instruction_ref_t instructions, tb_size_t count);
+
+/* execute the instructions over many argument sets in the lockstep lanes
+ *
+ * all lanes start from the registers and flags of the context, the lanes at the same instruction
+ * are executed together and the diverged lanes are masked until they are at the same instruction again.
+ *
+ * the registers and flags of the last call are saved to the context after returning.
+ *
+ * @param instructions      the instructions of the proc, it must be supported by vm86_spmd_check()
+ * @param count             the instructions count
+ * @param context           the execution context
+ * @param inputs            the input values, inputs_count values for each call
+ * @param outputs           the output values, outputs_count values for each call
+ * @param n                 the calls count
+ * @param layout            the layout, it has only the register slots
+ */
+tb_void_t                   vm86_spmd_done(vm86_instruction_ref_t instructions, tb_size_t count, vm86_context_ref_t context, tb_uint32_t const* inputs, tb_uint32_t* outputs, tb_size_t n, vm86_proc_layout_t const* layout);
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_leave__
+
+#endif
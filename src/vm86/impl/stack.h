@@ -0,0 +1,135 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * 
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        stack.h
+ *
+ */
+#ifndef VM86_IMPL_STACK_H
+#define VM86_IMPL_STACK_H
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "../stack.h"
+#include "../memory.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * macros
+ */
+
+/* the reserved items of the stack
+ *
+ * only the virtual range is reserved and the pages are committed when they are used,
+ * the given stack size will be used if it is larger than it.
+ */
+#ifdef __vm_small__
+#   define VM86_STACK_MAXN                  (1 << 14)
+#else
+#   define VM86_STACK_MAXN                  (1 << 18)
+#endif
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_enter__
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+// the machine stack type
+typedef struct __vm86_stack_t
+{
+    // the data
+    tb_uint32_t*    data;
+
+    // the size
+    tb_size_t       size;
+
+    // the esp register
+    tb_uint32_t*    esp;
+
+}vm86_stack_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * interfaces
+ */
+
+/* attach the stack and reserve its pages
+ *
+ * @param stack             the stack
+ * @param size              the minimum stack size
+ * @param esp               the esp register
+ *
+ * @return                  tb_true or tb_false
+ */
+tb_bool_t                   vm86_stack_attach(vm86_stack_t* stack, tb_size_t size, tb_uint32_t* esp);
+
+/* detach the stack and release its pages
+ *
+ * @param stack             the stack
+ */
+tb_void_t                   vm86_stack_detach(vm86_stack_t* stack);
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * inlines
+ */
+
+/* push data to the stack
+ *
+ * @param stack             the stack
+ * @param data              the data
+ */
+static __tb_inline__ tb_void_t vm86_stack_push_inline(vm86_stack_t* stack, tb_uint32_t data)
+{
+    // the top
+    tb_uint32_t* top = (tb_uint32_t*)vm86_memory_ptr(*stack->esp);
+    tb_assert(top && top > stack->data);
+
+    // push it
+    *--top = data;
+
+    // update esp
+    *stack->esp = vm86_memory_addr(top);
+}
+
+/* pop data from the stack
+ *
+ * @param stack             the stack
+ * @param pdata             the data pointer, optional
+ */
+static __tb_inline__ tb_void_t vm86_stack_pop_inline(vm86_stack_t* stack, tb_uint32_t* pdata)
+{
+    // the top
+    tb_uint32_t* top = (tb_uint32_t*)vm86_memory_ptr(*stack->esp);
+    tb_assert(top && top < stack->data + stack->size);
+
+    // save data
+    if (pdata) *pdata = *top;
+
+    // pop it
+    *stack->esp = vm86_memory_addr(top + 1);
+}
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_leave__
+
+#endif
+
+
@@ -0,0 +1,81 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * 
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        text.h
+ *
+ */
+#ifndef VM86_IMPL_TEXT_H
+#define VM86_IMPL_TEXT_H
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "../text.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_enter__
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+// the machine text text type
+typedef struct __vm86_text_t
+{
+    // the machine
+    vm86_machine_ref_t      machine;
+
+    // the procs
+    tb_hash_map_ref_t       procs;
+
+    // the compile cache: code hash => vm86_text_cache_t*
+    tb_hash_map_ref_t       cache;
+
+    // the cache hits
+    tb_size_t               cache_hits;
+
+    // the cache misses
+    tb_size_t               cache_misses;
+
+}vm86_text_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * interfaces
+ */
+
+/* insert the compiled proc and cache it by the hash of its code
+ *
+ * the proc with the same name will be replaced and exited.
+ * the code is kept in the cache to be compared on hit, only the size and the proc name are compared if it is null.
+ *
+ * @param text              the text
+ * @param proc              the proc, it will be owned by the text
+ * @param code              the proc code, it is null if the proc is loaded from the image
+ * @param size              the proc code size
+ *
+ * @return                  tb_true or tb_false
+ */
+tb_bool_t                   vm86_text_insert(vm86_text_t* text, vm86_proc_ref_t proc, tb_char_t const* code, tb_size_t size);
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_leave__
+
+#endif
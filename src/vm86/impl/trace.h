@@ -0,0 +1,123 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        trace.h
+ *
+ */
+#ifndef VM86_IMPL_TRACE_H
+#define VM86_IMPL_TRACE_H
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "../prefix.h"
+#include "../trace.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_enter__
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+/* the trace ring type
+ *
+ * it is written by the context only, so the writer needs not lock and only publishes the head after writing the record,
+ * and the reader copies the newest records and drops the records which may be overwritten while copying.
+ */
+typedef struct __vm86_trace_t
+{
+    // the records
+    vm86_trace_record_t*    records;
+
+    // the records count mask, the count is the power of 2
+    tb_size_t               mask;
+
+    // the written records count
+    tb_atomic_t             head;
+
+}vm86_trace_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * interfaces
+ */
+
+/* init the trace ring
+ *
+ * @param maxn              the maximum records count, it will be aligned to the power of 2
+ *
+ * @return                  the trace ring
+ */
+vm86_trace_t*               vm86_trace_init(tb_size_t maxn);
+
+/* exit the trace ring
+ *
+ * @param trace             the trace ring
+ */
+tb_void_t                   vm86_trace_exit(vm86_trace_t* trace);
+
+/* read the newest records
+ *
+ * @param trace             the trace ring
+ * @param records           the records
+ * @param maxn              the maximum records count
+ *
+ * @return                  the records count
+ */
+tb_size_t                   vm86_trace_read(vm86_trace_t* trace, vm86_trace_record_t* records, tb_size_t maxn);
+
+/* save the newest records to the trace file
+ *
+ * @param trace             the trace ring
+ * @param path              the file path
+ *
+ * @return                  tb_true or tb_false
+ */
+tb_bool_t                   vm86_trace_save(vm86_trace_t* trace, tb_char_t const* path);
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * inline
+ */
+
+/* get the next record for writing
+ *
+ * @param trace             the trace ring
+ *
+ * @return                  the record
+ */
+static __tb_inline__ vm86_trace_record_t* vm86_trace_next(vm86_trace_t* trace)
+{
+    return &trace->records[(tb_size_t)trace->head & trace->mask];
+}
+
+/* publish the record written by vm86_trace_next()
+ *
+ * @param trace             the trace ring
+ */
+static __tb_inline__ tb_void_t vm86_trace_commit(vm86_trace_t* trace)
+{
+    tb_atomic_set(&trace->head, trace->head + 1);
+}
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_leave__
+
+#endif
@@ -30,6 +30,19 @@
 #include "machine.h"
 #include "parser.h"
 #include "instruction.h"
+#include "impl/stack.h"
+#include "impl/machine.h"
+#include "impl/hash.h"
+#if defined(__vm_profile__) && defined(TB_COMPILER_IS_MSVC)
+#   include <intrin.h>
+#endif
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * macros
+ */
+
+// the lazy flags of the context
+#define vm86_instruction_flags(context)     (&((vm86_context_t*)(context))->flags)
 
 /* //////////////////////////////////////////////////////////////////////////////////////
  * types
@@ -41,74 +54,115 @@ typedef struct __vm86_instruction_entry_t
     // the instruction name
     tb_char_t const*                name;
 
-    // done it
-    vm86_instruction_done_ref_t     done;
+    // the opcode
+    tb_uint8_t                      opcode;
 
 }vm86_instruction_entry_t, *vm86_instruction_entry_ref_t;
 
-/* //////////////////////////////////////////////////////////////////////////////////////
- * implementation
- */
-static tb_long_t vm86_instruction_comp(tb_iterator_ref_t iterator, tb_cpointer_t item, tb_cpointer_t name)
+// the machine instruction operand form type, index of g_forms
+typedef enum __vm86_instruction_form_e
 {
-    // check
-    tb_assert(item);
+    VM86_INSTRUCTION_FORM_XXX                       = 0     //!< xxx
+,   VM86_INSTRUCTION_FORM_XXX_FUNC                  = 1     //!< xxx func
+,   VM86_INSTRUCTION_FORM_XXX_R0                    = 2     //!< xxx r0
+,   VM86_INSTRUCTION_FORM_XXX_V0                    = 3     //!< xxx v0
+,   VM86_INSTRUCTION_FORM_XXX_R0_R1                 = 4     //!< xxx r0, r1
+,   VM86_INSTRUCTION_FORM_XXX_R0_R1_R2              = 5     //!< xxx r0, r1, r2
+,   VM86_INSTRUCTION_FORM_XXX_R0_V0                 = 6     //!< xxx r0, v0
+,   VM86_INSTRUCTION_FORM_XXX_R0_$R1_ADD_V0$        = 7     //!< xxx r0, [r1 + v0]
+,   VM86_INSTRUCTION_FORM_XXX_R0_$R1_ADD_R2_OP_V0$  = 8     //!< xxx r0, [r1 + r2 op v0]
+,   VM86_INSTRUCTION_FORM_XXX_V0$R0_MUL_V1$         = 9     //!< xxx v0[r0 * v1]
+,   VM86_INSTRUCTION_FORM_XXX_$R0_ADD_V0$           = 10    //!< xxx [r0 + v0]
+,   VM86_INSTRUCTION_FORM_XXX_$R0_ADD_V0$_R1        = 11    //!< xxx [r0 + v0], r1
+,   VM86_INSTRUCTION_FORM_XXX_$R0_ADD_V0$_V1        = 12    //!< xxx [r0 + v0], v1
+,   VM86_INSTRUCTION_FORM_MAXN                      = 13
 
-    // comp it
-    return tb_stricmp(((vm86_instruction_entry_ref_t)item)->name, (tb_char_t const*)name);
-}
-static vm86_instruction_done_ref_t vm86_instruction_find(tb_char_t const* name, vm86_instruction_entry_ref_t entries, tb_size_t count)
+}vm86_instruction_form_e;
+
+// the machine instruction form entries type
+typedef struct __vm86_instruction_form_t
 {
-    // init iterator
-    tb_array_iterator_t array_iterator;
-    tb_iterator_ref_t   iterator = tb_array_iterator_init_mem(&array_iterator, entries, count, sizeof(vm86_instruction_entry_t));
+    // the entries
+    vm86_instruction_entry_ref_t    entries;
 
-    // find executor by the binary search
-    tb_size_t itor = tb_binary_find_all_if(iterator, vm86_instruction_comp, name);
-    tb_assert(itor != tb_iterator_tail(iterator));
+    // the entries count
+    tb_size_t                       count;
 
-    // get the executor
-    vm86_instruction_entry_ref_t entry = (vm86_instruction_entry_ref_t)tb_iterator_item(iterator, itor);
-    tb_assert(entry && entry->done);
+}vm86_instruction_form_t;
 
-    // ok?
-    return entry->done;
-}
-static vm86_instruction_ref_t vm86_instruction_done_leave(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+// the machine instruction mnemonic type, index: the key index of the mnemonics hash
+typedef struct __vm86_instruction_mnemonic_t
 {
-    // check
-    tb_assert(instruction && machine);
+    // the opcode of each operand form, VM86_OPCODE_NONE if the form is not supported
+    tb_uint8_t                      opcodes[VM86_INSTRUCTION_FORM_MAXN];
 
-    // the stack
-    vm86_stack_ref_t stack = vm86_machine_stack(machine);
-    tb_assert(stack);
+    // the condition code of jxx, vm86_flags_cond_e
+    tb_uint8_t                      cond;
 
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+}vm86_instruction_mnemonic_t;
+
+// the machine instruction condition code entry type
+typedef struct __vm86_instruction_cond_t
+{
+    // the instruction name
+    tb_char_t const*                name;
+
+    // the condition code, vm86_flags_cond_e
+    tb_uint8_t                      cond;
+
+}vm86_instruction_cond_t, *vm86_instruction_cond_ref_t;
+
+// the machine instruction width-specialized opcodes entry type
+typedef struct __vm86_instruction_width_t
+{
+    // the generic opcode
+    tb_uint8_t                      opcode;
+
+    // the registers count
+    tb_uint8_t                      registers;
+
+    // the 8, 16 and 32-bit opcodes
+    tb_uint8_t                      opcodes[3];
+
+}vm86_instruction_width_t, *vm86_instruction_width_ref_t;
+
+// the machine instruction fused opcode entry type
+typedef struct __vm86_instruction_fused_t
+{
+    // the opcodes of the instruction pair
+    tb_uint8_t                      opcodes[2];
+
+    // the fused opcode
+    tb_uint8_t                      opcode;
+
+}vm86_instruction_fused_t, *vm86_instruction_fused_ref_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * implementation
+ */
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_leave(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
+{
+    // check
+    tb_assert(instruction && registers && stack);
 
     // mov esp, ebp
     vm86_registers_value_set(registers, VM86_REGISTER_ESP, vm86_registers_value(registers, VM86_REGISTER_EBP));
 
     // pop ebp 
     tb_uint32_t ebp = 0;
-    vm86_stack_pop(stack, &ebp);
+    vm86_stack_pop_inline(stack, &ebp);
 
     // end
     return tb_null;
 }
-static vm86_instruction_ref_t vm86_instruction_done_retn(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_retn(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the stack
-    vm86_stack_ref_t stack = vm86_machine_stack(machine);
-    tb_assert(stack);
+    tb_assert(instruction && registers && stack);
 
     // pop the return address
     tb_uint32_t retn = 0;
-    vm86_stack_pop(stack, &retn);
+    vm86_stack_pop_inline(stack, &retn);
 
     // trace
     tb_trace_d("retn(%#x)", retn);
@@ -119,42 +173,37 @@ static vm86_instruction_ref_t vm86_instruction_done_retn(vm86_instruction_ref_t
     // end
     return tb_null;
 }
-static vm86_instruction_ref_t vm86_instruction_done_call(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_call(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
+    tb_assert(instruction && registers && stack);
 
-    // get the function name
-    tb_char_t const* name = instruction->v0.cstr;
-    tb_assert(name && instruction->is_cstr);
+    // the machine
+    vm86_machine_t* machine = (vm86_machine_t*)((vm86_context_t*)context)->machine;
+    tb_assert(machine && instruction->is_cstr);
 
-    // get the function
-    vm86_machine_func_t func = vm86_machine_function(machine, name);
+    // get the function from the linked slot
+    vm86_machine_func_t func = vm86_machine_function_at(machine, instruction->v1.u32);
 
     // trace
-    tb_trace_d("call %s(%#x)", name, func);
+    tb_trace_d("call %s(%#x)", instruction->v0.cstr, func);
 
-    // check
+    // check, the function must be bound before calling it
     tb_assert(func);
 
+    // compute the lazy flags, the function may read the eflags register
+    vm86_flags_eflags(vm86_instruction_flags(context), &registers[VM86_REGISTER_EFLAGS].u32);
+
     // call the function
-    func(machine);
+    func(context);
 
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_push_r0(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_push_r0(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
-
-    // the stack
-    vm86_stack_ref_t stack = vm86_machine_stack(machine);
-    tb_assert(stack);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -163,24 +212,15 @@ static vm86_instruction_ref_t vm86_instruction_done_push_r0(vm86_instruction_ref
     tb_trace_d("push %s(%#x)", vm86_registers_cstr(instruction->r0), r0);
 
     // push r0
-    vm86_stack_push(stack, r0);
+    vm86_stack_push_inline(stack, r0);
 
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_push_v0(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_push_v0(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
-    tb_used(registers);
-
-    // the stack
-    vm86_stack_ref_t stack = vm86_machine_stack(machine);
-    tb_assert(stack);
+    tb_assert(instruction && registers && stack);
 
     // get v0
     tb_uint32_t v0 = instruction->v0.u32;
@@ -189,27 +229,19 @@ static vm86_instruction_ref_t vm86_instruction_done_push_v0(vm86_instruction_ref
     tb_trace_d("push %#x", v0);
 
     // push r0
-    vm86_stack_push(stack, v0);
+    vm86_stack_push_inline(stack, v0);
 
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_pop_r0(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_pop_r0(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
-
-    // the stack
-    vm86_stack_ref_t stack = vm86_machine_stack(machine);
-    tb_assert(stack);
+    tb_assert(instruction && registers && stack);
 
     // pop r0
     tb_uint32_t r0 = 0;
-    vm86_stack_pop(stack, &r0);
+    vm86_stack_pop_inline(stack, &r0);
 
     // set r0
     vm86_registers_value_set(registers, instruction->r0, r0);
@@ -220,14 +252,10 @@ static vm86_instruction_ref_t vm86_instruction_done_pop_r0(vm86_instruction_ref_
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_mov_r0_r1(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_mov_r0_r1(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r1
     tb_uint32_t r1 = vm86_registers_value(registers, instruction->r1);
@@ -241,14 +269,10 @@ static vm86_instruction_ref_t vm86_instruction_done_mov_r0_r1(vm86_instruction_r
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_mov_r0_v0(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_mov_r0_v0(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get v0
     tb_uint32_t v0 = instruction->v0.u32;
@@ -262,14 +286,10 @@ static vm86_instruction_ref_t vm86_instruction_done_mov_r0_v0(vm86_instruction_r
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_mov_r0_$r1_add_v0$(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_mov_r0_$r1_add_v0$(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r1
     tb_uint32_t r1 = vm86_registers_value(registers, instruction->r1);
@@ -278,7 +298,7 @@ static vm86_instruction_ref_t vm86_instruction_done_mov_r0_$r1_add_v0$(vm86_inst
     tb_uint32_t v0 = instruction->v0.u32;
 
     // set r0
-    vm86_registers_value_set(registers, instruction->r0, *((tb_uint32_t*)(r1 + v0)));
+    vm86_registers_value_set(registers, instruction->r0, *((tb_uint32_t*)vm86_memory_ptr(r1 + v0)));
 
     // trace
     tb_trace_d("mov %s, [%s(%#x) + %#x]", vm86_registers_cstr(instruction->r0), vm86_registers_cstr(instruction->r1), r1, v0);
@@ -286,14 +306,10 @@ static vm86_instruction_ref_t vm86_instruction_done_mov_r0_$r1_add_v0$(vm86_inst
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_mov_$r0_add_v0$_r1(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_mov_$r0_add_v0$_r1(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -305,7 +321,7 @@ static vm86_instruction_ref_t vm86_instruction_done_mov_$r0_add_v0$_r1(vm86_inst
     tb_uint32_t v0 = instruction->v0.u32;
 
     // set [r0 + v0] = r1
-    *((tb_uint32_t*)(r0 + v0)) = r1;
+    *((tb_uint32_t*)vm86_memory_ptr(r0 + v0)) = r1;
 
     // trace
     tb_trace_d("mov [%s(%#x) + %#x], %s(%#x)", vm86_registers_cstr(instruction->r0), r0, v0, vm86_registers_cstr(instruction->r1), r1);
@@ -313,14 +329,10 @@ static vm86_instruction_ref_t vm86_instruction_done_mov_$r0_add_v0$_r1(vm86_inst
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_mov_$r0_add_v0$_v1(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_mov_$r0_add_v0$_v1(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -332,7 +344,7 @@ static vm86_instruction_ref_t vm86_instruction_done_mov_$r0_add_v0$_v1(vm86_inst
     tb_uint32_t v1 = instruction->v1.u32;
 
     // set [r0 + v0] = v1
-    *((tb_uint32_t*)(r0 + v0)) = v1;
+    *((tb_uint32_t*)vm86_memory_ptr(r0 + v0)) = v1;
 
     // trace
     tb_trace_d("mov [%s(%#x) + %#x], %#x", vm86_registers_cstr(instruction->r0), r0, v0, v1);
@@ -340,14 +352,10 @@ static vm86_instruction_ref_t vm86_instruction_done_mov_$r0_add_v0$_v1(vm86_inst
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_movzx_r0_r1(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_movzx_r0_r1(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r1
     tb_uint32_t r1 = vm86_registers_value(registers, instruction->r1);
@@ -361,14 +369,10 @@ static vm86_instruction_ref_t vm86_instruction_done_movzx_r0_r1(vm86_instruction
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_add_r0_r1(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_add_r0_r1(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -376,8 +380,14 @@ static vm86_instruction_ref_t vm86_instruction_done_add_r0_r1(vm86_instruction_r
     // get r1
     tb_uint32_t r1 = vm86_registers_value(registers, instruction->r1);
 
+    // the result
+    tb_uint32_t result = r0 + r1;
+
     // set r0
-    vm86_registers_value_set(registers, instruction->r0, r0 + r1);
+    vm86_registers_value_set(registers, instruction->r0, result);
+
+    // update flags lazily
+    vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_ADD, vm86_registers_bits(instruction->r0), r0, r1, result);
 
     // trace
     tb_trace_d("add %s(%#x), %s(%#x)", vm86_registers_cstr(instruction->r0), r0, vm86_registers_cstr(instruction->r1), r1);
@@ -385,14 +395,10 @@ static vm86_instruction_ref_t vm86_instruction_done_add_r0_r1(vm86_instruction_r
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_add_r0_v0(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_add_r0_v0(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -400,8 +406,14 @@ static vm86_instruction_ref_t vm86_instruction_done_add_r0_v0(vm86_instruction_r
     // get v0
     tb_uint32_t v0 = instruction->v0.u32;
 
+    // the result
+    tb_uint32_t result = r0 + v0;
+
     // set r0
-    vm86_registers_value_set(registers, instruction->r0, r0 + v0);
+    vm86_registers_value_set(registers, instruction->r0, result);
+
+    // update flags lazily
+    vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_ADD, vm86_registers_bits(instruction->r0), r0, v0, result);
 
     // trace
     tb_trace_d("add %s, %#x", vm86_registers_cstr(instruction->r0), v0);
@@ -409,14 +421,10 @@ static vm86_instruction_ref_t vm86_instruction_done_add_r0_v0(vm86_instruction_r
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_add_r0_$r1_add_v0$(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_add_r0_$r1_add_v0$(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -427,8 +435,17 @@ static vm86_instruction_ref_t vm86_instruction_done_add_r0_$r1_add_v0$(vm86_inst
     // get v0
     tb_uint32_t v0 = instruction->v0.u32;
 
+    // get [r1 + v0]
+    tb_uint32_t src = *((tb_uint32_t*)vm86_memory_ptr(r1 + v0));
+
+    // the result
+    tb_uint32_t result = r0 + src;
+
     // set r0
-    vm86_registers_value_set(registers, instruction->r0, r0 + *((tb_uint32_t*)(r1 + v0)));
+    vm86_registers_value_set(registers, instruction->r0, result);
+
+    // update flags lazily
+    vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_ADD, vm86_registers_bits(instruction->r0), r0, src, result);
 
     // trace
     tb_trace_d("add %s(%#x), [%s(%#x) + %#x]", vm86_registers_cstr(instruction->r0), r0, vm86_registers_cstr(instruction->r1), r1, v0);
@@ -436,14 +453,10 @@ static vm86_instruction_ref_t vm86_instruction_done_add_r0_$r1_add_v0$(vm86_inst
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_sub_r0_r1(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_sub_r0_r1(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -451,8 +464,14 @@ static vm86_instruction_ref_t vm86_instruction_done_sub_r0_r1(vm86_instruction_r
     // get r1
     tb_uint32_t r1 = vm86_registers_value(registers, instruction->r1);
 
+    // the result
+    tb_uint32_t result = r0 - r1;
+
     // set r0
-    vm86_registers_value_set(registers, instruction->r0, r0 - r1);
+    vm86_registers_value_set(registers, instruction->r0, result);
+
+    // update flags lazily
+    vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_SUB, vm86_registers_bits(instruction->r0), r0, r1, result);
 
     // trace
     tb_trace_d("sub %s(%#x), %s(%#x)", vm86_registers_cstr(instruction->r0), r0, vm86_registers_cstr(instruction->r1), r1);
@@ -460,14 +479,10 @@ static vm86_instruction_ref_t vm86_instruction_done_sub_r0_r1(vm86_instruction_r
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_sub_r0_v0(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_sub_r0_v0(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -475,8 +490,14 @@ static vm86_instruction_ref_t vm86_instruction_done_sub_r0_v0(vm86_instruction_r
     // get v0
     tb_uint32_t v0 = instruction->v0.u32;
 
+    // the result
+    tb_uint32_t result = r0 - v0;
+
     // set r0
-    vm86_registers_value_set(registers, instruction->r0, r0 - v0);
+    vm86_registers_value_set(registers, instruction->r0, result);
+
+    // update flags lazily
+    vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_SUB, vm86_registers_bits(instruction->r0), r0, v0, result);
 
     // trace
     tb_trace_d("sub %s, %#x", vm86_registers_cstr(instruction->r0), v0);
@@ -484,14 +505,10 @@ static vm86_instruction_ref_t vm86_instruction_done_sub_r0_v0(vm86_instruction_r
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_sub_r0_$r1_add_v0$(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_sub_r0_$r1_add_v0$(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -502,8 +519,17 @@ static vm86_instruction_ref_t vm86_instruction_done_sub_r0_$r1_add_v0$(vm86_inst
     // get v0
     tb_uint32_t v0 = instruction->v0.u32;
 
+    // get [r1 + v0]
+    tb_uint32_t src = *((tb_uint32_t*)vm86_memory_ptr(r1 + v0));
+
+    // the result
+    tb_uint32_t result = r0 - src;
+
     // set r0
-    vm86_registers_value_set(registers, instruction->r0, r0 - *((tb_uint32_t*)(r1 + v0)));
+    vm86_registers_value_set(registers, instruction->r0, result);
+
+    // update flags lazily
+    vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_SUB, vm86_registers_bits(instruction->r0), r0, src, result);
 
     // trace
     tb_trace_d("sub %s(%#x), [%s(%#x) + %#x]", vm86_registers_cstr(instruction->r0), r0, vm86_registers_cstr(instruction->r1), r1, v0);
@@ -511,14 +537,10 @@ static vm86_instruction_ref_t vm86_instruction_done_sub_r0_$r1_add_v0$(vm86_inst
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_lea_r0_$r1_add_r2_op_v0$(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_lea_r0_$r1_add_r2_op_v0$(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get op
     tb_char_t op = instruction->op;
@@ -542,78 +564,17 @@ static vm86_instruction_ref_t vm86_instruction_done_lea_r0_$r1_add_r2_op_v0$(vm8
     // ok
     return instruction + 1;
 }
-static tb_bool_t vm86_instruction_done_jxx(tb_uint32_t eflags, tb_char_t h1, tb_char_t h2)
-{
-    // done
-    tb_bool_t ok = tb_false;
-    do
-    {
-        // jmp?
-        if (h1 == 'm') ok = tb_true;
-        // jz?
-        else if (h1 == 'z') ok = (eflags & VM86_REGISTER_EFLAG_ZF);
-        // jnx?
-        else if (h1 == 'n')
-        {
-            // jnb?
-            if (h2 == 'b') ok = !(eflags & VM86_REGISTER_EFLAG_CF);
-            // jnz?
-            else if (h2 == 'z') ok = !(eflags & VM86_REGISTER_EFLAG_ZF);
-            // error
-            else 
-            {
-                // abort
-                tb_assert(0);
-            }
-        }
-        // jbx?
-        else if (h1 == 'b')
-        {
-            // jbe?
-            if (h2 == 'e') ok = (eflags & VM86_REGISTER_EFLAG_ZF) || (eflags & VM86_REGISTER_EFLAG_CF);
-            // error
-            else 
-            {
-                // abort
-                tb_assert(0);
-            }
-        }
-        // jax?
-        else if (h1 == 'a')
-        {
-            // ja?
-            if (h2 == '\0') ok = !((eflags & VM86_REGISTER_EFLAG_ZF) || (eflags & VM86_REGISTER_EFLAG_CF));
-            else 
-            {
-                // abort
-                tb_assert(0);
-            }
-        }
-
-    } while (0);
-
-    // ok?
-    return ok;
-}
-static vm86_instruction_ref_t vm86_instruction_done_jxx_r0(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_jxx_r0(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the hint
-    tb_char_t h1 = tb_tolower(instruction->hint[1]);
-    tb_char_t h2 = tb_tolower(instruction->hint[2]);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // ok?
-    tb_bool_t ok = vm86_instruction_done_jxx(registers[VM86_REGISTER_EFLAGS].u32, h1, h2);
+    tb_bool_t ok = vm86_flags_cond(vm86_instruction_flags(context), &registers[VM86_REGISTER_EFLAGS].u32, instruction->cond);
     if (!ok)
     {
         // trace
-        tb_trace_d("j%c%c %s(%#x), ok: %u", h1, h2? h2 : ' ', vm86_registers_cstr(instruction->r0), vm86_registers_value(registers, instruction->r0), ok);
+        tb_trace_d("%.3s %s(%#x), ok: %u", instruction->hint, vm86_registers_cstr(instruction->r0), vm86_registers_value(registers, instruction->r0), ok);
 
         // continue
         return instruction + 1;
@@ -623,49 +584,33 @@ static vm86_instruction_ref_t vm86_instruction_done_jxx_r0(vm86_instruction_ref_
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
 
     // trace
-    tb_trace_d("j%c%c %s(%#x), ok: %u", h1, h2? h2 : ' ', vm86_registers_cstr(instruction->r0), r0, ok);
+    tb_trace_d("%.3s %s(%#x), ok: %u", instruction->hint, vm86_registers_cstr(instruction->r0), r0, ok);
 
     // goto it
-    return (vm86_instruction_ref_t)r0;
+    return (vm86_instruction_ref_t)vm86_memory_ptr(r0);
 }
-static vm86_instruction_ref_t vm86_instruction_done_jxx_v0(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_jxx_v0(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the hint
-    tb_char_t h1 = tb_tolower(instruction->hint[1]);
-    tb_char_t h2 = tb_tolower(instruction->hint[2]);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get v0
     tb_uint32_t v0 = instruction->v0.u32;
     tb_assert(v0);
 
     // ok?
-    tb_bool_t ok = vm86_instruction_done_jxx(registers[VM86_REGISTER_EFLAGS].u32, h1, h2);
+    tb_bool_t ok = vm86_flags_cond(vm86_instruction_flags(context), &registers[VM86_REGISTER_EFLAGS].u32, instruction->cond);
 
     // trace
-    tb_trace_d("j%c%c %#x, ok: %u", h1, h2? h2 : ' ', v0, ok);
+    tb_trace_d("%.3s %#x, ok: %u", instruction->hint, v0, ok);
 
     // goto the next instruction
-    return ok? (vm86_instruction_ref_t)v0 : instruction + 1;
+    return ok? (vm86_instruction_ref_t)vm86_memory_ptr(v0) : instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_jxx_v0$r0_mul_v1$(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_jxx_v0$r0_mul_v1$(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the hint
-    tb_char_t h1 = tb_tolower(instruction->hint[1]);
-    tb_char_t h2 = tb_tolower(instruction->hint[2]);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get v0
     tb_uint32_t v0 = instruction->v0.u32;
@@ -674,11 +619,11 @@ static vm86_instruction_ref_t vm86_instruction_done_jxx_v0$r0_mul_v1$(vm86_instr
     tb_uint32_t v1 = instruction->v1.u32;
 
     // ok?
-    tb_bool_t ok = vm86_instruction_done_jxx(registers[VM86_REGISTER_EFLAGS].u32, h1, h2);
+    tb_bool_t ok = vm86_flags_cond(vm86_instruction_flags(context), &registers[VM86_REGISTER_EFLAGS].u32, instruction->cond);
     if (!ok)
     {
         // trace
-        tb_trace_d("j%c%c %#x[%s(%#x) * %#x]: %#x, ok: %u", h1, h2? h2 : ' ', v0, vm86_registers_cstr(instruction->r0), vm86_registers_value(registers, instruction->r0), v1, *((tb_uint32_t*)(v0 + (vm86_registers_value(registers, instruction->r0) * v1))), ok);
+        tb_trace_d("%.3s %#x[%s(%#x) * %#x]: %#x, ok: %u", instruction->hint, v0, vm86_registers_cstr(instruction->r0), vm86_registers_value(registers, instruction->r0), v1, *((tb_uint32_t*)vm86_memory_ptr(v0 + (vm86_registers_value(registers, instruction->r0) * v1))), ok);
 
         // continue
         return instruction + 1;
@@ -688,35 +633,60 @@ static vm86_instruction_ref_t vm86_instruction_done_jxx_v0$r0_mul_v1$(vm86_instr
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
 
     // the offset
-    tb_uint32_t offset = *((tb_uint32_t*)(v0 + (r0 * v1)));
+    tb_uint32_t offset = *((tb_uint32_t*)vm86_memory_ptr(v0 + (r0 * v1)));
     tb_assert(offset);
 
     // trace
-    tb_trace_d("j%c%c %#x[%s(%#x) * %#x]: %#x, ok: %u", h1, h2? h2 : ' ', v0, vm86_registers_cstr(instruction->r0), r0, v1, offset, ok);
+    tb_trace_d("%.3s %#x[%s(%#x) * %#x]: %#x, ok: %u", instruction->hint, v0, vm86_registers_cstr(instruction->r0), r0, v1, offset, ok);
 
     // goto it
-    return (vm86_instruction_ref_t)offset;
+    return (vm86_instruction_ref_t)vm86_memory_ptr(offset);
 }
-static tb_uint32_t vm86_instruction_done_cmp(tb_uint32_t v0, tb_uint32_t v1)
+/* jxx v0[r0 * 4] with the dispatch table of v1
+ *
+ * the jump table in the .data (v0) is resolved at compile time,
+ * the dispatch table is the entries count and the instruction offsets relative to this jump.
+ */
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_jxx_table_r0(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
-    // TODO
-    // set eflags
-    tb_uint32_t eflags = 0;
-    if (v0 == v1) eflags |= VM86_REGISTER_EFLAG_ZF;
-    if (v0 < v1) eflags |= VM86_REGISTER_EFLAG_SF;
-    if (v0 < v1) eflags |= VM86_REGISTER_EFLAG_CF;
+    // check
+    tb_assert(instruction && registers && stack);
 
     // ok?
-    return eflags;
+    tb_bool_t ok = vm86_flags_cond(vm86_instruction_flags(context), &registers[VM86_REGISTER_EFLAGS].u32, instruction->cond);
+    if (!ok)
+    {
+        // trace
+        tb_trace_d("%.3s %#x[%s(%#x) * 4], ok: %u", instruction->hint, instruction->v0.u32, vm86_registers_cstr(instruction->r0), vm86_registers_value(registers, instruction->r0), ok);
+
+        // continue
+        return instruction + 1;
+    }
+
+    // get r0
+    tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
+
+    // the dispatch table
+    tb_uint32_t const* table = (tb_uint32_t const*)vm86_memory_ptr(instruction->v1.u32);
+
+    // out of the jump table? stop it
+    if (r0 >= table[0])
+    {
+        // trace
+        tb_trace_e("%.3s %#x[%s(%#x) * 4]: out of the jump table: %u", instruction->hint, instruction->v0.u32, vm86_registers_cstr(instruction->r0), r0, table[0]);
+        return tb_null;
+    }
+
+    // trace
+    tb_trace_d("%.3s %#x[%s(%#x) * 4]: %d, ok: %u", instruction->hint, instruction->v0.u32, vm86_registers_cstr(instruction->r0), r0, (tb_sint32_t)table[r0 + 1], ok);
+
+    // goto it
+    return instruction + (tb_sint32_t)table[r0 + 1];
 }
-static vm86_instruction_ref_t vm86_instruction_done_cmp_r0_r1(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_cmp_r0_r1(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -724,23 +694,19 @@ static vm86_instruction_ref_t vm86_instruction_done_cmp_r0_r1(vm86_instruction_r
     // get r1
     tb_uint32_t r1 = vm86_registers_value(registers, instruction->r1);
 
-    // compare it
-    registers[VM86_REGISTER_EFLAGS].u32 = vm86_instruction_done_cmp(r0, r1);
+    // compare it, update flags lazily
+    vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_SUB, vm86_registers_bits(instruction->r0), r0, r1, r0 - r1);
 
     // trace
-    tb_trace_d("cmp %s(%#x), %s(%#x): %#x", vm86_registers_cstr(instruction->r0), r0, vm86_registers_cstr(instruction->r1), r1, registers[VM86_REGISTER_EFLAGS].u32);
+    tb_trace_d("cmp %s(%#x), %s(%#x)", vm86_registers_cstr(instruction->r0), r0, vm86_registers_cstr(instruction->r1), r1);
 
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_cmp_r0_v0(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_cmp_r0_v0(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -748,23 +714,19 @@ static vm86_instruction_ref_t vm86_instruction_done_cmp_r0_v0(vm86_instruction_r
     // get v0
     tb_uint32_t v0 = instruction->v0.u32;
 
-    // compare it
-    registers[VM86_REGISTER_EFLAGS].u32 = vm86_instruction_done_cmp(r0, v0);
+    // compare it, update flags lazily
+    vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_SUB, vm86_registers_bits(instruction->r0), r0, v0, r0 - v0);
 
     // trace
-    tb_trace_d("cmp %s(%#x), %#x: %#x", vm86_registers_cstr(instruction->r0), r0, v0, registers[VM86_REGISTER_EFLAGS].u32);
+    tb_trace_d("cmp %s(%#x), %#x", vm86_registers_cstr(instruction->r0), r0, v0);
 
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_cmp_r0_$r1_add_v0$(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_cmp_r0_$r1_add_v0$(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -775,23 +737,22 @@ static vm86_instruction_ref_t vm86_instruction_done_cmp_r0_$r1_add_v0$(vm86_inst
     // get v0
     tb_uint32_t v0 = instruction->v0.u32;
 
-    // compare it
-    registers[VM86_REGISTER_EFLAGS].u32 = vm86_instruction_done_cmp(r0, *((tb_uint32_t*)(r1 + v0)));
+    // get [r1 + v0]
+    tb_uint32_t src = *((tb_uint32_t*)vm86_memory_ptr(r1 + v0));
+
+    // compare it, update flags lazily
+    vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_SUB, vm86_registers_bits(instruction->r0), r0, src, r0 - src);
 
     // trace
-    tb_trace_d("cmp %s(%#x), [%s(%#x), %#x]: %#x", vm86_registers_cstr(instruction->r0), r0, vm86_registers_cstr(instruction->r1), r1, v0, registers[VM86_REGISTER_EFLAGS].u32);
+    tb_trace_d("cmp %s(%#x), [%s(%#x), %#x]", vm86_registers_cstr(instruction->r0), r0, vm86_registers_cstr(instruction->r1), r1, v0);
 
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_cmp_$r0_add_v0$_r1(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_cmp_$r0_add_v0$_r1(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -802,23 +763,22 @@ static vm86_instruction_ref_t vm86_instruction_done_cmp_$r0_add_v0$_r1(vm86_inst
     // get v0
     tb_uint32_t v0 = instruction->v0.u32;
 
-    // compare it
-    registers[VM86_REGISTER_EFLAGS].u32 = vm86_instruction_done_cmp(*((tb_uint32_t*)(r0 + v0)), r1);
+    // get [r0 + v0]
+    tb_uint32_t dst = *((tb_uint32_t*)vm86_memory_ptr(r0 + v0));
+
+    // compare it, update flags lazily
+    vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_SUB, 32, dst, r1, dst - r1);
 
     // trace
-    tb_trace_d("cmp [%s(%#x), %#x], %s(%#x): %#x", vm86_registers_cstr(instruction->r0), r0, v0, vm86_registers_cstr(instruction->r1), r1, registers[VM86_REGISTER_EFLAGS].u32);
+    tb_trace_d("cmp [%s(%#x), %#x], %s(%#x)", vm86_registers_cstr(instruction->r0), r0, v0, vm86_registers_cstr(instruction->r1), r1);
 
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_cmp_$r0_add_v0$_v1(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_cmp_$r0_add_v0$_v1(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -829,23 +789,25 @@ static vm86_instruction_ref_t vm86_instruction_done_cmp_$r0_add_v0$_v1(vm86_inst
     // get v1
     tb_uint32_t v1 = instruction->v1.u32;
 
-    // compare it
-    registers[VM86_REGISTER_EFLAGS].u32 = vm86_instruction_done_cmp(*((tb_uint32_t*)(r0 + v0)), v1);
+    // get [r0 + v0]
+    tb_uint32_t dst = *((tb_uint32_t*)vm86_memory_ptr(r0 + v0));
+
+    // compare it, update flags lazily
+    vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_SUB, 32, dst, v1, dst - v1);
 
     // trace
-    tb_trace_d("cmp [%s(%#x), %#x], %#x: %#x", vm86_registers_cstr(instruction->r0), r0, v0, v1, registers[VM86_REGISTER_EFLAGS].u32);
+    tb_trace_d("cmp [%s(%#x), %#x], %#x", vm86_registers_cstr(instruction->r0), r0, v0, v1);
 
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_shrd_r0_r1_r2(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_shrd_r0_r1_r2(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
+    tb_assert(instruction && registers && stack);
 
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    // get r0
+    tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
 
     // get r1
     tb_uint32_t r1 = vm86_registers_value(registers, instruction->r1);
@@ -853,23 +815,32 @@ static vm86_instruction_ref_t vm86_instruction_done_shrd_r0_r1_r2(vm86_instructi
     // get r2
     tb_uint32_t r2 = vm86_registers_value(registers, instruction->r2);
 
-    // set r0
-    vm86_registers_value_set(registers, instruction->r0, r1 >> r2);
+    // the count, only the low 5 bits are used
+    tb_uint32_t count = r2 & 0x1f;
+
+    // the flags are not affected if the count is zero
+    if (count)
+    {
+        // shift r0 right and fill the high bits from r1
+        tb_uint32_t result = (r0 >> count) | (r1 << (32 - count));
+
+        // set r0
+        vm86_registers_value_set(registers, instruction->r0, result);
+
+        // update flags lazily
+        vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_SHRD, 32, r0, count, result);
+    }
 
     // trace
-    tb_trace_d("shrd %s, %s(%#x), %s(%#x)", vm86_registers_cstr(instruction->r0), vm86_registers_cstr(instruction->r1), r1, vm86_registers_cstr(instruction->r2), r2);
+    tb_trace_d("shrd %s(%#x), %s(%#x), %s(%#x)", vm86_registers_cstr(instruction->r0), r0, vm86_registers_cstr(instruction->r1), r1, vm86_registers_cstr(instruction->r2), r2);
 
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_shr_r0_r1(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_shr_r0_r1(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -877,8 +848,24 @@ static vm86_instruction_ref_t vm86_instruction_done_shr_r0_r1(vm86_instruction_r
     // get r1
     tb_uint32_t r1 = vm86_registers_value(registers, instruction->r1);
 
-    // set r0
-    vm86_registers_value_set(registers, instruction->r0, r0 >> r1);
+    // the count, only the low 5 bits are used
+    tb_uint32_t count = r1 & 0x1f;
+
+    // the flags are not affected if the count is zero
+    if (count)
+    {
+        // the operand bits
+        tb_uint32_t bits = vm86_registers_bits(instruction->r0);
+
+        // the result
+        tb_uint32_t result = r0 >> count;
+
+        // set r0
+        vm86_registers_value_set(registers, instruction->r0, result);
+
+        // update flags lazily
+        vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_SHR, bits, r0, count, result);
+    }
 
     // trace
     tb_trace_d("shr %s(%#x), %s(%#x)", vm86_registers_cstr(instruction->r0), r0, vm86_registers_cstr(instruction->r1), r1);
@@ -886,14 +873,10 @@ static vm86_instruction_ref_t vm86_instruction_done_shr_r0_r1(vm86_instruction_r
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_shr_r0_v0(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_shr_r0_v0(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -901,8 +884,24 @@ static vm86_instruction_ref_t vm86_instruction_done_shr_r0_v0(vm86_instruction_r
     // get v0
     tb_uint32_t v0 = instruction->v0.u32;
 
-    // set r0
-    vm86_registers_value_set(registers, instruction->r0, r0 >> v0);
+    // the count, only the low 5 bits are used
+    tb_uint32_t count = v0 & 0x1f;
+
+    // the flags are not affected if the count is zero
+    if (count)
+    {
+        // the operand bits
+        tb_uint32_t bits = vm86_registers_bits(instruction->r0);
+
+        // the result
+        tb_uint32_t result = r0 >> count;
+
+        // set r0
+        vm86_registers_value_set(registers, instruction->r0, result);
+
+        // update flags lazily
+        vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_SHR, bits, r0, count, result);
+    }
 
     // trace
     tb_trace_d("shr %s(%#x), %#x", vm86_registers_cstr(instruction->r0), r0, v0);
@@ -910,14 +909,10 @@ static vm86_instruction_ref_t vm86_instruction_done_shr_r0_v0(vm86_instruction_r
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_shl_r0_r1(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_shl_r0_r1(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -925,8 +920,24 @@ static vm86_instruction_ref_t vm86_instruction_done_shl_r0_r1(vm86_instruction_r
     // get r1
     tb_uint32_t r1 = vm86_registers_value(registers, instruction->r1);
 
-    // set r0
-    vm86_registers_value_set(registers, instruction->r0, r0 << r1);
+    // the count, only the low 5 bits are used
+    tb_uint32_t count = r1 & 0x1f;
+
+    // the flags are not affected if the count is zero
+    if (count)
+    {
+        // the operand bits
+        tb_uint32_t bits = vm86_registers_bits(instruction->r0);
+
+        // the result
+        tb_uint32_t result = r0 << count;
+
+        // set r0
+        vm86_registers_value_set(registers, instruction->r0, result);
+
+        // update flags lazily
+        vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_SHL, bits, r0, count, result);
+    }
 
     // trace
     tb_trace_d("shl %s(%#x), %s(%#x)", vm86_registers_cstr(instruction->r0), r0, vm86_registers_cstr(instruction->r1), r1);
@@ -934,14 +945,10 @@ static vm86_instruction_ref_t vm86_instruction_done_shl_r0_r1(vm86_instruction_r
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_shl_r0_v0(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_shl_r0_v0(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -949,8 +956,24 @@ static vm86_instruction_ref_t vm86_instruction_done_shl_r0_v0(vm86_instruction_r
     // get v0
     tb_uint32_t v0 = instruction->v0.u32;
 
-    // set r0
-    vm86_registers_value_set(registers, instruction->r0, r0 << v0);
+    // the count, only the low 5 bits are used
+    tb_uint32_t count = v0 & 0x1f;
+
+    // the flags are not affected if the count is zero
+    if (count)
+    {
+        // the operand bits
+        tb_uint32_t bits = vm86_registers_bits(instruction->r0);
+
+        // the result
+        tb_uint32_t result = r0 << count;
+
+        // set r0
+        vm86_registers_value_set(registers, instruction->r0, result);
+
+        // update flags lazily
+        vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_SHL, bits, r0, count, result);
+    }
 
     // trace
     tb_trace_d("shl %s(%#x), %#x", vm86_registers_cstr(instruction->r0), r0, v0);
@@ -958,14 +981,10 @@ static vm86_instruction_ref_t vm86_instruction_done_shl_r0_v0(vm86_instruction_r
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_sar_r0_r1(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_sar_r0_r1(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -973,8 +992,24 @@ static vm86_instruction_ref_t vm86_instruction_done_sar_r0_r1(vm86_instruction_r
     // get r1
     tb_uint32_t r1 = vm86_registers_value(registers, instruction->r1);
 
-    // set r0
-    vm86_registers_value_set(registers, instruction->r0, ((tb_sint32_t)r0) >> r1);
+    // the count, only the low 5 bits are used
+    tb_uint32_t count = r1 & 0x1f;
+
+    // the flags are not affected if the count is zero
+    if (count)
+    {
+        // the operand bits
+        tb_uint32_t bits = vm86_registers_bits(instruction->r0);
+
+        // the result
+        tb_uint32_t result = (tb_uint32_t)(vm86_flags_sext(r0, bits) >> count);
+
+        // set r0
+        vm86_registers_value_set(registers, instruction->r0, result);
+
+        // update flags lazily
+        vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_SAR, bits, r0, count, result);
+    }
 
     // trace
     tb_trace_d("sar %s(%#x), %s(%#x)", vm86_registers_cstr(instruction->r0), r0, vm86_registers_cstr(instruction->r1), r1);
@@ -982,14 +1017,10 @@ static vm86_instruction_ref_t vm86_instruction_done_sar_r0_r1(vm86_instruction_r
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_sar_r0_v0(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_sar_r0_v0(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -997,8 +1028,24 @@ static vm86_instruction_ref_t vm86_instruction_done_sar_r0_v0(vm86_instruction_r
     // get v0
     tb_uint32_t v0 = instruction->v0.u32;
 
-    // set r0
-    vm86_registers_value_set(registers, instruction->r0, ((tb_sint32_t)r0) >> v0);
+    // the count, only the low 5 bits are used
+    tb_uint32_t count = v0 & 0x1f;
+
+    // the flags are not affected if the count is zero
+    if (count)
+    {
+        // the operand bits
+        tb_uint32_t bits = vm86_registers_bits(instruction->r0);
+
+        // the result
+        tb_uint32_t result = (tb_uint32_t)(vm86_flags_sext(r0, bits) >> count);
+
+        // set r0
+        vm86_registers_value_set(registers, instruction->r0, result);
+
+        // update flags lazily
+        vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_SAR, bits, r0, count, result);
+    }
 
     // trace
     tb_trace_d("sar %s(%#x), %#x", vm86_registers_cstr(instruction->r0), r0, v0);
@@ -1006,14 +1053,10 @@ static vm86_instruction_ref_t vm86_instruction_done_sar_r0_v0(vm86_instruction_r
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_and_r0_r1(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_and_r0_r1(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -1021,8 +1064,14 @@ static vm86_instruction_ref_t vm86_instruction_done_and_r0_r1(vm86_instruction_r
     // get r1
     tb_uint32_t r1 = vm86_registers_value(registers, instruction->r1);
 
+    // the result
+    tb_uint32_t result = r0 & r1;
+
     // set r0
-    vm86_registers_value_set(registers, instruction->r0, r0 & r1);
+    vm86_registers_value_set(registers, instruction->r0, result);
+
+    // update flags lazily
+    vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_LOGIC, vm86_registers_bits(instruction->r0), r0, r1, result);
 
     // trace
     tb_trace_d("and %s(%#x), %s(%#x)", vm86_registers_cstr(instruction->r0), r0, vm86_registers_cstr(instruction->r1), r1);
@@ -1030,14 +1079,10 @@ static vm86_instruction_ref_t vm86_instruction_done_and_r0_r1(vm86_instruction_r
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_and_r0_v0(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_and_r0_v0(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -1045,8 +1090,14 @@ static vm86_instruction_ref_t vm86_instruction_done_and_r0_v0(vm86_instruction_r
     // get v0
     tb_uint32_t v0 = instruction->v0.u32;
 
+    // the result
+    tb_uint32_t result = r0 & v0;
+
     // set r0
-    vm86_registers_value_set(registers, instruction->r0, r0 & v0);
+    vm86_registers_value_set(registers, instruction->r0, result);
+
+    // update flags lazily
+    vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_LOGIC, vm86_registers_bits(instruction->r0), r0, v0, result);
 
     // trace
     tb_trace_d("and %s(%#x), %#x", vm86_registers_cstr(instruction->r0), r0, v0);
@@ -1054,14 +1105,10 @@ static vm86_instruction_ref_t vm86_instruction_done_and_r0_v0(vm86_instruction_r
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_and_r0_$r1_add_v0$(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_and_r0_$r1_add_v0$(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -1072,8 +1119,17 @@ static vm86_instruction_ref_t vm86_instruction_done_and_r0_$r1_add_v0$(vm86_inst
     // get v0
     tb_uint32_t v0 = instruction->v0.u32;
 
+    // get [r1 + v0]
+    tb_uint32_t src = *((tb_uint32_t*)vm86_memory_ptr(r1 + v0));
+
+    // the result
+    tb_uint32_t result = r0 & src;
+
     // set r0
-    vm86_registers_value_set(registers, instruction->r0, r0 & *((tb_uint32_t*)(r1 + v0)));
+    vm86_registers_value_set(registers, instruction->r0, result);
+
+    // update flags lazily
+    vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_LOGIC, vm86_registers_bits(instruction->r0), r0, src, result);
 
     // trace
     tb_trace_d("and %s(%#x), [%s(%#x) + %#x]", vm86_registers_cstr(instruction->r0), r0, vm86_registers_cstr(instruction->r1), r1, v0);
@@ -1081,14 +1137,10 @@ static vm86_instruction_ref_t vm86_instruction_done_and_r0_$r1_add_v0$(vm86_inst
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_xor_r0_r1(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_xor_r0_r1(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -1096,8 +1148,14 @@ static vm86_instruction_ref_t vm86_instruction_done_xor_r0_r1(vm86_instruction_r
     // get r1
     tb_uint32_t r1 = vm86_registers_value(registers, instruction->r1);
 
+    // the result
+    tb_uint32_t result = r0 ^ r1;
+
     // set r0
-    vm86_registers_value_set(registers, instruction->r0, r0 ^ r1);
+    vm86_registers_value_set(registers, instruction->r0, result);
+
+    // update flags lazily
+    vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_LOGIC, vm86_registers_bits(instruction->r0), r0, r1, result);
 
     // trace
     tb_trace_d("xor %s(%#x), %s(%#x)", vm86_registers_cstr(instruction->r0), r0, vm86_registers_cstr(instruction->r1), r1);
@@ -1105,14 +1163,10 @@ static vm86_instruction_ref_t vm86_instruction_done_xor_r0_r1(vm86_instruction_r
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_xor_r0_v0(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_xor_r0_v0(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -1120,8 +1174,14 @@ static vm86_instruction_ref_t vm86_instruction_done_xor_r0_v0(vm86_instruction_r
     // get v0
     tb_uint32_t v0 = instruction->v0.u32;
 
+    // the result
+    tb_uint32_t result = r0 ^ v0;
+
     // set r0
-    vm86_registers_value_set(registers, instruction->r0, r0 ^ v0);
+    vm86_registers_value_set(registers, instruction->r0, result);
+
+    // update flags lazily
+    vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_LOGIC, vm86_registers_bits(instruction->r0), r0, v0, result);
 
     // trace
     tb_trace_d("xor %s(%#x), %#x", vm86_registers_cstr(instruction->r0), r0, v0);
@@ -1129,14 +1189,10 @@ static vm86_instruction_ref_t vm86_instruction_done_xor_r0_v0(vm86_instruction_r
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_xor_r0_$r1_add_v0$(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_xor_r0_$r1_add_v0$(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -1147,23 +1203,28 @@ static vm86_instruction_ref_t vm86_instruction_done_xor_r0_$r1_add_v0$(vm86_inst
     // get v0
     tb_uint32_t v0 = instruction->v0.u32;
 
-    // set r0
-    vm86_registers_value_set(registers, instruction->r0, r0 ^ *((tb_uint32_t*)(r1 + v0)));
+    // get [r1 + v0]
+    tb_uint32_t src = *((tb_uint32_t*)vm86_memory_ptr(r1 + v0));
 
-    // trace
+    // the result
+    tb_uint32_t result = r0 ^ src;
+
+    // set r0
+    vm86_registers_value_set(registers, instruction->r0, result);
+
+    // update flags lazily
+    vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_LOGIC, vm86_registers_bits(instruction->r0), r0, src, result);
+
+    // trace
     tb_trace_d("xor %s(%#x), [%s(%#x) + %#x]", vm86_registers_cstr(instruction->r0), r0, vm86_registers_cstr(instruction->r1), r1, v0);
 
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_or_r0_v0(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_or_r0_v0(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -1171,8 +1232,14 @@ static vm86_instruction_ref_t vm86_instruction_done_or_r0_v0(vm86_instruction_re
     // get v0
     tb_uint32_t v0 = instruction->v0.u32;
 
+    // the result
+    tb_uint32_t result = r0 | v0;
+
     // set r0
-    vm86_registers_value_set(registers, instruction->r0, r0 | v0);
+    vm86_registers_value_set(registers, instruction->r0, result);
+
+    // update flags lazily
+    vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_LOGIC, vm86_registers_bits(instruction->r0), r0, v0, result);
 
     // trace
     tb_trace_d("or %s(%#x), %#x", vm86_registers_cstr(instruction->r0), r0, v0);
@@ -1180,14 +1247,10 @@ static vm86_instruction_ref_t vm86_instruction_done_or_r0_v0(vm86_instruction_re
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_or_r0_$r1_add_v0$(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_or_r0_$r1_add_v0$(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -1198,8 +1261,17 @@ static vm86_instruction_ref_t vm86_instruction_done_or_r0_$r1_add_v0$(vm86_instr
     // get v0
     tb_uint32_t v0 = instruction->v0.u32;
 
+    // get [r1 + v0]
+    tb_uint32_t src = *((tb_uint32_t*)vm86_memory_ptr(r1 + v0));
+
+    // the result
+    tb_uint32_t result = r0 | src;
+
     // set r0
-    vm86_registers_value_set(registers, instruction->r0, r0 | *((tb_uint32_t*)(r1 + v0)));
+    vm86_registers_value_set(registers, instruction->r0, result);
+
+    // update flags lazily
+    vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_LOGIC, vm86_registers_bits(instruction->r0), r0, src, result);
 
     // trace
     tb_trace_d("or %s(%#x), [%s(%#x) + %#x]", vm86_registers_cstr(instruction->r0), r0, vm86_registers_cstr(instruction->r1), r1, v0);
@@ -1207,14 +1279,10 @@ static vm86_instruction_ref_t vm86_instruction_done_or_r0_$r1_add_v0$(vm86_instr
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_not_r0(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_not_r0(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -1228,14 +1296,10 @@ static vm86_instruction_ref_t vm86_instruction_done_not_r0(vm86_instruction_ref_
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_mul_$r0_add_v0$(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_mul_$r0_add_v0$(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -1247,7 +1311,7 @@ static vm86_instruction_ref_t vm86_instruction_done_mul_$r0_add_v0$(vm86_instruc
     tb_uint32_t multiplicand = registers[VM86_REGISTER_EAX].u32;
 
     // the multiplier
-    tb_uint32_t multiplier = *((tb_uint32_t*)(r0 + v0));
+    tb_uint32_t multiplier = *((tb_uint32_t*)vm86_memory_ptr(r0 + v0));
 
     // the result
     tb_uint64_t result = (tb_uint64_t)multiplicand * multiplier;
@@ -1256,20 +1320,19 @@ static vm86_instruction_ref_t vm86_instruction_done_mul_$r0_add_v0$(vm86_instruc
     vm86_registers_value_set(registers, VM86_REGISTER_EAX, (tb_uint32_t)result);
     vm86_registers_value_set(registers, VM86_REGISTER_EDX, (tb_uint32_t)(result >> 32));
 
+    // update flags lazily, cf and of are set if the high part is not zero
+    vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_MUL, 32, multiplicand, (result >> 32) != 0, (tb_uint32_t)result);
+
     // trace
     tb_trace_d("mul [%s(%#x), %#x]: %u * %u = %llu", vm86_registers_cstr(instruction->r0), r0, v0, multiplicand, multiplier, result);
 
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_imul_r0_$r1_add_v0$(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_imul_r0_$r1_add_v0$(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -1284,28 +1347,27 @@ static vm86_instruction_ref_t vm86_instruction_done_imul_r0_$r1_add_v0$(vm86_ins
     tb_uint32_t multiplicand = r0;
 
     // the multiplier
-    tb_uint32_t multiplier = *((tb_uint32_t*)(r1 + v0));
+    tb_uint32_t multiplier = *((tb_uint32_t*)vm86_memory_ptr(r1 + v0));
 
-    // the result
-    tb_uint64_t result = (tb_uint64_t)multiplicand * multiplier;
+    // the result, the low part is the same as the unsigned multiplication
+    tb_sint64_t result = (tb_sint64_t)(tb_sint32_t)multiplicand * (tb_sint32_t)multiplier;
 
     // set result
     vm86_registers_value_set(registers, instruction->r0, (tb_uint32_t)result);
 
+    // update flags lazily, cf and of are set if the result is truncated
+    vm86_flags_set(vm86_instruction_flags(context), VM86_FLAGS_OP_MUL, 32, multiplicand, result != (tb_sint32_t)result, (tb_uint32_t)result);
+
     // trace
-    tb_trace_d("imul %s(%#x), [%s(%#x), %#x]: %u * %u = %llu", vm86_registers_cstr(instruction->r0), r0, vm86_registers_cstr(instruction->r1), r1, v0, multiplicand, multiplier, result);
+    tb_trace_d("imul %s(%#x), [%s(%#x), %#x]: %d * %d = %lld", vm86_registers_cstr(instruction->r0), r0, vm86_registers_cstr(instruction->r1), r1, v0, multiplicand, multiplier, result);
 
     // ok
     return instruction + 1;
 }
-static vm86_instruction_ref_t vm86_instruction_done_div_$r0_add_v0$(vm86_instruction_ref_t instruction, vm86_machine_ref_t machine)
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_div_$r0_add_v0$(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
 {
     // check
-    tb_assert(instruction && machine);
-
-    // the registers
-    vm86_registers_ref_t registers = vm86_machine_registers(machine);
-    tb_assert(registers);
+    tb_assert(instruction && registers && stack);
 
     // get r0
     tb_uint32_t r0 = vm86_registers_value(registers, instruction->r0);
@@ -1317,7 +1379,7 @@ static vm86_instruction_ref_t vm86_instruction_done_div_$r0_add_v0$(vm86_instruc
     tb_uint64_t dividend = ((tb_uint64_t)registers[VM86_REGISTER_EDX].u32 << 32) | registers[VM86_REGISTER_EAX].u32;
 
     // the divisor
-    tb_uint32_t divisor = *((tb_uint32_t*)(r0 + v0));
+    tb_uint32_t divisor = *((tb_uint32_t*)vm86_memory_ptr(r0 + v0));
 
     // the quotient
     tb_uint32_t quotient = (tb_uint32_t)(dividend / divisor);
@@ -1336,139 +1398,1081 @@ static vm86_instruction_ref_t vm86_instruction_done_div_$r0_add_v0$(vm86_instruc
     return instruction + 1;
 }
 
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * width-specialized implementation
+ */
+
+// the xxx r0, r1 executor of the given width, r0 = expr(r0, src)
+#define VM86_INSTRUCTION_EXEC_R0_R1_W(n, w, s, expr, fop, save) \
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_##n##_r0_r1_##w##s(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack) \
+{ \
+    /* check */ \
+    tb_assert(instruction && registers && stack); \
+ \
+    /* get r0 */ \
+    tb_uint32_t r0 = vm86_registers_u##w(registers, instruction->r0); \
+ \
+    /* get r1 */ \
+    tb_uint32_t src = vm86_registers_u##w(registers, instruction->r1); \
+ \
+    /* the result */ \
+    tb_uint32_t result = (expr); \
+ \
+    /* set r0 */ \
+    if (save) vm86_registers_u##w(registers, instruction->r0) = (tb_uint##w##_t)result; \
+ \
+    /* update flags lazily */ \
+    if (fop != VM86_FLAGS_OP_NONE) vm86_flags_set(vm86_instruction_flags(context), fop, w, r0, src, result); \
+ \
+    /* trace */ \
+    tb_trace_d(#n " %s(%#x), %s(%#x)", vm86_registers_cstr(instruction->r0), r0, vm86_registers_cstr(instruction->r1), src); \
+ \
+    /* ok */ \
+    return instruction + 1; \
+}
+
+// the xxx r0, v0 executor of the given width, r0 = expr(r0, src)
+#define VM86_INSTRUCTION_EXEC_R0_V0_W(n, w, s, expr, fop, save) \
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_##n##_r0_v0_##w##s(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack) \
+{ \
+    /* check */ \
+    tb_assert(instruction && registers && stack); \
+ \
+    /* get r0 */ \
+    tb_uint32_t r0 = vm86_registers_u##w(registers, instruction->r0); \
+ \
+    /* get v0 */ \
+    tb_uint32_t src = instruction->v0.u32; \
+ \
+    /* the result */ \
+    tb_uint32_t result = (expr); \
+ \
+    /* set r0 */ \
+    if (save) vm86_registers_u##w(registers, instruction->r0) = (tb_uint##w##_t)result; \
+ \
+    /* update flags lazily */ \
+    if (fop != VM86_FLAGS_OP_NONE) vm86_flags_set(vm86_instruction_flags(context), fop, w, r0, src, result); \
+ \
+    /* trace */ \
+    tb_trace_d(#n " %s(%#x), %#x", vm86_registers_cstr(instruction->r0), r0, src); \
+ \
+    /* ok */ \
+    return instruction + 1; \
+}
+
+// the shift r0, v0 executor of the given width, r0 = expr(r0, count)
+#define VM86_INSTRUCTION_EXEC_SHIFT_R0_V0_W(n, w, s, expr, fop) \
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_##n##_r0_v0_##w##s(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack) \
+{ \
+    /* check */ \
+    tb_assert(instruction && registers && stack); \
+ \
+    /* get r0 */ \
+    tb_uint32_t r0 = vm86_registers_u##w(registers, instruction->r0); \
+ \
+    /* the operand bits */ \
+    tb_uint32_t bits = w; \
+ \
+    /* the count, only the low 5 bits are used */ \
+    tb_uint32_t count = instruction->v0.u32 & 0x1f; \
+ \
+    /* the flags are not affected if the count is zero */ \
+    if (count) \
+    { \
+        /* the result */ \
+        tb_uint32_t result = (expr); \
+ \
+        /* set r0 */ \
+        vm86_registers_u##w(registers, instruction->r0) = (tb_uint##w##_t)result; \
+ \
+        /* update flags lazily */ \
+        if (fop != VM86_FLAGS_OP_NONE) vm86_flags_set(vm86_instruction_flags(context), fop, bits, r0, count, result); \
+    } \
+ \
+    /* trace */ \
+    tb_trace_d(#n " %s(%#x), %#x", vm86_registers_cstr(instruction->r0), r0, count); \
+ \
+    /* ok */ \
+    return instruction + 1; \
+}
+
+// the 8, 16 and 32-bit executors
+#define VM86_INSTRUCTION_EXEC_R0_R1(n, expr, fop, save) \
+    VM86_INSTRUCTION_EXEC_R0_R1_W(n, 8, , expr, fop, save) \
+    VM86_INSTRUCTION_EXEC_R0_R1_W(n, 16, , expr, fop, save) \
+    VM86_INSTRUCTION_EXEC_R0_R1_W(n, 32, , expr, fop, save)
+#define VM86_INSTRUCTION_EXEC_R0_V0(n, expr, fop, save) \
+    VM86_INSTRUCTION_EXEC_R0_V0_W(n, 8, , expr, fop, save) \
+    VM86_INSTRUCTION_EXEC_R0_V0_W(n, 16, , expr, fop, save) \
+    VM86_INSTRUCTION_EXEC_R0_V0_W(n, 32, , expr, fop, save)
+#define VM86_INSTRUCTION_EXEC_SHIFT_R0_V0(n, expr, fop) \
+    VM86_INSTRUCTION_EXEC_SHIFT_R0_V0_W(n, 8, , expr, fop) \
+    VM86_INSTRUCTION_EXEC_SHIFT_R0_V0_W(n, 16, , expr, fop) \
+    VM86_INSTRUCTION_EXEC_SHIFT_R0_V0_W(n, 32, , expr, fop)
+
+// the flag-free 8, 16 and 32-bit executors, the lazy flags are not recorded
+#define VM86_INSTRUCTION_EXEC_R0_R1_NF(n, expr) \
+    VM86_INSTRUCTION_EXEC_R0_R1_W(n, 8, _nf, expr, VM86_FLAGS_OP_NONE, 1) \
+    VM86_INSTRUCTION_EXEC_R0_R1_W(n, 16, _nf, expr, VM86_FLAGS_OP_NONE, 1) \
+    VM86_INSTRUCTION_EXEC_R0_R1_W(n, 32, _nf, expr, VM86_FLAGS_OP_NONE, 1)
+#define VM86_INSTRUCTION_EXEC_R0_V0_NF(n, expr) \
+    VM86_INSTRUCTION_EXEC_R0_V0_W(n, 8, _nf, expr, VM86_FLAGS_OP_NONE, 1) \
+    VM86_INSTRUCTION_EXEC_R0_V0_W(n, 16, _nf, expr, VM86_FLAGS_OP_NONE, 1) \
+    VM86_INSTRUCTION_EXEC_R0_V0_W(n, 32, _nf, expr, VM86_FLAGS_OP_NONE, 1)
+#define VM86_INSTRUCTION_EXEC_SHIFT_R0_V0_NF(n, expr) \
+    VM86_INSTRUCTION_EXEC_SHIFT_R0_V0_W(n, 8, _nf, expr, VM86_FLAGS_OP_NONE) \
+    VM86_INSTRUCTION_EXEC_SHIFT_R0_V0_W(n, 16, _nf, expr, VM86_FLAGS_OP_NONE) \
+    VM86_INSTRUCTION_EXEC_SHIFT_R0_V0_W(n, 32, _nf, expr, VM86_FLAGS_OP_NONE)
+
+// xxx r0, r1
+VM86_INSTRUCTION_EXEC_R0_R1(add,    r0 + src,   VM86_FLAGS_OP_ADD,      1)
+VM86_INSTRUCTION_EXEC_R0_R1(and,    r0 & src,   VM86_FLAGS_OP_LOGIC,    1)
+VM86_INSTRUCTION_EXEC_R0_R1(cmp,    r0 - src,   VM86_FLAGS_OP_SUB,      0)
+VM86_INSTRUCTION_EXEC_R0_R1(mov,    src,        VM86_FLAGS_OP_NONE,     1)
+VM86_INSTRUCTION_EXEC_R0_R1(sub,    r0 - src,   VM86_FLAGS_OP_SUB,      1)
+VM86_INSTRUCTION_EXEC_R0_R1(xor,    r0 ^ src,   VM86_FLAGS_OP_LOGIC,    1)
+
+// xxx r0, v0
+VM86_INSTRUCTION_EXEC_R0_V0(add,    r0 + src,   VM86_FLAGS_OP_ADD,      1)
+VM86_INSTRUCTION_EXEC_R0_V0(and,    r0 & src,   VM86_FLAGS_OP_LOGIC,    1)
+VM86_INSTRUCTION_EXEC_R0_V0(cmp,    r0 - src,   VM86_FLAGS_OP_SUB,      0)
+VM86_INSTRUCTION_EXEC_R0_V0(mov,    src,        VM86_FLAGS_OP_NONE,     1)
+VM86_INSTRUCTION_EXEC_R0_V0(or,     r0 | src,   VM86_FLAGS_OP_LOGIC,    1)
+VM86_INSTRUCTION_EXEC_R0_V0(sub,    r0 - src,   VM86_FLAGS_OP_SUB,      1)
+VM86_INSTRUCTION_EXEC_R0_V0(xor,    r0 ^ src,   VM86_FLAGS_OP_LOGIC,    1)
+
+// shift r0, v0
+VM86_INSTRUCTION_EXEC_SHIFT_R0_V0(sar,  (tb_uint32_t)(vm86_flags_sext(r0, bits) >> count), VM86_FLAGS_OP_SAR)
+VM86_INSTRUCTION_EXEC_SHIFT_R0_V0(shl,  r0 << count,                                        VM86_FLAGS_OP_SHL)
+VM86_INSTRUCTION_EXEC_SHIFT_R0_V0(shr,  r0 >> count,                                        VM86_FLAGS_OP_SHR)
+
+// xxx r0, r1 without flags
+VM86_INSTRUCTION_EXEC_R0_R1_NF(add, r0 + src)
+VM86_INSTRUCTION_EXEC_R0_R1_NF(and, r0 & src)
+VM86_INSTRUCTION_EXEC_R0_R1_NF(sub, r0 - src)
+VM86_INSTRUCTION_EXEC_R0_R1_NF(xor, r0 ^ src)
+
+// xxx r0, v0 without flags
+VM86_INSTRUCTION_EXEC_R0_V0_NF(add, r0 + src)
+VM86_INSTRUCTION_EXEC_R0_V0_NF(and, r0 & src)
+VM86_INSTRUCTION_EXEC_R0_V0_NF(or,  r0 | src)
+VM86_INSTRUCTION_EXEC_R0_V0_NF(sub, r0 - src)
+VM86_INSTRUCTION_EXEC_R0_V0_NF(xor, r0 ^ src)
+
+// shift r0, v0 without flags
+VM86_INSTRUCTION_EXEC_SHIFT_R0_V0_NF(sar,   (tb_uint32_t)(vm86_flags_sext(r0, bits) >> count))
+VM86_INSTRUCTION_EXEC_SHIFT_R0_V0_NF(shl,   r0 << count)
+VM86_INSTRUCTION_EXEC_SHIFT_R0_V0_NF(shr,   r0 >> count)
+
+#undef VM86_INSTRUCTION_EXEC_R0_R1
+#undef VM86_INSTRUCTION_EXEC_R0_V0
+#undef VM86_INSTRUCTION_EXEC_SHIFT_R0_V0
+#undef VM86_INSTRUCTION_EXEC_R0_R1_NF
+#undef VM86_INSTRUCTION_EXEC_R0_V0_NF
+#undef VM86_INSTRUCTION_EXEC_SHIFT_R0_V0_NF
+#undef VM86_INSTRUCTION_EXEC_R0_R1_W
+#undef VM86_INSTRUCTION_EXEC_R0_V0_W
+#undef VM86_INSTRUCTION_EXEC_SHIFT_R0_V0_W
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * superinstruction implementation
+ */
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_push_ebp_mov_ebp_esp(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
+{
+    // check
+    tb_assert(instruction && instruction->fused == 2 && registers && stack);
+
+    // push ebp
+    vm86_stack_push_inline(stack, registers[VM86_REGISTER_EBP].u32);
+
+    // mov ebp, esp
+    registers[VM86_REGISTER_EBP].u32 = registers[VM86_REGISTER_ESP].u32;
+
+    // trace
+    tb_trace_d("push ebp; mov ebp, esp(%#x)", registers[VM86_REGISTER_ESP].u32);
+
+    // ok
+    return instruction + 2;
+}
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_mov_esp_ebp_pop_ebp_retn(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
+{
+    // check
+    tb_assert(instruction && instruction->fused == 3 && registers && stack);
+
+    // mov esp, ebp
+    registers[VM86_REGISTER_ESP].u32 = registers[VM86_REGISTER_EBP].u32;
+
+    // pop ebp
+    vm86_stack_pop_inline(stack, &registers[VM86_REGISTER_EBP].u32);
+
+    // trace
+    tb_trace_d("mov esp, ebp; pop ebp(%#x)", registers[VM86_REGISTER_EBP].u32);
+
+    // retn
+    return vm86_instruction_exec_retn(instruction + 2, context, registers, stack);
+}
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_pushs_call(vm86_instruction_ref_t instruction, vm86_instruction_ref_t tail, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
+{
+    // push the others, call the function and restore esp
+    while (instruction < tail)
+    {
+        switch (instruction->opcode)
+        {
+        case VM86_OPCODE_PUSH_R0:
+            instruction = vm86_instruction_exec_push_r0(instruction, context, registers, stack);
+            break;
+        case VM86_OPCODE_PUSH_V0:
+            instruction = vm86_instruction_exec_push_v0(instruction, context, registers, stack);
+            break;
+        case VM86_OPCODE_CALL:
+            instruction = vm86_instruction_exec_call(instruction, context, registers, stack);
+            break;
+        case VM86_OPCODE_ADD_R0_V0_32:
+            instruction = vm86_instruction_exec_add_r0_v0_32(instruction, context, registers, stack);
+            break;
+        case VM86_OPCODE_ADD_R0_V0_32_NF:
+            instruction = vm86_instruction_exec_add_r0_v0_32_nf(instruction, context, registers, stack);
+            break;
+        default:
+            // invalid superinstruction
+            tb_assert(0);
+            return tb_null;
+        }
+    }
+
+    // ok
+    return instruction;
+}
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_push_r0_call(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
+{
+    // check
+    tb_assert(instruction && instruction->fused > 1);
+
+    // the tail of the superinstruction
+    vm86_instruction_ref_t tail = instruction + instruction->fused;
+
+    // push r0
+    instruction = vm86_instruction_exec_push_r0(instruction, context, registers, stack);
+
+    // push the others and call the function
+    return vm86_instruction_exec_pushs_call(instruction, tail, context, registers, stack);
+}
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_push_v0_call(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack)
+{
+    // check
+    tb_assert(instruction && instruction->fused > 1);
+
+    // the tail of the superinstruction
+    vm86_instruction_ref_t tail = instruction + instruction->fused;
+
+    // push v0
+    instruction = vm86_instruction_exec_push_v0(instruction, context, registers, stack);
+
+    // push the others and call the function
+    return vm86_instruction_exec_pushs_call(instruction, tail, context, registers, stack);
+}
+
+// the superinstruction executor of the given instruction pair, the next instruction is kept in place
+#define VM86_INSTRUCTION_EXEC_FUSED(op, o0, n0, o1, n1) \
+static __tb_inline_force__ vm86_instruction_ref_t vm86_instruction_exec_##n0##_##n1(vm86_instruction_ref_t instruction, vm86_context_ref_t context, vm86_registers_ref_t registers, vm86_stack_t* stack) \
+{ \
+    /* check */ \
+    tb_assert(instruction && instruction->fused == 2 && instruction[1].opcode == VM86_OPCODE_##o1); \
+ \
+    /* done the first instruction */ \
+    instruction = vm86_instruction_exec_##n0(instruction, context, registers, stack); \
+ \
+    /* done the next instruction */ \
+    return vm86_instruction_exec_##n1(instruction, context, registers, stack); \
+}
+VM86_OPCODE_FUSED_LIST(op, VM86_INSTRUCTION_EXEC_FUSED)
+#undef VM86_INSTRUCTION_EXEC_FUSED
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * executors
+ */
+
+// define the executor of the function pointer dispatcher for the given opcode
+#define VM86_INSTRUCTION_DONE(o, n) \
+static vm86_instruction_ref_t vm86_instruction_done_##n(vm86_instruction_ref_t instruction, vm86_context_ref_t context) \
+{ \
+    return vm86_instruction_exec_##n(instruction, context, vm86_context_registers(context), (vm86_stack_t*)vm86_context_stack(context)); \
+}
+VM86_OPCODE_LIST(VM86_INSTRUCTION_DONE)
+#undef VM86_INSTRUCTION_DONE
+
 /* //////////////////////////////////////////////////////////////////////////////////////
  * globals
  */
 
+// the instruction executors, index: opcode
+#define VM86_INSTRUCTION_DONE_ENTRY(o, n)   ,   vm86_instruction_done_##n
+static vm86_instruction_done_ref_t g_dones[] =
+{
+    tb_null
+    VM86_OPCODE_LIST(VM86_INSTRUCTION_DONE_ENTRY)
+};
+#undef VM86_INSTRUCTION_DONE_ENTRY
+
 // the xxx entries
 static vm86_instruction_entry_t g_xxx[] =
 {
-    { "leave",    vm86_instruction_done_leave        }
-,   { "retn",     vm86_instruction_done_retn         }
+    { "leave",    VM86_OPCODE_LEAVE                  }
+,   { "retn",     VM86_OPCODE_RETN                   }
 };
 
 // the xxx func entries
 static vm86_instruction_entry_t g_xxx_func[] =
 {
-    { "call",   vm86_instruction_done_call           }
+    { "call",   VM86_OPCODE_CALL                     }
 };
 
 // the xxx r0 entries
 static vm86_instruction_entry_t g_xxx_r0[] =
 {
-    { "ja",     vm86_instruction_done_jxx_r0         }
-,   { "jbe",    vm86_instruction_done_jxx_r0         }
-,   { "jmp",    vm86_instruction_done_jxx_r0         }
-,   { "jnb",    vm86_instruction_done_jxx_r0         }
-,   { "jnz",    vm86_instruction_done_jxx_r0         }
-,   { "jz",     vm86_instruction_done_jxx_r0         }
-,   { "not",    vm86_instruction_done_not_r0         }
-,   { "pop",    vm86_instruction_done_pop_r0         }
-,   { "push",   vm86_instruction_done_push_r0        }
+    { "ja",     VM86_OPCODE_JXX_R0                   }
+,   { "jae",    VM86_OPCODE_JXX_R0                   }
+,   { "jb",     VM86_OPCODE_JXX_R0                   }
+,   { "jbe",    VM86_OPCODE_JXX_R0                   }
+,   { "jc",     VM86_OPCODE_JXX_R0                   }
+,   { "je",     VM86_OPCODE_JXX_R0                   }
+,   { "jg",     VM86_OPCODE_JXX_R0                   }
+,   { "jge",    VM86_OPCODE_JXX_R0                   }
+,   { "jl",     VM86_OPCODE_JXX_R0                   }
+,   { "jle",    VM86_OPCODE_JXX_R0                   }
+,   { "jmp",    VM86_OPCODE_JXX_R0                   }
+,   { "jna",    VM86_OPCODE_JXX_R0                   }
+,   { "jnae",   VM86_OPCODE_JXX_R0                   }
+,   { "jnb",    VM86_OPCODE_JXX_R0                   }
+,   { "jnbe",   VM86_OPCODE_JXX_R0                   }
+,   { "jnc",    VM86_OPCODE_JXX_R0                   }
+,   { "jne",    VM86_OPCODE_JXX_R0                   }
+,   { "jng",    VM86_OPCODE_JXX_R0                   }
+,   { "jnge",   VM86_OPCODE_JXX_R0                   }
+,   { "jnl",    VM86_OPCODE_JXX_R0                   }
+,   { "jnle",   VM86_OPCODE_JXX_R0                   }
+,   { "jno",    VM86_OPCODE_JXX_R0                   }
+,   { "jnp",    VM86_OPCODE_JXX_R0                   }
+,   { "jns",    VM86_OPCODE_JXX_R0                   }
+,   { "jnz",    VM86_OPCODE_JXX_R0                   }
+,   { "jo",     VM86_OPCODE_JXX_R0                   }
+,   { "jp",     VM86_OPCODE_JXX_R0                   }
+,   { "jpe",    VM86_OPCODE_JXX_R0                   }
+,   { "jpo",    VM86_OPCODE_JXX_R0                   }
+,   { "js",     VM86_OPCODE_JXX_R0                   }
+,   { "jz",     VM86_OPCODE_JXX_R0                   }
+,   { "not",    VM86_OPCODE_NOT_R0                   }
+,   { "pop",    VM86_OPCODE_POP_R0                   }
+,   { "push",   VM86_OPCODE_PUSH_R0                  }
 };
 
 // the xxx v0 entries
 static vm86_instruction_entry_t g_xxx_v0[] =
 {
-    { "ja",     vm86_instruction_done_jxx_v0         }
-,   { "jbe",    vm86_instruction_done_jxx_v0         }
-,   { "jmp",    vm86_instruction_done_jxx_v0         }
-,   { "jnb",    vm86_instruction_done_jxx_v0         }
-,   { "jnz",    vm86_instruction_done_jxx_v0         }
-,   { "jz",     vm86_instruction_done_jxx_v0         }
-,   { "push",   vm86_instruction_done_push_v0        }
+    { "ja",     VM86_OPCODE_JXX_V0                   }
+,   { "jae",    VM86_OPCODE_JXX_V0                   }
+,   { "jb",     VM86_OPCODE_JXX_V0                   }
+,   { "jbe",    VM86_OPCODE_JXX_V0                   }
+,   { "jc",     VM86_OPCODE_JXX_V0                   }
+,   { "je",     VM86_OPCODE_JXX_V0                   }
+,   { "jg",     VM86_OPCODE_JXX_V0                   }
+,   { "jge",    VM86_OPCODE_JXX_V0                   }
+,   { "jl",     VM86_OPCODE_JXX_V0                   }
+,   { "jle",    VM86_OPCODE_JXX_V0                   }
+,   { "jmp",    VM86_OPCODE_JXX_V0                   }
+,   { "jna",    VM86_OPCODE_JXX_V0                   }
+,   { "jnae",   VM86_OPCODE_JXX_V0                   }
+,   { "jnb",    VM86_OPCODE_JXX_V0                   }
+,   { "jnbe",   VM86_OPCODE_JXX_V0                   }
+,   { "jnc",    VM86_OPCODE_JXX_V0                   }
+,   { "jne",    VM86_OPCODE_JXX_V0                   }
+,   { "jng",    VM86_OPCODE_JXX_V0                   }
+,   { "jnge",   VM86_OPCODE_JXX_V0                   }
+,   { "jnl",    VM86_OPCODE_JXX_V0                   }
+,   { "jnle",   VM86_OPCODE_JXX_V0                   }
+,   { "jno",    VM86_OPCODE_JXX_V0                   }
+,   { "jnp",    VM86_OPCODE_JXX_V0                   }
+,   { "jns",    VM86_OPCODE_JXX_V0                   }
+,   { "jnz",    VM86_OPCODE_JXX_V0                   }
+,   { "jo",     VM86_OPCODE_JXX_V0                   }
+,   { "jp",     VM86_OPCODE_JXX_V0                   }
+,   { "jpe",    VM86_OPCODE_JXX_V0                   }
+,   { "jpo",    VM86_OPCODE_JXX_V0                   }
+,   { "js",     VM86_OPCODE_JXX_V0                   }
+,   { "jz",     VM86_OPCODE_JXX_V0                   }
+,   { "push",   VM86_OPCODE_PUSH_V0                  }
 };
 
 // the xxx r0, r1 entries
 static vm86_instruction_entry_t g_xxx_r0_r1[] =
 {
-    { "add",    vm86_instruction_done_add_r0_r1      }
-,   { "and",    vm86_instruction_done_and_r0_r1      }
-,   { "cmp",    vm86_instruction_done_cmp_r0_r1      }
-,   { "mov",    vm86_instruction_done_mov_r0_r1      }
-,   { "movzx",  vm86_instruction_done_movzx_r0_r1    }
-,   { "sar",    vm86_instruction_done_sar_r0_r1      }
-,   { "shl",    vm86_instruction_done_shl_r0_r1      }
-,   { "shr",    vm86_instruction_done_shr_r0_r1      }
-,   { "sub",    vm86_instruction_done_sub_r0_r1      }
-,   { "xor",    vm86_instruction_done_xor_r0_r1      }
+    { "add",    VM86_OPCODE_ADD_R0_R1                }
+,   { "and",    VM86_OPCODE_AND_R0_R1                }
+,   { "cmp",    VM86_OPCODE_CMP_R0_R1                }
+,   { "mov",    VM86_OPCODE_MOV_R0_R1                }
+,   { "movzx",  VM86_OPCODE_MOVZX_R0_R1              }
+,   { "sar",    VM86_OPCODE_SAR_R0_R1                }
+,   { "shl",    VM86_OPCODE_SHL_R0_R1                }
+,   { "shr",    VM86_OPCODE_SHR_R0_R1                }
+,   { "sub",    VM86_OPCODE_SUB_R0_R1                }
+,   { "xor",    VM86_OPCODE_XOR_R0_R1                }
 };
 
 // the xxx r0, r1, r2 entries
 static vm86_instruction_entry_t g_xxx_r0_r1_r2[] =
 {
-    { "shrd",   vm86_instruction_done_shrd_r0_r1_r2  }
+    { "shrd",   VM86_OPCODE_SHRD_R0_R1_R2            }
 };
 
 // the xxx r0, v0 entries
 static vm86_instruction_entry_t g_xxx_r0_v0[] =
 {
-    { "add",    vm86_instruction_done_add_r0_v0      }
-,   { "and",    vm86_instruction_done_and_r0_v0      }
-,   { "cmp",    vm86_instruction_done_cmp_r0_v0      }
-,   { "mov",    vm86_instruction_done_mov_r0_v0      }
-,   { "or",     vm86_instruction_done_or_r0_v0       }
-,   { "sar",    vm86_instruction_done_sar_r0_v0      }
-,   { "shl",    vm86_instruction_done_shl_r0_v0      }
-,   { "shr",    vm86_instruction_done_shr_r0_v0      }
-,   { "sub",    vm86_instruction_done_sub_r0_v0      }
-,   { "xor",    vm86_instruction_done_xor_r0_v0      }
+    { "add",    VM86_OPCODE_ADD_R0_V0                }
+,   { "and",    VM86_OPCODE_AND_R0_V0                }
+,   { "cmp",    VM86_OPCODE_CMP_R0_V0                }
+,   { "mov",    VM86_OPCODE_MOV_R0_V0                }
+,   { "or",     VM86_OPCODE_OR_R0_V0                 }
+,   { "sar",    VM86_OPCODE_SAR_R0_V0                }
+,   { "shl",    VM86_OPCODE_SHL_R0_V0                }
+,   { "shr",    VM86_OPCODE_SHR_R0_V0                }
+,   { "sub",    VM86_OPCODE_SUB_R0_V0                }
+,   { "xor",    VM86_OPCODE_XOR_R0_V0                }
 };
 
 // the xxx r0, [r1 + v0] entries
 static vm86_instruction_entry_t g_xxx_r0_$r1_add_v0$[] =
 {
-    { "add",    vm86_instruction_done_add_r0_$r1_add_v0$     }
-,   { "and",    vm86_instruction_done_and_r0_$r1_add_v0$     }
-,   { "cmp",    vm86_instruction_done_cmp_r0_$r1_add_v0$     }
-,   { "imul",   vm86_instruction_done_imul_r0_$r1_add_v0$    }
-,   { "mov",    vm86_instruction_done_mov_r0_$r1_add_v0$     }
-,   { "or",     vm86_instruction_done_or_r0_$r1_add_v0$      }
-,   { "sub",    vm86_instruction_done_sub_r0_$r1_add_v0$     }
-,   { "xor",    vm86_instruction_done_xor_r0_$r1_add_v0$     }
+    { "add",    VM86_OPCODE_ADD_R0_$R1_ADD_V0$               }
+,   { "and",    VM86_OPCODE_AND_R0_$R1_ADD_V0$               }
+,   { "cmp",    VM86_OPCODE_CMP_R0_$R1_ADD_V0$               }
+,   { "imul",   VM86_OPCODE_IMUL_R0_$R1_ADD_V0$              }
+,   { "mov",    VM86_OPCODE_MOV_R0_$R1_ADD_V0$               }
+,   { "or",     VM86_OPCODE_OR_R0_$R1_ADD_V0$                }
+,   { "sub",    VM86_OPCODE_SUB_R0_$R1_ADD_V0$               }
+,   { "xor",    VM86_OPCODE_XOR_R0_$R1_ADD_V0$               }
 };
 
 // the xxx r0, [r1 + r2 op v0] entries
 static vm86_instruction_entry_t g_xxx_r0_$r1_add_r2_op_v0$[] =
 {
-    { "lea",    vm86_instruction_done_lea_r0_$r1_add_r2_op_v0$  }
+    { "lea",    VM86_OPCODE_LEA_R0_$R1_ADD_R2_OP_V0$            }
 };
 
 // the xxx v0[r0 * v1] entries
 static vm86_instruction_entry_t g_xxx_v0$r0_mul_v1$[] =
 {
-    { "ja",     vm86_instruction_done_jxx_v0$r0_mul_v1$      }
-,   { "jbe",    vm86_instruction_done_jxx_v0$r0_mul_v1$      }
-,   { "jmp",    vm86_instruction_done_jxx_v0$r0_mul_v1$      }
-,   { "jnb",    vm86_instruction_done_jxx_v0$r0_mul_v1$      }
-,   { "jnz",    vm86_instruction_done_jxx_v0$r0_mul_v1$      }
-,   { "jz",     vm86_instruction_done_jxx_v0$r0_mul_v1$      }
+    { "ja",     VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jae",    VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jb",     VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jbe",    VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jc",     VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "je",     VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jg",     VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jge",    VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jl",     VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jle",    VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jmp",    VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jna",    VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jnae",   VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jnb",    VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jnbe",   VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jnc",    VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jne",    VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jng",    VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jnge",   VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jnl",    VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jnle",   VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jno",    VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jnp",    VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jns",    VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jnz",    VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jo",     VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jp",     VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jpe",    VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jpo",    VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "js",     VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
+,   { "jz",     VM86_OPCODE_JXX_V0$R0_MUL_V1$                }
 };
 
 // the xxx [r0 + v0] entries
 static vm86_instruction_entry_t g_xxx_$r0_add_v0$[] =
 {
-    { "div",    vm86_instruction_done_div_$r0_add_v0$        }
-,   { "mul",    vm86_instruction_done_mul_$r0_add_v0$        }
+    { "div",    VM86_OPCODE_DIV_$R0_ADD_V0$                  }
+,   { "mul",    VM86_OPCODE_MUL_$R0_ADD_V0$                  }
 };
 
 // the xxx [r0 + v0], r1 entries
 static vm86_instruction_entry_t g_xxx_$r0_add_v0$_r1[] =
 {
-    { "cmp",    vm86_instruction_done_cmp_$r0_add_v0$_r1     }
-,   { "mov",    vm86_instruction_done_mov_$r0_add_v0$_r1     }
+    { "cmp",    VM86_OPCODE_CMP_$R0_ADD_V0$_R1               }
+,   { "mov",    VM86_OPCODE_MOV_$R0_ADD_V0$_R1               }
 };
 
 // the xxx [r0 + v0], v1 entries
 static vm86_instruction_entry_t g_xxx_$r0_add_v0$_v1[] =
 {
-    { "cmp",    vm86_instruction_done_cmp_$r0_add_v0$_v1     }
-,   { "mov",    vm86_instruction_done_mov_$r0_add_v0$_v1     }
+    { "cmp",    VM86_OPCODE_CMP_$R0_ADD_V0$_V1               }
+,   { "mov",    VM86_OPCODE_MOV_$R0_ADD_V0$_V1               }
+};
+
+// the jxx condition code entries
+static vm86_instruction_cond_t g_conds[] =
+{
+    { "ja",     VM86_FLAGS_COND_A            }
+,   { "jae",    VM86_FLAGS_COND_NB           }
+,   { "jb",     VM86_FLAGS_COND_B            }
+,   { "jbe",    VM86_FLAGS_COND_BE           }
+,   { "jc",     VM86_FLAGS_COND_B            }
+,   { "je",     VM86_FLAGS_COND_Z            }
+,   { "jg",     VM86_FLAGS_COND_G            }
+,   { "jge",    VM86_FLAGS_COND_GE           }
+,   { "jl",     VM86_FLAGS_COND_L            }
+,   { "jle",    VM86_FLAGS_COND_LE           }
+,   { "jmp",    VM86_FLAGS_COND_ALWAYS       }
+,   { "jna",    VM86_FLAGS_COND_BE           }
+,   { "jnae",   VM86_FLAGS_COND_B            }
+,   { "jnb",    VM86_FLAGS_COND_NB           }
+,   { "jnbe",   VM86_FLAGS_COND_A            }
+,   { "jnc",    VM86_FLAGS_COND_NB           }
+,   { "jne",    VM86_FLAGS_COND_NZ           }
+,   { "jng",    VM86_FLAGS_COND_LE           }
+,   { "jnge",   VM86_FLAGS_COND_L            }
+,   { "jnl",    VM86_FLAGS_COND_GE           }
+,   { "jnle",   VM86_FLAGS_COND_G            }
+,   { "jno",    VM86_FLAGS_COND_NO           }
+,   { "jnp",    VM86_FLAGS_COND_NP           }
+,   { "jns",    VM86_FLAGS_COND_NS           }
+,   { "jnz",    VM86_FLAGS_COND_NZ           }
+,   { "jo",     VM86_FLAGS_COND_O            }
+,   { "jp",     VM86_FLAGS_COND_P            }
+,   { "jpe",    VM86_FLAGS_COND_P            }
+,   { "jpo",    VM86_FLAGS_COND_NP           }
+,   { "js",     VM86_FLAGS_COND_S            }
+,   { "jz",     VM86_FLAGS_COND_Z            }
+};
+
+// the width-specialized opcode entries
+#define VM86_INSTRUCTION_WIDTH_ENTRY(op, o, n, r)  { VM86_OPCODE_##o, r, { VM86_OPCODE_##o##_8, VM86_OPCODE_##o##_16, VM86_OPCODE_##o##_32 } },
+static vm86_instruction_width_t g_widths[] =
+{
+    VM86_OPCODE_WIDTH_LIST(op, VM86_INSTRUCTION_WIDTH_ENTRY)
 };
+#undef VM86_INSTRUCTION_WIDTH_ENTRY
+
+// the fused opcode entries of the instruction pairs
+#define VM86_INSTRUCTION_FUSED_ENTRY(op, o0, n0, o1, n1)  { { VM86_OPCODE_##o0, VM86_OPCODE_##o1 }, VM86_OPCODE_##o0##_##o1 },
+static vm86_instruction_fused_t g_fuseds[] =
+{
+    VM86_OPCODE_FUSED_LIST(op, VM86_INSTRUCTION_FUSED_ENTRY)
+};
+#undef VM86_INSTRUCTION_FUSED_ENTRY
+
+// the entries of each operand form, index: vm86_instruction_form_e
+static vm86_instruction_form_t g_forms[] =
+{
+    { g_xxx,                            tb_arrayn(g_xxx)                            }
+,   { g_xxx_func,                       tb_arrayn(g_xxx_func)                       }
+,   { g_xxx_r0,                         tb_arrayn(g_xxx_r0)                         }
+,   { g_xxx_v0,                         tb_arrayn(g_xxx_v0)                         }
+,   { g_xxx_r0_r1,                      tb_arrayn(g_xxx_r0_r1)                      }
+,   { g_xxx_r0_r1_r2,                   tb_arrayn(g_xxx_r0_r1_r2)                   }
+,   { g_xxx_r0_v0,                      tb_arrayn(g_xxx_r0_v0)                      }
+,   { g_xxx_r0_$r1_add_v0$,             tb_arrayn(g_xxx_r0_$r1_add_v0$)             }
+,   { g_xxx_r0_$r1_add_r2_op_v0$,       tb_arrayn(g_xxx_r0_$r1_add_r2_op_v0$)       }
+,   { g_xxx_v0$r0_mul_v1$,              tb_arrayn(g_xxx_v0$r0_mul_v1$)              }
+,   { g_xxx_$r0_add_v0$,                tb_arrayn(g_xxx_$r0_add_v0$)                }
+,   { g_xxx_$r0_add_v0$_r1,             tb_arrayn(g_xxx_$r0_add_v0$_r1)             }
+,   { g_xxx_$r0_add_v0$_v1,             tb_arrayn(g_xxx_$r0_add_v0$_v1)             }
+};
+
+/* the perfect hash of the mnemonics
+ *
+ * it is made from the entries above when the first instruction is compiled,
+ * so the entries are still the only place to add the instructions.
+ */
+static vm86_hash_perfect_t          g_mnemonics_hash;
+
+// the mnemonics, index: the key index of g_mnemonics_hash
+static vm86_instruction_mnemonic_t  g_mnemonics[VM86_HASH_PERFECT_MAXN];
+
+// the mnemonics is made?
+static tb_atomic_t                  g_mnemonics_made = 0;
+
+// the lock of making the mnemonics, the procs may be compiled in parallel
+static tb_spinlock_t                g_mnemonics_lock = TB_SPINLOCK_INIT;
 
 /* //////////////////////////////////////////////////////////////////////////////////////
  * implementation
  */
+static tb_bool_t vm86_instruction_mnemonics_make()
+{
+    // made?
+    tb_check_return_val(!tb_atomic_get(&g_mnemonics_made), tb_true);
+
+    // enter
+    tb_spinlock_enter(&g_mnemonics_lock);
+
+    // done
+    do
+    {
+        // made by the other thread?
+        tb_check_break(!tb_atomic_get(&g_mnemonics_made));
+
+        // add the mnemonics of all forms
+        tb_size_t i = 0;
+        tb_size_t form = 0;
+        tb_size_t index = 0;
+        for (form = 0; form < tb_arrayn(g_forms) && index != (tb_size_t)-1; form++)
+        {
+            for (i = 0; i < g_forms[form].count; i++)
+            {
+                // add it
+                tb_char_t const* name = g_forms[form].entries[i].name;
+                index = vm86_hash_perfect_add(&g_mnemonics_hash, vm86_hash_perfect_key(name, tb_strlen(name)));
+                tb_assert_and_check_break(index != (tb_size_t)-1);
+
+                // save the opcode of this form
+                g_mnemonics[index].opcodes[form] = g_forms[form].entries[i].opcode;
+            }
+        }
+        tb_check_break(index != (tb_size_t)-1);
+
+        // add the condition codes of jxx
+        for (i = 0; i < tb_arrayn(g_conds); i++)
+        {
+            // add it
+            index = vm86_hash_perfect_add(&g_mnemonics_hash, vm86_hash_perfect_key(g_conds[i].name, tb_strlen(g_conds[i].name)));
+            tb_assert_and_check_break(index != (tb_size_t)-1);
+
+            // save the condition code
+            g_mnemonics[index].cond = g_conds[i].cond;
+        }
+        tb_check_break(index != (tb_size_t)-1);
+
+        // make the perfect hash
+        if (!vm86_hash_perfect_make(&g_mnemonics_hash)) 
+        {
+            tb_trace_e("make the perfect hash of the mnemonics failed!");
+            break;
+        }
+
+        // ok
+        tb_atomic_set(&g_mnemonics_made, 1);
+
+    } while (0);
+
+    // leave
+    tb_spinlock_leave(&g_mnemonics_lock);
+
+    // ok?
+    return tb_atomic_get(&g_mnemonics_made)? tb_true : tb_false;
+}
+static __tb_inline__ tb_uint8_t vm86_instruction_find(tb_uint64_t key, tb_size_t form)
+{
+    // find the mnemonic
+    tb_size_t index = vm86_hash_perfect_find(&g_mnemonics_hash, key);
+    tb_check_return_val(index != (tb_size_t)-1, VM86_OPCODE_NONE);
+
+    // the opcode of this form
+    return g_mnemonics[index].opcodes[form];
+}
+static __tb_inline__ tb_uint8_t vm86_instruction_cond(tb_uint64_t key)
+{
+    // find the mnemonic
+    tb_size_t index = vm86_hash_perfect_find(&g_mnemonics_hash, key);
+    tb_assert_and_check_return_val(index != (tb_size_t)-1, VM86_FLAGS_COND_ALWAYS);
+
+    // the condition code
+    return g_mnemonics[index].cond;
+}
+static tb_uint8_t vm86_instruction_width(tb_uint8_t opcode, tb_uint8_t r0, tb_uint8_t r1)
+{
+    // the width index of the register: 32 => 2, 8 => 0, 16 => 1
+    static tb_uint8_t const s_index[] = {2, 0, 0, 1};
+
+    // find the width-specialized opcodes
+    tb_size_t i = 0;
+    for (i = 0; i < tb_arrayn(g_widths); i++)
+    {
+        // found?
+        vm86_instruction_width_ref_t entry = &g_widths[i];
+        if (entry->opcode == opcode)
+        {
+            // the width index of r0
+            tb_size_t index = s_index[(r0 >> 4) & 3];
+
+            // r0 and r1 have different widths? keep the generic opcode
+            if (entry->registers > 1 && index != s_index[(r1 >> 4) & 3]) break;
+
+            // ok
+            return entry->opcodes[index];
+        }
+    }
+
+    // keep the generic opcode
+    return opcode;
+}
+static tb_size_t vm86_instruction_width_of(tb_size_t opcode, tb_size_t* pregisters)
+{
+    // the 8, 16 and 32-bit variants
+#define VM86_INSTRUCTION_WIDTH_CASE(op, o, n, r) \
+    case VM86_OPCODE_##o##_8:   *pregisters = r; return 8; \
+    case VM86_OPCODE_##o##_16:  *pregisters = r; return 16; \
+    case VM86_OPCODE_##o##_32:  *pregisters = r; return 32;
+
+    // the flag-free variants
+#define VM86_INSTRUCTION_NOFLAGS_CASE(op, o, n) \
+    case VM86_OPCODE_##o##_8_NF:    return vm86_instruction_width_of(VM86_OPCODE_##o##_8, pregisters); \
+    case VM86_OPCODE_##o##_16_NF:   return vm86_instruction_width_of(VM86_OPCODE_##o##_16, pregisters); \
+    case VM86_OPCODE_##o##_32_NF:   return vm86_instruction_width_of(VM86_OPCODE_##o##_32, pregisters);
+
+    // the superinstructions have the width of the first instruction
+#define VM86_INSTRUCTION_FUSED_CASE(op, o0, n0, o1, n1) \
+    case VM86_OPCODE_##o0##_##o1:   return vm86_instruction_width_of(VM86_OPCODE_##o0, pregisters);
+
+    // the register width of the width-specialized opcode, 0: the generic opcode
+    switch (opcode)
+    {
+    VM86_OPCODE_WIDTH_LIST(op, VM86_INSTRUCTION_WIDTH_CASE)
+    VM86_OPCODE_NOFLAGS_LIST(op, VM86_INSTRUCTION_NOFLAGS_CASE)
+    VM86_OPCODE_FUSED_LIST(op, VM86_INSTRUCTION_FUSED_CASE)
+    default: break;
+    }
+
+#undef VM86_INSTRUCTION_WIDTH_CASE
+#undef VM86_INSTRUCTION_NOFLAGS_CASE
+#undef VM86_INSTRUCTION_FUSED_CASE
+
+    // generic
+    *pregisters = 0;
+    return 0;
+}
+static tb_bool_t vm86_instruction_register_check(tb_uint8_t index, tb_size_t width)
+{
+    // the register width: 32, 8 (low), 8 (high), 16
+    static tb_uint8_t const s_bits[] = {32, 8, 8, 16};
+
+    /* the sub-register (al, ah, ax ..) must be in eax, ebx, ecx or edx 
+     * and the high two bits are the index of it, e.g. VM86_REGISTER_ECX | VM86_REGISTER_CL
+     */
+    if ((index >> 4) && ((index & VM86_REGISTER_MASK) > VM86_REGISTER_EDX || (index >> 6) != (index & 3))) return tb_false;
+
+    // the width-specialized opcode indexes the registers without switching the width
+    return !width || s_bits[(index >> 4) & 3] == width;
+}
+static tb_size_t vm86_instruction_fuse_one(vm86_instruction_ref_t p, vm86_instruction_ref_t e)
+{
+    // push ebp; mov ebp, esp?
+    if (    p + 1 < e
+        &&  p[0].opcode == VM86_OPCODE_PUSH_R0 && p[0].r0 == VM86_REGISTER_EBP
+        &&  p[1].opcode == VM86_OPCODE_MOV_R0_R1_32 && p[1].r0 == VM86_REGISTER_EBP && p[1].r1 == VM86_REGISTER_ESP)
+    {
+        p->opcode = VM86_OPCODE_PUSH_EBP_MOV_EBP_ESP;
+        return 2;
+    }
+
+    // mov esp, ebp; pop ebp; retn?
+    if (    p + 2 < e
+        &&  p[0].opcode == VM86_OPCODE_MOV_R0_R1_32 && p[0].r0 == VM86_REGISTER_ESP && p[0].r1 == VM86_REGISTER_EBP
+        &&  p[1].opcode == VM86_OPCODE_POP_R0 && p[1].r0 == VM86_REGISTER_EBP
+        &&  p[2].opcode == VM86_OPCODE_RETN)
+    {
+        p->opcode = VM86_OPCODE_MOV_ESP_EBP_POP_EBP_RETN;
+        return 3;
+    }
+
+    // push ...; call func; [add esp, n]?
+    if (p[0].opcode == VM86_OPCODE_PUSH_R0 || p[0].opcode == VM86_OPCODE_PUSH_V0)
+    {
+        // skip the pushes, the instructions count must fit in the fused field
+        vm86_instruction_ref_t q = p + 1;
+        while (q < e && q - p < TB_MAXU8 - 2 && (q->opcode == VM86_OPCODE_PUSH_R0 || q->opcode == VM86_OPCODE_PUSH_V0)) q++;
+
+        // call func?
+        if (q < e && q->opcode == VM86_OPCODE_CALL)
+        {
+            // add esp, n?
+            q++;
+            if (q < e && (q->opcode == VM86_OPCODE_ADD_R0_V0_32 || q->opcode == VM86_OPCODE_ADD_R0_V0_32_NF) && q->r0 == VM86_REGISTER_ESP) q++;
+
+            // ok
+            p->opcode = p->opcode == VM86_OPCODE_PUSH_R0? VM86_OPCODE_PUSH_R0_CALL : VM86_OPCODE_PUSH_V0_CALL;
+            return q - p;
+        }
+    }
+
+    // the instruction pair?
+    if (p + 1 < e)
+    {
+        tb_size_t i = 0;
+        for (i = 0; i < tb_arrayn(g_fuseds); i++)
+        {
+            // found?
+            vm86_instruction_fused_ref_t entry = &g_fuseds[i];
+            if (entry->opcodes[0] == p[0].opcode && entry->opcodes[1] == p[1].opcode)
+            {
+                p->opcode = entry->opcode;
+                return 2;
+            }
+        }
+    }
+
+    // no fusion
+    return 0;
+}
+vm86_instruction_done_ref_t vm86_instruction_done(tb_size_t opcode)
+{
+    // check
+    tb_assert_static(tb_arrayn(g_dones) == VM86_OPCODE_MAXN);
+    tb_assert_and_check_return_val(opcode && opcode < tb_arrayn(g_dones), tb_null);
+
+    // the executor
+    return g_dones[opcode];
+}
+tb_void_t vm86_instruction_exec(vm86_instruction_ref_t instructions, tb_size_t count, vm86_context_ref_t context)
+{
+    // check
+    tb_assert_and_check_return(instructions && count && context);
+
+    // the registers and stack, keep them in the locals
+    vm86_registers_ref_t    registers = vm86_context_registers(context);
+    vm86_stack_t*           stack = (vm86_stack_t*)vm86_context_stack(context);
+    tb_assert_and_check_return(registers && stack);
+
+    // the instructions range
+    vm86_instruction_ref_t  p = instructions;
+    vm86_instruction_ref_t  e = instructions + count;
+
+#ifdef __vm_computed_goto__
+
+    // the dispatch labels, index: opcode
+#   define VM86_INSTRUCTION_EXEC_LABEL(o, n)    ,   &&label_##n
+    static tb_pointer_t const s_labels[] =
+    {
+        &&label_none
+        VM86_OPCODE_LIST(VM86_INSTRUCTION_EXEC_LABEL)
+    };
+#   undef VM86_INSTRUCTION_EXEC_LABEL
+    tb_assert_static(tb_arrayn(s_labels) == VM86_OPCODE_MAXN);
+
+    // dispatch the next instruction
+#   define VM86_INSTRUCTION_EXEC_NEXT() \
+    do \
+    { \
+        if (p < e && p) goto *s_labels[p->opcode]; \
+        goto label_end; \
+    \
+    } while (0)
+
+    // execute the given instruction and dispatch the next instruction directly
+#   define VM86_INSTRUCTION_EXEC_CASE(o, n) \
+    label_##n: \
+        p = vm86_instruction_exec_##n(p, context, registers, stack); \
+        VM86_INSTRUCTION_EXEC_NEXT();
+
+    // done it
+    VM86_INSTRUCTION_EXEC_NEXT();
+    VM86_OPCODE_LIST(VM86_INSTRUCTION_EXEC_CASE)
+
+label_none:
+    // invalid opcode
+    tb_assert(0);
+
+label_end:
+
+#   undef VM86_INSTRUCTION_EXEC_CASE
+#   undef VM86_INSTRUCTION_EXEC_NEXT
+#else
+    // done it
+    while (p < e && p) 
+    {
+        // check
+        tb_assert(p->done);
+
+        // execute it
+        p = p->done(p, context);
+    }
+#endif
+
+    // compute the lazy flags, the eflags register may be read after executing
+    vm86_flags_eflags(vm86_instruction_flags(context), &registers[VM86_REGISTER_EFLAGS].u32);
+}
+tb_void_t vm86_instruction_exec_trace(vm86_instruction_ref_t instructions, tb_size_t count, vm86_context_ref_t context, tb_uint32_t proc)
+{
+    // check
+    tb_assert_and_check_return(instructions && count && context);
+
+    // the trace
+    vm86_trace_t* trace = ((vm86_context_t*)context)->trace;
+    tb_assert_and_check_return(trace);
+
+    // the registers
+    vm86_registers_ref_t    registers = vm86_context_registers(context);
+    tb_assert_and_check_return(registers);
+
+    // done it
+    vm86_instruction_ref_t  p = instructions;
+    vm86_instruction_ref_t  e = instructions + count;
+    while (p < e && p) 
+    {
+        // check
+        tb_assert(p->done);
+
+        // not in this proc? execute it only
+        if (p < instructions)
+        {
+            p = p->done(p, context);
+            continue ;
+        }
+
+        // execute it
+        vm86_instruction_ref_t i = p;
+        p = p->done(p, context);
+
+        // record it after executing
+        vm86_trace_record_t* record = vm86_trace_next(trace);
+        record->proc    = proc;
+        record->index   = (tb_uint32_t)(i - instructions);
+        record->opcode  = i->opcode;
+        record->r0      = i->r0;
+        record->r1      = i->r1;
+        record->value0  = vm86_registers_value(registers, i->r0);
+        record->value1  = vm86_registers_value(registers, i->r1);
+        record->esp     = registers[VM86_REGISTER_ESP].u32;
+        record->eax     = registers[VM86_REGISTER_EAX].u32;
+        record->edx     = registers[VM86_REGISTER_EDX].u32;
+        if (!p || p < instructions || p >= e) record->flow = VM86_TRACE_FLOW_END;
+        else if (p == i + (i->fused? i->fused : 1)) record->flow = VM86_TRACE_FLOW_NEXT;
+        else record->flow = VM86_TRACE_FLOW_JUMP;
+        vm86_trace_commit(trace);
+    }
+
+    // compute the lazy flags, the eflags register may be read after executing
+    vm86_flags_eflags(vm86_instruction_flags(context), &registers[VM86_REGISTER_EFLAGS].u32);
+}
+#ifdef __vm_profile__
+tb_void_t vm86_instruction_exec_profile(vm86_instruction_ref_t instructions, tb_size_t count, vm86_context_ref_t context, tb_hize_t* counts, tb_hize_t* cycles)
+{
+    // check
+    tb_assert_and_check_return(instructions && count && context && counts);
+
+    // the registers
+    vm86_registers_ref_t    registers = vm86_context_registers(context);
+    tb_assert_and_check_return(registers);
+
+    // done it
+    vm86_instruction_ref_t  p = instructions;
+    vm86_instruction_ref_t  e = instructions + count;
+    while (p < e && p) 
+    {
+        // check
+        tb_assert(p->done);
+
+        // not in this proc? execute it only
+        if (p < instructions)
+        {
+            p = p->done(p, context);
+            continue ;
+        }
+
+        // count it
+        tb_size_t index = p - instructions;
+        counts[index]++;
+
+        // execute it and accumulate the cycles
+        if (cycles)
+        {
+            tb_hize_t tsc = vm86_instruction_tsc();
+            p = p->done(p, context);
+            cycles[index] += vm86_instruction_tsc() - tsc;
+        }
+        // execute it
+        else p = p->done(p, context);
+    }
+
+    // compute the lazy flags, the eflags register may be read after executing
+    vm86_flags_eflags(vm86_instruction_flags(context), &registers[VM86_REGISTER_EFLAGS].u32);
+}
+tb_hize_t vm86_instruction_tsc()
+{
+#if (defined(TB_ARCH_x86) || defined(TB_ARCH_x64)) && (defined(TB_COMPILER_IS_GCC) || defined(TB_COMPILER_IS_CLANG))
+    return (tb_hize_t)__builtin_ia32_rdtsc();
+#elif (defined(TB_ARCH_x86) || defined(TB_ARCH_x64)) && defined(TB_COMPILER_IS_MSVC)
+    return (tb_hize_t)__rdtsc();
+#else
+    return 0;
+#endif
+}
+#endif
+tb_size_t vm86_instruction_fuse(vm86_instruction_ref_t instructions, tb_size_t count)
+{
+    // check
+    tb_assert_and_check_return_val(instructions, 0);
+
+    // done
+    tb_size_t               fusions = 0;
+    vm86_instruction_ref_t  p = instructions;
+    vm86_instruction_ref_t  e = instructions + count;
+    while (p < e)
+    {
+        // fused? skip it
+        if (p->fused)
+        {
+            fusions++;
+            p += p->fused;
+            continue ;
+        }
+
+        // attempt to fuse the sequence at this instruction
+        tb_size_t n = vm86_instruction_fuse_one(p, e);
+        if (n)
+        {
+            // save the instructions count and update the executor
+            p->fused    = (tb_uint8_t)n;
+            p->done     = vm86_instruction_done(p->opcode);
+            tb_assert(p->done);
+
+            // trace
+            tb_trace_d("fuse: %lu instructions at %lu", n, p - instructions);
+
+            // skip the fused instructions
+            fusions++;
+            p += n;
+        }
+        else p++;
+    }
+
+    // ok?
+    return fusions;
+}
+tb_bool_t vm86_instruction_check(vm86_instruction_ref_t instruction)
+{
+    // check
+    tb_assert_and_check_return_val(instruction, tb_false);
+
+    // the register width of the opcode
+    tb_size_t registers = 0;
+    tb_size_t width = vm86_instruction_width_of(instruction->opcode, &registers);
+
+    // check the registers, only the register operands of the width-specialized opcode have its width
+    if (!vm86_instruction_register_check(instruction->r0, registers > 0? width : 0)) return tb_false;
+    if (!vm86_instruction_register_check(instruction->r1, registers > 1? width : 0)) return tb_false;
+    if (!vm86_instruction_register_check(instruction->r2, 0)) return tb_false;
+
+    // check the jump targets, the direct target must be the instruction address and the indirect target cannot be checked
+    switch (instruction->opcode)
+    {
+    case VM86_OPCODE_JXX_V0:
+        return instruction->v0_reloc == VM86_RELOC_CODE;
+    case VM86_OPCODE_JXX_R0:
+        return tb_false;
+    default:
+        break;
+    }
+
+    // ok
+    return tb_true;
+}
 tb_bool_t vm86_instruction_compile(vm86_instruction_ref_t instruction, tb_char_t const* code, tb_size_t size, vm86_machine_ref_t machine, tb_hash_map_ref_t proc_labels, tb_hash_map_ref_t proc_locals)
 {
     // check
@@ -1483,29 +2487,38 @@ tb_bool_t vm86_instruction_compile(vm86_instruction_ref_t instruction, tb_char_t
     tb_uint16_t         r2 = 0;
     tb_uint32_t         v0 = 0;
     tb_uint32_t         v1 = 0;
+    tb_uint8_t          v0_reloc = VM86_RELOC_NONE;
+    tb_uint8_t          v1_reloc = VM86_RELOC_NONE;
     do
     {
         // the .data
         vm86_data_ref_t data = vm86_machine_data(machine);
         tb_assert_and_check_break(data);
 
+        // make the perfect hash of the mnemonics at the first time
+        if (!vm86_instruction_mnemonics_make()) break;
+
         // get instruction name
         tb_char_t name[64] = {0};
         if (!vm86_parser_get_instruction_name(&p, e, name, sizeof(name))) break;
 
+        // the mnemonic key
+        tb_uint64_t key = vm86_hash_perfect_key(name, tb_strlen(name));
+
         // init instruction hint
         instruction->hint[0] = name[0];
         instruction->hint[1] = name[1];
         instruction->hint[2] = name[2];
 
-        // init executor
-        instruction->done = tb_null;
+        // init opcode and executor
+        instruction->opcode = VM86_OPCODE_NONE;
+        instruction->done   = tb_null;
 
         // xxx?
         if (p == e)
         {
             // init instruction
-            instruction->done = vm86_instruction_find(name, g_xxx, tb_arrayn(g_xxx));
+            instruction->opcode = vm86_instruction_find(key, VM86_INSTRUCTION_FORM_XXX);
         }
         // xxx [ ... ], ... ?
         else if (*p == '[')
@@ -1525,7 +2538,7 @@ tb_bool_t vm86_instruction_compile(vm86_instruction_ref_t instruction, tb_char_t
                 while (p < e && tb_isspace(*p)) p++;
      
                 // get v0
-                if (!vm86_parser_get_value(&p, e, &v0, proc_locals, proc_labels, data)) break;
+                if (!vm86_parser_get_value(&p, e, &v0, proc_locals, proc_labels, data, &v0_reloc)) break;
             }
 
             // skip "], "
@@ -1537,7 +2550,7 @@ tb_bool_t vm86_instruction_compile(vm86_instruction_ref_t instruction, tb_char_t
                 // init instruction
                 instruction->r0         = (tb_uint8_t)r0;
                 instruction->v0.u32     = v0;
-                instruction->done       = vm86_instruction_find(name, g_xxx_$r0_add_v0$, tb_arrayn(g_xxx_$r0_add_v0$));
+                instruction->opcode     = vm86_instruction_find(key, VM86_INSTRUCTION_FORM_XXX_$R0_ADD_V0$);
             }
             // xxx [r0 + v0], r1?
             else if (vm86_parser_get_register(&p, e, &r1))
@@ -1546,19 +2559,19 @@ tb_bool_t vm86_instruction_compile(vm86_instruction_ref_t instruction, tb_char_t
                 instruction->r0         = (tb_uint8_t)r0;
                 instruction->r1         = (tb_uint8_t)r1;
                 instruction->v0.u32     = v0;
-                instruction->done       = vm86_instruction_find(name, g_xxx_$r0_add_v0$_r1, tb_arrayn(g_xxx_$r0_add_v0$_r1));
+                instruction->opcode     = vm86_instruction_find(key, VM86_INSTRUCTION_FORM_XXX_$R0_ADD_V0$_R1);
             }
             // xxx [r0 + v0], v1?
             else 
             {
                 // get v1
-                if (!vm86_parser_get_value(&p, e, &v1, proc_locals, proc_labels, data)) break;
+                if (!vm86_parser_get_value(&p, e, &v1, proc_locals, proc_labels, data, &v1_reloc)) break;
 
                 // init instruction
                 instruction->r0         = (tb_uint8_t)r0;
                 instruction->v0.u32     = v0;
                 instruction->v1.u32     = v1;
-                instruction->done       = vm86_instruction_find(name, g_xxx_$r0_add_v0$_v1, tb_arrayn(g_xxx_$r0_add_v0$_v1));
+                instruction->opcode     = vm86_instruction_find(key, VM86_INSTRUCTION_FORM_XXX_$R0_ADD_V0$_V1);
             }
         } 
         // xxx r0, ...?
@@ -1572,7 +2585,7 @@ tb_bool_t vm86_instruction_compile(vm86_instruction_ref_t instruction, tb_char_t
             {
                 // init instruction
                 instruction->r0     = (tb_uint8_t)r0;
-                instruction->done   = vm86_instruction_find(name, g_xxx_r0, tb_arrayn(g_xxx_r0));
+                instruction->opcode = vm86_instruction_find(key, VM86_INSTRUCTION_FORM_XXX_R0);
             }
             // xxx r0, r1, ...?
             else if (vm86_parser_get_register(&p, e, &r1))
@@ -1586,7 +2599,7 @@ tb_bool_t vm86_instruction_compile(vm86_instruction_ref_t instruction, tb_char_t
                     // init instruction
                     instruction->r0         = (tb_uint8_t)r0;
                     instruction->r1         = (tb_uint8_t)r1;
-                    instruction->done       = vm86_instruction_find(name, g_xxx_r0_r1, tb_arrayn(g_xxx_r0_r1));
+                    instruction->opcode     = vm86_instruction_find(key, VM86_INSTRUCTION_FORM_XXX_R0_R1);
                 }
                 // xxx r0, r1, r2?
                 else if (vm86_parser_get_register(&p, e, &r2))
@@ -1595,7 +2608,7 @@ tb_bool_t vm86_instruction_compile(vm86_instruction_ref_t instruction, tb_char_t
                     instruction->r0         = (tb_uint8_t)r0;
                     instruction->r1         = (tb_uint8_t)r1;
                     instruction->r2         = (tb_uint8_t)r2;
-                    instruction->done       = vm86_instruction_find(name, g_xxx_r0_r1_r2, tb_arrayn(g_xxx_r0_r1_r2));
+                    instruction->opcode     = vm86_instruction_find(key, VM86_INSTRUCTION_FORM_XXX_R0_R1_R2);
                 }
                 else break;
             }
@@ -1625,7 +2638,7 @@ tb_bool_t vm86_instruction_compile(vm86_instruction_ref_t instruction, tb_char_t
                     while (p < e && tb_isspace(*p)) p++;
          
                     // get v0
-                    if (!vm86_parser_get_value(&p, e, &v0, proc_locals, proc_labels, data)) break;
+                    if (!vm86_parser_get_value(&p, e, &v0, proc_locals, proc_labels, data, &v0_reloc)) break;
 
                     // init instruction
                     instruction->r0         = (tb_uint8_t)r0;
@@ -1633,19 +2646,19 @@ tb_bool_t vm86_instruction_compile(vm86_instruction_ref_t instruction, tb_char_t
                     instruction->r2         = (tb_uint8_t)r2;
                     instruction->op         = op;
                     instruction->v0.u32     = v0;
-                    instruction->done       = vm86_instruction_find(name, g_xxx_r0_$r1_add_r2_op_v0$, tb_arrayn(g_xxx_r0_$r1_add_r2_op_v0$));
+                    instruction->opcode     = vm86_instruction_find(key, VM86_INSTRUCTION_FORM_XXX_R0_$R1_ADD_R2_OP_V0$);
                 }
                 // xxx r0, [r1 + v0]?
                 else
                 {
                     // get v0
-                    if (!vm86_parser_get_value(&p, e, &v0, proc_locals, proc_labels, data)) break;
+                    if (!vm86_parser_get_value(&p, e, &v0, proc_locals, proc_labels, data, &v0_reloc)) break;
 
                     // init instruction
                     instruction->r0         = (tb_uint8_t)r0;
                     instruction->r1         = (tb_uint8_t)r1;
                     instruction->v0.u32     = v0;
-                    instruction->done       = vm86_instruction_find(name, g_xxx_r0_$r1_add_v0$, tb_arrayn(g_xxx_r0_$r1_add_v0$));
+                    instruction->opcode     = vm86_instruction_find(key, VM86_INSTRUCTION_FORM_XXX_R0_$R1_ADD_V0$);
                 }
             }
             // xxx r0, offset label?
@@ -1656,12 +2669,12 @@ tb_bool_t vm86_instruction_compile(vm86_instruction_ref_t instruction, tb_char_t
                 while (p < e && tb_isspace(*p)) p++;
 
                 // get v0
-                if (!vm86_parser_get_offset_value(&p, e, &v0, proc_labels, data)) break;
+                if (!vm86_parser_get_offset_value(&p, e, &v0, proc_labels, data, &v0_reloc)) break;
 
                 // init instruction
                 instruction->r0         = (tb_uint8_t)r0;
                 instruction->v0.u32     = v0;
-                instruction->done       = vm86_instruction_find(name, g_xxx_r0_v0, tb_arrayn(g_xxx_r0_v0));
+                instruction->opcode     = vm86_instruction_find(key, VM86_INSTRUCTION_FORM_XXX_R0_V0);
             }
             // xxx r0, v0?
             else if (vm86_parser_get_number_value(&p, e, &v0))
@@ -1669,12 +2682,12 @@ tb_bool_t vm86_instruction_compile(vm86_instruction_ref_t instruction, tb_char_t
                 // init instruction
                 instruction->r0         = (tb_uint8_t)r0;
                 instruction->v0.u32     = v0;
-                instruction->done       = vm86_instruction_find(name, g_xxx_r0_v0, tb_arrayn(g_xxx_r0_v0));
+                instruction->opcode     = vm86_instruction_find(key, VM86_INSTRUCTION_FORM_XXX_R0_V0);
             }
             else break;
         }
         // xxx v0...?
-        else if (vm86_parser_get_value(&p, e, &v0, proc_locals, proc_labels, data))
+        else if (vm86_parser_get_value(&p, e, &v0, proc_locals, proc_labels, data, &v0_reloc))
         {
             // xxx v0[r0 * v1]?
             if (p < e && *p == '[')
@@ -1691,20 +2704,20 @@ tb_bool_t vm86_instruction_compile(vm86_instruction_ref_t instruction, tb_char_t
                 while (p < e && tb_isspace(*p)) p++;
      
                 // get v1
-                if (!vm86_parser_get_value(&p, e, &v1, proc_locals, proc_labels, data)) break;
+                if (!vm86_parser_get_value(&p, e, &v1, proc_locals, proc_labels, data, &v1_reloc)) break;
 
                 // init instruction
                 instruction->r0         = (tb_uint8_t)r0;
                 instruction->v0.u32     = v0;
                 instruction->v1.u32     = v1;
-                instruction->done       = vm86_instruction_find(name, g_xxx_v0$r0_mul_v1$, tb_arrayn(g_xxx_v0$r0_mul_v1$));
+                instruction->opcode     = vm86_instruction_find(key, VM86_INSTRUCTION_FORM_XXX_V0$R0_MUL_V1$);
             }
             // xxx v0?
             else
             {
                 // init instruction
                 instruction->v0.u32     = v0;
-                instruction->done       = vm86_instruction_find(name, g_xxx_v0, tb_arrayn(g_xxx_v0));
+                instruction->opcode     = vm86_instruction_find(key, VM86_INSTRUCTION_FORM_XXX_V0);
             }
         }
         // xxx func?
@@ -1714,13 +2727,41 @@ tb_bool_t vm86_instruction_compile(vm86_instruction_ref_t instruction, tb_char_t
             tb_char_t func[512] = {0};
             if (!vm86_parser_get_variable_name(&p, e, func, sizeof(func))) break;
 
+            // link the function slot, the function may be bound after compiling
+            tb_size_t slot = vm86_machine_function_slot((vm86_machine_t*)machine, func);
+            tb_assert_and_check_break(slot != (tb_size_t)-1);
+
             // init instruction
             instruction->is_cstr    = tb_true;
             instruction->v0.cstr    = tb_strdup(func);
-            instruction->done       = vm86_instruction_find(name, g_xxx_func, tb_arrayn(g_xxx_func));
+            instruction->v1.u32     = (tb_uint32_t)slot;
+            instruction->opcode     = vm86_instruction_find(key, VM86_INSTRUCTION_FORM_XXX_FUNC);
         }
 
-        // check
+        // unknown instruction?
+        if (instruction->opcode == VM86_OPCODE_NONE)
+        {
+            tb_trace_e("unknown instruction: %s", name);
+            break;
+        }
+
+        // choose the width-specialized opcode, the register width need not be switched at runtime
+        instruction->opcode = vm86_instruction_width(instruction->opcode, instruction->r0, instruction->r1);
+
+        // init the condition code of jxx
+        if (    instruction->opcode == VM86_OPCODE_JXX_R0
+            ||  instruction->opcode == VM86_OPCODE_JXX_V0
+            ||  instruction->opcode == VM86_OPCODE_JXX_V0$R0_MUL_V1$)
+        {
+            instruction->cond = vm86_instruction_cond(key);
+        }
+
+        // save the relocation types of the values
+        instruction->v0_reloc = v0_reloc;
+        instruction->v1_reloc = v1_reloc;
+
+        // init executor
+        instruction->done = vm86_instruction_done(instruction->opcode);
         tb_assert(instruction->done);
 
         // ok 
@@ -26,6 +26,146 @@
  */
 #include "prefix.h"
 
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * macros
+ */
+
+/* the opcode list, op(OPCODE, name)
+ *
+ * generate the opcode enum, the executor table and the dispatch labels from it,
+ * so the new opcode must be appended to the tail to keep the image compatible.
+ */
+#define VM86_OPCODE_LIST(op) \
+    op(LEAVE,                       leave) \
+    op(RETN,                        retn) \
+    op(CALL,                        call) \
+    op(PUSH_R0,                     push_r0) \
+    op(PUSH_V0,                     push_v0) \
+    op(POP_R0,                      pop_r0) \
+    op(MOV_R0_R1,                   mov_r0_r1) \
+    op(MOV_R0_V0,                   mov_r0_v0) \
+    op(MOV_R0_$R1_ADD_V0$,          mov_r0_$r1_add_v0$) \
+    op(MOV_$R0_ADD_V0$_R1,          mov_$r0_add_v0$_r1) \
+    op(MOV_$R0_ADD_V0$_V1,          mov_$r0_add_v0$_v1) \
+    op(MOVZX_R0_R1,                 movzx_r0_r1) \
+    op(ADD_R0_R1,                   add_r0_r1) \
+    op(ADD_R0_V0,                   add_r0_v0) \
+    op(ADD_R0_$R1_ADD_V0$,          add_r0_$r1_add_v0$) \
+    op(SUB_R0_R1,                   sub_r0_r1) \
+    op(SUB_R0_V0,                   sub_r0_v0) \
+    op(SUB_R0_$R1_ADD_V0$,          sub_r0_$r1_add_v0$) \
+    op(LEA_R0_$R1_ADD_R2_OP_V0$,    lea_r0_$r1_add_r2_op_v0$) \
+    op(JXX_R0,                      jxx_r0) \
+    op(JXX_V0,                      jxx_v0) \
+    op(JXX_V0$R0_MUL_V1$,           jxx_v0$r0_mul_v1$) \
+    op(CMP_R0_R1,                   cmp_r0_r1) \
+    op(CMP_R0_V0,                   cmp_r0_v0) \
+    op(CMP_R0_$R1_ADD_V0$,          cmp_r0_$r1_add_v0$) \
+    op(CMP_$R0_ADD_V0$_R1,          cmp_$r0_add_v0$_r1) \
+    op(CMP_$R0_ADD_V0$_V1,          cmp_$r0_add_v0$_v1) \
+    op(SHRD_R0_R1_R2,               shrd_r0_r1_r2) \
+    op(SHR_R0_R1,                   shr_r0_r1) \
+    op(SHR_R0_V0,                   shr_r0_v0) \
+    op(SHL_R0_R1,                   shl_r0_r1) \
+    op(SHL_R0_V0,                   shl_r0_v0) \
+    op(SAR_R0_R1,                   sar_r0_r1) \
+    op(SAR_R0_V0,                   sar_r0_v0) \
+    op(AND_R0_R1,                   and_r0_r1) \
+    op(AND_R0_V0,                   and_r0_v0) \
+    op(AND_R0_$R1_ADD_V0$,          and_r0_$r1_add_v0$) \
+    op(XOR_R0_R1,                   xor_r0_r1) \
+    op(XOR_R0_V0,                   xor_r0_v0) \
+    op(XOR_R0_$R1_ADD_V0$,          xor_r0_$r1_add_v0$) \
+    op(OR_R0_V0,                    or_r0_v0) \
+    op(OR_R0_$R1_ADD_V0$,           or_r0_$r1_add_v0$) \
+    op(NOT_R0,                      not_r0) \
+    op(MUL_$R0_ADD_V0$,             mul_$r0_add_v0$) \
+    op(IMUL_R0_$R1_ADD_V0$,         imul_r0_$r1_add_v0$) \
+    op(DIV_$R0_ADD_V0$,             div_$r0_add_v0$) \
+    VM86_OPCODE_WIDTH_LIST(op, VM86_OPCODE_WIDTH) \
+    op(PUSH_EBP_MOV_EBP_ESP,        push_ebp_mov_ebp_esp) \
+    op(MOV_ESP_EBP_POP_EBP_RETN,    mov_esp_ebp_pop_ebp_retn) \
+    op(PUSH_R0_CALL,                push_r0_call) \
+    op(PUSH_V0_CALL,                push_v0_call) \
+    VM86_OPCODE_FUSED_LIST(op, VM86_OPCODE_FUSED) \
+    VM86_OPCODE_NOFLAGS_LIST(op, VM86_OPCODE_NOFLAGS) \
+    op(JXX_TABLE_R0,                jxx_table_r0)
+
+/* the width-specialized opcode list, w(op, OPCODE, name, registers count)
+ *
+ * the register operands of these opcodes have the same width,
+ * so the compiler will choose the 8, 16 or 32-bit variant (OPCODE_8, OPCODE_16, OPCODE_32) 
+ * and the executor need not switch the register width at runtime.
+ */
+#define VM86_OPCODE_WIDTH_LIST(op, w) \
+    w(op, ADD_R0_R1,                    add_r0_r1, 2) \
+    w(op, AND_R0_R1,                    and_r0_r1, 2) \
+    w(op, CMP_R0_R1,                    cmp_r0_r1, 2) \
+    w(op, MOV_R0_R1,                    mov_r0_r1, 2) \
+    w(op, SUB_R0_R1,                    sub_r0_r1, 2) \
+    w(op, XOR_R0_R1,                    xor_r0_r1, 2) \
+    w(op, ADD_R0_V0,                    add_r0_v0, 1) \
+    w(op, AND_R0_V0,                    and_r0_v0, 1) \
+    w(op, CMP_R0_V0,                    cmp_r0_v0, 1) \
+    w(op, MOV_R0_V0,                    mov_r0_v0, 1) \
+    w(op, OR_R0_V0,                     or_r0_v0, 1) \
+    w(op, SAR_R0_V0,                    sar_r0_v0, 1) \
+    w(op, SHL_R0_V0,                    shl_r0_v0, 1) \
+    w(op, SHR_R0_V0,                    shr_r0_v0, 1) \
+    w(op, SUB_R0_V0,                    sub_r0_v0, 1) \
+    w(op, XOR_R0_V0,                    xor_r0_v0, 1)
+
+// expand the 8, 16 and 32-bit variants of the given opcode
+#define VM86_OPCODE_WIDTH(op, o, n, r) \
+    op(o##_8,                       n##_8) \
+    op(o##_16,                      n##_16) \
+    op(o##_32,                      n##_32)
+
+/* the fused opcode list of the instruction pairs, f(op, OPCODE0, name0, OPCODE1, name1)
+ *
+ * the superinstruction (OPCODE0_OPCODE1) executes the first instruction 
+ * and the next instruction in place with one dispatch.
+ */
+#define VM86_OPCODE_FUSED_LIST(op, f) \
+    f(op, CMP_R0_R1_8,                  cmp_r0_r1_8,            JXX_V0, jxx_v0) \
+    f(op, CMP_R0_R1_16,                 cmp_r0_r1_16,           JXX_V0, jxx_v0) \
+    f(op, CMP_R0_R1_32,                 cmp_r0_r1_32,           JXX_V0, jxx_v0) \
+    f(op, CMP_R0_V0_8,                  cmp_r0_v0_8,            JXX_V0, jxx_v0) \
+    f(op, CMP_R0_V0_16,                 cmp_r0_v0_16,           JXX_V0, jxx_v0) \
+    f(op, CMP_R0_V0_32,                 cmp_r0_v0_32,           JXX_V0, jxx_v0) \
+    f(op, CMP_R0_$R1_ADD_V0$,           cmp_r0_$r1_add_v0$,     JXX_V0, jxx_v0) \
+    f(op, CMP_$R0_ADD_V0$_R1,           cmp_$r0_add_v0$_r1,     JXX_V0, jxx_v0) \
+    f(op, CMP_$R0_ADD_V0$_V1,           cmp_$r0_add_v0$_v1,     JXX_V0, jxx_v0)
+
+// expand the fused opcode of the given instruction pair
+#define VM86_OPCODE_FUSED(op, o0, n0, o1, n1) \
+    op(o0##_##o1,                   n0##_##n1)
+
+/* the flag-free opcode list of the width-specialized opcodes, f(op, OPCODE, name)
+ *
+ * the flag-free variant (OPCODE_8_NF, OPCODE_16_NF, OPCODE_32_NF) does not record the lazy flags,
+ * the optimizer chooses it if the flags written by the instruction will not be read.
+ */
+#define VM86_OPCODE_NOFLAGS_LIST(op, f) \
+    f(op, ADD_R0_R1,                    add_r0_r1) \
+    f(op, AND_R0_R1,                    and_r0_r1) \
+    f(op, SUB_R0_R1,                    sub_r0_r1) \
+    f(op, XOR_R0_R1,                    xor_r0_r1) \
+    f(op, ADD_R0_V0,                    add_r0_v0) \
+    f(op, AND_R0_V0,                    and_r0_v0) \
+    f(op, OR_R0_V0,                     or_r0_v0) \
+    f(op, SAR_R0_V0,                    sar_r0_v0) \
+    f(op, SHL_R0_V0,                    shl_r0_v0) \
+    f(op, SHR_R0_V0,                    shr_r0_v0) \
+    f(op, SUB_R0_V0,                    sub_r0_v0) \
+    f(op, XOR_R0_V0,                    xor_r0_v0)
+
+// expand the flag-free 8, 16 and 32-bit variants of the given opcode
+#define VM86_OPCODE_NOFLAGS(op, o, n) \
+    op(o##_8_NF,                    n##_8_nf) \
+    op(o##_16_NF,                   n##_16_nf) \
+    op(o##_32_NF,                   n##_32_nf)
+
 /* //////////////////////////////////////////////////////////////////////////////////////
  * extern
  */
@@ -35,9 +175,20 @@ __tb_extern_c_enter__
  * types
  */
 
+// the machine instruction opcode enum, the index of the instruction executor
+#define VM86_OPCODE_ENUM(o, n)      ,   VM86_OPCODE_##o
+typedef enum __vm86_opcode_e
+{
+    VM86_OPCODE_NONE                = 0
+    VM86_OPCODE_LIST(VM86_OPCODE_ENUM)
+,   VM86_OPCODE_MAXN
+
+}vm86_opcode_e;
+#undef VM86_OPCODE_ENUM
+
 // the machine instruction done ref type
 struct __vm86_instruction_t;
-typedef struct __vm86_instruction_t* (*vm86_instruction_done_ref_t)(struct __vm86_instruction_t* instruction, vm86_machine_ref_t machine);
+typedef struct __vm86_instruction_t* (*vm86_instruction_done_ref_t)(struct __vm86_instruction_t* instruction, vm86_context_ref_t context);
 
 // the machine instruction type
 typedef struct __vm86_instruction_t
@@ -50,9 +201,22 @@ typedef struct __vm86_instruction_t
     // is cstr? need free it
     tb_uint8_t                      is_cstr : 1;
 
+    // the relocation type of v0 and v1, vm86_reloc_e
+    tb_uint8_t                      v0_reloc : 2;
+    tb_uint8_t                      v1_reloc : 2;
+
+    // the opcode, vm86_opcode_e
+    tb_uint8_t                      opcode;
+
     // the op: +, -, *
     tb_char_t                       op;
 
+    // the condition code of jxx, vm86_flags_cond_e
+    tb_uint8_t                      cond;
+
+    // the instructions count of the superinstruction, 0 if it is not fused
+    tb_uint8_t                      fused;
+
     // the hint 
     tb_char_t                       hint[3];
 
@@ -69,6 +233,91 @@ typedef struct __vm86_instruction_t
  * interfaces
  */
 
+/*! get the instruction executor of the given opcode
+ *
+ * @param opcode            the opcode
+ *
+ * @return                  the executor, return tb_null if the opcode is invalid
+ */
+vm86_instruction_done_ref_t vm86_instruction_done(tb_size_t opcode);
+
+/*! execute the instructions
+ *
+ * dispatch instructions by the computed goto if __vm_computed_goto__ is defined,
+ * otherwise call the executor of each instruction.
+ *
+ * @param instructions      the instructions
+ * @param count             the instructions count
+ * @param context           the execution context
+ */
+tb_void_t                   vm86_instruction_exec(vm86_instruction_ref_t instructions, tb_size_t count, vm86_context_ref_t context);
+
+/*! execute the instructions and record each executed instruction to the trace ring of the context
+ *
+ * it is the instrumented copy of vm86_instruction_exec() and is only called if the context trace is enabled,
+ * so the dispatch loop of vm86_instruction_exec() has no cost of the tracing.
+ *
+ * the fused superinstruction is recorded by its head.
+ *
+ * @param instructions      the instructions
+ * @param count             the instructions count
+ * @param context           the execution context with the trace ring
+ * @param proc              the proc id saved to the records
+ */
+tb_void_t                   vm86_instruction_exec_trace(vm86_instruction_ref_t instructions, tb_size_t count, vm86_context_ref_t context, tb_uint32_t proc);
+
+#ifdef __vm_profile__
+/*! execute the instructions and count the executions of each instruction
+ *
+ * it is the instrumented copy of vm86_instruction_exec() which calls the executor of each instruction,
+ * so the dispatch loop of vm86_instruction_exec() has no cost of the counters.
+ *
+ * the fused superinstruction is counted by its head.
+ *
+ * @param instructions      the instructions
+ * @param count             the instructions count
+ * @param context           the execution context
+ * @param counts            the executions count of each instruction
+ * @param cycles            the accumulated tsc cycles of each instruction, optional
+ */
+tb_void_t                   vm86_instruction_exec_profile(vm86_instruction_ref_t instructions, tb_size_t count, vm86_context_ref_t context, tb_hize_t* counts, tb_hize_t* cycles);
+
+/*! the current tsc cycles
+ *
+ * @return                  the cycles, return 0 if the tsc is not supported
+ */
+tb_hize_t                   vm86_instruction_tsc(tb_noarg_t);
+#endif
+
+/*! fuse the common instruction sequences into the superinstructions
+ *
+ * - push ebp; mov ebp, esp
+ * - mov esp, ebp; pop ebp; retn
+ * - push ...; call func; [add esp, n]
+ * - cmp ...; jxx v0
+ *
+ * only the opcode of the first instruction is replaced and the others are kept in place,
+ * so the labels and the code addresses in .data which point into the sequence are still valid.
+ *
+ * @param instructions      the instructions
+ * @param count             the instructions count
+ *
+ * @return                  the fusions count, the fused superinstructions are counted too
+ */
+tb_size_t                   vm86_instruction_fuse(vm86_instruction_ref_t instructions, tb_size_t count);
+
+/*! check the operands of the instruction which is not compiled from the code, e.g. loaded from the image
+ *
+ * - the registers must be the valid indexes and have the width of the width-specialized opcode
+ * - the direct jump must be relocated to the instruction address
+ * - the indirect jump by the register is rejected, because its target cannot be checked
+ *
+ * @param instruction       the instruction
+ *
+ * @return                  tb_true or tb_false
+ */
+tb_bool_t                   vm86_instruction_check(vm86_instruction_ref_t instruction);
+
 /*! compile the instruction 
  *
  * @param instruction       the instruction
@@ -0,0 +1,1245 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        jit.c
+ *
+ */
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * trace
+ */
+#define TB_TRACE_MODULE_NAME            "machine_jit"
+#define TB_TRACE_MODULE_DEBUG           (0)
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "machine.h"
+#include "impl/jit.h"
+#include "impl/machine.h"
+#ifdef __vm_jit__
+#   include <sys/mman.h>
+#endif
+
+#ifdef __vm_jit__
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * macros
+ */
+
+// the host registers
+#define VM86_JIT_RAX                    (0)
+#define VM86_JIT_RCX                    (1)
+#define VM86_JIT_RDX                    (2)
+#define VM86_JIT_RBX                    (3)
+#define VM86_JIT_RBP                    (5)
+#define VM86_JIT_RSI                    (6)
+#define VM86_JIT_RDI                    (7)
+#define VM86_JIT_R10                    (10)
+#define VM86_JIT_R11                    (11)
+#define VM86_JIT_R12                    (12)
+#define VM86_JIT_R13                    (13)
+#define VM86_JIT_R14                    (14)
+#define VM86_JIT_R15                    (15)
+
+/* the fixed host registers
+ *
+ * r15: the base of the guest space
+ * r14: the context
+ * r13: the guest address of the indirect jump target or the instruction to continue in the interpreter
+ * r11, r10: the scratch registers
+ */
+#define VM86_JIT_BASE                   VM86_JIT_R15
+#define VM86_JIT_CONTEXT                VM86_JIT_R14
+#define VM86_JIT_RESUME                 VM86_JIT_R13
+#define VM86_JIT_TEMP                   VM86_JIT_R11
+#define VM86_JIT_TEMP2                  VM86_JIT_R10
+
+// the labels after the instructions
+#define VM86_JIT_LABEL_END(count)       (count)         //!< finish the proc
+#define VM86_JIT_LABEL_EXIT(count)      ((count) + 1)   //!< save the guest state and return r13
+#define VM86_JIT_LABEL_INDIRECT(count)  ((count) + 2)   //!< jump to the guest address in r13d
+#define VM86_JIT_LABEL_INVALID(count)   ((count) + 3)   //!< the invalid target of the indirect jump
+#define VM86_JIT_LABEL_MAXN(count)      ((count) + 4)
+
+// the operand modes of the modrm
+#define VM86_JIT_MODE_REG               (0)             //!< the register
+#define VM86_JIT_MODE_MEM               (1)             //!< [r15 + index], the guest memory
+#define VM86_JIT_MODE_DISP              (2)             //!< [base + disp32]
+
+// the alu opcodes of the register forms, the immediate forms use (opcode >> 3) as the digit of 0x81
+#define VM86_JIT_ALU_ADD                (0x00)
+#define VM86_JIT_ALU_OR                 (0x08)
+#define VM86_JIT_ALU_AND                (0x20)
+#define VM86_JIT_ALU_SUB                (0x28)
+#define VM86_JIT_ALU_XOR                (0x30)
+#define VM86_JIT_ALU_CMP                (0x38)
+#define VM86_JIT_ALU_MOV                (0x88)
+
+// the digits of the shift opcodes
+#define VM86_JIT_SHIFT_SHL              (4)
+#define VM86_JIT_SHIFT_SHR              (5)
+#define VM86_JIT_SHIFT_SAR              (7)
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+// the native code entry type
+typedef vm86_instruction_ref_t (*vm86_jit_func_t)(vm86_context_t* context);
+
+// the jump fixup type, the rel32 at the given position will be patched to the label
+typedef struct __vm86_jit_fixup_t
+{
+    // the position of the rel32
+    tb_uint32_t                 pos;
+
+    // the label
+    tb_uint32_t                 label;
+
+}vm86_jit_fixup_t;
+
+// the native jump table type, the imm64 at the given position will be patched to the table of the host labels
+typedef struct __vm86_jit_table_t
+{
+    // the position of the imm64
+    tb_uint32_t                 pos;
+
+    // the instruction index of the table jump
+    tb_uint32_t                 index;
+
+}vm86_jit_table_t;
+
+// the emitter type
+typedef struct __vm86_jit_emitter_t
+{
+    // the code
+    tb_buffer_t                 code;
+
+    // the fixups
+    tb_buffer_t                 fixups;
+
+    // the native offsets of the instructions and the stubs
+    tb_uint32_t*                labels;
+
+    // the instructions
+    vm86_instruction_ref_t      instructions;
+
+    // the instructions count
+    tb_size_t                   count;
+
+    // the position of the imm64 address of the indirect jump table
+    tb_size_t                   table;
+
+    // the native jump tables of the table jumps, vm86_jit_table_t
+    tb_buffer_t                 tables;
+
+}vm86_jit_emitter_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * globals
+ */
+
+// the host registers of the guest registers: eax, ebx, ecx, edx, esp, ebp, esi, edi
+static tb_uint8_t const g_hosts[] =
+{
+    VM86_JIT_RAX
+,   VM86_JIT_RBX
+,   VM86_JIT_RCX
+,   VM86_JIT_RDX
+,   VM86_JIT_R12
+,   VM86_JIT_RBP
+,   VM86_JIT_RSI
+,   VM86_JIT_RDI
+};
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * emitter implementation
+ */
+static __tb_inline__ tb_size_t vm86_jit_pos(vm86_jit_emitter_t* emitter)
+{
+    return tb_buffer_size(&emitter->code);
+}
+static tb_void_t vm86_jit_emit_bytes(vm86_jit_emitter_t* emitter, tb_byte_t const* data, tb_size_t size)
+{
+    tb_buffer_memncat(&emitter->code, data, size);
+}
+static tb_void_t vm86_jit_emit_u8(vm86_jit_emitter_t* emitter, tb_size_t value)
+{
+    tb_byte_t data = (tb_byte_t)value;
+    vm86_jit_emit_bytes(emitter, &data, 1);
+}
+static tb_void_t vm86_jit_emit_u16(vm86_jit_emitter_t* emitter, tb_uint32_t value)
+{
+    tb_byte_t data[2];
+    tb_bits_set_u16_le(data, value);
+    vm86_jit_emit_bytes(emitter, data, sizeof(data));
+}
+static tb_void_t vm86_jit_emit_u32(vm86_jit_emitter_t* emitter, tb_uint32_t value)
+{
+    tb_byte_t data[4];
+    tb_bits_set_u32_le(data, value);
+    vm86_jit_emit_bytes(emitter, data, sizeof(data));
+}
+static tb_void_t vm86_jit_emit_u64(vm86_jit_emitter_t* emitter, tb_uint64_t value)
+{
+    tb_byte_t data[8];
+    tb_bits_set_u64_le(data, value);
+    vm86_jit_emit_bytes(emitter, data, sizeof(data));
+}
+static tb_void_t vm86_jit_emit_imm(vm86_jit_emitter_t* emitter, tb_size_t bits, tb_uint32_t value)
+{
+    switch (bits)
+    {
+    case 8:     vm86_jit_emit_u8(emitter, value);   break;
+    case 16:    vm86_jit_emit_u16(emitter, value);  break;
+    default:    vm86_jit_emit_u32(emitter, value);  break;
+    }
+}
+/* emit the instruction with the modrm operands
+ *
+ * the high byte registers (host codes 4 - 7 of the 8-bit operands) never need the rex prefix,
+ * because only the guest registers eax, ebx, ecx and edx have the sub-registers.
+ *
+ * @param bits      the operand bits: 8, 16 or 32
+ * @param opcode    the opcode, 0x0fxx for the two-byte opcodes
+ * @param reg       the host register or the digit of the reg field
+ * @param mode      the mode of the rm operand
+ * @param rm        the host register, the base register (disp) or the index register (guest memory)
+ * @param disp      the displacement of the disp mode
+ */
+static tb_void_t vm86_jit_emit_op(vm86_jit_emitter_t* emitter, tb_size_t bits, tb_uint32_t opcode, tb_size_t reg, tb_size_t mode, tb_size_t rm, tb_uint32_t disp)
+{
+    // the operand size prefix
+    if (bits == 16) vm86_jit_emit_u8(emitter, 0x66);
+
+    // the rex prefix
+    tb_size_t rex = 0x40;
+    if (reg & 8) rex |= 0x04;
+    if (mode == VM86_JIT_MODE_MEM)
+    {
+        // [r15 + index]
+        rex |= 0x01;
+        if (rm & 8) rex |= 0x02;
+    }
+    else if (rm & 8) rex |= 0x01;
+    if (rex != 0x40) vm86_jit_emit_u8(emitter, rex);
+
+    // the opcode
+    if (opcode > 0xff) vm86_jit_emit_u8(emitter, opcode >> 8);
+    vm86_jit_emit_u8(emitter, opcode & 0xff);
+
+    // the modrm
+    switch (mode)
+    {
+    case VM86_JIT_MODE_REG:
+        vm86_jit_emit_u8(emitter, 0xc0 | ((reg & 7) << 3) | (rm & 7));
+        break;
+    case VM86_JIT_MODE_MEM:
+        vm86_jit_emit_u8(emitter, 0x04 | ((reg & 7) << 3));
+        vm86_jit_emit_u8(emitter, ((rm & 7) << 3) | (VM86_JIT_BASE & 7));
+        break;
+    default:
+        vm86_jit_emit_u8(emitter, 0x80 | ((reg & 7) << 3) | (rm & 7));
+        if ((rm & 7) == 4) vm86_jit_emit_u8(emitter, 0x24);
+        vm86_jit_emit_u32(emitter, disp);
+        break;
+    }
+}
+static tb_void_t vm86_jit_emit_label(vm86_jit_emitter_t* emitter, tb_size_t label)
+{
+    emitter->labels[label] = (tb_uint32_t)vm86_jit_pos(emitter);
+}
+static tb_void_t vm86_jit_emit_jump(vm86_jit_emitter_t* emitter, tb_size_t cond, tb_size_t label)
+{
+    // jmp rel32 or jcc rel32
+    if (cond == VM86_FLAGS_COND_ALWAYS) vm86_jit_emit_u8(emitter, 0xe9);
+    else
+    {
+        vm86_jit_emit_u8(emitter, 0x0f);
+        vm86_jit_emit_u8(emitter, 0x80 | cond);
+    }
+
+    // patch it later
+    vm86_jit_fixup_t fixup = {(tb_uint32_t)vm86_jit_pos(emitter), (tb_uint32_t)label};
+    tb_buffer_memncat(&emitter->fixups, (tb_byte_t const*)&fixup, sizeof(fixup));
+    vm86_jit_emit_u32(emitter, 0);
+}
+static tb_void_t vm86_jit_emit_addr(vm86_jit_emitter_t* emitter, tb_size_t reg, tb_uint32_t disp)
+{
+    // lea r11d, [reg + disp]
+    vm86_jit_emit_op(emitter, 32, 0x8d, VM86_JIT_TEMP, VM86_JIT_MODE_DISP, reg, disp);
+}
+static tb_void_t vm86_jit_emit_esp(vm86_jit_emitter_t* emitter, tb_uint32_t disp)
+{
+    // lea r12d, [r12 + disp], the flags are not affected
+    vm86_jit_emit_op(emitter, 32, 0x8d, VM86_JIT_R12, VM86_JIT_MODE_DISP, VM86_JIT_R12, disp);
+}
+static tb_void_t vm86_jit_emit_registers_save(vm86_jit_emitter_t* emitter)
+{
+    // mov [r14 + registers[i]], reg
+    tb_size_t i = 0;
+    for (i = 0; i < tb_arrayn(g_hosts); i++)
+        vm86_jit_emit_op(emitter, 32, 0x89, g_hosts[i], VM86_JIT_MODE_DISP, VM86_JIT_CONTEXT, (tb_uint32_t)(tb_offsetof(vm86_context_t, registers) + i * sizeof(vm86_register_t)));
+}
+static tb_void_t vm86_jit_emit_registers_load(vm86_jit_emitter_t* emitter)
+{
+    // mov reg, [r14 + registers[i]]
+    tb_size_t i = 0;
+    for (i = 0; i < tb_arrayn(g_hosts); i++)
+        vm86_jit_emit_op(emitter, 32, 0x8b, g_hosts[i], VM86_JIT_MODE_DISP, VM86_JIT_CONTEXT, (tb_uint32_t)(tb_offsetof(vm86_context_t, registers) + i * sizeof(vm86_register_t)));
+}
+static tb_void_t vm86_jit_emit_flags_save(vm86_jit_emitter_t* emitter)
+{
+    // the offsets
+    tb_uint32_t eflags  = (tb_uint32_t)(tb_offsetof(vm86_context_t, registers) + VM86_REGISTER_EFLAGS * sizeof(vm86_register_t));
+    tb_uint32_t op      = (tb_uint32_t)(tb_offsetof(vm86_context_t, flags) + tb_offsetof(vm86_flags_t, op));
+
+    // pushfq; pop r11
+    vm86_jit_emit_u8(emitter, 0x9c);
+    vm86_jit_emit_u8(emitter, 0x41);
+    vm86_jit_emit_u8(emitter, 0x58 | (VM86_JIT_TEMP & 7));
+
+    // and r11d, mask
+    vm86_jit_emit_op(emitter, 32, 0x81, VM86_JIT_ALU_AND >> 3, VM86_JIT_MODE_REG, VM86_JIT_TEMP, 0);
+    vm86_jit_emit_u32(emitter, VM86_FLAGS_MASK);
+
+    // mov r10d, [r14 + eflags]
+    vm86_jit_emit_op(emitter, 32, 0x8b, VM86_JIT_TEMP2, VM86_JIT_MODE_DISP, VM86_JIT_CONTEXT, eflags);
+
+    // and r10d, ~mask
+    vm86_jit_emit_op(emitter, 32, 0x81, VM86_JIT_ALU_AND >> 3, VM86_JIT_MODE_REG, VM86_JIT_TEMP2, 0);
+    vm86_jit_emit_u32(emitter, ~(tb_uint32_t)VM86_FLAGS_MASK);
+
+    // or r10d, r11d
+    vm86_jit_emit_op(emitter, 32, VM86_JIT_ALU_OR + 1, VM86_JIT_TEMP, VM86_JIT_MODE_REG, VM86_JIT_TEMP2, 0);
+
+    // mov [r14 + eflags], r10d
+    vm86_jit_emit_op(emitter, 32, 0x89, VM86_JIT_TEMP2, VM86_JIT_MODE_DISP, VM86_JIT_CONTEXT, eflags);
+
+    // mov dword [r14 + flags.op], VM86_FLAGS_OP_NONE
+    vm86_jit_emit_op(emitter, 32, 0xc7, 0, VM86_JIT_MODE_DISP, VM86_JIT_CONTEXT, op);
+    vm86_jit_emit_u32(emitter, VM86_FLAGS_OP_NONE);
+}
+static tb_void_t vm86_jit_emit_flags_load(vm86_jit_emitter_t* emitter)
+{
+    // mov r11d, [r14 + eflags]
+    vm86_jit_emit_op(emitter, 32, 0x8b, VM86_JIT_TEMP, VM86_JIT_MODE_DISP, VM86_JIT_CONTEXT, (tb_uint32_t)(tb_offsetof(vm86_context_t, registers) + VM86_REGISTER_EFLAGS * sizeof(vm86_register_t)));
+
+    // and r11d, mask
+    vm86_jit_emit_op(emitter, 32, 0x81, VM86_JIT_ALU_AND >> 3, VM86_JIT_MODE_REG, VM86_JIT_TEMP, 0);
+    vm86_jit_emit_u32(emitter, VM86_FLAGS_MASK);
+
+    // or r11d, 2, the reserved bit
+    vm86_jit_emit_op(emitter, 32, 0x81, VM86_JIT_ALU_OR >> 3, VM86_JIT_MODE_REG, VM86_JIT_TEMP, 0);
+    vm86_jit_emit_u32(emitter, 2);
+
+    // push r11; popfq
+    vm86_jit_emit_u8(emitter, 0x41);
+    vm86_jit_emit_u8(emitter, 0x50 | (VM86_JIT_TEMP & 7));
+    vm86_jit_emit_u8(emitter, 0x9d);
+}
+static tb_void_t vm86_jit_emit_resume(vm86_jit_emitter_t* emitter, vm86_instruction_ref_t instruction)
+{
+    // mov r13, imm64
+    vm86_jit_emit_u8(emitter, 0x49);
+    vm86_jit_emit_u8(emitter, 0xb8 | (VM86_JIT_RESUME & 7));
+    vm86_jit_emit_u64(emitter, (tb_uint64_t)(tb_size_t)instruction);
+
+    // jmp exit
+    vm86_jit_emit_jump(emitter, VM86_FLAGS_COND_ALWAYS, VM86_JIT_LABEL_EXIT(emitter->count));
+}
+static tb_void_t vm86_jit_emit_prologue(vm86_jit_emitter_t* emitter)
+{
+    // push rbx, rbp, r12, r13, r14, r15
+    static tb_byte_t const s_code[] = {0x53, 0x55, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57};
+    vm86_jit_emit_bytes(emitter, s_code, sizeof(s_code));
+
+    // sub rsp, 8, align the stack for calling the host functions
+    vm86_jit_emit_u8(emitter, 0x48);
+    vm86_jit_emit_u8(emitter, 0x83);
+    vm86_jit_emit_u8(emitter, 0xec);
+    vm86_jit_emit_u8(emitter, 0x08);
+
+    // mov r14, rdi
+    vm86_jit_emit_u8(emitter, 0x49);
+    vm86_jit_emit_u8(emitter, 0x89);
+    vm86_jit_emit_u8(emitter, 0xfe);
+
+    // mov r15, imm64
+    vm86_jit_emit_u8(emitter, 0x49);
+    vm86_jit_emit_u8(emitter, 0xb8 | (VM86_JIT_BASE & 7));
+    vm86_jit_emit_u64(emitter, (tb_uint64_t)(tb_size_t)vm86_memory_base());
+
+    // load the guest eflags and registers
+    vm86_jit_emit_flags_load(emitter);
+    vm86_jit_emit_registers_load(emitter);
+}
+static tb_void_t vm86_jit_emit_epilogue(vm86_jit_emitter_t* emitter)
+{
+    // shr r11d, 3; popfq; mov r10, imm64
+    static tb_byte_t const s_indirect[] = {0x41, 0xc1, 0xeb, 0x03, 0x9d, 0x49, 0xba};
+
+    // end: mov r13d, 0
+    vm86_jit_emit_label(emitter, VM86_JIT_LABEL_END(emitter->count));
+    vm86_jit_emit_op(emitter, 32, 0xc7, 0, VM86_JIT_MODE_REG, VM86_JIT_RESUME, 0);
+    vm86_jit_emit_u32(emitter, 0);
+
+    // exit: save the guest registers and eflags
+    vm86_jit_emit_label(emitter, VM86_JIT_LABEL_EXIT(emitter->count));
+    vm86_jit_emit_registers_save(emitter);
+    vm86_jit_emit_flags_save(emitter);
+
+    // mov rax, r13; add rsp, 8; pop r15, r14, r13, r12, rbp, rbx; ret
+    static tb_byte_t const s_code[] = {0x4c, 0x89, 0xe8, 0x48, 0x83, 0xc4, 0x08, 0x41, 0x5f, 0x41, 0x5e, 0x41, 0x5d, 0x41, 0x5c, 0x5d, 0x5b, 0xc3};
+    vm86_jit_emit_bytes(emitter, s_code, sizeof(s_code));
+
+    /* indirect: jump to the instruction of the guest address in r13d
+     *
+     * pushfq
+     * lea r11d, [r13 - instructions]
+     * cmp r11d, count * sizeof(vm86_instruction_t)
+     * jae out
+     * shr r11d, 3
+     * popfq
+     * mov r10, table
+     * jmp [r10 + r11 * 8]
+     */
+    vm86_jit_emit_label(emitter, VM86_JIT_LABEL_INDIRECT(emitter->count));
+    vm86_jit_emit_u8(emitter, 0x9c);
+    vm86_jit_emit_op(emitter, 32, 0x8d, VM86_JIT_TEMP, VM86_JIT_MODE_DISP, VM86_JIT_RESUME, (tb_uint32_t)0 - vm86_memory_addr(emitter->instructions));
+    vm86_jit_emit_op(emitter, 32, 0x81, VM86_JIT_ALU_CMP >> 3, VM86_JIT_MODE_REG, VM86_JIT_TEMP, 0);
+    vm86_jit_emit_u32(emitter, (tb_uint32_t)(emitter->count * sizeof(vm86_instruction_t)));
+    vm86_jit_emit_u8(emitter, 0x73);
+    vm86_jit_emit_u8(emitter, 0);
+    tb_size_t out = vm86_jit_pos(emitter);
+    vm86_jit_emit_bytes(emitter, s_indirect, sizeof(s_indirect));
+    emitter->table = vm86_jit_pos(emitter);
+    vm86_jit_emit_u64(emitter, 0);
+    vm86_jit_emit_u8(emitter, 0x43);
+    vm86_jit_emit_u8(emitter, 0xff);
+    vm86_jit_emit_u8(emitter, 0x24);
+    vm86_jit_emit_u8(emitter, 0xda);
+    tb_buffer_data(&emitter->code)[out - 1] = (tb_byte_t)(vm86_jit_pos(emitter) - out);
+
+    // out: popfq; lea r13, [r15 + r13]; jmp exit
+    vm86_jit_emit_u8(emitter, 0x9d);
+    vm86_jit_emit_u8(emitter, 0x4f);
+    vm86_jit_emit_u8(emitter, 0x8d);
+    vm86_jit_emit_u8(emitter, 0x2c);
+    vm86_jit_emit_u8(emitter, 0x2f);
+    vm86_jit_emit_jump(emitter, VM86_FLAGS_COND_ALWAYS, VM86_JIT_LABEL_EXIT(emitter->count));
+
+    // invalid: the misaligned target of the indirect jump, finish it
+    vm86_jit_emit_label(emitter, VM86_JIT_LABEL_INVALID(emitter->count));
+    vm86_jit_emit_jump(emitter, VM86_FLAGS_COND_ALWAYS, VM86_JIT_LABEL_END(emitter->count));
+}
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * translator implementation
+ */
+static tb_void_t vm86_jit_call(vm86_context_t* context, vm86_instruction_ref_t instruction)
+{
+    // the machine
+    vm86_machine_t* machine = (vm86_machine_t*)context->machine;
+    tb_assert(machine && instruction);
+
+    // get the function from the linked slot
+    vm86_machine_func_t func = vm86_machine_function_at(machine, instruction->v1.u32);
+
+    // check, the function must be bound before calling it
+    tb_assert_and_check_return(func);
+
+    // call the function
+    func((vm86_context_ref_t)context);
+}
+static tb_bool_t vm86_jit_reg(tb_uint8_t index, tb_size_t* preg, tb_size_t* pbits)
+{
+    // the guest register, uses the same register as vm86_registers_value()
+    tb_size_t r = index & VM86_REGISTER_MASK;
+    tb_check_return_val(r < tb_arrayn(g_hosts), tb_false);
+
+    // the host register
+    tb_size_t reg = g_hosts[r];
+    switch ((index >> 4) & 3)
+    {
+    case 0: *pbits = 32;                                            break;
+    case 1: *pbits = 8;     tb_check_return_val(reg < 4, tb_false); break;
+    case 2: *pbits = 8;     tb_check_return_val(reg < 4, tb_false); reg += 4; break;
+    default: *pbits = 16;                                           break;
+    }
+
+    // ok
+    *preg = reg;
+    return tb_true;
+}
+static tb_bool_t vm86_jit_reg32(tb_uint8_t index, tb_size_t* preg)
+{
+    // only the 32-bit register
+    tb_size_t bits = 0;
+    return vm86_jit_reg(index, preg, &bits) && bits == 32;
+}
+static tb_bool_t vm86_jit_reg_cl(tb_uint8_t index)
+{
+    // the shift count must be in cl, cx or ecx
+    tb_size_t reg = 0;
+    tb_size_t bits = 0;
+    return vm86_jit_reg(index, &reg, &bits) && reg == VM86_JIT_RCX;
+}
+static tb_bool_t vm86_jit_target(vm86_jit_emitter_t* emitter, tb_uint32_t addr, tb_size_t* plabel)
+{
+    // the offset of the target
+    tb_uint32_t offset = addr - vm86_memory_addr(emitter->instructions);
+
+    // in this proc?
+    tb_check_return_val(offset < emitter->count * sizeof(vm86_instruction_t) && !(offset % sizeof(vm86_instruction_t)), tb_false);
+
+    // ok
+    *plabel = offset / sizeof(vm86_instruction_t);
+    return tb_true;
+}
+static tb_size_t vm86_jit_opcode(vm86_instruction_ref_t instruction)
+{
+    // the head of the superinstruction executes the same as the original instruction, the native code always writes the flags
+#define VM86_JIT_UNFUSE(op, o0, n0, o1, n1) case VM86_OPCODE_##o0##_##o1: return VM86_OPCODE_##o0;
+#define VM86_JIT_NOFLAGS(op, o, n)          case VM86_OPCODE_##o##_8_NF: return VM86_OPCODE_##o##_8; case VM86_OPCODE_##o##_16_NF: return VM86_OPCODE_##o##_16; case VM86_OPCODE_##o##_32_NF: return VM86_OPCODE_##o##_32;
+    switch (instruction->opcode)
+    {
+    case VM86_OPCODE_PUSH_EBP_MOV_EBP_ESP:      return VM86_OPCODE_PUSH_R0;
+    case VM86_OPCODE_MOV_ESP_EBP_POP_EBP_RETN:  return VM86_OPCODE_MOV_R0_R1_32;
+    case VM86_OPCODE_PUSH_R0_CALL:              return VM86_OPCODE_PUSH_R0;
+    case VM86_OPCODE_PUSH_V0_CALL:              return VM86_OPCODE_PUSH_V0;
+    VM86_OPCODE_FUSED_LIST(_, VM86_JIT_UNFUSE)
+    VM86_OPCODE_NOFLAGS_LIST(_, VM86_JIT_NOFLAGS)
+    default:                                    return instruction->opcode;
+    }
+#undef VM86_JIT_UNFUSE
+#undef VM86_JIT_NOFLAGS
+}
+static tb_bool_t vm86_jit_emit_alu_r0_r1(vm86_jit_emitter_t* emitter, vm86_instruction_ref_t instruction, tb_size_t alu)
+{
+    // the registers
+    tb_size_t r0 = 0;
+    tb_size_t r1 = 0;
+    tb_size_t bits0 = 0;
+    tb_size_t bits1 = 0;
+    tb_check_return_val(vm86_jit_reg(instruction->r0, &r0, &bits0) && vm86_jit_reg(instruction->r1, &r1, &bits1) && bits0 == bits1, tb_false);
+
+    // op r0, r1
+    vm86_jit_emit_op(emitter, bits0, bits0 == 8? alu : alu + 1, r1, VM86_JIT_MODE_REG, r0, 0);
+    return tb_true;
+}
+static tb_bool_t vm86_jit_emit_alu_r0_v0(vm86_jit_emitter_t* emitter, vm86_instruction_ref_t instruction, tb_size_t alu)
+{
+    // the register
+    tb_size_t r0 = 0;
+    tb_size_t bits = 0;
+    tb_check_return_val(vm86_jit_reg(instruction->r0, &r0, &bits), tb_false);
+
+    // mov r0, v0
+    if (alu == VM86_JIT_ALU_MOV)
+    {
+        if (bits == 16) vm86_jit_emit_u8(emitter, 0x66);
+        if (r0 & 8) vm86_jit_emit_u8(emitter, 0x41);
+        vm86_jit_emit_u8(emitter, (bits == 8? 0xb0 : 0xb8) | (r0 & 7));
+    }
+    // op r0, v0
+    else vm86_jit_emit_op(emitter, bits, bits == 8? 0x80 : 0x81, alu >> 3, VM86_JIT_MODE_REG, r0, 0);
+
+    // the immediate value
+    vm86_jit_emit_imm(emitter, bits, instruction->v0.u32);
+    return tb_true;
+}
+static tb_bool_t vm86_jit_emit_alu_r0_$r1_add_v0$(vm86_jit_emitter_t* emitter, vm86_instruction_ref_t instruction, tb_size_t alu)
+{
+    // the registers
+    tb_size_t r0 = 0;
+    tb_size_t r1 = 0;
+    tb_check_return_val(vm86_jit_reg32(instruction->r0, &r0) && vm86_jit_reg32(instruction->r1, &r1), tb_false);
+
+    // lea r11d, [r1 + v0]; op r0, [r15 + r11]
+    vm86_jit_emit_addr(emitter, r1, instruction->v0.u32);
+    vm86_jit_emit_op(emitter, 32, alu + 3, r0, VM86_JIT_MODE_MEM, VM86_JIT_TEMP, 0);
+    return tb_true;
+}
+static tb_bool_t vm86_jit_emit_alu_$r0_add_v0$_r1(vm86_jit_emitter_t* emitter, vm86_instruction_ref_t instruction, tb_size_t alu)
+{
+    // the registers
+    tb_size_t r0 = 0;
+    tb_size_t r1 = 0;
+    tb_check_return_val(vm86_jit_reg32(instruction->r0, &r0) && vm86_jit_reg32(instruction->r1, &r1), tb_false);
+
+    // lea r11d, [r0 + v0]; op [r15 + r11], r1
+    vm86_jit_emit_addr(emitter, r0, instruction->v0.u32);
+    vm86_jit_emit_op(emitter, 32, alu + 1, r1, VM86_JIT_MODE_MEM, VM86_JIT_TEMP, 0);
+    return tb_true;
+}
+static tb_bool_t vm86_jit_emit_alu_$r0_add_v0$_v1(vm86_jit_emitter_t* emitter, vm86_instruction_ref_t instruction, tb_size_t alu)
+{
+    // the register
+    tb_size_t r0 = 0;
+    tb_check_return_val(vm86_jit_reg32(instruction->r0, &r0), tb_false);
+
+    // lea r11d, [r0 + v0]; op dword [r15 + r11], v1
+    vm86_jit_emit_addr(emitter, r0, instruction->v0.u32);
+    if (alu == VM86_JIT_ALU_MOV) vm86_jit_emit_op(emitter, 32, 0xc7, 0, VM86_JIT_MODE_MEM, VM86_JIT_TEMP, 0);
+    else vm86_jit_emit_op(emitter, 32, 0x81, alu >> 3, VM86_JIT_MODE_MEM, VM86_JIT_TEMP, 0);
+    vm86_jit_emit_u32(emitter, instruction->v1.u32);
+    return tb_true;
+}
+static tb_bool_t vm86_jit_emit_shift_r0_r1(vm86_jit_emitter_t* emitter, vm86_instruction_ref_t instruction, tb_size_t digit)
+{
+    // the register, the count must be in cl
+    tb_size_t r0 = 0;
+    tb_size_t bits = 0;
+    tb_check_return_val(vm86_jit_reg(instruction->r0, &r0, &bits) && vm86_jit_reg_cl(instruction->r1), tb_false);
+
+    // op r0, cl, the host masks the count and keeps the flags if it is zero too
+    vm86_jit_emit_op(emitter, bits, bits == 8? 0xd2 : 0xd3, digit, VM86_JIT_MODE_REG, r0, 0);
+    return tb_true;
+}
+static tb_bool_t vm86_jit_emit_shift_r0_v0(vm86_jit_emitter_t* emitter, vm86_instruction_ref_t instruction, tb_size_t digit)
+{
+    // the register
+    tb_size_t r0 = 0;
+    tb_size_t bits = 0;
+    tb_check_return_val(vm86_jit_reg(instruction->r0, &r0, &bits), tb_false);
+
+    // nothing to do if the count is zero
+    tb_uint32_t count = instruction->v0.u32 & 0x1f;
+    tb_check_return_val(count, tb_true);
+
+    // op r0, count
+    vm86_jit_emit_op(emitter, bits, bits == 8? 0xc0 : 0xc1, digit, VM86_JIT_MODE_REG, r0, 0);
+    vm86_jit_emit_u8(emitter, count);
+    return tb_true;
+}
+static tb_bool_t vm86_jit_emit_instruction(vm86_jit_emitter_t* emitter, tb_size_t index)
+{
+    // the instruction
+    vm86_instruction_ref_t instruction = emitter->instructions + index;
+
+    // the registers
+    tb_size_t r0 = 0;
+    tb_size_t r1 = 0;
+    tb_size_t r2 = 0;
+    tb_size_t bits = 0;
+    tb_size_t label = 0;
+
+    // done
+    tb_bool_t ok = tb_true;
+    switch (vm86_jit_opcode(instruction))
+    {
+    case VM86_OPCODE_LEAVE:
+        {
+            // lea esp, [ebp + 4] and finish it, the popped value is dropped like the interpreter
+            vm86_jit_emit_op(emitter, 32, 0x8d, VM86_JIT_R12, VM86_JIT_MODE_DISP, VM86_JIT_RBP, 4);
+            vm86_jit_emit_jump(emitter, VM86_FLAGS_COND_ALWAYS, VM86_JIT_LABEL_END(emitter->count));
+        }
+        break;
+    case VM86_OPCODE_RETN:
+        {
+            // pop the stub return address and finish it
+            vm86_jit_emit_esp(emitter, 4);
+            vm86_jit_emit_jump(emitter, VM86_FLAGS_COND_ALWAYS, VM86_JIT_LABEL_END(emitter->count));
+        }
+        break;
+    case VM86_OPCODE_CALL:
+        {
+            // save the guest state, the function may read the registers and the eflags
+            vm86_jit_emit_registers_save(emitter);
+            vm86_jit_emit_flags_save(emitter);
+
+            // mov rdi, r14
+            vm86_jit_emit_u8(emitter, 0x4c);
+            vm86_jit_emit_u8(emitter, 0x89);
+            vm86_jit_emit_u8(emitter, 0xf7);
+
+            // mov rsi, instruction
+            vm86_jit_emit_u8(emitter, 0x48);
+            vm86_jit_emit_u8(emitter, 0xbe);
+            vm86_jit_emit_u64(emitter, (tb_uint64_t)(tb_size_t)instruction);
+
+            // mov rax, vm86_jit_call; call rax
+            vm86_jit_emit_u8(emitter, 0x48);
+            vm86_jit_emit_u8(emitter, 0xb8);
+            vm86_jit_emit_u64(emitter, (tb_uint64_t)(tb_size_t)vm86_jit_call);
+            vm86_jit_emit_u8(emitter, 0xff);
+            vm86_jit_emit_u8(emitter, 0xd0);
+
+            // reload the guest state, the function may modify them
+            vm86_jit_emit_flags_load(emitter);
+            vm86_jit_emit_registers_load(emitter);
+        }
+        break;
+    case VM86_OPCODE_PUSH_R0:
+        {
+            // lea r12d, [r12 - 4]; mov [r15 + r12], r0
+            if (!vm86_jit_reg32(instruction->r0, &r0)) ok = tb_false;
+            else
+            {
+                vm86_jit_emit_esp(emitter, (tb_uint32_t)-4);
+                vm86_jit_emit_op(emitter, 32, 0x89, r0, VM86_JIT_MODE_MEM, VM86_JIT_R12, 0);
+            }
+        }
+        break;
+    case VM86_OPCODE_PUSH_V0:
+        {
+            // lea r12d, [r12 - 4]; mov dword [r15 + r12], v0
+            vm86_jit_emit_esp(emitter, (tb_uint32_t)-4);
+            vm86_jit_emit_op(emitter, 32, 0xc7, 0, VM86_JIT_MODE_MEM, VM86_JIT_R12, 0);
+            vm86_jit_emit_u32(emitter, instruction->v0.u32);
+        }
+        break;
+    case VM86_OPCODE_POP_R0:
+        {
+            // mov r0, [r15 + r12]; lea r12d, [r12 + 4]
+            if (!vm86_jit_reg32(instruction->r0, &r0)) ok = tb_false;
+            else if (r0 != VM86_JIT_R12)
+            {
+                vm86_jit_emit_op(emitter, 32, 0x8b, r0, VM86_JIT_MODE_MEM, VM86_JIT_R12, 0);
+                vm86_jit_emit_esp(emitter, 4);
+            }
+            // pop esp
+            else
+            {
+                vm86_jit_emit_op(emitter, 32, 0x8b, VM86_JIT_TEMP, VM86_JIT_MODE_MEM, VM86_JIT_R12, 0);
+                vm86_jit_emit_op(emitter, 32, 0x89, VM86_JIT_TEMP, VM86_JIT_MODE_REG, VM86_JIT_R12, 0);
+            }
+        }
+        break;
+    case VM86_OPCODE_MOV_R0_R1:
+    case VM86_OPCODE_MOV_R0_R1_8:
+    case VM86_OPCODE_MOV_R0_R1_16:
+    case VM86_OPCODE_MOV_R0_R1_32:
+        ok = vm86_jit_emit_alu_r0_r1(emitter, instruction, VM86_JIT_ALU_MOV);
+        break;
+    case VM86_OPCODE_MOV_R0_V0:
+    case VM86_OPCODE_MOV_R0_V0_8:
+    case VM86_OPCODE_MOV_R0_V0_16:
+    case VM86_OPCODE_MOV_R0_V0_32:
+        ok = vm86_jit_emit_alu_r0_v0(emitter, instruction, VM86_JIT_ALU_MOV);
+        break;
+    case VM86_OPCODE_MOV_R0_$R1_ADD_V0$:
+        ok = vm86_jit_emit_alu_r0_$r1_add_v0$(emitter, instruction, VM86_JIT_ALU_MOV);
+        break;
+    case VM86_OPCODE_MOV_$R0_ADD_V0$_R1:
+        ok = vm86_jit_emit_alu_$r0_add_v0$_r1(emitter, instruction, VM86_JIT_ALU_MOV);
+        break;
+    case VM86_OPCODE_MOV_$R0_ADD_V0$_V1:
+        ok = vm86_jit_emit_alu_$r0_add_v0$_v1(emitter, instruction, VM86_JIT_ALU_MOV);
+        break;
+    case VM86_OPCODE_MOVZX_R0_R1:
+        {
+            // movzx r0, r1
+            if (!vm86_jit_reg32(instruction->r0, &r0) || !vm86_jit_reg(instruction->r1, &r1, &bits)) ok = tb_false;
+            else if (bits == 32) vm86_jit_emit_op(emitter, 32, 0x89, r1, VM86_JIT_MODE_REG, r0, 0);
+            else if (bits == 16) vm86_jit_emit_op(emitter, 32, 0x0fb7, r0, VM86_JIT_MODE_REG, r1, 0);
+            // the high byte register cannot be encoded with the rex prefix
+            else if ((r0 & 8) && r1 >= 4) ok = tb_false;
+            else vm86_jit_emit_op(emitter, 32, 0x0fb6, r0, VM86_JIT_MODE_REG, r1, 0);
+        }
+        break;
+    case VM86_OPCODE_ADD_R0_R1:
+    case VM86_OPCODE_ADD_R0_R1_8:
+    case VM86_OPCODE_ADD_R0_R1_16:
+    case VM86_OPCODE_ADD_R0_R1_32:
+        ok = vm86_jit_emit_alu_r0_r1(emitter, instruction, VM86_JIT_ALU_ADD);
+        break;
+    case VM86_OPCODE_ADD_R0_V0:
+    case VM86_OPCODE_ADD_R0_V0_8:
+    case VM86_OPCODE_ADD_R0_V0_16:
+    case VM86_OPCODE_ADD_R0_V0_32:
+        ok = vm86_jit_emit_alu_r0_v0(emitter, instruction, VM86_JIT_ALU_ADD);
+        break;
+    case VM86_OPCODE_ADD_R0_$R1_ADD_V0$:
+        ok = vm86_jit_emit_alu_r0_$r1_add_v0$(emitter, instruction, VM86_JIT_ALU_ADD);
+        break;
+    case VM86_OPCODE_SUB_R0_R1:
+    case VM86_OPCODE_SUB_R0_R1_8:
+    case VM86_OPCODE_SUB_R0_R1_16:
+    case VM86_OPCODE_SUB_R0_R1_32:
+        ok = vm86_jit_emit_alu_r0_r1(emitter, instruction, VM86_JIT_ALU_SUB);
+        break;
+    case VM86_OPCODE_SUB_R0_V0:
+    case VM86_OPCODE_SUB_R0_V0_8:
+    case VM86_OPCODE_SUB_R0_V0_16:
+    case VM86_OPCODE_SUB_R0_V0_32:
+        ok = vm86_jit_emit_alu_r0_v0(emitter, instruction, VM86_JIT_ALU_SUB);
+        break;
+    case VM86_OPCODE_SUB_R0_$R1_ADD_V0$:
+        ok = vm86_jit_emit_alu_r0_$r1_add_v0$(emitter, instruction, VM86_JIT_ALU_SUB);
+        break;
+    case VM86_OPCODE_LEA_R0_$R1_ADD_R2_OP_V0$:
+        {
+            // the registers
+            if (!vm86_jit_reg32(instruction->r0, &r0) || !vm86_jit_reg32(instruction->r1, &r1) || !vm86_jit_reg32(instruction->r2, &r2))
+            {
+                ok = tb_false;
+                break;
+            }
+
+            // the scale and the displacement
+            tb_size_t   scale = 0;
+            tb_uint32_t disp = instruction->v0.u32;
+            if (instruction->op == '*')
+            {
+                // only 1, 2, 4 and 8 can be encoded
+                switch (disp)
+                {
+                case 1: scale = 0; break;
+                case 2: scale = 1; break;
+                case 4: scale = 2; break;
+                case 8: scale = 3; break;
+                default: ok = tb_false; break;
+                }
+                disp = 0;
+            }
+            tb_check_break(ok);
+
+            // lea r0, [r1 + r2 * scale + disp32]
+            tb_size_t rex = 0x40 | ((r0 & 8)? 0x04 : 0) | ((r2 & 8)? 0x02 : 0) | ((r1 & 8)? 0x01 : 0);
+            if (rex != 0x40) vm86_jit_emit_u8(emitter, rex);
+            vm86_jit_emit_u8(emitter, 0x8d);
+            vm86_jit_emit_u8(emitter, 0x84 | ((r0 & 7) << 3));
+            vm86_jit_emit_u8(emitter, (scale << 6) | ((r2 & 7) << 3) | (r1 & 7));
+            vm86_jit_emit_u32(emitter, disp);
+        }
+        break;
+    case VM86_OPCODE_JXX_R0:
+        {
+            // skip it if the condition is not satisfied
+            if (!vm86_jit_reg32(instruction->r0, &r0))
+            {
+                ok = tb_false;
+                break;
+            }
+            if (instruction->cond != VM86_FLAGS_COND_ALWAYS) vm86_jit_emit_jump(emitter, instruction->cond ^ 1, index + 1);
+
+            // mov r13d, r0; jmp indirect
+            vm86_jit_emit_op(emitter, 32, 0x89, r0, VM86_JIT_MODE_REG, VM86_JIT_RESUME, 0);
+            vm86_jit_emit_jump(emitter, VM86_FLAGS_COND_ALWAYS, VM86_JIT_LABEL_INDIRECT(emitter->count));
+        }
+        break;
+    case VM86_OPCODE_JXX_V0:
+        {
+            // jump to the native label if the target is in this proc
+            if (vm86_jit_target(emitter, instruction->v0.u32, &label)) vm86_jit_emit_jump(emitter, instruction->cond, label);
+            else
+            {
+                // continue in the interpreter from the target
+                if (instruction->cond != VM86_FLAGS_COND_ALWAYS) vm86_jit_emit_jump(emitter, instruction->cond ^ 1, index + 1);
+                vm86_jit_emit_resume(emitter, (vm86_instruction_ref_t)vm86_memory_ptr(instruction->v0.u32));
+            }
+        }
+        break;
+    case VM86_OPCODE_JXX_V0$R0_MUL_V1$:
+        {
+            // the scale, the jump table in the .data is still read by the native code
+            tb_size_t scale = 0;
+            if (!vm86_jit_reg32(instruction->r0, &r0)) ok = tb_false;
+            else
+            {
+                switch (instruction->v1.u32)
+                {
+                case 1: scale = 0; break;
+                case 2: scale = 1; break;
+                case 4: scale = 2; break;
+                case 8: scale = 3; break;
+                default: ok = tb_false; break;
+                }
+            }
+            tb_check_break(ok);
+
+            // skip it if the condition is not satisfied
+            if (instruction->cond != VM86_FLAGS_COND_ALWAYS) vm86_jit_emit_jump(emitter, instruction->cond ^ 1, index + 1);
+
+            // lea r11d, [r0 * scale + v0]
+            vm86_jit_emit_u8(emitter, 0x44 | ((r0 & 8)? 0x02 : 0));
+            vm86_jit_emit_u8(emitter, 0x8d);
+            vm86_jit_emit_u8(emitter, 0x04 | ((VM86_JIT_TEMP & 7) << 3));
+            vm86_jit_emit_u8(emitter, (scale << 6) | ((r0 & 7) << 3) | 5);
+            vm86_jit_emit_u32(emitter, instruction->v0.u32);
+
+            // mov r13d, [r15 + r11]; jmp indirect
+            vm86_jit_emit_op(emitter, 32, 0x8b, VM86_JIT_RESUME, VM86_JIT_MODE_MEM, VM86_JIT_TEMP, 0);
+            vm86_jit_emit_jump(emitter, VM86_FLAGS_COND_ALWAYS, VM86_JIT_LABEL_INDIRECT(emitter->count));
+        }
+        break;
+    case VM86_OPCODE_JXX_TABLE_R0:
+        {
+            // the index register
+            if (!vm86_jit_reg32(instruction->r0, &r0))
+            {
+                ok = tb_false;
+                break;
+            }
+
+            // skip it if the condition is not satisfied
+            if (instruction->cond != VM86_FLAGS_COND_ALWAYS) vm86_jit_emit_jump(emitter, instruction->cond ^ 1, index + 1);
+
+            /* jump by the native table of the host labels, it is made from the dispatch table after the code is mapped,
+             * out of the dispatch table? continue in the interpreter from this jump and it will be stopped there
+             *
+             * pushfq
+             * cmp r0d, count
+             * jae out
+             * popfq
+             * mov r11d, r0d
+             * mov r10, table
+             * jmp [r10 + r11 * 8]
+             * out: popfq; mov r13, instruction; jmp exit
+             */
+            vm86_jit_emit_u8(emitter, 0x9c);
+            vm86_jit_emit_op(emitter, 32, 0x81, VM86_JIT_ALU_CMP >> 3, VM86_JIT_MODE_REG, r0, 0);
+            vm86_jit_emit_u32(emitter, ((tb_uint32_t const*)vm86_memory_ptr(instruction->v1.u32))[0]);
+            vm86_jit_emit_u8(emitter, 0x73);
+            vm86_jit_emit_u8(emitter, 0);
+            tb_size_t out = vm86_jit_pos(emitter);
+            vm86_jit_emit_u8(emitter, 0x9d);
+            vm86_jit_emit_op(emitter, 32, 0x8b, VM86_JIT_TEMP, VM86_JIT_MODE_REG, r0, 0);
+            vm86_jit_emit_u8(emitter, 0x49);
+            vm86_jit_emit_u8(emitter, 0xba);
+            vm86_jit_table_t table = {(tb_uint32_t)vm86_jit_pos(emitter), (tb_uint32_t)index};
+            tb_buffer_memncat(&emitter->tables, (tb_byte_t const*)&table, sizeof(table));
+            vm86_jit_emit_u64(emitter, 0);
+            vm86_jit_emit_u8(emitter, 0x43);
+            vm86_jit_emit_u8(emitter, 0xff);
+            vm86_jit_emit_u8(emitter, 0x24);
+            vm86_jit_emit_u8(emitter, 0xda);
+            tb_buffer_data(&emitter->code)[out - 1] = (tb_byte_t)(vm86_jit_pos(emitter) - out);
+            vm86_jit_emit_u8(emitter, 0x9d);
+            vm86_jit_emit_resume(emitter, instruction);
+        }
+        break;
+    case VM86_OPCODE_CMP_R0_R1:
+    case VM86_OPCODE_CMP_R0_R1_8:
+    case VM86_OPCODE_CMP_R0_R1_16:
+    case VM86_OPCODE_CMP_R0_R1_32:
+        ok = vm86_jit_emit_alu_r0_r1(emitter, instruction, VM86_JIT_ALU_CMP);
+        break;
+    case VM86_OPCODE_CMP_R0_V0:
+    case VM86_OPCODE_CMP_R0_V0_8:
+    case VM86_OPCODE_CMP_R0_V0_16:
+    case VM86_OPCODE_CMP_R0_V0_32:
+        ok = vm86_jit_emit_alu_r0_v0(emitter, instruction, VM86_JIT_ALU_CMP);
+        break;
+    case VM86_OPCODE_CMP_R0_$R1_ADD_V0$:
+        ok = vm86_jit_emit_alu_r0_$r1_add_v0$(emitter, instruction, VM86_JIT_ALU_CMP);
+        break;
+    case VM86_OPCODE_CMP_$R0_ADD_V0$_R1:
+        ok = vm86_jit_emit_alu_$r0_add_v0$_r1(emitter, instruction, VM86_JIT_ALU_CMP);
+        break;
+    case VM86_OPCODE_CMP_$R0_ADD_V0$_V1:
+        ok = vm86_jit_emit_alu_$r0_add_v0$_v1(emitter, instruction, VM86_JIT_ALU_CMP);
+        break;
+    case VM86_OPCODE_SHRD_R0_R1_R2:
+        {
+            // shrd r0, r1, cl
+            if (!vm86_jit_reg32(instruction->r0, &r0) || !vm86_jit_reg32(instruction->r1, &r1) || !vm86_jit_reg_cl(instruction->r2)) ok = tb_false;
+            else vm86_jit_emit_op(emitter, 32, 0x0fad, r1, VM86_JIT_MODE_REG, r0, 0);
+        }
+        break;
+    case VM86_OPCODE_SHR_R0_R1:
+        ok = vm86_jit_emit_shift_r0_r1(emitter, instruction, VM86_JIT_SHIFT_SHR);
+        break;
+    case VM86_OPCODE_SHR_R0_V0:
+    case VM86_OPCODE_SHR_R0_V0_8:
+    case VM86_OPCODE_SHR_R0_V0_16:
+    case VM86_OPCODE_SHR_R0_V0_32:
+        ok = vm86_jit_emit_shift_r0_v0(emitter, instruction, VM86_JIT_SHIFT_SHR);
+        break;
+    case VM86_OPCODE_SHL_R0_R1:
+        ok = vm86_jit_emit_shift_r0_r1(emitter, instruction, VM86_JIT_SHIFT_SHL);
+        break;
+    case VM86_OPCODE_SHL_R0_V0:
+    case VM86_OPCODE_SHL_R0_V0_8:
+    case VM86_OPCODE_SHL_R0_V0_16:
+    case VM86_OPCODE_SHL_R0_V0_32:
+        ok = vm86_jit_emit_shift_r0_v0(emitter, instruction, VM86_JIT_SHIFT_SHL);
+        break;
+    case VM86_OPCODE_SAR_R0_R1:
+        ok = vm86_jit_emit_shift_r0_r1(emitter, instruction, VM86_JIT_SHIFT_SAR);
+        break;
+    case VM86_OPCODE_SAR_R0_V0:
+    case VM86_OPCODE_SAR_R0_V0_8:
+    case VM86_OPCODE_SAR_R0_V0_16:
+    case VM86_OPCODE_SAR_R0_V0_32:
+        ok = vm86_jit_emit_shift_r0_v0(emitter, instruction, VM86_JIT_SHIFT_SAR);
+        break;
+    case VM86_OPCODE_AND_R0_R1:
+    case VM86_OPCODE_AND_R0_R1_8:
+    case VM86_OPCODE_AND_R0_R1_16:
+    case VM86_OPCODE_AND_R0_R1_32:
+        ok = vm86_jit_emit_alu_r0_r1(emitter, instruction, VM86_JIT_ALU_AND);
+        break;
+    case VM86_OPCODE_AND_R0_V0:
+    case VM86_OPCODE_AND_R0_V0_8:
+    case VM86_OPCODE_AND_R0_V0_16:
+    case VM86_OPCODE_AND_R0_V0_32:
+        ok = vm86_jit_emit_alu_r0_v0(emitter, instruction, VM86_JIT_ALU_AND);
+        break;
+    case VM86_OPCODE_AND_R0_$R1_ADD_V0$:
+        ok = vm86_jit_emit_alu_r0_$r1_add_v0$(emitter, instruction, VM86_JIT_ALU_AND);
+        break;
+    case VM86_OPCODE_XOR_R0_R1:
+    case VM86_OPCODE_XOR_R0_R1_8:
+    case VM86_OPCODE_XOR_R0_R1_16:
+    case VM86_OPCODE_XOR_R0_R1_32:
+        ok = vm86_jit_emit_alu_r0_r1(emitter, instruction, VM86_JIT_ALU_XOR);
+        break;
+    case VM86_OPCODE_XOR_R0_V0:
+    case VM86_OPCODE_XOR_R0_V0_8:
+    case VM86_OPCODE_XOR_R0_V0_16:
+    case VM86_OPCODE_XOR_R0_V0_32:
+        ok = vm86_jit_emit_alu_r0_v0(emitter, instruction, VM86_JIT_ALU_XOR);
+        break;
+    case VM86_OPCODE_XOR_R0_$R1_ADD_V0$:
+        ok = vm86_jit_emit_alu_r0_$r1_add_v0$(emitter, instruction, VM86_JIT_ALU_XOR);
+        break;
+    case VM86_OPCODE_OR_R0_V0:
+    case VM86_OPCODE_OR_R0_V0_8:
+    case VM86_OPCODE_OR_R0_V0_16:
+    case VM86_OPCODE_OR_R0_V0_32:
+        ok = vm86_jit_emit_alu_r0_v0(emitter, instruction, VM86_JIT_ALU_OR);
+        break;
+    case VM86_OPCODE_OR_R0_$R1_ADD_V0$:
+        ok = vm86_jit_emit_alu_r0_$r1_add_v0$(emitter, instruction, VM86_JIT_ALU_OR);
+        break;
+    case VM86_OPCODE_NOT_R0:
+        {
+            // not r0
+            if (!vm86_jit_reg(instruction->r0, &r0, &bits)) ok = tb_false;
+            else vm86_jit_emit_op(emitter, bits, bits == 8? 0xf6 : 0xf7, 2, VM86_JIT_MODE_REG, r0, 0);
+        }
+        break;
+    case VM86_OPCODE_MUL_$R0_ADD_V0$:
+        {
+            // lea r11d, [r0 + v0]; mul dword [r15 + r11]
+            if (!vm86_jit_reg32(instruction->r0, &r0)) ok = tb_false;
+            else
+            {
+                vm86_jit_emit_addr(emitter, r0, instruction->v0.u32);
+                vm86_jit_emit_op(emitter, 32, 0xf7, 4, VM86_JIT_MODE_MEM, VM86_JIT_TEMP, 0);
+            }
+        }
+        break;
+    case VM86_OPCODE_IMUL_R0_$R1_ADD_V0$:
+        {
+            // lea r11d, [r1 + v0]; imul r0, [r15 + r11]
+            if (!vm86_jit_reg32(instruction->r0, &r0) || !vm86_jit_reg32(instruction->r1, &r1)) ok = tb_false;
+            else
+            {
+                vm86_jit_emit_addr(emitter, r1, instruction->v0.u32);
+                vm86_jit_emit_op(emitter, 32, 0x0faf, r0, VM86_JIT_MODE_MEM, VM86_JIT_TEMP, 0);
+            }
+        }
+        break;
+    case VM86_OPCODE_DIV_$R0_ADD_V0$:
+        {
+            // lea r11d, [r0 + v0]; div dword [r15 + r11]
+            if (!vm86_jit_reg32(instruction->r0, &r0)) ok = tb_false;
+            else
+            {
+                vm86_jit_emit_addr(emitter, r0, instruction->v0.u32);
+                vm86_jit_emit_op(emitter, 32, 0xf7, 6, VM86_JIT_MODE_MEM, VM86_JIT_TEMP, 0);
+            }
+        }
+        break;
+    default:
+        ok = tb_false;
+        break;
+    }
+
+    // trace
+    if (!ok) tb_trace_d("unsupported opcode: %u", instruction->opcode);
+
+    // ok?
+    return ok;
+}
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * implementation
+ */
+vm86_jit_ref_t vm86_jit_init(vm86_instruction_ref_t instructions, tb_size_t count)
+{
+    // check
+    tb_assert_and_check_return_val(instructions && count, tb_null);
+
+    // the indirect jump table indexes the instructions by (offset / 8)
+    tb_assert_static(!(sizeof(vm86_instruction_t) % 8));
+
+    // init the emitter
+    vm86_jit_emitter_t emitter;
+    tb_memset(&emitter, 0, sizeof(emitter));
+    emitter.instructions    = instructions;
+    emitter.count           = count;
+
+    // done
+    tb_bool_t       ok = tb_false;
+    vm86_jit_ref_t  jit = tb_null;
+    tb_byte_t*      code = (tb_byte_t*)MAP_FAILED;
+    tb_size_t       size = 0;
+    do
+    {
+        // init the buffers
+        if (!tb_buffer_init(&emitter.code)) break;
+        if (!tb_buffer_init(&emitter.fixups)) break;
+        if (!tb_buffer_init(&emitter.tables)) break;
+
+        // init the labels
+        emitter.labels = tb_nalloc0_type(VM86_JIT_LABEL_MAXN(count), tb_uint32_t);
+        tb_assert_and_check_break(emitter.labels);
+
+        // emit the prologue
+        vm86_jit_emit_prologue(&emitter);
+
+        // emit the instructions
+        tb_size_t i = 0;
+        for (i = 0; i < count; i++)
+        {
+            vm86_jit_emit_label(&emitter, i);
+            if (!vm86_jit_emit_instruction(&emitter, i)) break;
+        }
+        tb_check_break(i == count);
+
+        // emit the epilogue and the stubs
+        vm86_jit_emit_epilogue(&emitter);
+
+        // the indirect jump table after the code
+        tb_size_t table = tb_align(vm86_jit_pos(&emitter), 8);
+        tb_size_t slots = count * sizeof(vm86_instruction_t) / 8;
+
+        // the native jump tables after the indirect jump table
+        vm86_jit_table_t const* native = (vm86_jit_table_t const*)tb_buffer_data(&emitter.tables);
+        tb_size_t               natives = tb_buffer_size(&emitter.tables) / sizeof(vm86_jit_table_t);
+        tb_size_t               entries = 0;
+        for (i = 0; i < natives; i++)
+            entries += ((tb_uint32_t const*)vm86_memory_ptr(emitter.instructions[native[i].index].v1.u32))[0];
+        size = tb_align(table + (slots + entries) * sizeof(tb_uint64_t), VM86_MEMORY_PAGE_SIZE);
+
+        // map the code pages
+        code = (tb_byte_t*)mmap(tb_null, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        tb_assert_and_check_break(code != MAP_FAILED);
+
+        // copy the code
+        tb_memcpy(code, tb_buffer_data(&emitter.code), vm86_jit_pos(&emitter));
+
+        // patch the jumps
+        vm86_jit_fixup_t const* fixup = (vm86_jit_fixup_t const*)tb_buffer_data(&emitter.fixups);
+        tb_size_t               fixups = tb_buffer_size(&emitter.fixups) / sizeof(vm86_jit_fixup_t);
+        for (i = 0; i < fixups; i++, fixup++)
+            tb_bits_set_u32_le(code + fixup->pos, (tb_uint32_t)(emitter.labels[fixup->label] - (fixup->pos + 4)));
+
+        // patch the address of the indirect jump table
+        tb_bits_set_u64_le(code + emitter.table, (tb_uint64_t)(tb_size_t)(code + table));
+
+        // fill the indirect jump table, the misaligned slots jump to the invalid stub
+        tb_uint64_t* slot = (tb_uint64_t*)(code + table);
+        for (i = 0; i < slots; i++)
+        {
+            tb_size_t offset = i * 8;
+            tb_size_t label = (offset % sizeof(vm86_instruction_t))? VM86_JIT_LABEL_INVALID(count) : offset / sizeof(vm86_instruction_t);
+            slot[i] = (tb_uint64_t)(tb_size_t)(code + emitter.labels[label]);
+        }
+
+        // fill the native jump tables with the host labels of the dispatch tables, the targets out of this proc jump to the invalid stub
+        slot += slots;
+        for (i = 0; i < natives; i++, native++)
+        {
+            // patch the address of this table
+            tb_bits_set_u64_le(code + native->pos, (tb_uint64_t)(tb_size_t)slot);
+
+            // fill it
+            tb_uint32_t const*  dispatch = (tb_uint32_t const*)vm86_memory_ptr(emitter.instructions[native->index].v1.u32);
+            tb_uint32_t         j = 0;
+            for (j = 0; j < dispatch[0]; j++)
+            {
+                tb_uint32_t target = native->index + dispatch[j + 1];
+                *slot++ = (tb_uint64_t)(tb_size_t)(code + emitter.labels[target < count? target : VM86_JIT_LABEL_INVALID(count)]);
+            }
+        }
+
+        // make it executable
+        if (mprotect(code, size, PROT_READ | PROT_EXEC) != 0) break;
+
+        // make the jit code
+        jit = tb_malloc0_type(vm86_jit_t);
+        tb_assert_and_check_break(jit);
+        jit->code = code;
+        jit->size = size;
+
+        // trace
+        tb_trace_d("init: %lu instructions => %lu bytes", count, vm86_jit_pos(&emitter));
+
+        // ok
+        ok = tb_true;
+
+    } while (0);
+
+    // failed?
+    if (!ok && code != MAP_FAILED) munmap(code, size);
+
+    // exit the emitter
+    if (emitter.labels) tb_free(emitter.labels);
+    tb_buffer_exit(&emitter.tables);
+    tb_buffer_exit(&emitter.fixups);
+    tb_buffer_exit(&emitter.code);
+
+    // ok?
+    return jit;
+}
+tb_void_t vm86_jit_exit(vm86_jit_ref_t jit)
+{
+    // check
+    tb_check_return(jit);
+
+    // exit the code
+    if (jit->code) munmap(jit->code, jit->size);
+
+    // exit it
+    tb_free(jit);
+}
+vm86_instruction_ref_t vm86_jit_done(vm86_jit_ref_t jit, vm86_context_ref_t context)
+{
+    // check
+    tb_assert_and_check_return_val(jit && jit->code && context, tb_null);
+
+    // compute the lazy flags, the native code keeps the eflags in the host eflags
+    vm86_context_eflags(context);
+
+    // done it
+    return ((vm86_jit_func_t)jit->code)((vm86_context_t*)context);
+}
+#else
+vm86_jit_ref_t vm86_jit_init(vm86_instruction_ref_t instructions, tb_size_t count)
+{
+    // the jit is not supported
+    tb_used(instructions);
+    tb_used(count);
+    return tb_null;
+}
+tb_void_t vm86_jit_exit(vm86_jit_ref_t jit)
+{
+    tb_used(jit);
+}
+vm86_instruction_ref_t vm86_jit_done(vm86_jit_ref_t jit, vm86_context_ref_t context)
+{
+    // the jit is not supported
+    tb_used(jit);
+    tb_used(context);
+    return tb_null;
+}
+#endif
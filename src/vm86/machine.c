@@ -22,45 +22,22 @@
  * includes
  */
 #include "machine.h"
+#include "impl/machine.h"
 
 /* //////////////////////////////////////////////////////////////////////////////////////
- * types
+ * macros
  */
 
-// the machine machine type
-typedef struct __vm86_machine_t
-{
-    // the text
-    vm86_text_ref_t         text;
-
-    // the data
-    vm86_data_ref_t         data;
-
-    // the stack
-    vm86_stack_ref_t        stack;
-
-    // the registers
-    vm86_registers_t        registers;
-
-    // the functions
-    tb_hash_map_ref_t       functions;
-
-    // the lock
-    tb_spinlock_t           lock;
-
-}vm86_machine_t;
+// the cache line size
+#define VM86_MACHINE_CACHE_LINE     (64)
 
 /* //////////////////////////////////////////////////////////////////////////////////////
  * private implementation
  */
 static tb_handle_t vm86_instance_init(tb_cpointer_t* ppriv)
 {
-    // init it
-#ifdef __vm_small__
-    return vm86_machine_init(1024, 1024);
-#else
-    return vm86_machine_init(2048, 2048);
-#endif
+    // init it, the stack and data only commit the used pages
+    return vm86_machine_init(VM86_DATA_MAXN, VM86_STACK_MAXN);
 }
 static tb_void_t vm86_instance_exit(tb_handle_t machine, tb_cpointer_t priv)
 {
@@ -84,33 +61,34 @@ vm86_machine_ref_t vm86_machine_init(tb_size_t data_size, tb_size_t stack_size)
     vm86_machine_t*     machine = tb_null;
     do
     {
-        // check
-        tb_assert_static(sizeof(tb_pointer_t) <= sizeof(tb_uint32_t));
-
         // make machine
-        machine = tb_malloc0_type(vm86_machine_t);
+        machine = (vm86_machine_t*)tb_align_malloc0(sizeof(vm86_machine_t), VM86_MACHINE_CACHE_LINE);
         tb_assert_and_check_break(machine);
 
         // init lock
         if (!tb_spinlock_init(&machine->lock)) break;
 
-        // init registers
-        vm86_registers_clear(machine->registers);
+        // init the function slots lock
+        if (!tb_spinlock_init(&machine->functions_lock)) break;
 
-        // make stack
-        machine->stack = vm86_stack_init(stack_size, &machine->registers[VM86_REGISTER_ESP].u32);
-        tb_assert_and_check_break(machine->stack);
+        // init snapshot
+        vm86_snapshot_init(&machine->snapshot);
 
-        // make data
-        machine->data = vm86_data_init(data_size);
-        tb_assert_and_check_break(machine->data);
+        // init the jit threshold
+        machine->jit_threshold = VM86_JIT_THRESHOLD;
+
+        // init the default context, the stack pages are reserved in the guest space
+        if (!vm86_context_attach(&machine->context, (vm86_machine_ref_t)machine, stack_size)) break;
+
+        // init data, the data pages are reserved in the guest space
+        if (!vm86_data_attach(&machine->data, data_size)) break;
 
         // make text
         machine->text = vm86_text_init((vm86_machine_ref_t)machine);
         tb_assert_and_check_break(machine->text);
 
-        // make functions
-        machine->functions = tb_hash_map_init(8, tb_element_str(tb_true), tb_element_ptr(tb_null, tb_null));
+        // make function slots
+        machine->functions = tb_hash_map_init(8, tb_element_str(tb_true), tb_element_uint32());
         tb_assert_and_check_break(machine->functions);
 
         // ok
@@ -142,26 +120,39 @@ tb_void_t vm86_machine_exit(vm86_machine_ref_t self)
     if (machine->text) vm86_text_exit(machine->text);
     machine->text = tb_null;
 
+    // exit snapshot
+    vm86_snapshot_exit(&machine->snapshot);
+
     // exit data
-    if (machine->data) vm86_data_exit(machine->data);
-    machine->data = tb_null;
+    vm86_data_detach(&machine->data);
 
-    // exit stack
-    if (machine->stack) vm86_stack_exit(machine->stack);
-    machine->stack = tb_null;
+    // exit the default context
+    vm86_context_detach(&machine->context);
 
-    // exit functions
+    // exit function slots
     if (machine->functions) tb_hash_map_exit(machine->functions);
     machine->functions = tb_null;
 
+    // exit function table
+    tb_size_t i = 0;
+    for (i = 0; i < VM86_MACHINE_FUNCS_CHUNK_MAXN; i++)
+    {
+        if (machine->funcs[i]) tb_free(machine->funcs[i]);
+        machine->funcs[i] = tb_null;
+    }
+    machine->funcs_count = 0;
+
     // leave
     tb_spinlock_leave(&machine->lock);
 
+    // exit the function slots lock
+    tb_spinlock_exit(&machine->functions_lock);
+
     // exit lock
     tb_spinlock_exit(&machine->lock);
 
     // exit it
-    tb_free(machine);
+    tb_align_free(machine);
 }
 tb_spinlock_ref_t vm86_machine_lock(vm86_machine_ref_t self)
 {
@@ -179,7 +170,7 @@ vm86_data_ref_t vm86_machine_data(vm86_machine_ref_t self)
     tb_assert_and_check_return_val(machine, tb_null);
 
     // the data
-    return machine->data;
+    return (vm86_data_ref_t)&machine->data;
 }
 vm86_text_ref_t vm86_machine_text(vm86_machine_ref_t self)
 {
@@ -197,7 +188,7 @@ vm86_stack_ref_t vm86_machine_stack(vm86_machine_ref_t self)
     tb_assert_and_check_return_val(machine, tb_null);
 
     // the stack
-    return machine->stack;
+    return (vm86_stack_ref_t)&machine->context.stack;
 }
 vm86_registers_ref_t vm86_machine_registers(vm86_machine_ref_t self)
 {
@@ -206,16 +197,73 @@ vm86_registers_ref_t vm86_machine_registers(vm86_machine_ref_t self)
     tb_assert_and_check_return_val(machine, tb_null);
 
     // the registers
-    return machine->registers;
+    return machine->context.registers;
+}
+vm86_context_ref_t vm86_machine_context(vm86_machine_ref_t self)
+{
+    // check
+    vm86_machine_t* machine = (vm86_machine_t*)self;
+    tb_assert_and_check_return_val(machine, tb_null);
+
+    // the default context
+    return (vm86_context_ref_t)&machine->context;
+}
+tb_bool_t vm86_machine_snapshot(vm86_machine_ref_t self)
+{
+    // check
+    vm86_machine_t* machine = (vm86_machine_t*)self;
+    tb_assert_and_check_return_val(machine, tb_false);
+
+    // capture the default context and the data
+    return vm86_snapshot_capture(&machine->snapshot, &machine->context, &machine->data);
+}
+tb_bool_t vm86_machine_restore(vm86_machine_ref_t self)
+{
+    // check
+    vm86_machine_t* machine = (vm86_machine_t*)self;
+    tb_assert_and_check_return_val(machine, tb_false);
+
+    // restore the default context and the data
+    return vm86_snapshot_restore(&machine->snapshot, &machine->context, &machine->data);
+}
+tb_void_t vm86_machine_jit_threshold_set(vm86_machine_ref_t self, tb_size_t threshold)
+{
+    // check
+    vm86_machine_t* machine = (vm86_machine_t*)self;
+    tb_assert_and_check_return(machine);
+
+    // set the threshold
+    machine->jit_threshold = threshold;
+}
+tb_void_t vm86_machine_optimize_set(vm86_machine_ref_t self, tb_size_t passes)
+{
+    // check
+    vm86_machine_t* machine = (vm86_machine_t*)self;
+    tb_assert_and_check_return(machine);
+
+    // set the passes
+    machine->optimize = passes;
 }
 vm86_machine_func_t vm86_machine_function(vm86_machine_ref_t self, tb_char_t const* name)
 {
     // check
     vm86_machine_t* machine = (vm86_machine_t*)self;
-    tb_assert_and_check_return_val(machine && name, tb_null);
+    tb_assert_and_check_return_val(machine && machine->functions && name, tb_null);
+
+    // enter, the slots may be added by the procs compiled in parallel
+    tb_spinlock_enter(&machine->functions_lock);
+
+    // find the slot
+    tb_size_t               slot = (tb_size_t)-1;
+    tb_size_t               itor = tb_hash_map_find(machine->functions, name);
+    tb_hash_map_item_ref_t  item = itor != tb_iterator_tail(machine->functions)? (tb_hash_map_item_ref_t)tb_iterator_item(machine->functions, itor) : tb_null;
+    if (item) slot = tb_p2u32(item->data);
+
+    // leave
+    tb_spinlock_leave(&machine->functions_lock);
 
     // the function
-    return (vm86_machine_func_t)tb_hash_map_get(machine->functions, name);
+    return slot != (tb_size_t)-1? vm86_machine_function_at(machine, slot) : tb_null;
 }
 tb_void_t vm86_machine_function_set(vm86_machine_ref_t self, tb_char_t const* name, vm86_machine_func_t func)
 {
@@ -223,8 +271,64 @@ tb_void_t vm86_machine_function_set(vm86_machine_ref_t self, tb_char_t const* na
     vm86_machine_t* machine = (vm86_machine_t*)self;
     tb_assert_and_check_return(machine && name);
 
-    // set the function
-    if (func) tb_hash_map_insert(machine->functions, name, func);
-    else tb_hash_map_remove(machine->functions, name);
+    /* get the slot
+     *
+     * the slot is kept after the function is removed, 
+     * because the compiled call instructions have been linked to it.
+     */
+    tb_size_t slot = vm86_machine_function_slot(machine, name);
+    tb_assert_and_check_return(slot != (tb_size_t)-1);
+
+    // bind the function, unbind it if func is null
+    machine->funcs[slot / VM86_MACHINE_FUNCS_CHUNK][slot % VM86_MACHINE_FUNCS_CHUNK] = func;
 }
+tb_size_t vm86_machine_function_slot(vm86_machine_t* machine, tb_char_t const* name)
+{
+    // check
+    tb_assert_and_check_return_val(machine && machine->functions && name, (tb_size_t)-1);
+
+    // enter, the procs may be compiled in parallel by vm86_text_compile_file()
+    tb_spinlock_enter(&machine->functions_lock);
+
+    // done
+    tb_size_t slot = (tb_size_t)-1;
+    do
+    {
+        // exists?
+        tb_size_t itor = tb_hash_map_find(machine->functions, name);
+        if (itor != tb_iterator_tail(machine->functions))
+        {
+            // the slot
+            tb_hash_map_item_ref_t item = (tb_hash_map_item_ref_t)tb_iterator_item(machine->functions, itor);
+            tb_assert_and_check_break(item);
+
+            // ok
+            slot = tb_p2u32(item->data);
+            break;
+        }
+
+        // the chunk of the new slot
+        tb_size_t chunk = machine->funcs_count / VM86_MACHINE_FUNCS_CHUNK;
+        tb_assert_and_check_break(chunk < VM86_MACHINE_FUNCS_CHUNK_MAXN);
+
+        // make the chunk, the filled chunks are never moved because the executing procs read them without the lock
+        if (!machine->funcs[chunk])
+        {
+            machine->funcs[chunk] = tb_nalloc0_type(VM86_MACHINE_FUNCS_CHUNK, vm86_machine_func_t);
+            tb_assert_and_check_break(machine->funcs[chunk]);
+        }
+
+        // add an unbound slot
+        slot = machine->funcs_count++;
+
+        // save the slot
+        tb_hash_map_insert(machine->functions, name, tb_u2p(slot));
+
+    } while (0);
 
+    // leave
+    tb_spinlock_leave(&machine->functions_lock);
+
+    // ok?
+    return slot;
+}
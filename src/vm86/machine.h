@@ -27,6 +27,8 @@
 #include "data.h"
 #include "text.h"
 #include "stack.h"
+#include "memory.h"
+#include "context.h"
 #include "register.h"
 
 /* //////////////////////////////////////////////////////////////////////////////////////
@@ -40,9 +42,12 @@ __tb_extern_c_enter__
 
 /*! the machine func type
  *
- * @param machine               the machine
+ * the addresses passed by the guest code are the guest addresses, 
+ * please convert them to the host pointers by vm86_memory_ptr().
+ *
+ * @param context               the context of the caller, we can get the machine by vm86_context_machine()
  */
-typedef tb_void_t               (*vm86_machine_func_t)(vm86_machine_ref_t machine);
+typedef tb_void_t               (*vm86_machine_func_t)(vm86_context_ref_t context);
 
 /* //////////////////////////////////////////////////////////////////////////////////////
  * interfaces
@@ -56,8 +61,11 @@ vm86_machine_ref_t              vm86_machine(tb_noarg_t);
 
 /*! init machine
  *
- * @param data_size             the data size
- * @param stack_size            the stack size
+ * the stack and data are reserved in the guest space and grow in place,
+ * only the used pages will be committed, so the given sizes are only the minimum reserved sizes.
+ *
+ * @param data_size             the minimum data size
+ * @param stack_size            the minimum stack size
  *
  * @return                      the machine
  */
@@ -70,6 +78,9 @@ vm86_machine_ref_t              vm86_machine_init(tb_size_t data_size, tb_size_t
 tb_void_t                       vm86_machine_exit(vm86_machine_ref_t machine);
 
 /*! the machine lock
+ *
+ * only need to hold it when compiling procs or using the default context,
+ * the procs can be done on the other contexts without it.
  *
  * @param machine               the machine
  */
@@ -91,7 +102,7 @@ vm86_text_ref_t                 vm86_machine_text(vm86_machine_ref_t machine);
  */
 vm86_data_ref_t                 vm86_machine_data(vm86_machine_ref_t machine);
 
-/*! the machine stack
+/*! the machine stack of the default context
  *
  * @param machine               the machine
  *
@@ -99,7 +110,7 @@ vm86_data_ref_t                 vm86_machine_data(vm86_machine_ref_t machine);
  */
 vm86_stack_ref_t                vm86_machine_stack(vm86_machine_ref_t machine);
 
-/*! the machine registers
+/*! the machine registers of the default context
  *
  * @param machine               the machine
  *
@@ -107,6 +118,63 @@ vm86_stack_ref_t                vm86_machine_stack(vm86_machine_ref_t machine);
  */
 vm86_registers_ref_t            vm86_machine_registers(vm86_machine_ref_t machine);
 
+/*! the default context of the machine
+ *
+ * @param machine               the machine
+ *
+ * @return                      the context
+ */
+vm86_context_ref_t              vm86_machine_context(vm86_machine_ref_t machine);
+
+/*! capture the snapshot of the machine
+ *
+ * the registers, the stack of the default context and the .data are captured,
+ * it is usually called once after all procs have been compiled.
+ *
+ * @param machine               the machine
+ *
+ * @return                      tb_true or tb_false
+ */
+tb_bool_t                       vm86_machine_snapshot(vm86_machine_ref_t machine);
+
+/*! restore the machine to the snapshot
+ *
+ * only the pages modified after the last restoring are restored,
+ * so it is cheap to get a clean machine before each execution.
+ *
+ * @note the .data added after capturing is not allowed, we need capture the snapshot again.
+ *
+ * @param machine               the machine
+ *
+ * @return                      tb_true or tb_false
+ */
+tb_bool_t                       vm86_machine_restore(vm86_machine_ref_t machine);
+
+/*! set the jit threshold of the machine
+ *
+ * the proc will be translated to the native code after it has been executed the given times,
+ * and it will be kept in the interpreter if it uses the instructions which cannot be translated.
+ *
+ * it only works for the x86-64 host and the jit option, the default threshold is 16.
+ *
+ * @param machine               the machine
+ * @param threshold             the executions count, 0: disable the jit tier
+ */
+tb_void_t                       vm86_machine_jit_threshold_set(vm86_machine_ref_t machine, tb_size_t threshold);
+
+/*! set the optimizer passes of the procs compiled after it
+ *
+ * the compiled instructions are optimized before linking, the default passes are VM86_PROC_OPTIMIZE_NONE.
+ *
+ * @code
+ * vm86_machine_optimize_set(machine, VM86_PROC_OPTIMIZE_ALL);
+ * @endcode
+ *
+ * @param machine               the machine
+ * @param passes                the passes, vm86_proc_optimize_e
+ */
+tb_void_t                       vm86_machine_optimize_set(vm86_machine_ref_t machine, tb_size_t passes);
+
 /*! get function from the machine 
  *
  * @param machine               the machine
@@ -117,6 +185,10 @@ vm86_registers_ref_t            vm86_machine_registers(vm86_machine_ref_t machin
 vm86_machine_func_t             vm86_machine_function(vm86_machine_ref_t machine, tb_char_t const* name);
 
 /*! set function to the machine 
+ *
+ * the call instructions are linked to the function slot at compile time,
+ * so the function can be set (or replaced) before or after compiling the procs.
+ * the function will be unbound if func is tb_null.
  *
  * @param machine               the machine
  * @param name                  the function name
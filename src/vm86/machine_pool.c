@@ -0,0 +1,323 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * 
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        machine_pool.c
+ *
+ */
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * trace
+ */
+#define TB_TRACE_MODULE_NAME            "machine_pool"
+#define TB_TRACE_MODULE_DEBUG           (0)
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "machine_pool.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+// the machine pool type
+typedef struct __vm86_machine_pool_t
+{
+    // the free machines
+    tb_vector_ref_t                 machines;
+
+    // the machine count
+    tb_size_t                       count;
+
+    // the data size
+    tb_size_t                       data_size;
+
+    // the stack size
+    tb_size_t                       stack_size;
+
+    // the init func
+    vm86_machine_pool_init_func_t   func;
+
+    // the init func private data
+    tb_cpointer_t                   priv;
+
+    // the thread local machine
+    tb_thread_local_t               local;
+
+    // the lock
+    tb_spinlock_t                   lock;
+
+}vm86_machine_pool_t;
+
+// the thread local machine type
+typedef struct __vm86_machine_pool_local_t
+{
+    // the pool
+    vm86_machine_pool_t*            pool;
+
+    // the machine
+    vm86_machine_ref_t              machine;
+
+}vm86_machine_pool_local_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * private implementation
+ */
+static vm86_machine_ref_t vm86_machine_pool_make(vm86_machine_pool_t* pool)
+{
+    // check
+    tb_assert(pool);
+
+    // make machine
+    vm86_machine_ref_t machine = vm86_machine_init(pool->data_size, pool->stack_size);
+    tb_assert_and_check_return_val(machine, tb_null);
+
+    // init machine
+    if (pool->func && !pool->func(machine, pool->priv))
+    {
+        // trace
+        tb_trace_e("init machine failed!");
+
+        // exit it
+        vm86_machine_exit(machine);
+        return tb_null;
+    }
+
+    // update count
+    tb_spinlock_enter(&pool->lock);
+    pool->count++;
+    tb_spinlock_leave(&pool->lock);
+
+    // trace
+    tb_trace_d("make machine: %p", machine);
+
+    // ok
+    return machine;
+}
+static tb_void_t vm86_machine_pool_local_free(tb_cpointer_t priv)
+{
+    // check
+    vm86_machine_pool_local_t* local = (vm86_machine_pool_local_t*)priv;
+    tb_assert_and_check_return(local && local->pool);
+
+    // free the machine to the pool
+    if (local->machine) vm86_machine_pool_free((vm86_machine_pool_ref_t)local->pool, local->machine);
+
+    // exit it
+    tb_free(local);
+}
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * implementation
+ */
+vm86_machine_pool_ref_t vm86_machine_pool_init(tb_size_t count, tb_size_t data_size, tb_size_t stack_size, vm86_machine_pool_init_func_t func, tb_cpointer_t priv)
+{
+    // check
+    tb_assert_and_check_return_val(data_size && stack_size, tb_null);
+
+    // done
+    tb_bool_t               ok = tb_false;
+    vm86_machine_pool_t*    pool = tb_null;
+    do
+    {
+        // make pool
+        pool = tb_malloc0_type(vm86_machine_pool_t);
+        tb_assert_and_check_break(pool);
+
+        // init pool
+        pool->data_size     = data_size;
+        pool->stack_size    = stack_size;
+        pool->func          = func;
+        pool->priv          = priv;
+
+        // init lock
+        if (!tb_spinlock_init(&pool->lock)) break;
+
+        // init the thread local machine
+        if (!tb_thread_local_init(&pool->local, vm86_machine_pool_local_free)) break;
+
+        // init the free machines
+        pool->machines = tb_vector_init(count? count : 8, tb_element_ptr(tb_null, tb_null));
+        tb_assert_and_check_break(pool->machines);
+
+        // make the preinitialized machines
+        tb_size_t i = 0;
+        for (i = 0; i < count; i++)
+        {
+            // make machine
+            vm86_machine_ref_t machine = vm86_machine_pool_make(pool);
+            tb_assert_and_check_break(machine);
+
+            // save it
+            tb_vector_insert_tail(pool->machines, machine);
+        }
+        tb_check_break(i == count);
+
+        // ok
+        ok = tb_true;
+
+    } while (0);
+
+    // failed?
+    if (!ok)
+    {
+        // exit it
+        if (pool) vm86_machine_pool_exit((vm86_machine_pool_ref_t)pool);
+        pool = tb_null;
+    }
+
+    // ok?
+    return (vm86_machine_pool_ref_t)pool;
+}
+tb_void_t vm86_machine_pool_exit(vm86_machine_pool_ref_t self)
+{
+    // check
+    vm86_machine_pool_t* pool = (vm86_machine_pool_t*)self;
+    tb_assert_and_check_return(pool);
+
+    // exit the thread local machine of the current thread
+    vm86_machine_pool_local_t* local = (vm86_machine_pool_local_t*)tb_thread_local_get(&pool->local);
+    if (local)
+    {
+        tb_thread_local_set(&pool->local, tb_null);
+        vm86_machine_pool_local_free(local);
+    }
+
+    // exit the thread local machine
+    tb_thread_local_exit(&pool->local);
+
+    // exit the free machines
+    if (pool->machines)
+    {
+        // all machines must have been returned
+        tb_assert(tb_vector_size(pool->machines) == pool->count);
+
+        // exit machines
+        tb_for_all_if (vm86_machine_ref_t, machine, pool->machines, machine)
+        {
+            vm86_machine_exit(machine);
+        }
+
+        // exit it
+        tb_vector_exit(pool->machines);
+        pool->machines = tb_null;
+    }
+
+    // exit lock
+    tb_spinlock_exit(&pool->lock);
+
+    // exit it
+    tb_free(pool);
+}
+vm86_machine_ref_t vm86_machine_pool_alloc(vm86_machine_pool_ref_t self)
+{
+    // check
+    vm86_machine_pool_t* pool = (vm86_machine_pool_t*)self;
+    tb_assert_and_check_return_val(pool && pool->machines, tb_null);
+
+    // enter
+    tb_spinlock_enter(&pool->lock);
+
+    // get a free machine
+    vm86_machine_ref_t machine = tb_null;
+    if (tb_vector_size(pool->machines))
+    {
+        machine = (vm86_machine_ref_t)tb_vector_last(pool->machines);
+        tb_vector_remove_last(pool->machines);
+    }
+
+    // leave
+    tb_spinlock_leave(&pool->lock);
+
+    // no free machine? make a new one
+    if (!machine) machine = vm86_machine_pool_make(pool);
+
+    // ok?
+    return machine;
+}
+tb_void_t vm86_machine_pool_free(vm86_machine_pool_ref_t self, vm86_machine_ref_t machine)
+{
+    // check
+    vm86_machine_pool_t* pool = (vm86_machine_pool_t*)self;
+    tb_assert_and_check_return(pool && pool->machines && machine);
+
+    // enter
+    tb_spinlock_enter(&pool->lock);
+
+    // save it
+    tb_vector_insert_tail(pool->machines, machine);
+
+    // leave
+    tb_spinlock_leave(&pool->lock);
+}
+vm86_machine_ref_t vm86_machine_pool_local(vm86_machine_pool_ref_t self)
+{
+    // check
+    vm86_machine_pool_t* pool = (vm86_machine_pool_t*)self;
+    tb_assert_and_check_return_val(pool, tb_null);
+
+    // get the machine of the current thread
+    vm86_machine_pool_local_t* local = (vm86_machine_pool_local_t*)tb_thread_local_get(&pool->local);
+    if (local) return local->machine;
+
+    // done
+    tb_bool_t           ok = tb_false;
+    vm86_machine_ref_t  machine = tb_null;
+    do
+    {
+        // alloc a machine
+        machine = vm86_machine_pool_alloc(self);
+        tb_assert_and_check_break(machine);
+
+        // make the thread local machine
+        local = tb_malloc0_type(vm86_machine_pool_local_t);
+        tb_assert_and_check_break(local);
+
+        // init it
+        local->pool     = pool;
+        local->machine  = machine;
+
+        // bind it to the current thread
+        if (!tb_thread_local_set(&pool->local, local)) break;
+
+        // ok
+        ok = tb_true;
+
+    } while (0);
+
+    // failed?
+    if (!ok)
+    {
+        // exit the thread local machine
+        if (local) tb_free(local);
+
+        // free the machine
+        if (machine) vm86_machine_pool_free(self, machine);
+        machine = tb_null;
+    }
+
+    // ok?
+    return machine;
+}
+tb_size_t vm86_machine_pool_size(vm86_machine_pool_ref_t self)
+{
+    // check
+    vm86_machine_pool_t* pool = (vm86_machine_pool_t*)self;
+    tb_assert_and_check_return_val(pool, 0);
+
+    // the machine count
+    return pool->count;
+}
@@ -0,0 +1,119 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * 
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        machine_pool.h
+ *
+ */
+#ifndef VM86_MACHINE_POOL_H
+#define VM86_MACHINE_POOL_H
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "machine.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_enter__
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+/// the machine pool ref type
+typedef struct{}*                   vm86_machine_pool_ref_t;
+
+/*! the machine pool init func type
+ *
+ * it will be called once for each new machine, .e.g register functions, compile procs ..
+ *
+ * @param machine                   the machine
+ * @param priv                      the user private data
+ *
+ * @return                          tb_true or tb_false
+ */
+typedef tb_bool_t                   (*vm86_machine_pool_init_func_t)(vm86_machine_ref_t machine, tb_cpointer_t priv);
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * interfaces
+ */
+
+/*! init machine pool
+ *
+ * each machine has its own registers, stack and data, 
+ * so the machines can be used on different threads at the same time without the machine lock.
+ *
+ * @param count                     the preinitialized machine count
+ * @param data_size                 the minimum data size of each machine
+ * @param stack_size                the minimum stack size of each machine
+ * @param func                      the machine init func, optional
+ * @param priv                      the user private data
+ *
+ * @return                          the machine pool
+ */
+vm86_machine_pool_ref_t             vm86_machine_pool_init(tb_size_t count, tb_size_t data_size, tb_size_t stack_size, vm86_machine_pool_init_func_t func, tb_cpointer_t priv);
+
+/*! exit machine pool
+ *
+ * @note all machines must have been returned to the pool and all threads using vm86_machine_pool_local() must have exited
+ *
+ * @param pool                      the machine pool
+ */
+tb_void_t                           vm86_machine_pool_exit(vm86_machine_pool_ref_t pool);
+
+/*! alloc a machine from the pool for one request
+ *
+ * @param pool                      the machine pool
+ *
+ * @return                          the machine
+ */
+vm86_machine_ref_t                  vm86_machine_pool_alloc(vm86_machine_pool_ref_t pool);
+
+/*! free the machine to the pool
+ *
+ * @param pool                      the machine pool
+ * @param machine                   the machine
+ */
+tb_void_t                           vm86_machine_pool_free(vm86_machine_pool_ref_t pool, vm86_machine_ref_t machine);
+
+/*! get the machine of the current thread
+ *
+ * the machine is bound to the current thread and will be returned to the pool when the thread exits
+ *
+ * @param pool                      the machine pool
+ *
+ * @return                          the machine
+ */
+vm86_machine_ref_t                  vm86_machine_pool_local(vm86_machine_pool_ref_t pool);
+
+/*! the machine count of the pool
+ *
+ * @param pool                      the machine pool
+ *
+ * @return                          the count of all machines, including the allocated machines
+ */
+tb_size_t                           vm86_machine_pool_size(vm86_machine_pool_ref_t pool);
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_leave__
+
+#endif
+
+
@@ -0,0 +1,411 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        memory.c
+ *
+ */
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * trace
+ */
+#define TB_TRACE_MODULE_NAME            "machine_memory"
+#define TB_TRACE_MODULE_DEBUG           (0)
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "memory.h"
+#if defined(TB_CONFIG_POSIX_HAVE_MMAP)
+#   include <sys/mman.h>
+#elif defined(TB_CONFIG_OS_WINDOWS)
+#   include <windows.h>
+#endif
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * macros
+ */
+
+// the guard size at the head of the guest space, the null address is not accessible
+#define VM86_MEMORY_GUARD               (4096)
+
+// the grow count of the released page ranges
+#define VM86_MEMORY_RANGES_GROW         (64)
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+// the released page range type
+typedef struct __vm86_memory_range_t
+{
+    // the offset in the guest space
+    tb_uint32_t                 offset;
+
+    // the size
+    tb_uint32_t                 size;
+
+}vm86_memory_range_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * globals
+ */
+
+#if TB_CPU_BIT64
+
+// the base of the guest space
+tb_byte_t*                  g_vm86_memory_base = tb_null;
+
+// the allocator of the guest space
+static tb_allocator_ref_t   g_allocator = tb_null;
+
+// the lock
+static tb_spinlock_t        g_lock = TB_SPINLOCK_INIT;
+
+// the offset of the unused pages after the heap
+static tb_uint64_t          g_pages = VM86_MEMORY_HEAP_SIZE;
+
+// the released page ranges, the adjacent ranges are always merged
+static vm86_memory_range_t* g_ranges = tb_null;
+static tb_size_t            g_ranges_count = 0;
+static tb_size_t            g_ranges_maxn = 0;
+
+#endif
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * private implementation
+ */
+#if TB_CPU_BIT64
+static tb_allocator_ref_t vm86_memory_allocator()
+{
+    // inited?
+    tb_allocator_ref_t allocator = g_allocator;
+    tb_check_return_val(!allocator, allocator);
+
+    // enter
+    tb_spinlock_enter(&g_lock);
+
+    // done
+    do
+    {
+        // inited by the other thread?
+        tb_check_break(!g_allocator);
+
+        // the base
+        tb_byte_t* base = tb_null;
+
+#ifdef TB_CONFIG_POSIX_HAVE_MMAP
+        /* reserve the guest space
+         *
+         * the pages will be committed when they are touched at the first time
+         */
+        base = (tb_byte_t*)mmap(tb_null, (tb_size_t)VM86_MEMORY_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        tb_assert_and_check_break(base && base != MAP_FAILED);
+
+        // protect the guard page
+        if (mprotect(base, VM86_MEMORY_GUARD, PROT_NONE) != 0)
+        {
+            munmap(base, (tb_size_t)VM86_MEMORY_SIZE);
+            break;
+        }
+#else
+        // trace
+        tb_trace_e("the guest space is not supported on this platform!");
+        break;
+#endif
+
+        // init the allocator of the heap after the guard page
+        allocator = tb_static_allocator_init(base + VM86_MEMORY_GUARD, (tb_size_t)VM86_MEMORY_HEAP_SIZE - VM86_MEMORY_GUARD);
+        tb_assert_and_check_break(allocator);
+
+        // trace
+        tb_trace_d("reserve: %p, size: %llu", base, VM86_MEMORY_SIZE);
+
+        // save it
+        g_vm86_memory_base  = base;
+        g_allocator         = allocator;
+
+    } while (0);
+
+    // the allocator
+    allocator = g_allocator;
+
+    // leave
+    tb_spinlock_leave(&g_lock);
+
+    // ok?
+    return allocator;
+}
+static tb_byte_t* vm86_memory_pages_alloc(tb_size_t size)
+{
+    // done
+    tb_byte_t* data = tb_null;
+    tb_spinlock_enter(&g_lock);
+    do
+    {
+        // find the first released range which is large enough
+        tb_size_t i = 0;
+        for (i = 0; i < g_ranges_count && g_ranges[i].size < size; i++) ;
+
+        // reuse it?
+        if (i < g_ranges_count)
+        {
+            // alloc pages from the head of this range
+            vm86_memory_range_t* range = &g_ranges[i];
+            data = g_vm86_memory_base + range->offset;
+            range->offset += (tb_uint32_t)size;
+            range->size -= (tb_uint32_t)size;
+
+            // remove this range if it is empty
+            if (!range->size) *range = g_ranges[--g_ranges_count];
+            break;
+        }
+
+        // no more pages?
+        tb_check_break(g_pages + size <= VM86_MEMORY_SIZE);
+
+        // alloc the unused pages
+        data = g_vm86_memory_base + g_pages;
+        g_pages += size;
+
+    } while (0);
+    tb_spinlock_leave(&g_lock);
+
+    // ok?
+    return data;
+}
+static tb_void_t vm86_memory_pages_free(tb_byte_t* data, tb_size_t size)
+{
+    // the range offset
+    tb_uint32_t offset = (tb_uint32_t)(data - g_vm86_memory_base);
+
+    // enter
+    tb_spinlock_enter(&g_lock);
+
+    // find the ranges before and after the released pages
+    tb_size_t i = 0;
+    tb_size_t prev = g_ranges_count;
+    tb_size_t next = g_ranges_count;
+    for (i = 0; i < g_ranges_count; i++)
+    {
+        // the range
+        vm86_memory_range_t* range = &g_ranges[i];
+        if (range->offset + range->size == offset) prev = i;
+        else if (offset + size == range->offset) next = i;
+    }
+
+    // merge the range after the released pages
+    if (next < g_ranges_count)
+    {
+        size += g_ranges[next].size;
+        g_ranges[next] = g_ranges[--g_ranges_count];
+        if (prev == g_ranges_count) prev = next;
+    }
+
+    // merge the range before the released pages
+    if (prev < g_ranges_count)
+    {
+        offset = g_ranges[prev].offset;
+        size += g_ranges[prev].size;
+        g_ranges[prev] = g_ranges[--g_ranges_count];
+    }
+
+    // are the last pages? give them back to the unused pages
+    if (offset + size == g_pages) g_pages = offset;
+    else
+    {
+        // grow the ranges
+        if (g_ranges_count == g_ranges_maxn)
+        {
+            tb_size_t               maxn = g_ranges_maxn + VM86_MEMORY_RANGES_GROW;
+            vm86_memory_range_t*    ranges = (vm86_memory_range_t*)tb_ralloc(g_ranges, maxn * sizeof(vm86_memory_range_t));
+            if (ranges)
+            {
+                g_ranges        = ranges;
+                g_ranges_maxn   = maxn;
+            }
+        }
+
+        // add a new range
+        if (g_ranges_count < g_ranges_maxn)
+        {
+            g_ranges[g_ranges_count].offset = offset;
+            g_ranges[g_ranges_count].size   = (tb_uint32_t)size;
+            g_ranges_count++;
+        }
+        // the pages are lost
+        else tb_trace_e("lose the released pages: %p, size: %lu", g_vm86_memory_base + offset, size);
+    }
+
+    // leave
+    tb_spinlock_leave(&g_lock);
+}
+#endif
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * implementation
+ */
+tb_byte_t* vm86_memory_base()
+{
+#if TB_CPU_BIT64
+    // reserve the guest space
+    return vm86_memory_allocator()? g_vm86_memory_base : tb_null;
+#else
+    // the guest address is the host pointer
+    return tb_null;
+#endif
+}
+tb_pointer_t vm86_memory_malloc0(tb_size_t size)
+{
+#if TB_CPU_BIT64
+    // the allocator
+    tb_allocator_ref_t allocator = vm86_memory_allocator();
+    tb_assert_and_check_return_val(allocator, tb_null);
+
+    // malloc it
+    return tb_allocator_malloc0(allocator, size);
+#else
+    return tb_malloc0(size);
+#endif
+}
+tb_pointer_t vm86_memory_align_malloc0(tb_size_t size, tb_size_t align)
+{
+#if TB_CPU_BIT64
+    // the allocator
+    tb_allocator_ref_t allocator = vm86_memory_allocator();
+    tb_assert_and_check_return_val(allocator, tb_null);
+
+    // malloc it
+    return tb_allocator_align_malloc0(allocator, size, align);
+#else
+    return tb_align_malloc0(size, align);
+#endif
+}
+tb_void_t vm86_memory_free(tb_pointer_t data)
+{
+    // check
+    tb_check_return(data);
+
+#if TB_CPU_BIT64
+    // check
+    tb_assert_and_check_return(g_allocator);
+
+    // free it
+    tb_allocator_free(g_allocator, data);
+#else
+    tb_free(data);
+#endif
+}
+tb_void_t vm86_memory_align_free(tb_pointer_t data)
+{
+    // check
+    tb_check_return(data);
+
+#if TB_CPU_BIT64
+    // check
+    tb_assert_and_check_return(g_allocator);
+
+    // free it
+    tb_allocator_align_free(g_allocator, data);
+#else
+    tb_align_free(data);
+#endif
+}
+tb_pointer_t vm86_memory_reserve(tb_size_t size)
+{
+    // check
+    tb_assert_and_check_return_val(size, tb_null);
+
+    // align size
+    size = tb_align(size, VM86_MEMORY_PAGE_SIZE);
+
+    // done
+    tb_byte_t* data = tb_null;
+#if TB_CPU_BIT64
+    // reserve the guest space
+    tb_check_return_val(vm86_memory_allocator(), tb_null);
+
+    // alloc the pages after the heap, they are committed when they are touched at the first time
+    data = vm86_memory_pages_alloc(size);
+#elif defined(TB_CONFIG_POSIX_HAVE_MMAP)
+    // reserve pages
+    data = (tb_byte_t*)mmap(tb_null, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (data == MAP_FAILED) data = tb_null;
+#elif defined(TB_CONFIG_OS_WINDOWS)
+    // reserve pages, the committed pages are not backed by the physical pages until they are touched
+    data = (tb_byte_t*)VirtualAlloc(tb_null, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    // alloc them directly
+    data = (tb_byte_t*)tb_malloc0(size);
+#endif
+
+    // trace
+    if (!data) tb_trace_e("reserve %lu bytes failed!", size);
+    else tb_trace_d("reserve: %p, size: %lu", data, size);
+
+    // ok?
+    return data;
+}
+tb_void_t vm86_memory_release(tb_pointer_t data, tb_size_t size)
+{
+    // check
+    tb_check_return(data && size);
+
+    // align size
+    size = tb_align(size, VM86_MEMORY_PAGE_SIZE);
+
+#if TB_CPU_BIT64
+    // discard the committed pages, they will be zeroed when they are reserved again
+    vm86_memory_discard(data, size);
+
+    // free pages
+    vm86_memory_pages_free((tb_byte_t*)data, size);
+#elif defined(TB_CONFIG_POSIX_HAVE_MMAP)
+    munmap(data, size);
+#elif defined(TB_CONFIG_OS_WINDOWS)
+    VirtualFree(data, 0, MEM_RELEASE);
+#else
+    tb_free(data);
+#endif
+}
+tb_void_t vm86_memory_discard(tb_pointer_t data, tb_size_t size)
+{
+    // check
+    tb_check_return(data && size);
+
+#if defined(TB_CONFIG_POSIX_HAVE_MMAP) && defined(MADV_DONTNEED)
+    // the private anonymous pages will be zeroed when they are touched again
+    if (madvise(data, size, MADV_DONTNEED) == 0) return ;
+#endif
+
+    // clear them
+    tb_memset(data, 0, size);
+}
+tb_void_t vm86_memory_hugepage(tb_pointer_t data, tb_size_t size)
+{
+#if defined(__vm_hugepage__) && defined(TB_CONFIG_POSIX_HAVE_MMAP) && defined(MADV_HUGEPAGE)
+    // the huge pages inside this range
+    tb_size_t head = tb_align((tb_size_t)data, VM86_MEMORY_HUGEPAGE_SIZE);
+    tb_size_t tail = ((tb_size_t)data + size) & ~((tb_size_t)VM86_MEMORY_HUGEPAGE_SIZE - 1);
+
+    // advise them
+    if (head < tail && madvise((tb_pointer_t)head, tail - head, MADV_HUGEPAGE) != 0)
+        tb_trace_d("advise the huge pages failed: %p, size: %lu", (tb_pointer_t)head, tail - head);
+#else
+    // unused
+    tb_used(data);
+    tb_used(size);
+#endif
+}
@@ -0,0 +1,164 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        memory.h
+ *
+ */
+#ifndef VM86_MEMORY_H
+#define VM86_MEMORY_H
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "prefix.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * macros
+ */
+
+// the guest space size
+#define VM86_MEMORY_SIZE                        ((tb_uint64_t)1 << 32)
+
+/* the heap size at the head of the guest space
+ *
+ * the instructions are allocated from the heap and the reserved pages (stack and .data) are after it
+ */
+#define VM86_MEMORY_HEAP_SIZE                   ((tb_uint64_t)1 << 30)
+
+// the page size
+#define VM86_MEMORY_PAGE_SIZE                   (4096)
+
+// the huge page size
+#define VM86_MEMORY_HUGEPAGE_SIZE               (1 << 21)
+
+/*! the host pointer of the guest address and the guest address of the host pointer
+ *
+ * the guest address is the offset in the reserved 4 GiB guest space on the 64-bit host,
+ * and it is the host pointer directly on the 32-bit host.
+ */
+#if TB_CPU_BIT64
+#   define vm86_memory_ptr(addr)                ((tb_pointer_t)(g_vm86_memory_base + (tb_uint32_t)(addr)))
+#   define vm86_memory_addr(ptr)                ((tb_uint32_t)((tb_byte_t const*)(ptr) - g_vm86_memory_base))
+#else
+#   define vm86_memory_ptr(addr)                tb_u2p((tb_uint32_t)(addr))
+#   define vm86_memory_addr(ptr)                tb_p2u32(ptr)
+#endif
+
+// alloc the typed items in the guest space
+#define vm86_memory_nalloc0_type(item, type)    ((type*)vm86_memory_malloc0((item) * sizeof(type)))
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_enter__
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * globals
+ */
+
+#if TB_CPU_BIT64
+// the base of the guest space, uses vm86_memory_ptr() and vm86_memory_addr() instead of it
+extern tb_byte_t*           g_vm86_memory_base;
+#endif
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * interfaces
+ */
+
+/*! the base of the guest space
+ *
+ * the guest space will be reserved at the first time and kept until the process exits,
+ * all machines share it and the first page is not accessible to catch the null address.
+ *
+ * @return                  the base, return tb_null if the guest space cannot be reserved
+ */
+tb_byte_t*                  vm86_memory_base(tb_noarg_t);
+
+/*! malloc the zeroed memory in the guest space
+ *
+ * the instructions must be allocated from it, because the guest code accesses them by the 32-bit addresses,
+ * and the stack and the .data use vm86_memory_reserve() instead of it.
+ *
+ * @param size              the size
+ *
+ * @return                  the data
+ */
+tb_pointer_t                vm86_memory_malloc0(tb_size_t size);
+
+/*! malloc the aligned and zeroed memory in the guest space
+ *
+ * @param size              the size
+ * @param align             the alignment
+ *
+ * @return                  the data
+ */
+tb_pointer_t                vm86_memory_align_malloc0(tb_size_t size, tb_size_t align);
+
+/*! free the memory in the guest space
+ *
+ * @param data              the data
+ */
+tb_void_t                   vm86_memory_free(tb_pointer_t data);
+
+/*! free the aligned memory in the guest space
+ *
+ * @param data              the data
+ */
+tb_void_t                   vm86_memory_align_free(tb_pointer_t data);
+
+/*! reserve the zeroed pages in the guest space
+ *
+ * only the virtual range is reserved and the pages will be committed when they are touched at the first time,
+ * so the stack and the .data only pay for the pages they use and never move when they grow.
+ *
+ * @param size              the size, will be aligned by the page size
+ *
+ * @return                  the pages
+ */
+tb_pointer_t                vm86_memory_reserve(tb_size_t size);
+
+/*! release the reserved pages
+ *
+ * @param data              the pages
+ * @param size              the reserved size
+ */
+tb_void_t                   vm86_memory_release(tb_pointer_t data, tb_size_t size);
+
+/*! discard the reserved pages
+ *
+ * the committed pages will be returned to the system and they will be zeroed when they are touched again.
+ *
+ * @param data              the pages
+ * @param size              the size
+ */
+tb_void_t                   vm86_memory_discard(tb_pointer_t data, tb_size_t size);
+
+/*! advise the transparent huge pages for the reserved pages
+ *
+ * only the huge pages inside the given range are advised and it does nothing if the hugepage option is disabled.
+ *
+ * @param data              the data
+ * @param size              the size
+ */
+tb_void_t                   vm86_memory_hugepage(tb_pointer_t data, tb_size_t size);
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_leave__
+
+#endif
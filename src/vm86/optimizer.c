@@ -0,0 +1,1034 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        optimizer.c
+ *
+ */
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * trace
+ */
+#define TB_TRACE_MODULE_NAME            "machine_optimizer"
+#define TB_TRACE_MODULE_DEBUG           (0)
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "machine.h"
+#include "impl/optimizer.h"
+#include "impl/context.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * macros
+ */
+
+// the mask bit of the register, only the general registers are tracked
+#define VM86_OPTIMIZER_REG(r)           ((tb_uint32_t)1 << ((r) & VM86_REGISTER_MASK))
+
+// the mask bit of the flags
+#define VM86_OPTIMIZER_FLAGS            ((tb_uint32_t)1 << VM86_REGISTER_EFLAGS)
+
+// the general registers: eax, ebx, ecx, edx, esp, ebp, esi, edi
+#define VM86_OPTIMIZER_REGS             (0xff)
+
+// all registers and flags, they are live at the exits, the indirect jumps and the calls
+#define VM86_OPTIMIZER_ALL              (VM86_OPTIMIZER_REGS | VM86_OPTIMIZER_FLAGS)
+
+// the unknown operation of the constant flags
+#define VM86_OPTIMIZER_FLAGS_UNKNOWN    (0xff)
+
+// no block
+#define VM86_OPTIMIZER_NONE             (0xffffffff)
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+// the instruction kind
+typedef enum __vm86_optimizer_kind_e
+{
+    VM86_OPTIMIZER_KIND_OTHER       = 0     //!< the memory, stack and call instructions, they are always kept
+,   VM86_OPTIMIZER_KIND_PURE        = 1     //!< only reads and writes the registers and flags
+,   VM86_OPTIMIZER_KIND_JUMP        = 2     //!< the direct jump in this proc, v0 is the label id
+,   VM86_OPTIMIZER_KIND_INDIRECT    = 3     //!< the indirect jump, it may go to any root or leave this proc
+,   VM86_OPTIMIZER_KIND_EXIT        = 4     //!< retn, leave
+
+}vm86_optimizer_kind_e;
+
+// the instruction effect type
+typedef struct __vm86_optimizer_effect_t
+{
+    // the kind, vm86_optimizer_kind_e
+    tb_size_t                   kind;
+
+    // the read registers and flags
+    tb_uint32_t                 uses;
+
+    // the written registers and flags, they may be written partially or conditionally
+    tb_uint32_t                 defs;
+
+    // the registers and flags which are overwritten completely
+    tb_uint32_t                 kills;
+
+}vm86_optimizer_effect_t;
+
+// the basic block type
+typedef struct __vm86_optimizer_block_t
+{
+    // the head instruction index
+    tb_uint32_t                 head;
+
+    // the tail instruction index, exclusive
+    tb_uint32_t                 tail;
+
+    // the target block of the direct jump, VM86_OPTIMIZER_NONE if no
+    tb_uint32_t                 jump;
+
+    // the next block of the fallthrough, VM86_OPTIMIZER_NONE if no
+    tb_uint32_t                 next;
+
+    // the live registers and flags at the head
+    tb_uint32_t                 live_in;
+
+    // the live registers and flags at the tail
+    tb_uint32_t                 live_out;
+
+    // leave this proc or jump indirectly? all registers and flags are live at the tail
+    tb_uint8_t                  exit;
+
+    // is the entry or taken?
+    tb_uint8_t                  root;
+
+    // is reachable from the roots?
+    tb_uint8_t                  reachable;
+
+}vm86_optimizer_block_t, *vm86_optimizer_block_ref_t;
+
+// the constant state type
+typedef struct __vm86_optimizer_state_t
+{
+    // the register values, only the known registers are valid
+    vm86_registers_t            registers;
+
+    // the lazy flags, the operation is VM86_OPTIMIZER_FLAGS_UNKNOWN if it is unknown
+    vm86_flags_t                flags;
+
+    // the known registers mask
+    tb_uint32_t                 known;
+
+    // has been reached?
+    tb_bool_t                   reached;
+
+}vm86_optimizer_state_t, *vm86_optimizer_state_ref_t;
+
+// the optimizer type
+typedef struct __vm86_optimizer_t
+{
+    // the code
+    vm86_optimizer_code_t*      code;
+
+    // the blocks
+    vm86_optimizer_block_ref_t  blocks;
+
+    // the blocks count
+    tb_size_t                   blocks_count;
+
+    // the block index of each instruction
+    tb_uint32_t*                owners;
+
+    // the live registers and flags after each instruction
+    tb_uint32_t*                lives;
+
+    // the leader marks of each instruction, 1: leader, 2: root
+    tb_byte_t*                  leaders;
+
+    // the deleted marks of each instruction
+    tb_byte_t*                  removed;
+
+}vm86_optimizer_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * private implementation
+ */
+static tb_uint8_t vm86_optimizer_opcode(tb_uint8_t opcode)
+{
+    // the generic opcode of the width-specialized or flag-free opcode
+#define VM86_OPTIMIZER_WIDTH_CASE(op, o, n, r)      case VM86_OPCODE_##o##_8: case VM86_OPCODE_##o##_16: case VM86_OPCODE_##o##_32: return VM86_OPCODE_##o;
+#define VM86_OPTIMIZER_NOFLAGS_CASE(op, o, n)       case VM86_OPCODE_##o##_8_NF: case VM86_OPCODE_##o##_16_NF: case VM86_OPCODE_##o##_32_NF: return VM86_OPCODE_##o;
+    switch (opcode)
+    {
+    VM86_OPCODE_WIDTH_LIST(op, VM86_OPTIMIZER_WIDTH_CASE)
+    VM86_OPCODE_NOFLAGS_LIST(op, VM86_OPTIMIZER_NOFLAGS_CASE)
+    default: break;
+    }
+#undef VM86_OPTIMIZER_WIDTH_CASE
+#undef VM86_OPTIMIZER_NOFLAGS_CASE
+
+    // the generic opcode
+    return opcode;
+}
+static tb_uint8_t vm86_optimizer_width(tb_uint8_t opcode, tb_uint8_t r0)
+{
+    // the width index of the register: 32 => 2, 8 => 0, 16 => 1
+    static tb_uint8_t const s_index[] = {2, 0, 0, 1};
+
+    // the width-specialized opcode of the generic opcode
+#define VM86_OPTIMIZER_WIDTH_CASE(op, o, n, r) \
+    case VM86_OPCODE_##o: \
+        { \
+            static tb_uint8_t const s_opcodes[] = {VM86_OPCODE_##o##_8, VM86_OPCODE_##o##_16, VM86_OPCODE_##o##_32}; \
+            return s_opcodes[s_index[(r0 >> 4) & 3]]; \
+        }
+    switch (opcode)
+    {
+    VM86_OPCODE_WIDTH_LIST(op, VM86_OPTIMIZER_WIDTH_CASE)
+    default: break;
+    }
+#undef VM86_OPTIMIZER_WIDTH_CASE
+
+    // keep the generic opcode
+    return opcode;
+}
+static tb_uint8_t vm86_optimizer_noflags(tb_uint8_t opcode)
+{
+    // the flag-free variant of the width-specialized opcode
+#define VM86_OPTIMIZER_NOFLAGS_CASE(op, o, n) \
+    case VM86_OPCODE_##o##_8:   return VM86_OPCODE_##o##_8_NF; \
+    case VM86_OPCODE_##o##_16:  return VM86_OPCODE_##o##_16_NF; \
+    case VM86_OPCODE_##o##_32:  return VM86_OPCODE_##o##_32_NF;
+    switch (opcode)
+    {
+    VM86_OPCODE_NOFLAGS_LIST(op, VM86_OPTIMIZER_NOFLAGS_CASE)
+    default: break;
+    }
+#undef VM86_OPTIMIZER_NOFLAGS_CASE
+
+    // no flag-free variant
+    return VM86_OPCODE_NONE;
+}
+static tb_bool_t vm86_optimizer_noflags_is(tb_uint8_t opcode)
+{
+    // is the flag-free opcode?
+#define VM86_OPTIMIZER_NOFLAGS_CASE(op, o, n)       case VM86_OPCODE_##o##_8_NF: case VM86_OPCODE_##o##_16_NF: case VM86_OPCODE_##o##_32_NF: return tb_true;
+    switch (opcode)
+    {
+    VM86_OPCODE_NOFLAGS_LIST(op, VM86_OPTIMIZER_NOFLAGS_CASE)
+    default: break;
+    }
+#undef VM86_OPTIMIZER_NOFLAGS_CASE
+    return tb_false;
+}
+static tb_void_t vm86_optimizer_effect(vm86_instruction_ref_t instruction, vm86_optimizer_effect_t* effect)
+{
+    // the operands
+    tb_uint32_t r0 = VM86_OPTIMIZER_REG(instruction->r0);
+    tb_uint32_t r1 = VM86_OPTIMIZER_REG(instruction->r1);
+    tb_uint32_t r2 = VM86_OPTIMIZER_REG(instruction->r2);
+    tb_uint32_t f = VM86_OPTIMIZER_FLAGS;
+    tb_uint32_t esp = VM86_OPTIMIZER_REG(VM86_REGISTER_ESP);
+
+    // r0 is overwritten completely if it is the 32-bit register, the others are merged into it
+    tb_uint32_t full = ((instruction->r0 >> 4) & 3)? 0 : r0;
+
+    // the jumps read the flags if they are conditional
+    tb_uint32_t cond = instruction->cond != VM86_FLAGS_COND_ALWAYS? f : 0;
+
+    // done
+    tb_uint32_t uses = 0;
+    tb_uint32_t defs = 0;
+    tb_uint32_t kills = 0;
+    tb_size_t   kind = VM86_OPTIMIZER_KIND_PURE;
+    switch (vm86_optimizer_opcode(instruction->opcode))
+    {
+    case VM86_OPCODE_RETN:
+    case VM86_OPCODE_LEAVE:
+        kind = VM86_OPTIMIZER_KIND_EXIT; uses = VM86_OPTIMIZER_ALL;
+        break;
+    case VM86_OPCODE_PUSH_R0:
+        kind = VM86_OPTIMIZER_KIND_OTHER; uses = r0 | esp; defs = esp;
+        break;
+    case VM86_OPCODE_PUSH_V0:
+        kind = VM86_OPTIMIZER_KIND_OTHER; uses = esp; defs = esp;
+        break;
+    case VM86_OPCODE_POP_R0:
+        kind = VM86_OPTIMIZER_KIND_OTHER; uses = esp; defs = r0 | esp; kills = full;
+        break;
+    case VM86_OPCODE_MOV_R0_R1:
+    case VM86_OPCODE_MOVZX_R0_R1:
+        uses = r1; defs = r0; kills = full;
+        break;
+    case VM86_OPCODE_MOV_R0_V0:
+        defs = r0; kills = full;
+        break;
+    case VM86_OPCODE_LEA_R0_$R1_ADD_R2_OP_V0$:
+        uses = r1 | r2; defs = r0; kills = full;
+        break;
+    case VM86_OPCODE_NOT_R0:
+        uses = r0; defs = r0;
+        break;
+    case VM86_OPCODE_ADD_R0_R1:
+    case VM86_OPCODE_SUB_R0_R1:
+    case VM86_OPCODE_AND_R0_R1:
+    case VM86_OPCODE_XOR_R0_R1:
+        uses = r0 | r1; defs = r0 | f; kills = full | f;
+        break;
+    case VM86_OPCODE_ADD_R0_V0:
+    case VM86_OPCODE_SUB_R0_V0:
+    case VM86_OPCODE_AND_R0_V0:
+    case VM86_OPCODE_XOR_R0_V0:
+    case VM86_OPCODE_OR_R0_V0:
+        uses = r0; defs = r0 | f; kills = full | f;
+        break;
+    case VM86_OPCODE_CMP_R0_R1:
+        uses = r0 | r1; defs = f; kills = f;
+        break;
+    case VM86_OPCODE_CMP_R0_V0:
+        uses = r0; defs = f; kills = f;
+        break;
+    case VM86_OPCODE_SHR_R0_R1:
+    case VM86_OPCODE_SHL_R0_R1:
+    case VM86_OPCODE_SAR_R0_R1:
+        // the flags are not affected if the count is zero
+        uses = r0 | r1; defs = r0 | f;
+        break;
+    case VM86_OPCODE_SHR_R0_V0:
+    case VM86_OPCODE_SHL_R0_V0:
+    case VM86_OPCODE_SAR_R0_V0:
+        uses = r0; defs = r0 | f; kills = (instruction->v0.u32 & 0x1f)? f : 0;
+        break;
+    case VM86_OPCODE_SHRD_R0_R1_R2:
+        uses = r0 | r1 | r2; defs = r0 | f;
+        break;
+    case VM86_OPCODE_MOV_R0_$R1_ADD_V0$:
+        kind = VM86_OPTIMIZER_KIND_OTHER; uses = r1; defs = r0; kills = full;
+        break;
+    case VM86_OPCODE_MOV_$R0_ADD_V0$_R1:
+        kind = VM86_OPTIMIZER_KIND_OTHER; uses = r0 | r1;
+        break;
+    case VM86_OPCODE_MOV_$R0_ADD_V0$_V1:
+        kind = VM86_OPTIMIZER_KIND_OTHER; uses = r0;
+        break;
+    case VM86_OPCODE_ADD_R0_$R1_ADD_V0$:
+    case VM86_OPCODE_SUB_R0_$R1_ADD_V0$:
+    case VM86_OPCODE_AND_R0_$R1_ADD_V0$:
+    case VM86_OPCODE_XOR_R0_$R1_ADD_V0$:
+    case VM86_OPCODE_OR_R0_$R1_ADD_V0$:
+        kind = VM86_OPTIMIZER_KIND_OTHER; uses = r0 | r1; defs = r0 | f; kills = full | f;
+        break;
+    case VM86_OPCODE_CMP_R0_$R1_ADD_V0$:
+    case VM86_OPCODE_CMP_$R0_ADD_V0$_R1:
+        kind = VM86_OPTIMIZER_KIND_OTHER; uses = r0 | r1; defs = f; kills = f;
+        break;
+    case VM86_OPCODE_CMP_$R0_ADD_V0$_V1:
+        kind = VM86_OPTIMIZER_KIND_OTHER; uses = r0; defs = f; kills = f;
+        break;
+    case VM86_OPCODE_MUL_$R0_ADD_V0$:
+        {
+            tb_uint32_t eax = VM86_OPTIMIZER_REG(VM86_REGISTER_EAX);
+            tb_uint32_t edx = VM86_OPTIMIZER_REG(VM86_REGISTER_EDX);
+            kind = VM86_OPTIMIZER_KIND_OTHER; uses = r0 | eax; defs = eax | edx | f; kills = defs;
+        }
+        break;
+    case VM86_OPCODE_IMUL_R0_$R1_ADD_V0$:
+        kind = VM86_OPTIMIZER_KIND_OTHER; uses = r0 | r1; defs = r0 | f; kills = full | f;
+        break;
+    case VM86_OPCODE_DIV_$R0_ADD_V0$:
+        {
+            // the flags are not affected
+            tb_uint32_t eax = VM86_OPTIMIZER_REG(VM86_REGISTER_EAX);
+            tb_uint32_t edx = VM86_OPTIMIZER_REG(VM86_REGISTER_EDX);
+            kind = VM86_OPTIMIZER_KIND_OTHER; uses = r0 | eax | edx; defs = eax | edx; kills = defs;
+        }
+        break;
+    case VM86_OPCODE_JXX_V0:
+        // the label id is only known for the jump in this proc
+        kind = instruction->v0_reloc == VM86_RELOC_CODE? VM86_OPTIMIZER_KIND_JUMP : VM86_OPTIMIZER_KIND_INDIRECT; uses = cond;
+        break;
+    case VM86_OPCODE_JXX_R0:
+    case VM86_OPCODE_JXX_V0$R0_MUL_V1$:
+    case VM86_OPCODE_JXX_TABLE_R0:
+        kind = VM86_OPTIMIZER_KIND_INDIRECT; uses = r0 | cond;
+        break;
+    default:
+        // the call and the unknown instructions may read and write all registers and flags
+        kind = VM86_OPTIMIZER_KIND_OTHER; uses = VM86_OPTIMIZER_ALL; defs = VM86_OPTIMIZER_ALL;
+        break;
+    }
+
+    // the flag-free variant does not write the flags
+    if (vm86_optimizer_noflags_is(instruction->opcode))
+    {
+        defs &= ~f;
+        kills &= ~f;
+    }
+
+    // save it
+    effect->kind    = kind;
+    effect->uses    = uses;
+    effect->defs    = defs;
+    effect->kills   = kills;
+}
+static tb_void_t vm86_optimizer_root(vm86_optimizer_t* optimizer, tb_uint32_t label)
+{
+    // the label instruction
+    vm86_optimizer_code_t* code = optimizer->code;
+    tb_assert_and_check_return(label < code->labels_count);
+    tb_uint32_t index = code->labels[label];
+
+    // mark it as the root, the label at the end of proc is ignored
+    if (index < code->count) optimizer->leaders[index] |= 3;
+}
+static tb_void_t vm86_optimizer_make(vm86_optimizer_t* optimizer)
+{
+    // the code
+    vm86_optimizer_code_t*  code = optimizer->code;
+    tb_size_t               count = code->count;
+
+    // the entry and the taken labels in the .data are the roots
+    tb_memset(optimizer->leaders, 0, count);
+    optimizer->leaders[0] = 3;
+    tb_size_t i = 0;
+    for (i = 0; i < code->taken_count; i++) vm86_optimizer_root(optimizer, code->taken[i]);
+
+    // mark the leaders
+    vm86_optimizer_effect_t effect;
+    for (i = 0; i < count; i++)
+    {
+        // the effect
+        vm86_instruction_ref_t instruction = code->instructions + i;
+        vm86_optimizer_effect(instruction, &effect);
+
+        // the jump target is the leader
+        if (effect.kind == VM86_OPTIMIZER_KIND_JUMP)
+        {
+            tb_assert(instruction->v0.u32 < code->labels_count);
+            tb_uint32_t target = code->labels[instruction->v0.u32];
+            if (target < count) optimizer->leaders[target] |= 1;
+        }
+        // the other labels referred by the instructions are taken, e.g. mov eax, offset loc_xxx
+        else if (instruction->v0_reloc == VM86_RELOC_CODE) vm86_optimizer_root(optimizer, instruction->v0.u32);
+        if (instruction->v1_reloc == VM86_RELOC_CODE) vm86_optimizer_root(optimizer, instruction->v1.u32);
+
+        // the instruction after the jump or exit is the leader
+        if (effect.kind >= VM86_OPTIMIZER_KIND_JUMP && i + 1 < count) optimizer->leaders[i + 1] |= 1;
+    }
+
+    // make blocks
+    optimizer->blocks_count = 0;
+    for (i = 0; i < count; i++)
+    {
+        // start a new block?
+        if (optimizer->leaders[i])
+        {
+            // close the previous block
+            if (optimizer->blocks_count) optimizer->blocks[optimizer->blocks_count - 1].tail = (tb_uint32_t)i;
+
+            // init the new block
+            vm86_optimizer_block_ref_t block = optimizer->blocks + optimizer->blocks_count++;
+            tb_memset(block, 0, sizeof(vm86_optimizer_block_t));
+            block->head = (tb_uint32_t)i;
+            block->root = optimizer->leaders[i] >> 1;
+        }
+
+        // save the owner block
+        optimizer->owners[i] = (tb_uint32_t)(optimizer->blocks_count - 1);
+    }
+    optimizer->blocks[optimizer->blocks_count - 1].tail = (tb_uint32_t)count;
+
+    // link the successors
+    for (i = 0; i < optimizer->blocks_count; i++)
+    {
+        // the last instruction
+        vm86_optimizer_block_ref_t  block = optimizer->blocks + i;
+        vm86_instruction_ref_t      instruction = code->instructions + block->tail - 1;
+        vm86_optimizer_effect(instruction, &effect);
+
+        // the direct jump
+        block->jump = VM86_OPTIMIZER_NONE;
+        if (effect.kind == VM86_OPTIMIZER_KIND_JUMP)
+        {
+            tb_uint32_t target = code->labels[instruction->v0.u32];
+            if (target < count) block->jump = optimizer->owners[target];
+            else block->exit = 1;
+        }
+
+        // leave this proc or jump indirectly?
+        if (effect.kind == VM86_OPTIMIZER_KIND_INDIRECT || effect.kind == VM86_OPTIMIZER_KIND_EXIT) block->exit = 1;
+
+        // the fallthrough, it leaves this proc at the end
+        block->next = VM86_OPTIMIZER_NONE;
+        if (effect.kind < VM86_OPTIMIZER_KIND_JUMP || (effect.kind != VM86_OPTIMIZER_KIND_EXIT && instruction->cond != VM86_FLAGS_COND_ALWAYS))
+        {
+            if (block->tail < count) block->next = (tb_uint32_t)(i + 1);
+            else block->exit = 1;
+        }
+    }
+
+    // mark the reachable blocks from the roots, the owners are reused as the stack
+    tb_uint32_t*    stack = optimizer->owners;
+    tb_size_t       top = 0;
+    for (i = 0; i < optimizer->blocks_count; i++)
+    {
+        vm86_optimizer_block_ref_t block = optimizer->blocks + i;
+        if (block->root)
+        {
+            block->reachable = 1;
+            stack[top++] = (tb_uint32_t)i;
+        }
+    }
+    while (top)
+    {
+        // visit the successors
+        vm86_optimizer_block_ref_t block = optimizer->blocks + stack[--top];
+        tb_uint32_t succs[2] = {block->jump, block->next};
+        tb_size_t   j = 0;
+        for (j = 0; j < 2; j++)
+        {
+            if (succs[j] != VM86_OPTIMIZER_NONE && !optimizer->blocks[succs[j]].reachable)
+            {
+                optimizer->blocks[succs[j]].reachable = 1;
+                stack[top++] = succs[j];
+            }
+        }
+    }
+
+    // restore the owners
+    for (i = 0; i < optimizer->blocks_count; i++)
+    {
+        vm86_optimizer_block_ref_t  block = optimizer->blocks + i;
+        tb_uint32_t                 j = 0;
+        for (j = block->head; j < block->tail; j++) optimizer->owners[j] = (tb_uint32_t)i;
+    }
+
+    // clear the deleted marks
+    tb_memset(optimizer->removed, 0, count);
+}
+static tb_void_t vm86_optimizer_liveness(vm86_optimizer_t* optimizer)
+{
+    // the code
+    vm86_optimizer_code_t*  code = optimizer->code;
+    tb_size_t               i = 0;
+
+    // compute the live registers and flags at the heads until they are not changed
+    tb_bool_t changed = tb_true;
+    while (changed)
+    {
+        // walk the blocks backward, most of the successors are behind
+        changed = tb_false;
+        for (i = optimizer->blocks_count; i > 0; i--)
+        {
+            // the live registers and flags at the tail
+            vm86_optimizer_block_ref_t block = optimizer->blocks + i - 1;
+            tb_uint32_t live = block->exit? VM86_OPTIMIZER_ALL : 0;
+            if (block->jump != VM86_OPTIMIZER_NONE) live |= optimizer->blocks[block->jump].live_in;
+            if (block->next != VM86_OPTIMIZER_NONE) live |= optimizer->blocks[block->next].live_in;
+            block->live_out = live;
+
+            // walk the instructions backward
+            tb_uint32_t j = block->tail;
+            while (j > block->head)
+            {
+                // save the live registers and flags after it
+                optimizer->lives[--j] = live;
+
+                // the deleted instruction is skipped
+                tb_check_continue(!optimizer->removed[j]);
+
+                // live = uses | (live - kills)
+                vm86_optimizer_effect_t effect;
+                vm86_optimizer_effect(code->instructions + j, &effect);
+                live = (live & ~effect.kills) | effect.uses;
+            }
+
+            // changed?
+            if (live != block->live_in)
+            {
+                block->live_in = live;
+                changed = tb_true;
+            }
+        }
+    }
+}
+static tb_void_t vm86_optimizer_state_unknown(vm86_optimizer_state_ref_t state)
+{
+    state->known    = 0;
+    state->flags.op = VM86_OPTIMIZER_FLAGS_UNKNOWN;
+    state->reached  = tb_true;
+}
+static tb_bool_t vm86_optimizer_state_merge(vm86_optimizer_state_ref_t state, vm86_optimizer_state_ref_t other)
+{
+    // the first predecessor?
+    if (!state->reached)
+    {
+        tb_memcpy(state, other, sizeof(vm86_optimizer_state_t));
+        return tb_true;
+    }
+
+    // only keep the same constant registers
+    tb_uint32_t known = state->known & other->known;
+    tb_size_t   r = 0;
+    for (r = 0; r < 8; r++)
+    {
+        if ((known & (1 << r)) && state->registers[r].u32 != other->registers[r].u32) known &= ~(1 << r);
+    }
+
+    // only keep the same constant flags
+    tb_uint32_t op = state->flags.op;
+    if (    op != other->flags.op
+        ||  state->flags.bits != other->flags.bits
+        ||  state->flags.dst != other->flags.dst
+        ||  state->flags.src != other->flags.src
+        ||  state->flags.result != other->flags.result)
+        op = VM86_OPTIMIZER_FLAGS_UNKNOWN;
+
+    // changed?
+    tb_bool_t changed = known != state->known || op != state->flags.op;
+    state->known    = known;
+    state->flags.op = op;
+    return changed;
+}
+static tb_bool_t vm86_optimizer_state_eval(vm86_optimizer_state_ref_t state, vm86_instruction_ref_t instruction, vm86_optimizer_effect_t const* effect)
+{
+    // the partially or conditionally written registers are the inputs too
+    tb_uint32_t inputs = (effect->uses | (effect->defs & ~effect->kills)) & VM86_OPTIMIZER_REGS;
+    tb_uint32_t known = state->known;
+
+    // xor r0, r0 and sub r0, r0 are always zero
+    tb_uint8_t opcode = vm86_optimizer_opcode(instruction->opcode);
+    if (    (opcode == VM86_OPCODE_XOR_R0_R1 || opcode == VM86_OPCODE_SUB_R0_R1)
+        &&  instruction->r0 == instruction->r1 && !((instruction->r0 >> 4) & 3))
+    {
+        state->registers[instruction->r0].u32 = 0;
+        known |= VM86_OPTIMIZER_REG(instruction->r0);
+    }
+
+    // only the register instructions with the constant inputs are evaluated, the relocated values are not constant
+    if (    effect->kind == VM86_OPTIMIZER_KIND_PURE
+        &&  instruction->v0_reloc == VM86_RELOC_NONE && instruction->v1_reloc == VM86_RELOC_NONE
+        &&  !(inputs & ~known))
+    {
+        // execute it on the scratch context, the register instructions do not touch the stack
+        vm86_context_t context;
+        tb_memset(&context, 0, sizeof(vm86_context_t));
+        tb_memcpy(context.registers, state->registers, sizeof(vm86_registers_t));
+        context.flags = state->flags;
+        vm86_instruction_done(instruction->opcode)(instruction, (vm86_context_ref_t)&context);
+
+        // save the results, the flags are still unknown if they are not written
+        tb_memcpy(state->registers, context.registers, sizeof(vm86_registers_t));
+        state->flags = context.flags;
+        state->known = known | (effect->defs & VM86_OPTIMIZER_REGS);
+        return tb_true;
+    }
+
+    // the written registers and flags are unknown now
+    state->known &= ~effect->defs;
+    if (effect->defs & VM86_OPTIMIZER_FLAGS) state->flags.op = VM86_OPTIMIZER_FLAGS_UNKNOWN;
+    return tb_false;
+}
+static tb_void_t vm86_optimizer_state_block(vm86_optimizer_t* optimizer, vm86_optimizer_block_ref_t block, vm86_optimizer_state_ref_t state)
+{
+    tb_uint32_t j = 0;
+    for (j = block->head; j < block->tail; j++)
+    {
+        vm86_optimizer_effect_t effect;
+        vm86_instruction_ref_t  instruction = optimizer->code->instructions + j;
+        vm86_optimizer_effect(instruction, &effect);
+        vm86_optimizer_state_eval(state, instruction, &effect);
+    }
+}
+static tb_void_t vm86_optimizer_mov(vm86_instruction_ref_t instruction, tb_uint32_t value)
+{
+    // rewrite it to mov r0, v0
+    instruction->opcode     = vm86_optimizer_width(VM86_OPCODE_MOV_R0_V0, instruction->r0);
+    instruction->r1         = 0;
+    instruction->r2         = 0;
+    instruction->op         = 0;
+    instruction->v0.u32     = value;
+    instruction->v1.u32     = 0;
+    instruction->hint[0]    = 'm';
+    instruction->hint[1]    = 'o';
+    instruction->hint[2]    = 'v';
+}
+static tb_size_t vm86_optimizer_unreachable(vm86_optimizer_t* optimizer)
+{
+    // delete all instructions of the unreachable blocks
+    tb_size_t count = 0;
+    tb_size_t i = 0;
+    for (i = 0; i < optimizer->blocks_count; i++)
+    {
+        vm86_optimizer_block_ref_t block = optimizer->blocks + i;
+        if (!block->reachable)
+        {
+            tb_memset(optimizer->removed + block->head, 1, block->tail - block->head);
+            count += block->tail - block->head;
+        }
+    }
+
+    // ok
+    return count;
+}
+static tb_size_t vm86_optimizer_constant(vm86_optimizer_t* optimizer)
+{
+    // make the constant states at the heads of the blocks
+    tb_size_t                   blocks_count = optimizer->blocks_count;
+    vm86_optimizer_state_ref_t  states = tb_nalloc0_type(blocks_count, vm86_optimizer_state_t);
+    tb_assert_and_check_return_val(states, 0);
+
+    // nothing is known at the roots, they may be reached from the caller or the indirect jumps
+    tb_size_t i = 0;
+    for (i = 0; i < blocks_count; i++)
+    {
+        if (optimizer->blocks[i].root) vm86_optimizer_state_unknown(states + i);
+    }
+
+    // propagate the constants until the states are not changed
+    vm86_optimizer_state_t  state;
+    tb_bool_t               changed = tb_true;
+    while (changed)
+    {
+        changed = tb_false;
+        for (i = 0; i < blocks_count; i++)
+        {
+            // the reached block
+            vm86_optimizer_block_ref_t block = optimizer->blocks + i;
+            tb_check_continue(states[i].reached);
+
+            // the state at the tail
+            state = states[i];
+            vm86_optimizer_state_block(optimizer, block, &state);
+
+            // merge it to the successors
+            if (block->jump != VM86_OPTIMIZER_NONE && vm86_optimizer_state_merge(states + block->jump, &state)) changed = tb_true;
+            if (block->next != VM86_OPTIMIZER_NONE && vm86_optimizer_state_merge(states + block->next, &state)) changed = tb_true;
+        }
+    }
+
+    // fold the constant instructions
+    tb_size_t count = 0;
+    vm86_optimizer_code_t* code = optimizer->code;
+    for (i = 0; i < blocks_count; i++)
+    {
+        // the reached block
+        vm86_optimizer_block_ref_t block = optimizer->blocks + i;
+        tb_check_continue(states[i].reached);
+
+        // walk the instructions
+        state = states[i];
+        tb_uint32_t j = 0;
+        for (j = block->head; j < block->tail; j++)
+        {
+            // the effect
+            vm86_instruction_ref_t  instruction = code->instructions + j;
+            vm86_optimizer_effect_t effect;
+            vm86_optimizer_effect(instruction, &effect);
+
+            // the jump by the table with the constant index? jump to the entry directly
+            if (    instruction->opcode == VM86_OPCODE_JXX_TABLE_R0 && code->tables
+                &&  (state.known & VM86_OPTIMIZER_REG(instruction->r0))
+                &&  vm86_registers_value(state.registers, instruction->r0) < code->tables[instruction->v1.u32])
+            {
+                tb_uint32_t index = vm86_registers_value(state.registers, instruction->r0);
+                instruction->opcode     = VM86_OPCODE_JXX_V0;
+                instruction->r0         = 0;
+                instruction->v0.u32     = code->tables[instruction->v1.u32 + 1 + index];
+                instruction->v0_reloc   = VM86_RELOC_CODE;
+                instruction->v1.u32     = 0;
+                count++;
+                continue ;
+            }
+
+            // the conditional jump with the constant flags?
+            if (    effect.kind >= VM86_OPTIMIZER_KIND_JUMP && effect.kind != VM86_OPTIMIZER_KIND_EXIT
+                &&  instruction->cond != VM86_FLAGS_COND_ALWAYS
+                &&  state.flags.op != VM86_OPTIMIZER_FLAGS_UNKNOWN && state.flags.op != VM86_FLAGS_OP_NONE)
+            {
+                // test it on the copy of the flags
+                vm86_flags_t    flags = state.flags;
+                tb_uint32_t     eflags = 0;
+                if (vm86_flags_cond(&flags, &eflags, instruction->cond))
+                {
+                    // it is always taken
+                    instruction->cond       = VM86_FLAGS_COND_ALWAYS;
+                    instruction->hint[0]    = 'j';
+                    instruction->hint[1]    = 'm';
+                    instruction->hint[2]    = 'p';
+                }
+                // it is never taken
+                else optimizer->removed[j] = 1;
+                count++;
+                continue ;
+            }
+
+            // evaluate it
+            vm86_optimizer_state_t  prev = state;
+            tb_bool_t               known = vm86_optimizer_state_eval(&state, instruction, &effect);
+
+            // the register value is constant and the written flags will not be read?
+            tb_uint8_t  r0 = instruction->r0;
+            tb_uint8_t  r1 = instruction->r1;
+            tb_uint8_t  opcode = vm86_optimizer_opcode(instruction->opcode);
+            if (known && (effect.defs & VM86_OPTIMIZER_REGS) && !(effect.defs & optimizer->lives[j] & VM86_OPTIMIZER_FLAGS))
+            {
+                // the register is not changed? delete it
+                tb_size_t r = r0 & VM86_REGISTER_MASK;
+                if ((prev.known & VM86_OPTIMIZER_REG(r0)) && prev.registers[r].u32 == state.registers[r].u32)
+                {
+                    optimizer->removed[j] = 1;
+                    count++;
+                }
+                // rewrite it to mov r0, v0
+                else if (opcode != VM86_OPCODE_MOV_R0_V0)
+                {
+                    vm86_optimizer_mov(instruction, vm86_registers_value(state.registers, r0));
+                    count++;
+                }
+            }
+            // the r1 of xxx r0, r1 is constant? rewrite it to xxx r0, v0, the flags are the same
+            else if (effect.kind == VM86_OPTIMIZER_KIND_PURE && (prev.known & VM86_OPTIMIZER_REG(r1)))
+            {
+                // the xxx r0, v0 opcode, the operands of the generic opcodes may have the different widths
+                tb_uint8_t  generic = VM86_OPCODE_NONE;
+                tb_uint32_t value = vm86_registers_value(prev.registers, r1);
+                switch (opcode)
+                {
+                case VM86_OPCODE_ADD_R0_R1: generic = VM86_OPCODE_ADD_R0_V0; break;
+                case VM86_OPCODE_SUB_R0_R1: generic = VM86_OPCODE_SUB_R0_V0; break;
+                case VM86_OPCODE_AND_R0_R1: generic = VM86_OPCODE_AND_R0_V0; break;
+                case VM86_OPCODE_XOR_R0_R1: generic = VM86_OPCODE_XOR_R0_V0; break;
+                case VM86_OPCODE_CMP_R0_R1: generic = VM86_OPCODE_CMP_R0_V0; break;
+                case VM86_OPCODE_SHR_R0_R1: generic = VM86_OPCODE_SHR_R0_V0; value &= 0x1f; break;
+                case VM86_OPCODE_SHL_R0_R1: generic = VM86_OPCODE_SHL_R0_V0; value &= 0x1f; break;
+                case VM86_OPCODE_SAR_R0_R1: generic = VM86_OPCODE_SAR_R0_V0; value &= 0x1f; break;
+                default: break;
+                }
+                if (generic && (opcode != instruction->opcode || opcode == VM86_OPCODE_SHR_R0_R1 || opcode == VM86_OPCODE_SHL_R0_R1 || opcode == VM86_OPCODE_SAR_R0_R1))
+                {
+                    instruction->opcode = vm86_optimizer_width(generic, r0);
+                    instruction->r1     = 0;
+                    instruction->v0.u32 = value;
+                    count++;
+                }
+            }
+        }
+    }
+
+    // exit the states
+    tb_free(states);
+
+    // ok
+    return count;
+}
+static tb_size_t vm86_optimizer_dead(vm86_optimizer_t* optimizer)
+{
+    // delete the register instructions whose written registers and flags will not be read
+    tb_size_t count = 0;
+    tb_size_t i = 0;
+    for (i = 0; i < optimizer->blocks_count; i++)
+    {
+        // the reachable block
+        vm86_optimizer_block_ref_t block = optimizer->blocks + i;
+        tb_check_continue(block->reachable);
+
+        // walk the instructions backward, so the dead chain in this block is deleted at once
+        tb_uint32_t live = block->live_out;
+        tb_uint32_t j = block->tail;
+        while (j > block->head)
+        {
+            // the effect
+            vm86_optimizer_effect_t effect;
+            vm86_optimizer_effect(optimizer->code->instructions + --j, &effect);
+
+            // dead?
+            if (effect.kind == VM86_OPTIMIZER_KIND_PURE && !(effect.defs & live))
+            {
+                optimizer->removed[j] = 1;
+                count++;
+                continue ;
+            }
+
+            // live = uses | (live - kills)
+            live = (live & ~effect.kills) | effect.uses;
+        }
+    }
+
+    // ok
+    return count;
+}
+static tb_size_t vm86_optimizer_flags(vm86_optimizer_t* optimizer)
+{
+    // choose the flag-free variants of the instructions whose written flags will not be read
+    tb_size_t               count = 0;
+    tb_size_t               i = 0;
+    vm86_optimizer_code_t*  code = optimizer->code;
+    for (i = 0; i < code->count; i++)
+    {
+        // the reachable instruction
+        tb_check_continue(optimizer->blocks[optimizer->owners[i]].reachable);
+
+        // the flags are written and dead?
+        vm86_instruction_ref_t  instruction = code->instructions + i;
+        vm86_optimizer_effect_t effect;
+        vm86_optimizer_effect(instruction, &effect);
+        tb_check_continue((effect.defs & VM86_OPTIMIZER_FLAGS) && !(optimizer->lives[i] & VM86_OPTIMIZER_FLAGS));
+
+        // the flag-free variant
+        tb_uint8_t opcode = vm86_optimizer_noflags(instruction->opcode);
+        if (opcode)
+        {
+            instruction->opcode = opcode;
+            count++;
+        }
+    }
+
+    // ok
+    return count;
+}
+static tb_size_t vm86_optimizer_compact(vm86_optimizer_t* optimizer)
+{
+    // the code
+    vm86_optimizer_code_t*  code = optimizer->code;
+    tb_size_t               count = code->count;
+
+    // move the kept instructions forward, the owners are reused as the new index of each instruction
+    tb_size_t i = 0;
+    tb_size_t n = 0;
+    for (i = 0; i < count; i++)
+    {
+        optimizer->owners[i] = (tb_uint32_t)n;
+        if (optimizer->removed[i])
+        {
+            // exit cstring
+            vm86_instruction_ref_t instruction = code->instructions + i;
+            if (instruction->is_cstr && instruction->v0.cstr) tb_free(instruction->v0.cstr);
+            continue ;
+        }
+        if (n != i)
+        {
+            code->instructions[n]   = code->instructions[i];
+            code->lines[n]          = code->lines[i];
+        }
+        n++;
+    }
+
+    // move the labels to the next kept instructions
+    for (i = 0; i < code->labels_count; i++)
+    {
+        tb_uint32_t index = code->labels[i];
+        code->labels[i] = index < count? optimizer->owners[index] : (tb_uint32_t)n;
+    }
+
+    // save the new count
+    code->count = n;
+
+    // the deleted count
+    return count - n;
+}
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * implementation
+ */
+tb_void_t vm86_optimizer_done(vm86_optimizer_code_t* code, tb_size_t passes, tb_size_t stats[VM86_OPTIMIZER_PASSES])
+{
+    // check
+    tb_assert_and_check_return(code && code->instructions && code->lines && (code->labels || !code->labels_count) && stats);
+
+    // all labels must be defined
+    tb_size_t i = 0;
+    for (i = 0; i < code->labels_count; i++)
+    {
+        tb_check_return(code->labels[i] <= code->count);
+    }
+
+    // done
+    tb_size_t           count = code->count;
+    vm86_optimizer_t    optimizer = {0};
+    do
+    {
+        // check
+        tb_check_break(count && passes);
+
+        // init the optimizer
+        optimizer.code      = code;
+        optimizer.blocks    = tb_nalloc_type(count, vm86_optimizer_block_t);
+        optimizer.owners    = tb_nalloc_type(count, tb_uint32_t);
+        optimizer.lives     = tb_nalloc_type(count, tb_uint32_t);
+        optimizer.leaders   = tb_nalloc_type(count, tb_byte_t);
+        optimizer.removed   = tb_nalloc_type(count, tb_byte_t);
+        tb_assert_and_check_break(optimizer.blocks && optimizer.owners && optimizer.lives && optimizer.leaders && optimizer.removed);
+
+        // delete the unreachable blocks
+        if (passes & VM86_PROC_OPTIMIZE_UNREACHABLE)
+        {
+            vm86_optimizer_make(&optimizer);
+            vm86_optimizer_unreachable(&optimizer);
+            stats[0] += vm86_optimizer_compact(&optimizer);
+        }
+
+        // propagate the constants and fold them
+        if ((passes & VM86_PROC_OPTIMIZE_CONSTANT) && code->count)
+        {
+            vm86_optimizer_make(&optimizer);
+            vm86_optimizer_liveness(&optimizer);
+            stats[1] += vm86_optimizer_constant(&optimizer);
+            vm86_optimizer_compact(&optimizer);
+
+            // the folded jumps may make more blocks unreachable
+            if (passes & VM86_PROC_OPTIMIZE_UNREACHABLE)
+            {
+                vm86_optimizer_make(&optimizer);
+                vm86_optimizer_unreachable(&optimizer);
+                stats[0] += vm86_optimizer_compact(&optimizer);
+            }
+        }
+
+        // delete the dead register writes until there are no more, the deleted writes may make their inputs dead
+        if (passes & VM86_PROC_OPTIMIZE_DEAD)
+        {
+            tb_size_t deleted = 1;
+            while (deleted && code->count)
+            {
+                vm86_optimizer_make(&optimizer);
+                vm86_optimizer_liveness(&optimizer);
+                vm86_optimizer_dead(&optimizer);
+                deleted = vm86_optimizer_compact(&optimizer);
+                stats[2] += deleted;
+            }
+        }
+
+        // drop the dead flags updates at last, the other passes only see the instructions with the flags
+        if ((passes & VM86_PROC_OPTIMIZE_FLAGS) && code->count)
+        {
+            vm86_optimizer_make(&optimizer);
+            vm86_optimizer_liveness(&optimizer);
+            stats[3] += vm86_optimizer_flags(&optimizer);
+        }
+
+        // update the executors of the rewritten instructions
+        for (i = 0; i < code->count; i++) code->instructions[i].done = vm86_instruction_done(code->instructions[i].opcode);
+
+        // trace
+        tb_trace_d("optimize: %lu => %lu, unreachable: %lu, constant: %lu, dead: %lu, flags: %lu", count, code->count, stats[0], stats[1], stats[2], stats[3]);
+
+    } while (0);
+
+    // exit the optimizer
+    if (optimizer.blocks) tb_free(optimizer.blocks);
+    if (optimizer.owners) tb_free(optimizer.owners);
+    if (optimizer.lives) tb_free(optimizer.lives);
+    if (optimizer.leaders) tb_free(optimizer.leaders);
+    if (optimizer.removed) tb_free(optimizer.removed);
+}
@@ -28,17 +28,104 @@
  * includes
  */
 #include "parser.h"
+#include "impl/hash.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+// the register entry type
+typedef struct __vm86_parser_register_t
+{
+    // the register name
+    tb_char_t const*        name;
+
+    // the register index
+    tb_uint8_t              index;
+
+}vm86_parser_register_t, *vm86_parser_register_ref_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * globals
+ */
+
+// the registers, index: the key index of g_registers_hash
+static vm86_parser_register_t   g_registers[] =
+{
+    { "ah",     VM86_REGISTER_EAX | VM86_REGISTER_AH }
+,   { "al",     VM86_REGISTER_EAX | VM86_REGISTER_AL }
+,   { "ax",     VM86_REGISTER_EAX | VM86_REGISTER_AX }
+,   { "bh",     VM86_REGISTER_EBX | VM86_REGISTER_BH }
+,   { "bl",     VM86_REGISTER_EBX | VM86_REGISTER_BL }
+,   { "bx",     VM86_REGISTER_EBX | VM86_REGISTER_BX }
+,   { "ch",     VM86_REGISTER_ECX | VM86_REGISTER_CH }
+,   { "cl",     VM86_REGISTER_ECX | VM86_REGISTER_CL }
+,   { "cx",     VM86_REGISTER_ECX | VM86_REGISTER_CX }
+,   { "dh",     VM86_REGISTER_EDX | VM86_REGISTER_DH }
+,   { "dl",     VM86_REGISTER_EDX | VM86_REGISTER_DL }
+,   { "dx",     VM86_REGISTER_EDX | VM86_REGISTER_DX }
+,   { "eax",    VM86_REGISTER_EAX }
+,   { "ebp",    VM86_REGISTER_EBP }
+,   { "ebx",    VM86_REGISTER_EBX }
+,   { "ecx",    VM86_REGISTER_ECX }
+,   { "edi",    VM86_REGISTER_EDI }
+,   { "edx",    VM86_REGISTER_EDX }
+,   { "esi",    VM86_REGISTER_ESI }
+,   { "esp",    VM86_REGISTER_ESP }
+};
+
+// the perfect hash of the registers, it is made when the first register is parsed
+static vm86_hash_perfect_t      g_registers_hash;
+
+// the registers hash is made?
+static tb_atomic_t              g_registers_made = 0;
+
+// the lock of making the registers hash, the procs may be compiled in parallel
+static tb_spinlock_t            g_registers_lock = TB_SPINLOCK_INIT;
 
 /* //////////////////////////////////////////////////////////////////////////////////////
  * private implementation
  */
-static tb_long_t vm86_parser_comp_register(tb_iterator_ref_t iterator, tb_cpointer_t item, tb_cpointer_t name)
+static tb_bool_t vm86_parser_registers_make()
 {
-    // check
-    tb_assert(item);
+    // made?
+    tb_check_return_val(!tb_atomic_get(&g_registers_made), tb_true);
+
+    // enter
+    tb_spinlock_enter(&g_registers_lock);
+
+    // done
+    do
+    {
+        // made by the other thread?
+        tb_check_break(!tb_atomic_get(&g_registers_made));
+
+        // add the registers, the key index is the same as the entry index
+        tb_size_t i = 0;
+        for (i = 0; i < tb_arrayn(g_registers); i++)
+        {
+            tb_size_t index = vm86_hash_perfect_add(&g_registers_hash, vm86_hash_perfect_key(g_registers[i].name, tb_strlen(g_registers[i].name)));
+            tb_assert_and_check_break(index == i);
+        }
+        tb_check_break(i == tb_arrayn(g_registers));
+
+        // make the perfect hash
+        if (!vm86_hash_perfect_make(&g_registers_hash)) 
+        {
+            tb_trace_e("make the perfect hash of the registers failed!");
+            break;
+        }
 
-    // hacking for register 
-    return tb_stricmp(*((tb_char_t const**)item), (tb_char_t const*)name);
+        // ok
+        tb_atomic_set(&g_registers_made, 1);
+
+    } while (0);
+
+    // leave
+    tb_spinlock_leave(&g_registers_lock);
+
+    // ok?
+    return tb_atomic_get(&g_registers_made)? tb_true : tb_false;
 }
 
 /* //////////////////////////////////////////////////////////////////////////////////////
@@ -63,7 +150,7 @@ tb_bool_t vm86_parser_get_variable_name(tb_char_t const** pp, tb_char_t const* e
 
         // get name
         while (p < e && (tb_isalpha(*p) || *p == '_' || tb_isdigit(*p))) p++;
-        tb_check_break(p <= e && p - b < maxn);
+        tb_check_break(p <= e && (tb_size_t)(p - b) < maxn);
         tb_memcpy(name, b, p - b);
 
         // end
@@ -98,7 +185,7 @@ tb_bool_t vm86_parser_get_segment_name(tb_char_t const** pp, tb_char_t const* e,
 
         // get name
         while (p < e && tb_isalpha(*p)) p++;
-        tb_check_break(p < e && p - b < maxn && *p == ':');
+        tb_check_break(p < e && (tb_size_t)(p - b) < maxn && *p == ':');
         tb_memcpy(name, b, p - b);
 
         // end
@@ -136,7 +223,7 @@ tb_bool_t vm86_parser_get_instruction_name(tb_char_t const** pp, tb_char_t const
 
         // skip name
         while (p < e && tb_isalpha(*p)) p++;
-        tb_check_break(p <= e && p - b < maxn);
+        tb_check_break(p <= e && (tb_size_t)(p - b) < maxn);
 
         // not instruction name?
         if (p < e && !tb_isspace(*p)) break;
@@ -174,68 +261,29 @@ tb_bool_t vm86_parser_get_register(tb_char_t const** pp, tb_char_t const* e, tb_
         // save base
         tb_char_t const* b = p;
 
-        // get instruction name
-        tb_char_t name[64] = {0};
+        // make the perfect hash of the registers at the first time
+        if (!vm86_parser_registers_make()) break;
+
+        // get the register key
         while (p < e && tb_isalpha(*p)) p++;
-        tb_check_break(p <= e && p - b < sizeof(name));
-        tb_memcpy(name, b, p - b);
+        tb_uint64_t key = vm86_hash_perfect_key(b, p - b);
 
         // skip the space
         while (p < e && tb_isspace(*p)) p++;
 
-        // the register entry type
-        typedef struct __vm86_register_entry_t
-        {
-            // the register name
-            tb_char_t const*        name;
-
-            // the register index
-            tb_uint8_t              index;
-
-        }vm86_register_entry_t, *vm86_register_entry_ref_t;
-
-        // the registers
-        static vm86_register_entry_t s_registers[] =
-        {
-            { "ah",     VM86_REGISTER_EAX | VM86_REGISTER_AH }
-        ,   { "al",     VM86_REGISTER_EAX | VM86_REGISTER_AL }
-        ,   { "ax",     VM86_REGISTER_EAX | VM86_REGISTER_AX }
-        ,   { "bh",     VM86_REGISTER_EBX | VM86_REGISTER_BH }
-        ,   { "bl",     VM86_REGISTER_EBX | VM86_REGISTER_BL }
-        ,   { "bx",     VM86_REGISTER_EBX | VM86_REGISTER_BX }
-        ,   { "ch",     VM86_REGISTER_ECX | VM86_REGISTER_CH }
-        ,   { "cl",     VM86_REGISTER_ECX | VM86_REGISTER_CL }
-        ,   { "cx",     VM86_REGISTER_ECX | VM86_REGISTER_CX }
-        ,   { "dh",     VM86_REGISTER_EDX | VM86_REGISTER_DH }
-        ,   { "dl",     VM86_REGISTER_EDX | VM86_REGISTER_DL }
-        ,   { "dx",     VM86_REGISTER_EDX | VM86_REGISTER_DX }
-        ,   { "eax",    VM86_REGISTER_EAX }
-        ,   { "ebp",    VM86_REGISTER_EBP }
-        ,   { "ebx",    VM86_REGISTER_EBX }
-        ,   { "ecx",    VM86_REGISTER_ECX }
-        ,   { "edi",    VM86_REGISTER_EDI }
-        ,   { "edx",    VM86_REGISTER_EDX }
-        ,   { "esi",    VM86_REGISTER_ESI }
-        ,   { "esp",    VM86_REGISTER_ESP }
-        };
-
-        // init iterator
-        tb_array_iterator_t array_iterator;
-        tb_iterator_ref_t   iterator = tb_array_iterator_init_mem(&array_iterator, s_registers, tb_arrayn(s_registers), sizeof(vm86_register_entry_t));
-
-        // find register by the binary search
-        tb_size_t itor = tb_binary_find_all_if(iterator, vm86_parser_comp_register, name);
-        tb_check_break(itor != tb_iterator_tail(iterator));
+        // find register by the perfect hash
+        tb_size_t index = vm86_hash_perfect_find(&g_registers_hash, key);
+        tb_check_break(index != (tb_size_t)-1);
 
         // get the register
-        vm86_register_entry_ref_t entry = (vm86_register_entry_ref_t)tb_iterator_item(iterator, itor);
-        tb_assert_and_check_break(entry && (entry->index & VM86_REGISTER_MASK) < VM86_REGISTER_MAXN);
+        vm86_parser_register_ref_t entry = &g_registers[index];
+        tb_assert_and_check_break((entry->index & VM86_REGISTER_MASK) < VM86_REGISTER_MAXN);
 
         // save register
         *r = entry->index;
 
         // trace
-        tb_trace_d("register: %s: %x", name, entry->index);
+        tb_trace_d("register: %s: %x", entry->name, entry->index);
 
         // ok 
         ok = tb_true;
@@ -248,19 +296,29 @@ tb_bool_t vm86_parser_get_register(tb_char_t const** pp, tb_char_t const* e, tb_
     // ok?
     return ok;
 }
-tb_bool_t vm86_parser_get_value(tb_char_t const** pp, tb_char_t const* e, tb_uint32_t* value, tb_hash_map_ref_t proc_locals, tb_hash_map_ref_t proc_labels, vm86_data_ref_t data)
+tb_bool_t vm86_parser_get_value(tb_char_t const** pp, tb_char_t const* e, tb_uint32_t* value, tb_hash_map_ref_t proc_locals, tb_hash_map_ref_t proc_labels, vm86_data_ref_t data, tb_uint8_t* reloc)
 {
     // check
     tb_assert(pp && e && value && proc_labels);
 
     // try to get the number value first
-    if (vm86_parser_get_number_value(pp, e, value)) return tb_true;
+    if (vm86_parser_get_number_value(pp, e, value)) 
+    {
+        // not an address
+        if (reloc) *reloc = VM86_RELOC_NONE;
+        return tb_true;
+    }
 
     // try to get the local value again
-    if (vm86_parser_get_local_value(pp, e, value, proc_locals)) return tb_true;
+    if (vm86_parser_get_local_value(pp, e, value, proc_locals)) 
+    {
+        // not an address
+        if (reloc) *reloc = VM86_RELOC_NONE;
+        return tb_true;
+    }
 
     // get the offset value last
-    return vm86_parser_get_offset_value(pp, e, value, proc_labels, data);
+    return vm86_parser_get_offset_value(pp, e, value, proc_labels, data, reloc);
 }
 tb_bool_t vm86_parser_get_number_value(tb_char_t const** pp, tb_char_t const* e, tb_uint32_t* value)
 { 
@@ -334,7 +392,7 @@ tb_bool_t vm86_parser_get_local_value(tb_char_t const** pp, tb_char_t const* e,
 
         // get value
         if (tb_hash_map_find(proc_locals, name) != tb_iterator_tail(proc_locals))
-            *value = (tb_uint32_t)tb_hash_map_get(proc_locals, name);
+            *value = tb_p2u32(tb_hash_map_get(proc_locals, name));
         else break;
 
         // trace
@@ -351,13 +409,14 @@ tb_bool_t vm86_parser_get_local_value(tb_char_t const** pp, tb_char_t const* e,
     // ok?
     return ok;
 }
-tb_bool_t vm86_parser_get_offset_value(tb_char_t const** pp, tb_char_t const* e, tb_uint32_t* value, tb_hash_map_ref_t proc_labels, vm86_data_ref_t data)
+tb_bool_t vm86_parser_get_offset_value(tb_char_t const** pp, tb_char_t const* e, tb_uint32_t* value, tb_hash_map_ref_t proc_labels, vm86_data_ref_t data, tb_uint8_t* reloc)
 {
     // check
     tb_assert(pp && e && value && proc_labels);
 
     // done
     tb_bool_t           ok = tb_false;
+    tb_uint8_t          type = VM86_RELOC_NONE;
     tb_char_t const*    p = *pp;
     do
     {
@@ -377,17 +436,29 @@ tb_bool_t vm86_parser_get_offset_value(tb_char_t const** pp, tb_char_t const* e,
 
         // is .data segment?
         if (has_segment && !tb_stricmp(segment, "ds"))
+        {
             *value = vm86_data_get(data, name, tb_null);
+            type = VM86_RELOC_DATA;
+        }
         // is .code segment?
         else if (has_segment && !tb_stricmp(segment, "cs"))
-            *value = (tb_uint32_t)tb_hash_map_get(proc_labels, name);
+        {
+            *value = tb_p2u32(tb_hash_map_get(proc_labels, name));
+            type = VM86_RELOC_CODE;
+        }
         else
         {
             // get value
             if (tb_hash_map_find(proc_labels, name) != tb_iterator_tail(proc_labels))
-                *value = (tb_uint32_t)tb_hash_map_get(proc_labels, name);
+            {
+                *value = tb_p2u32(tb_hash_map_get(proc_labels, name));
+                type = VM86_RELOC_CODE;
+            }
             else if (vm86_data_is(data, name)) 
+            {
                 *value = vm86_data_get(data, name, tb_null);
+                type = VM86_RELOC_DATA;
+            }
             else break;
         }
 
@@ -402,8 +473,12 @@ tb_bool_t vm86_parser_get_offset_value(tb_char_t const** pp, tb_char_t const* e,
 
     } while (0);
 
-    // update the code pointer if ok
-    if (ok) *pp = p;
+    // update the code pointer and relocation type if ok
+    if (ok) 
+    {
+        *pp = p;
+        if (reloc) *reloc = type;
+    }
 
     // ok?
     return ok;
@@ -86,10 +86,11 @@ tb_bool_t                   vm86_parser_get_register(tb_char_t const** pp, tb_ch
  * @param proc_locals       the proc locals
  * @param proc_labels       the proc labels
  * @param data              the .data segment
+ * @param reloc             the relocation type pointer of the value, vm86_reloc_e, optional
  *
  * @return                  tb_true or tb_false
  */
-tb_bool_t                   vm86_parser_get_value(tb_char_t const** pp, tb_char_t const* e, tb_uint32_t* value, tb_hash_map_ref_t proc_locals, tb_hash_map_ref_t proc_labels, vm86_data_ref_t data);
+tb_bool_t                   vm86_parser_get_value(tb_char_t const** pp, tb_char_t const* e, tb_uint32_t* value, tb_hash_map_ref_t proc_locals, tb_hash_map_ref_t proc_labels, vm86_data_ref_t data, tb_uint8_t* reloc);
 
 /* get number value
  *
@@ -119,10 +120,11 @@ tb_bool_t                   vm86_parser_get_local_value(tb_char_t const** pp, tb
  * @param value             the value pointer
  * @param proc_labels       the proc labels
  * @param data              the .data segment
+ * @param reloc             the relocation type pointer of the value, vm86_reloc_e, optional
  *
  * @return                  tb_true or tb_false
  */
-tb_bool_t                   vm86_parser_get_offset_value(tb_char_t const** pp, tb_char_t const* e, tb_uint32_t* value, tb_hash_map_ref_t proc_labels, vm86_data_ref_t data);
+tb_bool_t                   vm86_parser_get_offset_value(tb_char_t const** pp, tb_char_t const* e, tb_uint32_t* value, tb_hash_map_ref_t proc_labels, vm86_data_ref_t data, tb_uint8_t* reloc);
 
 /* //////////////////////////////////////////////////////////////////////////////////////
  * extern
@@ -33,6 +33,18 @@
 /// the machine ref type
 typedef struct{}*           vm86_machine_ref_t;
 
+/// the machine context ref type
+typedef struct{}*           vm86_context_ref_t;
+
+/// the relocation type
+typedef enum __vm86_reloc_e
+{
+    VM86_RELOC_NONE         = 0     //!< not an address
+,   VM86_RELOC_CODE         = 1     //!< the instruction address of the proc
+,   VM86_RELOC_DATA         = 2     //!< the address of the .data segment
+
+}vm86_reloc_e;
+
 #endif
 
 
@@ -39,6 +39,30 @@
 #   define __vm_small__
 #endif
 
+/*! @def __vm_hugepage__
+ *
+ * advise the transparent huge pages for the large .data chunks
+ */
+#ifdef VM86_CONFIG_HUGEPAGE
+#   define __vm_hugepage__
+#endif
+
+/*! @def __vm_jit__
+ *
+ * translate the hot procs to the native code, only for the x86-64 host with mmap
+ */
+#if defined(VM86_CONFIG_JIT) && defined(TB_ARCH_x64) && defined(TB_CONFIG_POSIX_HAVE_MMAP)
+#   define __vm_jit__
+#endif
+
+/*! @def __vm_profile__
+ *
+ * count the executions and the cycles of each instruction for the profiled procs
+ */
+#ifdef VM86_CONFIG_PROFILE
+#   define __vm_profile__
+#endif
+
 /*! @def __vm_debug__
  *
  * debug mode
@@ -47,6 +71,22 @@
 #   define __vm_debug__
 #endif
 
+/*! @def __vm_computed_goto__
+ *
+ * dispatch instructions by the computed goto (labels as values) 
+ */
+#if defined(TB_COMPILER_IS_GCC) || defined(TB_COMPILER_IS_CLANG)
+#   define __vm_computed_goto__
+#endif
+
+/*! @def __vm_spmd__
+ *
+ * execute the batch of the register-only procs in the vector lanes (the vector extensions)
+ */
+#if defined(TB_COMPILER_IS_GCC) || defined(TB_COMPILER_IS_CLANG)
+#   define __vm_spmd__
+#endif
+
 #endif
 
 
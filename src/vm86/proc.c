@@ -28,38 +28,95 @@
  * includes
  */
 #include "machine.h"
-#include "instruction.h"
 #include "parser.h"
+#include "impl/proc.h"
+#include "impl/hash.h"
+#include "impl/data.h"
+#include "impl/machine.h"
+#include "impl/spmd.h"
+#include "impl/optimizer.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * macros
+ */
+
+// the undefined label, it is only referred by the forward jumps now
+#define VM86_PROC_LABEL_NONE            (0xffffffff)
+
+// the name maxn of the locals, labels and data
+#define VM86_PROC_NAME_MAXN             (256)
 
 /* //////////////////////////////////////////////////////////////////////////////////////
  * types
  */
 
-// the machine proc proc type
-typedef struct __vm86_proc_t
+// the label address in the .data, it is patched after all labels are defined
+typedef struct __vm86_proc_compiler_patch_t
 {
-    // the name
-    tb_char_t*                  name;
+    // the guest address of the label address in the .data
+    tb_uint32_t                 address;
 
-    // the labels
-    tb_hash_map_ref_t           labels;
+    // the label id
+    tb_uint32_t                 label;
 
-    // the locals
-    tb_hash_map_ref_t           locals;
+}vm86_proc_compiler_patch_t, *vm86_proc_compiler_patch_ref_t;
 
-    // the machine
-    vm86_machine_ref_t          machine;
+/* the single-pass proc compiler
+ *
+ * the lines are tokenized from the proc code directly and the instructions are emitted to the growable array,
+ * the labels referred by the instructions and the .data are the label ids until all labels are defined.
+ */
+typedef struct __vm86_proc_compiler_t
+{
+    // the proc
+    vm86_proc_t*                proc;
 
     // the instructions
     vm86_instruction_ref_t      instructions;
 
-    // the instruction count
-    tb_size_t                   instructions_count;
+    // the source line number of each instruction
+    tb_uint32_t*                lines;
+
+    // the instructions count
+    tb_size_t                   count;
+
+    // the instructions maxn
+    tb_size_t                   maxn;
+
+    // the instruction index of each label id, it is VM86_PROC_LABEL_NONE if the label is not defined now
+    tb_uint32_t*                labels;
+
+    // the labels count
+    tb_size_t                   labels_count;
+
+    // the labels maxn
+    tb_size_t                   labels_maxn;
+
+    // the label addresses in the .data, vm86_proc_compiler_patch_t
+    tb_vector_ref_t             patches;
 
-    // the last data name
-    tb_char_t                   last_data_name[8192];
+    // the resolved jump tables, the entries count and the label ids of each table
+    tb_uint32_t*                tables;
 
-}vm86_proc_t;
+    // the tables size
+    tb_size_t                   tables_size;
+
+    // has the .data?
+    tb_bool_t                   has_data;
+
+}vm86_proc_compiler_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * globals
+ */
+
+#ifdef __vm_jit__
+/* the jit lock
+ *
+ * it is not the machine lock, because the proc may be executed while the machine is locked by the user
+ */
+static tb_spinlock_t    g_jit_lock = TB_SPINLOCK_INIT;
+#endif
 
 /* //////////////////////////////////////////////////////////////////////////////////////
  * compiler implementation
@@ -119,62 +176,41 @@ static tb_char_t const* vm86_proc_compiler_find_name(vm86_proc_t* proc, tb_char_
     // ok?
     return p;
 }
-static tb_char_t const* vm86_proc_compiler_read_line(tb_char_t const* p, tb_char_t const* e, tb_char_t* line, tb_size_t* size)
+static tb_char_t const* vm86_proc_compiler_read_line(tb_char_t const* p, tb_char_t const* e, tb_char_t const** pb, tb_char_t const** pe)
 {
-    // done
-    tb_char_t   ch = 0;
-    tb_char_t*  q = line;
-    tb_bool_t   is_space = tb_true;
-    tb_bool_t   is_comment = tb_false;
-    tb_size_t   maxn = *size;
-    while (p < e)
-    {
-        // read char
-        ch = *p++;
-
-        // is line?
-        if (ch == '\n') 
-        {
-            // finish line
-            if (q > line && q[-1] == '\r')
-                q--;
-            *q = '\0';
-
-            // save size
-            *size = q - line;
-    
-            // ok
-            return p;
-        }
+    // find the line end and the comment
+    tb_char_t const* b = p;
+    tb_char_t const* c = tb_null;
+    while (p < e && *p != '\n' && *p)
+    {
         // is comment?
-        else if (ch == ';') is_comment = tb_true;
-        // append char to line
-        else if (!is_comment)
-        {
-            // exists non-space character
-            if (!tb_isspace(ch)) is_space = tb_false;
+        if (*p == ';' && !c) c = p;
+        p++;
+    }
 
-            // append it
-            if ((q - line) < maxn - 1 && (!tb_isspace(ch) || !is_space)) *q++ = ch;
+    // the line end without the comment
+    tb_char_t const* q = c? c : p;
 
-            // no data?
-            if (!ch) break;
-        }
-    }
+    // no data? end it
+    if (p < e && !*p) p = e;
+    // skip '\n'
+    else if (p < e) p++;
 
-    // end
-    *q = '\0';
+    // trim the spaces and '\r'
+    while (b < q && tb_isspace(*b)) b++;
+    while (q > b && tb_isspace(q[-1])) q--;
 
-    // save size
-    *size = q - line;
-    
-    // ok?
+    // save the line
+    *pb = b;
+    *pe = q;
+
+    // ok
     return p;
 }
-static tb_char_t const* vm86_proc_compiler_read_data(vm86_proc_t* proc, tb_char_t const* p, tb_char_t const* e, tb_byte_t* data, tb_size_t* size)
+static tb_char_t const* vm86_proc_compiler_read_data(vm86_proc_t* proc, tb_char_t const* p, tb_char_t const* e, tb_byte_t* data, tb_size_t* size, tb_size_t offset)
 {
     // check
-    tb_assert_and_check_return_val(proc && proc->labels, tb_null);
+    tb_assert_and_check_return_val(proc && proc->labels && proc->data_relocs, tb_null);
 
     // done
     tb_bool_t   ok = tb_false;
@@ -191,7 +227,7 @@ static tb_char_t const* vm86_proc_compiler_read_data(vm86_proc_t* proc, tb_char_
         // init type
         tb_char_t type[16] = {0};
         while (p < e && !tb_isspace(*p)) p++;
-        tb_check_break(p < e && p - b < sizeof(type));
+        tb_check_break(p < e && (tb_size_t)(p - b) < sizeof(type));
         tb_memcpy(type, b, p - b);
 
         // trace
@@ -276,7 +312,15 @@ static tb_char_t const* vm86_proc_compiler_read_data(vm86_proc_t* proc, tb_char_
 
                     // get the offset value
                     tb_uint32_t value = 0;
-                    if (!vm86_parser_get_offset_value(&p, e, &value, proc->labels, vm86_machine_data(proc->machine))) break;
+                    tb_uint8_t  reloc = VM86_RELOC_NONE;
+                    if (!vm86_parser_get_offset_value(&p, e, &value, proc->labels, vm86_machine_data(proc->machine), &reloc)) break;
+
+                    // save the relocation of this address
+                    if (reloc != VM86_RELOC_NONE)
+                    {
+                        vm86_data_reloc_t item = {(tb_uint32_t)(offset + (qb - data)), reloc};
+                        tb_vector_insert_tail(proc->data_relocs, &item);
+                    }
 
                     // append data
                     tb_bits_set_u32_ne(qb, value);
@@ -333,20 +377,65 @@ static tb_char_t const* vm86_proc_compiler_read_data(vm86_proc_t* proc, tb_char_
     // ok?
     return p;
 }
-static tb_bool_t vm86_proc_compiler_prepare_locals(vm86_proc_t* proc, tb_char_t const* p, tb_char_t const* e)
+static __tb_inline__ tb_bool_t vm86_proc_compiler_is_token(tb_char_t const* p, tb_char_t const* e, tb_char_t const* token, tb_size_t size)
+{
+    return (tb_size_t)(e - p) == size && !tb_strnicmp(p, token, size);
+}
+static tb_uint32_t vm86_proc_compiler_label(vm86_proc_compiler_t* compiler, tb_char_t const* name)
+{
+    // check
+    vm86_proc_t* proc = compiler->proc;
+    tb_assert_and_check_return_val(proc && proc->labels && name, VM86_PROC_LABEL_NONE);
+
+    // exists?
+    tb_size_t itor = tb_hash_map_find(proc->labels, name);
+    if (itor != tb_iterator_tail(proc->labels))
+    {
+        // the label id
+        tb_hash_map_item_ref_t item = (tb_hash_map_item_ref_t)tb_iterator_item(proc->labels, itor);
+        tb_assert_and_check_return_val(item, VM86_PROC_LABEL_NONE);
+
+        // ok
+        return tb_p2u32(item->data);
+    }
+
+    // grow the labels
+    if (compiler->labels_count >= compiler->labels_maxn)
+    {
+        // the new maxn
+        tb_size_t maxn = compiler->labels_maxn? (compiler->labels_maxn << 1) : 16;
+
+        // grow it
+        tb_uint32_t* labels = (tb_uint32_t*)tb_ralloc(compiler->labels, maxn * sizeof(tb_uint32_t));
+        tb_assert_and_check_return_val(labels, VM86_PROC_LABEL_NONE);
+
+        // save it
+        compiler->labels        = labels;
+        compiler->labels_maxn   = maxn;
+    }
+
+    // add an undefined label
+    tb_uint32_t label = (tb_uint32_t)compiler->labels_count++;
+    compiler->labels[label] = VM86_PROC_LABEL_NONE;
+
+    // save the label id
+    tb_hash_map_insert(proc->labels, name, tb_u2p(label));
+
+    // ok
+    return label;
+}
+static tb_bool_t vm86_proc_compiler_compile_local(vm86_proc_compiler_t* compiler, tb_char_t const* p, tb_char_t const* e)
 {
     // check
+    vm86_proc_t* proc = compiler->proc;
     tb_assert_and_check_return_val(proc && proc->locals, tb_false);
 
     // done
     tb_bool_t ok = tb_false;
     do
     {
-        // save base
-        tb_char_t const* b = p;
-
         // init name
-        tb_char_t name[8192] = {0};
+        tb_char_t name[VM86_PROC_NAME_MAXN];
         if (!vm86_parser_get_variable_name(&p, e, name, sizeof(name))) break;
 
         // find '='
@@ -357,17 +446,16 @@ static tb_bool_t vm86_proc_compiler_prepare_locals(vm86_proc_t* proc, tb_char_t
         // skip space
         while (p < e && tb_isspace(*p)) p++;
 
-        // init type
-        tb_char_t type[8192] = {0};
-        for (b = p; p < e && !tb_isspace(*p); p++) {}
-        tb_check_break(p < e && p - b < sizeof(type));
-        tb_memcpy(type, b, p - b);
+        // get type
+        tb_char_t const* b = p;
+        while (p < e && !tb_isspace(*p)) p++;
+        tb_check_break(p < e);
 
         // check type
-        if (    tb_stricmp(type, "dword")
-            &&  tb_stricmp(type, "word")
-            &&  tb_stricmp(type, "byte")
-            &&  tb_stricmp(type, "qword"))
+        if (    !vm86_proc_compiler_is_token(b, p, "dword", 5)
+            &&  !vm86_proc_compiler_is_token(b, p, "word", 4)
+            &&  !vm86_proc_compiler_is_token(b, p, "byte", 4)
+            &&  !vm86_proc_compiler_is_token(b, p, "qword", 5))
         {
             break;
         }
@@ -380,10 +468,10 @@ static tb_bool_t vm86_proc_compiler_prepare_locals(vm86_proc_t* proc, tb_char_t
         if (!vm86_parser_get_number_value(&p, e, &value)) break;
 
         // save local
-        tb_hash_map_insert(proc->locals, name, (tb_pointer_t)value);
+        tb_hash_map_insert(proc->locals, name, tb_u2p(value));
 
         // trace
-        tb_trace_d("local: %s, type: %s, value: %d", name, type, value);
+        tb_trace_d("local: %s, value: %d", name, value);
 
         // ok
         ok = tb_true;
@@ -393,11 +481,8 @@ static tb_bool_t vm86_proc_compiler_prepare_locals(vm86_proc_t* proc, tb_char_t
     // ok?
     return ok;
 }
-static tb_bool_t vm86_proc_compiler_prepare_label(vm86_proc_t* proc, tb_char_t const* p, tb_char_t const* e, tb_size_t offset)
+static tb_bool_t vm86_proc_compiler_compile_label(vm86_proc_compiler_t* compiler, tb_char_t const* p, tb_char_t const* e)
 {
-    // check
-    tb_assert_and_check_return_val(proc && proc->labels, tb_false);
-
     // done
     tb_bool_t ok = tb_false;
     do
@@ -405,17 +490,22 @@ static tb_bool_t vm86_proc_compiler_prepare_label(vm86_proc_t* proc, tb_char_t c
         // save base
         tb_char_t const* b = p;
 
-        // init name
-        tb_char_t name[8192] = {0};
+        // is "name:"?
         while (p < e && !tb_isspace(*p) && *p != ':') p++;
-        tb_check_break(p < e && p - b < sizeof(name) && *p == ':');
+        tb_check_break(p < e && *p == ':' && p - b < VM86_PROC_NAME_MAXN);
+
+        // init name
+        tb_char_t name[VM86_PROC_NAME_MAXN];
         tb_memcpy(name, b, p - b);
+        name[p - b] = '\0';
 
-        // save offset
-        tb_hash_map_insert(proc->labels, name, (tb_cpointer_t)offset);
+        // define the label at the next instruction, it may have been referred by the forward jumps
+        tb_uint32_t label = vm86_proc_compiler_label(compiler, name);
+        tb_assert_and_check_break(label != VM86_PROC_LABEL_NONE);
+        compiler->labels[label] = (tb_uint32_t)compiler->count;
 
         // trace
-        tb_trace_d("label: %s => %lu", name, offset);
+        tb_trace_d("label: %s => %lu", name, compiler->count);
 
         // ok
         ok = tb_true;
@@ -425,115 +515,118 @@ static tb_bool_t vm86_proc_compiler_prepare_label(vm86_proc_t* proc, tb_char_t c
     // ok?
     return ok;
 }
-static tb_char_t const* vm86_proc_compiler_prepare(vm86_proc_t* proc, tb_char_t const* p, tb_char_t const* e, tb_size_t* instructions_count)
+static tb_void_t vm86_proc_compiler_forward_label(vm86_proc_compiler_t* compiler, tb_char_t const* p, tb_char_t const* e)
 {
-    // trace
-    tb_trace_d("");
-    tb_trace_d("prepare: ..");
-
-    // done
-    tb_char_t           line[8192];
-    tb_size_t           count = 0;
-    tb_bool_t           is_data = tb_false;
-    tb_char_t const*    start = tb_null;
-    while (p < e)
-    {
-        // save the base
-        tb_char_t const* b = p;
+    // check
+    vm86_proc_t* proc = compiler->proc;
+    tb_assert_and_check_return(proc && proc->labels && proc->locals);
 
-        // read line
-        tb_size_t size = sizeof(line);
-        p = vm86_proc_compiler_read_line(p, e, line, &size);
+    // get the name
+    tb_char_t name[VM86_PROC_NAME_MAXN];
+    tb_check_return(vm86_parser_get_variable_name(&p, e, name, sizeof(name)));
 
-        // check
-        tb_check_continue(size);
-        tb_assert(size < sizeof(line));
+    // only the whole operand, e.g. not ds:xxx, xxx[eax*4] and dword ptr
+    tb_check_return(p == e || *p == ',');
 
-        // attempt to prepare locals
-        if (vm86_proc_compiler_prepare_locals(proc, line, line + size)) continue ;
+    // is label?
+    tb_check_return(tb_hash_map_find(proc->labels, name) == tb_iterator_tail(proc->labels));
 
-        // save the start position
-        if (!start) start = b;
+    // is register?
+    tb_uint16_t         r = 0;
+    tb_char_t const*    n = name;
+    if (vm86_parser_get_register(&n, name + tb_strlen(name), &r) && !*n) return ;
 
-        // is data or code segment?
-        if (!tb_strnicmp(line, ".data", 5))
-        {
-            is_data = tb_true;
-            continue ;
-        }
-        else if (!tb_strnicmp(line, ".code", 5))
-        {
-            is_data = tb_false;
-            continue ;
-        }
+    // is local or data?
+    tb_check_return(tb_hash_map_find(proc->locals, name) == tb_iterator_tail(proc->locals));
+    tb_check_return(!vm86_data_is(vm86_machine_data(proc->machine), name));
 
-        // is data?
-        tb_check_continue(!is_data);
-
-        // attempt to prepare label
-        if (vm86_proc_compiler_prepare_label(proc, line, line + size, count)) continue ;
-
-        // is end?
-        if (tb_strnistr(line, size, "endp")) break;
+    // declare the forward label, it must be defined before the end of the proc
+    vm86_proc_compiler_label(compiler, name);
+}
+static tb_void_t vm86_proc_compiler_forward_labels(vm86_proc_compiler_t* compiler, tb_char_t const* p, tb_char_t const* e, tb_bool_t is_code)
+{
+    // get the instruction name
+    tb_char_t const* b = p;
+    while (p < e && tb_isalpha(*p)) p++;
+    tb_size_t n = p - b;
 
-        // trace
-//        tb_trace_d("line: %s", line);
+    // jxx or loop? the operand may be a label, but the operand of call is always a function
+    if (is_code && n && p < e && tb_isspace(*p) && (*b == 'j' || *b == 'J' || (n >= 4 && !tb_strnicmp(b, "loop", 4))))
+    {
+        // skip the space and "short ..."
+        while (p < e && tb_isspace(*p)) p++;
+        if (p + 6 < e && !tb_strnicmp(p, "short ", 6)) p += 6;
+        while (p < e && tb_isspace(*p)) p++;
 
-        // update the instructions count
-        count++;
+        // declare it
+        vm86_proc_compiler_forward_label(compiler, p, e);
     }
 
-    // trace
-    tb_trace_d("prepare: count: %lu", count);
-
-    // save the instructions count
-    *instructions_count = count;
-
-    // ok?
-    return start;
+    // find "offset label" and "cs:label"
+    for (; p < e; p++)
+    {
+        // at the head of the token?
+        if (p > b && (tb_isalpha(p[-1]) || tb_isdigit(p[-1]) || p[-1] == '_')) continue ;
+
+        // the label position
+        tb_char_t const* q = tb_null;
+        if (p + 7 < e && !tb_strnicmp(p, "offset", 6) && tb_isspace(p[6])) q = p + 6;
+        else if (p + 3 < e && !tb_strnicmp(p, "cs:", 3)) q = p + 3;
+        tb_check_continue(q);
+
+        // declare it
+        while (q < e && tb_isspace(*q)) q++;
+        vm86_proc_compiler_forward_label(compiler, q, e);
+    }
 }
-static tb_bool_t vm86_proc_compiler_compile_skip_label(vm86_proc_t* proc, tb_char_t const* p, tb_char_t const* e)
+static tb_bool_t vm86_proc_compiler_is_end(tb_char_t const* p, tb_char_t const* e)
 {
-    // check
-    tb_assert_and_check_return_val(proc && proc->labels, tb_false);
-
-    // done
-    tb_bool_t ok = tb_false;
-    do
+    // "endp" or "xxx endp"?
+    tb_size_t i = 0;
+    for (i = 0; i < 2 && p < e; i++)
     {
-        // init name
-        while (p < e && !tb_isspace(*p) && *p != ':') p++;
-        tb_check_break(p < e && *p == ':');
-
-        // ok
-        ok = tb_true;
+        // get the token
+        tb_char_t const* b = p;
+        while (p < e && !tb_isspace(*p)) p++;
+        if (vm86_proc_compiler_is_token(b, p, "endp", 4)) return tb_true;
 
-    } while (0);
+        // skip the space
+        while (p < e && tb_isspace(*p)) p++;
+    }
 
-    // ok?
-    return ok;
+    // no
+    return tb_false;
 }
-static tb_bool_t vm86_proc_compiler_compile_data(vm86_proc_t* proc, tb_char_t const* p, tb_char_t const* e)
+static tb_bool_t vm86_proc_compiler_compile_data(vm86_proc_compiler_t* compiler, tb_char_t const* p, tb_char_t const* e)
 {
     // check
-    tb_assert_and_check_return_val(proc && proc->machine, tb_false);
+    vm86_proc_t* proc = compiler->proc;
+    tb_assert_and_check_return_val(proc && proc->machine && proc->data_relocs, tb_false);
 
     // the data
     vm86_data_ref_t data = vm86_machine_data(proc->machine);
     tb_assert_and_check_return_val(data, tb_false);
 
+    // clear the relocations of the previous data
+    tb_vector_clear(proc->data_relocs);
+
     // done
-    tb_bool_t ok = tb_false;
+    tb_bool_t   ok = tb_false;
+    tb_byte_t*  buff = tb_null;
     do
     {
         // save base
         tb_char_t const* b = p;
 
+        // declare the forward labels of "dd offset label"
+        vm86_proc_compiler_forward_labels(compiler, p, e, tb_false);
+
         // init name
-        tb_char_t name[8192] = {0};
+        tb_char_t name[VM86_PROC_NAME_MAXN];
         while (p < e && !tb_isspace(*p)) p++;
-        tb_check_break(p < e && p - b < sizeof(name));
+        tb_check_break(p < e && (tb_size_t)(p - b) < sizeof(name));
         tb_memcpy(name, b, p - b);
+        name[p - b] = '\0';
 
         // only data? restore the pointer offset
         tb_bool_t only_data = tb_false;
@@ -543,94 +636,150 @@ static tb_bool_t vm86_proc_compiler_compile_data(vm86_proc_t* proc, tb_char_t co
             only_data = tb_true;
         }
 
+        /* make the data buffer
+         *
+         * each character of the source is decoded to one byte of "db" or four bytes of "dd" at most,
+         * so the long data line is never truncated.
+         */
+        tb_size_t maxn = (tb_size_t)(e - p) << 2;
+        tb_assert_and_check_break(maxn);
+        buff = tb_malloc_bytes(maxn);
+        tb_assert_and_check_break(buff);
+
         // done
-        tb_byte_t   buff[8192];
-        tb_size_t   maxn = sizeof(buff);
-        tb_byte_t*  base = buff;
-        while (p < e)
+        tb_byte_t* base = buff;
+        while (p && p < e)
         {
             // read data
             tb_size_t read = maxn;
-            p = vm86_proc_compiler_read_data(proc, p, e, base, &read);
-            tb_assert(p && read);
+            p = vm86_proc_compiler_read_data(proc, p, e, base, &read, base - buff);
 
             // update the buffer
-            maxn -= read;
-            base += read;
+            if (p)
+            {
+                maxn -= read;
+                base += read;
+            }
         }
 
         // check
-        tb_assert(base > buff);
+        tb_assert_and_check_break(p && base > buff);
 
         // only data? append to the last data
+        tb_uint32_t offset = 0;
         if (only_data)
         {
             // add data
-            vm86_data_add(data, proc->last_data_name, buff, base - buff);
+            offset = vm86_data_add(data, proc->last_data_name, buff, base - buff);
         }
         // exists name? add new data
         else 
         {
             // add data
-            vm86_data_add(data, name, buff, base - buff);
+            offset = vm86_data_add(data, name, buff, base - buff);
 
             // save the last data name
             tb_strlcpy(proc->last_data_name, name, sizeof(proc->last_data_name));
         }
 
+        // save the relocations of the addresses in this data
+        tb_byte_t* address = ((vm86_data_t*)data)->data + offset;
+        tb_for_all_if (vm86_data_reloc_ref_t, reloc, proc->data_relocs, reloc)
+        {
+            // add relocation
+            vm86_data_reloc_add((vm86_data_t*)data, offset + reloc->offset, reloc->type);
+
+            // the label id is patched to the instruction address after all labels are defined
+            if (reloc->type == VM86_RELOC_CODE)
+            {
+                vm86_proc_compiler_patch_t patch = {vm86_memory_addr(address + reloc->offset), tb_bits_get_u32_ne(address + reloc->offset)};
+                tb_vector_insert_tail(compiler->patches, &patch);
+            }
+        }
+
         // ok
         ok = tb_true;
 
     } while (0);
 
+    // exit the data buffer
+    if (buff) tb_free(buff);
+    buff = tb_null;
+
     // ok?
     return ok;
 }
-static tb_bool_t vm86_proc_compiler_compile_code(vm86_proc_t* proc, tb_char_t const* p, tb_char_t const* e, vm86_instruction_ref_t instruction)
+static tb_bool_t vm86_proc_compiler_compile_code(vm86_proc_compiler_t* compiler, tb_char_t const* p, tb_char_t const* e, tb_size_t lineno)
 {
     // check
+    vm86_proc_t* proc = compiler->proc;
     tb_assert_and_check_return_val(proc, tb_false);
 
-    // compile this instruction
-    return vm86_instruction_compile(instruction, p, e - p, proc->machine, proc->labels, proc->locals);
+    // grow the instructions
+    if (compiler->count >= compiler->maxn)
+    {
+        // the new maxn
+        tb_size_t maxn = compiler->maxn? (compiler->maxn << 1) : 64;
+
+        // grow the instructions
+        vm86_instruction_ref_t instructions = (vm86_instruction_ref_t)tb_ralloc(compiler->instructions, maxn * sizeof(vm86_instruction_t));
+        tb_assert_and_check_return_val(instructions, tb_false);
+        compiler->instructions = instructions;
+
+        // grow the source line numbers
+        tb_uint32_t* lines = (tb_uint32_t*)tb_ralloc(compiler->lines, maxn * sizeof(tb_uint32_t));
+        tb_assert_and_check_return_val(lines, tb_false);
+        compiler->lines = lines;
+
+        // save the new maxn
+        compiler->maxn = maxn;
+    }
+
+    // declare the forward labels referred by this instruction
+    vm86_proc_compiler_forward_labels(compiler, p, e, tb_true);
+
+    // compile this instruction, the referred labels are the label ids now
+    vm86_instruction_ref_t instruction = compiler->instructions + compiler->count;
+    tb_memset(instruction, 0, sizeof(vm86_instruction_t));
+    if (!vm86_instruction_compile(instruction, p, e - p, proc->machine, proc->labels, proc->locals)) return tb_false;
+
+    // save the source line number
+    compiler->lines[compiler->count++] = (tb_uint32_t)lineno;
+
+    // ok
+    return tb_true;
 }
-static tb_size_t vm86_proc_compiler_compile_done(vm86_proc_t* proc, tb_char_t const* p, tb_char_t const* e)
+static tb_bool_t vm86_proc_compiler_compile_done(vm86_proc_compiler_t* compiler, tb_char_t const* p, tb_char_t const* e)
 {
-    // check
-    tb_assert_and_check_return_val(proc, 0);
-
     // trace
     tb_trace_d("");
     tb_trace_d("compile: ..");
 
-    // done
-    tb_char_t line[8192];
-    tb_size_t count = 0;
-    tb_bool_t is_data = tb_false;
-    while (p < e)
+    // done, the line of "xxx proc near" is the first source line
+    tb_size_t           lineno = 1;
+    tb_bool_t           is_data = tb_false;
+    tb_char_t const*    b = tb_null;
+    tb_char_t const*    q = tb_null;
+    for (; p < e; lineno++)
     {
         // read line
-        tb_size_t size = sizeof(line);
-        p = vm86_proc_compiler_read_line(p, e, line, &size);
+        p = vm86_proc_compiler_read_line(p, e, &b, &q);
 
         // check
-        tb_check_continue(size);
-        tb_assert(size < sizeof(line));
+        tb_check_continue(b < q);
+
+        // attempt to compile the local
+        if (vm86_proc_compiler_compile_local(compiler, b, q)) continue ;
 
         // is data or code segment?
-        if (!tb_strnicmp(line, ".data", 5))
+        if (q - b >= 5 && !tb_strnicmp(b, ".data", 5))
         {
             // switch to the data segment
             is_data = tb_true;
             continue ;
         }
-        else if (!tb_strnicmp(line, ".code", 5))
+        else if (q - b >= 5 && !tb_strnicmp(b, ".code", 5))
         {
-            // dump data
-#ifdef __vm_debug__
-            if (is_data) vm86_data_dump(vm86_machine_data(proc->machine));
-#endif
-
             // switch to the code segment
             is_data = tb_false;
             continue ;
@@ -640,84 +789,445 @@ static tb_size_t vm86_proc_compiler_compile_done(vm86_proc_t* proc, tb_char_t co
         if (is_data)
         {
             // compile data
-            if (!vm86_proc_compiler_compile_data(proc, line, line + size)) break ;
+            if (!vm86_proc_compiler_compile_data(compiler, b, q)) return tb_false;
+            compiler->has_data = tb_true;
         }
         // is code?
         else
         {
-            // skip the label
-            if (vm86_proc_compiler_compile_skip_label(proc, line, line + size)) continue ;
+            // compile the label
+            if (vm86_proc_compiler_compile_label(compiler, b, q)) continue ;
 
             // is end?
-            if (tb_strnistr(line, size, "endp")) break;
-
-            // trace
-            tb_trace_d("");
-            tb_trace_d("line: %s", line);
+            if (vm86_proc_compiler_is_end(b, q)) break;
 
             // compile code
-            if (!vm86_proc_compiler_compile_code(proc, line, line + size, &proc->instructions[count])) break ;
-
-            // update the instructions count
-            count++;
+            if (!vm86_proc_compiler_compile_code(compiler, b, q, lineno)) return tb_false;
         }
     }
 
     // trace
-    tb_trace_d("compile: count: %lu", count);
+    tb_trace_d("compile: count: %lu", compiler->count);
 
     // ok?
+    return compiler->count > 0;
+}
+static tb_size_t vm86_proc_compiler_compile_table(vm86_proc_compiler_t* compiler, tb_uint32_t address)
+{
+    // check
+    vm86_proc_t* proc = compiler->proc;
+    tb_assert_and_check_return_val(proc && proc->machine, 0);
+
+    // the data
+    vm86_data_t* data = (vm86_data_t*)vm86_machine_data(proc->machine);
+    tb_assert_and_check_return_val(data && data->labels, 0);
+
+    // get the entries maxn from the .data chunk of this table, the following table is the other chunk
+    tb_size_t maxn   = 0;
+    tb_size_t offset = (tb_size_t)((tb_byte_t*)vm86_memory_ptr(address) - data->data);
+    tb_for_all_if (tb_hash_map_item_t*, item, data->labels, item && item->data)
+    {
+        vm86_data_chunk_ref_t chunk = (vm86_data_chunk_ref_t)item->data;
+        if (offset >= chunk->offset && offset < chunk->offset + chunk->size)
+        {
+            maxn = (chunk->offset + chunk->size - offset) >> 2;
+            break;
+        }
+    }
+    tb_check_return_val(maxn, 0);
+
+    // grow the tables, all label addresses in the .data may be in this table
+    tb_uint32_t* tables = (tb_uint32_t*)tb_ralloc(compiler->tables, (compiler->tables_size + tb_vector_size(compiler->patches) + 1) * sizeof(tb_uint32_t));
+    tb_assert_and_check_return_val(tables, 0);
+    compiler->tables = tables;
+
+    // save the label ids of the table, the following label addresses are read by the jump too
+    tb_uint32_t*    table = tables + compiler->tables_size;
+    tb_size_t       count = 0;
+    tb_for_all_if (vm86_proc_compiler_patch_ref_t, patch, compiler->patches, patch)
+    {
+        if (patch->address == address + (count << 2)) table[++count] = patch->label;
+        else if (count) break;
+
+        // stop at the end of the chunk
+        if (count == maxn) break;
+    }
+    tb_check_return_val(count, 0);
+
+    // save the entries count
+    table[0] = (tb_uint32_t)count;
+    compiler->tables_size += count + 1;
+
+    // ok
     return count;
 }
+static tb_bool_t vm86_proc_compiler_compile_tables(vm86_proc_compiler_t* compiler)
+{
+    // resolve the jump tables of the .data, e.g. jmp ds:jpt_xxx[ecx*4]
+    tb_size_t i = 0;
+    for (i = 0; i < compiler->count; i++)
+    {
+        // the jump with the label addresses of this proc in the .data?
+        vm86_instruction_ref_t instruction = compiler->instructions + i;
+        if (    instruction->opcode == VM86_OPCODE_JXX_V0$R0_MUL_V1$
+            &&  instruction->v0_reloc == VM86_RELOC_DATA && instruction->v1_reloc == VM86_RELOC_NONE
+            &&  instruction->v1.u32 == 4)
+        {
+            // make the table, the jump table of the other proc is kept in the .data
+            tb_size_t offset = compiler->tables_size;
+            if (vm86_proc_compiler_compile_table(compiler, instruction->v0.u32))
+            {
+                // jump by the table, v1 is the table offset until linking
+                instruction->opcode = VM86_OPCODE_JXX_TABLE_R0;
+                instruction->v1.u32 = (tb_uint32_t)offset;
+                instruction->done   = vm86_instruction_done(instruction->opcode);
+
+                // trace
+                tb_trace_d("table: %u entries at %lu", compiler->tables[offset], i);
+            }
+        }
+    }
+
+    // ok
+    return tb_true;
+}
+static tb_bool_t vm86_proc_compiler_compile_optimize(vm86_proc_compiler_t* compiler)
+{
+    // check
+    vm86_proc_t* proc = compiler->proc;
+    tb_assert_and_check_return_val(proc && proc->machine, tb_false);
+
+    // the optimizer is disabled?
+    tb_size_t passes = ((vm86_machine_t*)proc->machine)->optimize;
+    tb_check_return_val(passes, tb_true);
+
+    // done
+    tb_bool_t       ok = tb_false;
+    tb_uint32_t*    taken = tb_null;
+    do
+    {
+        // the labels in the .data are taken, they may be the targets of the indirect jumps
+        tb_size_t taken_count = tb_vector_size(compiler->patches);
+        if (taken_count)
+        {
+            taken = tb_nalloc_type(taken_count, tb_uint32_t);
+            tb_assert_and_check_break(taken);
+
+            tb_size_t i = 0;
+            tb_for_all_if (vm86_proc_compiler_patch_ref_t, patch, compiler->patches, patch)
+            {
+                taken[i++] = patch->label;
+            }
+        }
+
+        // optimize the instructions, the jump targets are the label ids now
+        vm86_optimizer_code_t code;
+        code.instructions   = compiler->instructions;
+        code.lines          = compiler->lines;
+        code.count          = compiler->count;
+        code.labels         = compiler->labels;
+        code.labels_count   = compiler->labels_count;
+        code.taken          = taken;
+        code.taken_count    = taken_count;
+        code.tables         = compiler->tables;
+        vm86_optimizer_done(&code, passes, proc->optimized);
+
+        // save the new count
+        compiler->count = code.count;
+
+        // trace
+        tb_trace_d("optimize: count: %lu", compiler->count);
+
+        // ok
+        ok = tb_true;
+
+    } while (0);
+
+    // exit the taken labels
+    if (taken) tb_free(taken);
+
+    // ok?
+    return ok;
+}
+static tb_bool_t vm86_proc_compiler_compile_link(vm86_proc_compiler_t* compiler)
+{
+    // check
+    vm86_proc_t* proc = compiler->proc;
+    tb_assert_and_check_return_val(proc && proc->labels, tb_false);
+
+    // done
+    tb_bool_t ok = tb_false;
+    do
+    {
+        // all labels have been defined?
+        tb_bool_t undefined = tb_false;
+        tb_for_all_if (tb_hash_map_item_t*, item, proc->labels, item)
+        {
+            if (compiler->labels[tb_p2u32(item->data)] == VM86_PROC_LABEL_NONE)
+            {
+                // trace
+                tb_trace_e("%s: undefined label: %s", proc->name, (tb_char_t const*)item->name);
+                undefined = tb_true;
+            }
+        }
+        tb_check_break(!undefined);
+
+        // make instructions, the jump targets are the guest addresses of them
+        tb_size_t count = compiler->count;
+        proc->instructions = vm86_memory_nalloc0_type(count, vm86_instruction_t);
+        tb_assert_and_check_break(proc->instructions);
+
+        // move the instructions and the source line numbers to the proc
+        tb_memcpy(proc->instructions, compiler->instructions, count * sizeof(vm86_instruction_t));
+        proc->instructions_count    = count;
+        proc->lines                 = compiler->lines;
+        compiler->lines             = tb_null;
+        compiler->count             = 0;
+
+        // patch the label ids of the instructions to the instructions address
+        tb_size_t i = 0;
+        for (i = 0; i < count; i++)
+        {
+            // the label of v0
+            vm86_instruction_ref_t instruction = proc->instructions + i;
+            if (instruction->v0_reloc == VM86_RELOC_CODE)
+            {
+                tb_assert(instruction->v0.u32 < compiler->labels_count);
+                instruction->v0.u32 = vm86_memory_addr(proc->instructions + compiler->labels[instruction->v0.u32]);
+            }
+
+            // the label of v1
+            if (instruction->v1_reloc == VM86_RELOC_CODE)
+            {
+                tb_assert(instruction->v1.u32 < compiler->labels_count);
+                instruction->v1.u32 = vm86_memory_addr(proc->instructions + compiler->labels[instruction->v1.u32]);
+            }
+        }
+
+        // make the dispatch tables, the entries are the instruction offsets relative to the jump
+        if (compiler->tables_size)
+        {
+            proc->tables = vm86_memory_nalloc0_type(compiler->tables_size, tb_uint32_t);
+            tb_assert_and_check_break(proc->tables);
+        }
+        for (i = 0; i < count; i++)
+        {
+            // the jump by the table?
+            vm86_instruction_ref_t instruction = proc->instructions + i;
+            tb_check_continue(instruction->opcode == VM86_OPCODE_JXX_TABLE_R0);
+
+            // make the dispatch table
+            tb_uint32_t const*  labels = compiler->tables + instruction->v1.u32;
+            tb_uint32_t*        table = proc->tables + instruction->v1.u32;
+            tb_uint32_t         j = 0;
+            table[0] = labels[0];
+            for (j = 1; j <= labels[0]; j++)
+            {
+                tb_assert(labels[j] < compiler->labels_count);
+                table[j] = (tb_uint32_t)((tb_sint32_t)compiler->labels[labels[j]] - (tb_sint32_t)i);
+            }
+
+            // save the table address
+            instruction->v1.u32 = vm86_memory_addr(table);
+        }
+
+        // patch the label ids of the .data to the instructions address
+        tb_for_all_if (vm86_proc_compiler_patch_ref_t, patch, compiler->patches, patch)
+        {
+            tb_assert(patch->label < compiler->labels_count);
+            tb_bits_set_u32_ne((tb_byte_t*)vm86_memory_ptr(patch->address), vm86_memory_addr(proc->instructions + compiler->labels[patch->label]));
+        }
+
+        // convert the labels id to the instructions address
+        tb_for_all_if (tb_hash_map_item_t*, label, proc->labels, label)
+        {
+            tb_iterator_copy(proc->labels, label_itor, tb_u2p(vm86_memory_addr(proc->instructions + compiler->labels[tb_p2u32(label->data)])));
+        }
+
+        // ok
+        ok = tb_true;
+
+    } while (0);
+
+    // ok?
+    return ok;
+}
+static tb_void_t vm86_proc_compiler_exit(vm86_proc_compiler_t* compiler)
+{
+    // exit the instructions which are not moved to the proc
+    if (compiler->instructions)
+    {
+        // exit cstring
+        tb_size_t i = 0;
+        for (i = 0; i < compiler->count; i++)
+        {
+            vm86_instruction_ref_t instruction = compiler->instructions + i;
+            if (instruction->is_cstr && instruction->v0.cstr) tb_free(instruction->v0.cstr);
+        }
+
+        // exit it
+        tb_free(compiler->instructions);
+        compiler->instructions = tb_null;
+    }
+
+    // exit the source line numbers
+    if (compiler->lines) tb_free(compiler->lines);
+    compiler->lines = tb_null;
+
+    // exit the labels
+    if (compiler->labels) tb_free(compiler->labels);
+    compiler->labels = tb_null;
+
+    // exit the patches
+    if (compiler->patches) tb_vector_exit(compiler->patches);
+    compiler->patches = tb_null;
+
+    // exit the tables
+    if (compiler->tables) tb_free(compiler->tables);
+    compiler->tables = tb_null;
+}
 static tb_bool_t vm86_proc_compile(vm86_proc_t* proc, tb_char_t const* code, tb_size_t size)
 {
     // trace
     tb_trace_d("=====================================================================");
 
     // done
-    tb_bool_t           ok = tb_false;
-    tb_char_t const*    p = code;
-    tb_char_t const*    e = code + size;
+    tb_bool_t               ok = tb_false;
+    tb_char_t const*        p = code;
+    tb_char_t const*        e = code + size;
+    vm86_proc_compiler_t    compiler = {0};
     do
     {
         // find the proc name
         p = vm86_proc_compiler_find_name(proc, p, e);
         tb_assert_and_check_break(p && proc->name);
 
-        // prepare some data and labels first before compiling code
-        p = vm86_proc_compiler_prepare(proc, p, e, &proc->instructions_count);
-        tb_assert_and_check_break(p < e && p && proc->instructions_count);
+#ifdef __vm_profile__
+        // the line of "xxx proc near" is the first source line
+        tb_char_t const* head = p;
+        while (head > code && head[-1] != '\n') head--;
 
-        // make instructions
-        proc->instructions = tb_nalloc0_type(proc->instructions_count, vm86_instruction_t);
-        tb_assert_and_check_break(proc->instructions);
+        // save the proc code for the profile report
+        proc->code = tb_strndup(head, e - head);
+        tb_assert_and_check_break(proc->code);
+#endif
 
-        // convert the labels offset to the instructions address
-        tb_for_all_if (tb_hash_map_item_t*, item, proc->labels, item)
-        {
-            // check
-            tb_assert((tb_uint32_t)item->data < proc->instructions_count);
+        // init the compiler
+        compiler.proc       = proc;
+        compiler.patches    = tb_vector_init(0, tb_element_mem(sizeof(vm86_proc_compiler_patch_t), tb_null, tb_null));
+        tb_assert_and_check_break(compiler.patches);
 
-            // the offset
-            tb_uint32_t offset = (tb_uint32_t)(proc->instructions + (tb_uint32_t)item->data);
+        // compile it in one pass
+        if (!vm86_proc_compiler_compile_done(&compiler, p, e)) break;
 
-            // update the offset
-            tb_iterator_copy(proc->labels, item_itor, (tb_pointer_t)offset);
-        }
+        // resolve the jump tables
+        if (!vm86_proc_compiler_compile_tables(&compiler)) break;
 
-        // compile it
-        tb_size_t count = vm86_proc_compiler_compile_done(proc, p, e);
-        tb_assert_and_check_break(count == proc->instructions_count);
+        // optimize it before linking
+        if (!vm86_proc_compiler_compile_optimize(&compiler)) break;
+
+        // link the labels
+        if (!vm86_proc_compiler_compile_link(&compiler)) break;
+
+        // dump data, the label addresses in it have been patched
+#ifdef __vm_debug__
+        if (compiler.has_data) vm86_data_dump(vm86_machine_data(proc->machine));
+#endif
+
+        // fuse the common instruction sequences into the superinstructions
+        proc->fusions = vm86_instruction_fuse(proc->instructions, proc->instructions_count);
+
+        // trace
+        tb_trace_d("fusions: %lu", proc->fusions);
 
         // ok
         ok = tb_true;
 
     } while (0);
 
+    // exit the compiler
+    vm86_proc_compiler_exit(&compiler);
+
     // ok?
     return ok;
 }
 
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * jit implementation
+ */
+#ifdef __vm_jit__
+static vm86_jit_ref_t vm86_proc_jit(vm86_proc_t* proc)
+{
+    // enter
+    tb_spinlock_enter(&g_jit_lock);
+
+    // translated by the other thread?
+    vm86_jit_ref_t jit = (vm86_jit_ref_t)tb_atomic_get(&proc->jit);
+    if (!jit && !proc->jit_failed)
+    {
+        // translate it, keep it in the interpreter if there are unsupported instructions
+        jit = vm86_jit_init(proc->instructions, proc->instructions_count);
+        if (jit) tb_atomic_set(&proc->jit, (tb_atomic_t)jit);
+        else proc->jit_failed = tb_true;
+
+        // trace
+        tb_trace_d("jit: %s, %s", proc->name, jit? "ok" : "unsupported");
+    }
+
+    // leave
+    tb_spinlock_leave(&g_jit_lock);
+
+    // ok?
+    return jit;
+}
+#endif
+static tb_void_t vm86_proc_done_exec(vm86_proc_t* proc, vm86_context_ref_t context, vm86_stack_ref_t stack)
+{
+    // push the stub return address
+    vm86_stack_push(stack, 0xbeaf);
+
+#ifdef __vm_profile__
+    // done it in the instrumented loop if it is profiled, the jit code is not used
+    if (proc->profile_counts)
+    {
+        vm86_instruction_exec_profile(proc->instructions, proc->instructions_count, context, proc->profile_counts, proc->profile_cycles);
+        return ;
+    }
+#endif
+
+    // done it in the traced loop if the context trace is enabled, the jit code is not used
+    if (((vm86_context_t*)context)->trace)
+    {
+        vm86_instruction_exec_trace(proc->instructions, proc->instructions_count, context, (tb_uint32_t)vm86_hash_fnv64((tb_byte_t const*)proc->name, tb_strlen(proc->name)));
+        return ;
+    }
+
+#ifdef __vm_jit__
+    // translate it if it is hot enough, the threshold is 0 if the jit tier is disabled
+    vm86_jit_ref_t  jit = tb_null;
+    tb_size_t       threshold = ((vm86_machine_t*)proc->machine)->jit_threshold;
+    if (threshold)
+    {
+        // the jit code is read with the barrier, so the native code published by the other thread is seen completely
+        jit = (vm86_jit_ref_t)tb_atomic_get(&proc->jit);
+        if (!jit && !proc->jit_failed && (tb_size_t)tb_atomic_fetch_and_inc(&proc->jit_count) + 1 >= threshold) jit = vm86_proc_jit(proc);
+    }
+
+    // done the jit code
+    if (jit)
+    {
+        // continue in the interpreter if the native code exits at the jump out of this proc
+        vm86_instruction_ref_t p = vm86_jit_done(jit, context);
+        vm86_instruction_ref_t e = proc->instructions + proc->instructions_count;
+        if (p && p < e) vm86_instruction_exec(p, e - p, context);
+        return ;
+    }
+#endif
+
+    // done it
+    vm86_instruction_exec(proc->instructions, proc->instructions_count, context);
+}
+
 /* //////////////////////////////////////////////////////////////////////////////////////
  * implementation
  */
@@ -738,6 +1248,10 @@ vm86_proc_ref_t vm86_proc_init(vm86_machine_ref_t machine, tb_char_t const* code
         // save machine
         proc->machine = machine;
 
+        // save the hash and size of the proc code
+        proc->hash = vm86_hash_fnv64((tb_byte_t const*)code, size);
+        proc->size = size;
+
         // init labels
         proc->labels = tb_hash_map_init(8, tb_element_str(tb_true), tb_element_uint32());
         tb_assert_and_check_break(proc->labels);
@@ -746,6 +1260,10 @@ vm86_proc_ref_t vm86_proc_init(vm86_machine_ref_t machine, tb_char_t const* code
         proc->locals = tb_hash_map_init(8, tb_element_str(tb_true), tb_element_uint32());
         tb_assert_and_check_break(proc->locals);
 
+        // init the data relocations
+        proc->data_relocs = tb_vector_init(0, tb_element_mem(sizeof(vm86_data_reloc_t), tb_null, tb_null));
+        tb_assert_and_check_break(proc->data_relocs);
+
         // compile code
         ok = vm86_proc_compile(proc, code, size);
 
@@ -780,6 +1298,32 @@ tb_void_t vm86_proc_exit(vm86_proc_ref_t self)
     if (proc->locals) tb_hash_map_exit(proc->locals);
     proc->locals = tb_null;
 
+    // exit the data relocations
+    if (proc->data_relocs) tb_vector_exit(proc->data_relocs);
+    proc->data_relocs = tb_null;
+
+#ifdef __vm_jit__
+    // exit the jit code
+    if (proc->jit) vm86_jit_exit((vm86_jit_ref_t)proc->jit);
+    proc->jit = 0;
+#endif
+
+    // exit the source line numbers
+    if (proc->lines) tb_free(proc->lines);
+    proc->lines = tb_null;
+
+#ifdef __vm_profile__
+    // exit the proc code
+    if (proc->code) tb_free(proc->code);
+    proc->code = tb_null;
+
+    // exit the counters
+    if (proc->profile_counts) tb_free(proc->profile_counts);
+    proc->profile_counts = tb_null;
+    if (proc->profile_cycles) tb_free(proc->profile_cycles);
+    proc->profile_cycles = tb_null;
+#endif
+
     // exit instructions
     if (proc->instructions) 
     {
@@ -801,10 +1345,14 @@ tb_void_t vm86_proc_exit(vm86_proc_ref_t self)
         }
 
         // exit it
-        tb_free(proc->instructions);
+        vm86_memory_free(proc->instructions);
         proc->instructions = tb_null;
     }
 
+    // exit the dispatch tables
+    if (proc->tables) vm86_memory_free(proc->tables);
+    proc->tables = tb_null;
+
     // exit it
     tb_free(proc);
 }
@@ -817,7 +1365,212 @@ tb_char_t const* vm86_proc_name(vm86_proc_ref_t self)
     // the name
     return proc->name;
 }
-tb_void_t vm86_proc_done(vm86_proc_ref_t self)
+tb_uint64_t vm86_proc_hash(vm86_proc_ref_t self)
+{
+    // check
+    vm86_proc_t* proc = (vm86_proc_t*)self;
+    tb_assert_and_check_return_val(proc, 0);
+
+    // the hash
+    return proc->hash;
+}
+tb_size_t vm86_proc_fusions(vm86_proc_ref_t self)
+{
+    // check
+    vm86_proc_t* proc = (vm86_proc_t*)self;
+    tb_assert_and_check_return_val(proc, 0);
+
+    // the fusions count
+    return proc->fusions;
+}
+tb_size_t vm86_proc_optimized(vm86_proc_ref_t self, tb_size_t passes)
+{
+    // check
+    vm86_proc_t* proc = (vm86_proc_t*)self;
+    tb_assert_and_check_return_val(proc, 0);
+
+    // sum the counts of the given passes
+    tb_size_t count = 0;
+    tb_size_t i = 0;
+    for (i = 0; i < VM86_OPTIMIZER_PASSES; i++)
+    {
+        if (passes & (1 << i)) count += proc->optimized[i];
+    }
+
+    // ok
+    return count;
+}
+tb_size_t vm86_proc_line(vm86_proc_ref_t self, tb_size_t index)
+{
+    // check
+    vm86_proc_t* proc = (vm86_proc_t*)self;
+    tb_assert_and_check_return_val(proc, 0);
+
+    // the line number
+    return proc->lines && index < proc->instructions_count? proc->lines[index] : 0;
+}
+tb_bool_t vm86_proc_profile_set(vm86_proc_ref_t self, tb_size_t mode)
+{
+    // check
+    vm86_proc_t* proc = (vm86_proc_t*)self;
+    tb_assert_and_check_return_val(proc && proc->instructions && mode <= VM86_PROC_PROFILE_CYCLES, tb_false);
+
+#ifdef __vm_profile__
+    // done
+    tb_bool_t ok = tb_false;
+    do
+    {
+        // disable it?
+        if (mode == VM86_PROC_PROFILE_NONE)
+        {
+            // exit the counters
+            if (proc->profile_counts) tb_free(proc->profile_counts);
+            proc->profile_counts = tb_null;
+            if (proc->profile_cycles) tb_free(proc->profile_cycles);
+            proc->profile_cycles = tb_null;
+
+            // ok
+            ok = tb_true;
+            break;
+        }
+
+        // the tsc is not supported?
+        if (mode == VM86_PROC_PROFILE_CYCLES && !vm86_instruction_tsc())
+        {
+            tb_trace_e("the tsc cycles are not supported on this platform!");
+            break;
+        }
+
+        // init or clear the executions counts
+        if (!proc->profile_counts) proc->profile_counts = tb_nalloc0_type(proc->instructions_count, tb_hize_t);
+        else tb_memset(proc->profile_counts, 0, proc->instructions_count * sizeof(tb_hize_t));
+        tb_assert_and_check_break(proc->profile_counts);
+
+        // init or clear the cycles
+        if (mode == VM86_PROC_PROFILE_CYCLES)
+        {
+            if (!proc->profile_cycles) proc->profile_cycles = tb_nalloc0_type(proc->instructions_count, tb_hize_t);
+            else tb_memset(proc->profile_cycles, 0, proc->instructions_count * sizeof(tb_hize_t));
+            tb_assert_and_check_break(proc->profile_cycles);
+        }
+        // exit the cycles
+        else if (proc->profile_cycles)
+        {
+            tb_free(proc->profile_cycles);
+            proc->profile_cycles = tb_null;
+        }
+
+        // ok
+        ok = tb_true;
+
+    } while (0);
+
+    // ok?
+    return ok;
+#else
+    // trace
+    if (mode != VM86_PROC_PROFILE_NONE) tb_trace_e("the profiling is not supported, please build vm86 with --profile=y");
+
+    // ok?
+    return mode == VM86_PROC_PROFILE_NONE;
+#endif
+}
+tb_void_t vm86_proc_profile_dump(vm86_proc_ref_t self)
+{
+    // check
+    vm86_proc_t* proc = (vm86_proc_t*)self;
+    tb_assert_and_check_return(proc && proc->instructions);
+
+#ifdef __vm_profile__
+    // not profiled?
+    tb_hize_t const* counts = proc->profile_counts;
+    tb_hize_t const* cycles = proc->profile_cycles;
+    if (!counts)
+    {
+        tb_trace_e("the proc(%s) is not profiled!", proc->name);
+        return ;
+    }
+
+    // the label of each instruction
+    tb_size_t           count = proc->instructions_count;
+    tb_char_t const**   labels = tb_nalloc0_type(count, tb_char_t const*);
+    tb_assert_and_check_return(labels);
+    tb_for_all_if (tb_hash_map_item_t*, item, proc->labels, item)
+    {
+        // the instruction of this label
+        vm86_instruction_ref_t instruction = (vm86_instruction_ref_t)vm86_memory_ptr(tb_p2u32(item->data));
+        if (instruction >= proc->instructions && instruction < proc->instructions + count)
+            labels[instruction - proc->instructions] = item->name;
+    }
+
+    // the total executions and cycles
+    tb_size_t i = 0;
+    tb_hize_t total_counts = 0;
+    tb_hize_t total_cycles = 0;
+    for (i = 0; i < count; i++)
+    {
+        total_counts += counts[i];
+        if (cycles) total_cycles += cycles[i];
+    }
+
+    // trace
+    tb_trace_i("");
+    tb_trace_i("profile: %s, executions: %llu, cycles: %llu", proc->name, total_counts, total_cycles);
+
+    // dump the executions count, the cycles and the per mille of each instruction
+    tb_char_t           line[256];
+    tb_char_t const*    code = proc->code;
+    tb_char_t const*    code_end = code? code + tb_strlen(code) : tb_null;
+    tb_size_t           code_lineno = 1;
+    tb_size_t           fused_end = 0;
+    for (i = 0; i < count; i++)
+    {
+        // the label
+        if (labels[i]) tb_trace_i("%s:", labels[i]);
+
+        // the source line, the proc loaded from the image has no source lines
+        tb_strlcpy(line, "?", sizeof(line));
+        if (code && proc->lines && proc->lines[i])
+        {
+            // seek to this line, the line numbers are increasing
+            while (code < code_end && code_lineno < proc->lines[i]) 
+            {
+                if (*code++ == '\n') code_lineno++;
+            }
+
+            // read it
+            tb_char_t const* b = tb_null;
+            tb_char_t const* q = tb_null;
+            vm86_proc_compiler_read_line(code, code_end, &b, &q);
+            tb_strlcpy(line, b, tb_min((tb_size_t)(q - b) + 1, sizeof(line)));
+        }
+
+        // the instruction in the superinstruction is counted by the head
+        if (i < fused_end)
+        {
+            tb_trace_i("    %12s    %s", "(fused)", line);
+            continue ;
+        }
+        if (proc->instructions[i].fused > 1) fused_end = i + proc->instructions[i].fused;
+
+        // dump it
+        tb_size_t counts_permille = total_counts? (tb_size_t)(counts[i] * 1000 / total_counts) : 0;
+        if (cycles)
+        {
+            tb_size_t cycles_permille = total_cycles? (tb_size_t)(cycles[i] * 1000 / total_cycles) : 0;
+            tb_trace_i("    %12llu %3lu.%lu%% %14llu %3lu.%lu%%    %s", counts[i], counts_permille / 10, counts_permille % 10, cycles[i], cycles_permille / 10, cycles_permille % 10, line);
+        }
+        else tb_trace_i("    %12llu %3lu.%lu%%    %s", counts[i], counts_permille / 10, counts_permille % 10, line);
+    }
+
+    // exit labels
+    tb_free(labels);
+#else
+    // trace
+    tb_trace_e("the profiling is not supported, please build vm86 with --profile=y");
+#endif
+}
+tb_void_t vm86_proc_done(vm86_proc_ref_t self, vm86_context_ref_t context)
 {
     // check
     vm86_proc_t* proc = (vm86_proc_t*)self;
@@ -827,26 +1580,136 @@ tb_void_t vm86_proc_done(vm86_proc_ref_t self)
     tb_trace_d("=====================================================================");
     tb_trace_d("done: %s", proc->name);
 
-    // the machine
-    vm86_machine_ref_t machine = proc->machine;
-    tb_assert_and_check_return(machine);
+    // uses the default context of the machine if no context
+    if (!context) context = vm86_machine_context(proc->machine);
+    tb_assert_and_check_return(context);
 
     // the stack
-    vm86_stack_ref_t stack = vm86_machine_stack(machine);
+    vm86_stack_ref_t stack = vm86_context_stack(context);
     tb_assert_and_check_return(stack);
 
-    // push the stub return address
-    vm86_stack_push(stack, 0xbeaf);
+    // done it
+    vm86_proc_done_exec(proc, context, stack);
+}
+tb_bool_t vm86_proc_done_batch(vm86_proc_ref_t self, vm86_context_ref_t context, tb_uint32_t const* inputs, tb_uint32_t* outputs, tb_size_t count, vm86_proc_layout_t const* layout)
+{
+    // check
+    vm86_proc_t* proc = (vm86_proc_t*)self;
+    tb_assert_and_check_return_val(proc && proc->name && layout, tb_false);
+    tb_assert_and_check_return_val(!layout->inputs_count || (layout->inputs && inputs), tb_false);
+    tb_assert_and_check_return_val(!layout->outputs_count || (layout->outputs && outputs), tb_false);
+
+    // uses the default context of the machine if no context
+    if (!context) context = vm86_machine_context(proc->machine);
+    tb_assert_and_check_return_val(context, tb_false);
+
+    // the stack
+    vm86_stack_ref_t stack = vm86_context_stack(context);
+    tb_assert_and_check_return_val(stack, tb_false);
+
+    // the registers
+    vm86_registers_ref_t registers = vm86_context_registers(context);
+    tb_assert_and_check_return_val(registers, tb_false);
+
+    // check the slots and compute the stack arguments count
+    tb_size_t i = 0;
+    tb_size_t argn = 0;
+    for (i = 0; i < layout->inputs_count + layout->outputs_count; i++)
+    {
+        // the slot
+        vm86_proc_slot_t const* slot = i < layout->inputs_count? &layout->inputs[i] : &layout->outputs[i - layout->inputs_count];
+        if (slot->kind == VM86_PROC_SLOT_STACK) argn = tb_max(argn, (tb_size_t)slot->index + 1);
+        else
+        {
+            // check, the esp is reset for each call and cannot be the input
+            tb_assert_and_check_return_val(slot->kind == VM86_PROC_SLOT_REGISTER, tb_false);
+            tb_assert_and_check_return_val(i >= layout->inputs_count || slot->index != VM86_REGISTER_ESP, tb_false);
+        }
+    }
+
+#ifdef __vm_spmd__
+    /* done all calls in the spmd lanes if there are only the register slots and the register instructions,
+     * the instrumented loops of the profiled proc and the traced context are kept scalar.
+     */
+    tb_bool_t spmd = !argn && count > 1 && !((vm86_context_t*)context)->trace;
+#   ifdef __vm_profile__
+    if (proc->profile_counts) spmd = tb_false;
+#   endif
+    if (spmd)
+    {
+        /* check it once
+         *
+         * the multiple contexts may check it at the same time, but they always save the same state
+         */
+        tb_long_t state = tb_atomic_get(&proc->spmd);
+        if (state == VM86_SPMD_STATE_UNKNOWN)
+        {
+            state = vm86_spmd_check(proc->instructions, proc->instructions_count);
+            tb_atomic_set(&proc->spmd, state);
+        }
+        if (state == VM86_SPMD_STATE_SUPPORTED)
+        {
+            // done it and restore esp
+            tb_uint32_t esp = registers[VM86_REGISTER_ESP].u32;
+            vm86_spmd_done(proc->instructions, proc->instructions_count, context, inputs, outputs, count, layout);
+            registers[VM86_REGISTER_ESP].u32 = esp;
+            return tb_true;
+        }
+    }
+#endif
+
+    // reserve the stack arguments once
+    tb_uint32_t esp = registers[VM86_REGISTER_ESP].u32;
+    for (i = 0; i < argn; i++) vm86_stack_push(stack, 0);
+
+    // the stack arguments, the stack grows down and the first argument is at the top
+    tb_uint32_t     base = registers[VM86_REGISTER_ESP].u32;
+    tb_uint32_t*    args = (tb_uint32_t*)vm86_memory_ptr(base);
+
+    // save the registers and the lazy flags, all calls start from them like the spmd lanes
+    vm86_registers_t    saved_registers;
+    vm86_flags_t        saved_flags = ((vm86_context_t*)context)->flags;
+    tb_memcpy(saved_registers, registers, sizeof(vm86_registers_t));
 
     // done it
-    vm86_instruction_ref_t p = proc->instructions;
-    vm86_instruction_ref_t e = proc->instructions + proc->instructions_count;
-    while (p < e && p) 
+    tb_size_t j = 0;
+    tb_size_t inputs_count = layout->inputs_count;
+    tb_size_t outputs_count = layout->outputs_count;
+    vm86_proc_slot_t const* input_slots = layout->inputs;
+    vm86_proc_slot_t const* output_slots = layout->outputs;
+    for (i = 0; i < count; i++)
     {
-        // check
-        tb_assert(p->done);
+        // restore the registers and the lazy flags left by the previous call
+        if (i)
+        {
+            tb_memcpy(registers, saved_registers, sizeof(vm86_registers_t));
+            ((vm86_context_t*)context)->flags = saved_flags;
+        }
+
+        // set the inputs
+        for (j = 0; j < inputs_count; j++)
+        {
+            if (input_slots[j].kind == VM86_PROC_SLOT_STACK) args[input_slots[j].index] = *inputs++;
+            else vm86_registers_value_set(registers, input_slots[j].index, *inputs++);
+        }
+
+        // reset esp, the callee may pop the arguments (e.g. retn 8)
+        registers[VM86_REGISTER_ESP].u32 = base;
 
-        // execute it
-        p = p->done(p, machine);
+        // done it
+        vm86_proc_done_exec(proc, context, stack);
+
+        // get the outputs
+        for (j = 0; j < outputs_count; j++)
+        {
+            if (output_slots[j].kind == VM86_PROC_SLOT_STACK) *outputs++ = args[output_slots[j].index];
+            else *outputs++ = vm86_registers_value(registers, output_slots[j].index);
+        }
     }
+
+    // restore esp
+    registers[VM86_REGISTER_ESP].u32 = esp;
+
+    // ok
+    return tb_true;
 }
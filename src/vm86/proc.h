@@ -38,6 +38,63 @@ __tb_extern_c_enter__
 /// the machine proc ref type
 typedef struct{}*           vm86_proc_ref_t;
 
+/// the profile mode
+typedef enum __vm86_proc_profile_e
+{
+    VM86_PROC_PROFILE_NONE      = 0     //!< disable it
+,   VM86_PROC_PROFILE_COUNT     = 1     //!< count the executions of each instruction
+,   VM86_PROC_PROFILE_CYCLES    = 2     //!< count the executions and accumulate the tsc cycles of each instruction
+
+}vm86_proc_profile_e;
+
+/// the optimizer pass
+typedef enum __vm86_proc_optimize_e
+{
+    VM86_PROC_OPTIMIZE_NONE         = 0     //!< disable it
+,   VM86_PROC_OPTIMIZE_UNREACHABLE  = 1     //!< delete the unreachable blocks
+,   VM86_PROC_OPTIMIZE_CONSTANT     = 2     //!< propagate the constants through the registers, fold the constant arithmetic and jumps
+,   VM86_PROC_OPTIMIZE_DEAD         = 4     //!< delete the dead register writes
+,   VM86_PROC_OPTIMIZE_FLAGS        = 8     //!< execute the flag-free variants of the instructions whose flags will not be read
+,   VM86_PROC_OPTIMIZE_ALL          = 15    //!< enable all passes
+
+}vm86_proc_optimize_e;
+
+/// the batch slot kind
+typedef enum __vm86_proc_slot_kind_e
+{
+    VM86_PROC_SLOT_REGISTER     = 0     //!< the register, the index is vm86_register_e, e.g. VM86_REGISTER_ECX | VM86_REGISTER_CL
+,   VM86_PROC_SLOT_STACK        = 1     //!< the stack argument, the index 0 is the last pushed argument, e.g. [esp+4] at the entry
+
+}vm86_proc_slot_kind_e;
+
+/// the batch slot type
+typedef struct __vm86_proc_slot_t
+{
+    /// the kind, vm86_proc_slot_kind_e
+    tb_uint8_t              kind;
+
+    /// the register or the stack argument index
+    tb_uint8_t              index;
+
+}vm86_proc_slot_t, *vm86_proc_slot_ref_t;
+
+/// the batch layout type
+typedef struct __vm86_proc_layout_t
+{
+    /// the input slots, the input values of each call are set to them in order
+    vm86_proc_slot_t const* inputs;
+
+    /// the input slots count
+    tb_size_t               inputs_count;
+
+    /// the output slots, the output values of each call are read from them in order after returning
+    vm86_proc_slot_t const* outputs;
+
+    /// the output slots count
+    tb_size_t               outputs_count;
+
+}vm86_proc_layout_t, *vm86_proc_layout_ref_t;
+
 /* //////////////////////////////////////////////////////////////////////////////////////
  * interfaces
  */
@@ -66,11 +123,116 @@ tb_void_t                   vm86_proc_exit(vm86_proc_ref_t proc);
  */
 tb_char_t const*            vm86_proc_name(vm86_proc_ref_t proc);
 
+/*! the hash of the proc code
+ *
+ * @param proc              the proc
+ *
+ * @return                  the hash
+ */
+tb_uint64_t                 vm86_proc_hash(vm86_proc_ref_t proc);
+
+/*! the superinstruction fusions count of the proc
+ *
+ * @param proc              the proc
+ *
+ * @return                  the fusions count
+ */
+tb_size_t                   vm86_proc_fusions(vm86_proc_ref_t proc);
+
+/*! the instructions count deleted, folded or rewritten by the optimizer passes
+ *
+ * the passes are enabled by vm86_machine_optimize_set() before compiling the proc.
+ *
+ * @code
+ * tb_trace_i("%s: unreachable: %lu, constant: %lu, dead: %lu, flags: %lu", vm86_proc_name(proc)
+ *     , vm86_proc_optimized(proc, VM86_PROC_OPTIMIZE_UNREACHABLE)
+ *     , vm86_proc_optimized(proc, VM86_PROC_OPTIMIZE_CONSTANT)
+ *     , vm86_proc_optimized(proc, VM86_PROC_OPTIMIZE_DEAD)
+ *     , vm86_proc_optimized(proc, VM86_PROC_OPTIMIZE_FLAGS));
+ * @endcode
+ *
+ * @param proc              the proc
+ * @param passes            the passes, vm86_proc_optimize_e, the counts of all given passes are summed
+ *
+ * @return                  the instructions count, return 0 if it is not optimized (e.g. the proc is loaded from the image)
+ */
+tb_size_t                   vm86_proc_optimized(vm86_proc_ref_t proc, tb_size_t passes);
+
+/*! the source line number of the instruction
+ *
+ * the line of "xxx proc near" is 1, so the line can be found from the proc code without the leading text.
+ *
+ * @param proc              the proc
+ * @param index             the instruction index
+ *
+ * @return                  the line number, return 0 if it is unknown (e.g. the proc is loaded from the image)
+ */
+tb_size_t                   vm86_proc_line(vm86_proc_ref_t proc, tb_size_t index);
+
+/*! set the profile mode of the proc and clear the counters
+ *
+ * the profiled proc is executed by the instrumented loop in the interpreter instead of the jit code,
+ * the other procs are not affected and there is no cost if the profiling is disabled.
+ *
+ * the counters are not atomic, so please profile it on one context at the same time.
+ *
+ * @note it is only supported if vm86 is built with --profile=y
+ *
+ * @param proc              the proc
+ * @param mode              the profile mode
+ *
+ * @return                  tb_true or tb_false
+ */
+tb_bool_t                   vm86_proc_profile_set(vm86_proc_ref_t proc, tb_size_t mode);
+
+/*! dump the execution counts and cycles of each instruction with the source lines and labels
+ *
+ * @param proc              the proc
+ */
+tb_void_t                   vm86_proc_profile_dump(vm86_proc_ref_t proc);
+
 /*! done proc
+ *
+ * the compiled proc is immutable and can be shared by multiple contexts,
+ * so we can done it on the different contexts in parallel.
  *
  * @param proc              the proc
+ * @param context           the execution context, uses the default context of the machine if be null
+ */
+tb_void_t                   vm86_proc_done(vm86_proc_ref_t proc, vm86_context_ref_t context);
+
+/*! done proc over many argument sets in one call
+ *
+ * the context, the stack arguments and the layout are prepared once,
+ * and only the input values are set and the output values are read for each call.
+ *
+ * e.g. uint64_t sub_6B2B40(uint64_t edx:eax, uint8_t cl)
+ *
+ * @code
+ * static vm86_proc_slot_t const s_inputs[]  = {{VM86_PROC_SLOT_REGISTER, VM86_REGISTER_EAX}, {VM86_PROC_SLOT_REGISTER, VM86_REGISTER_EDX}, {VM86_PROC_SLOT_REGISTER, VM86_REGISTER_ECX | VM86_REGISTER_CL}};
+ * static vm86_proc_slot_t const s_outputs[] = {{VM86_PROC_SLOT_REGISTER, VM86_REGISTER_EAX}, {VM86_PROC_SLOT_REGISTER, VM86_REGISTER_EDX}};
+ * vm86_proc_layout_t layout = {s_inputs, tb_arrayn(s_inputs), s_outputs, tb_arrayn(s_outputs)};
+ *
+ * tb_uint32_t inputs[3 * n];
+ * tb_uint32_t outputs[2 * n];
+ * vm86_proc_done_batch(proc, tb_null, inputs, outputs, n, &layout);
+ * @endcode
+ *
+ * if the layout has only the register slots and the proc has only the register instructions and the jumps in it,
+ * the calls are executed in the vector lanes in lockstep.
+ * all calls start from the registers and the flags of the context in both paths, so each call does not see the registers left by the previous call,
+ * and the registers of the last call are left in the context.
+ *
+ * @param proc              the proc
+ * @param context           the execution context, uses the default context of the machine if be null
+ * @param inputs            the input values, inputs_count values for each call
+ * @param outputs           the output values, outputs_count values for each call
+ * @param count             the calls count
+ * @param layout            the layout
+ *
+ * @return                  tb_true or tb_false
  */
-tb_void_t                   vm86_proc_done(vm86_proc_ref_t proc);
+tb_bool_t                   vm86_proc_done_batch(vm86_proc_ref_t proc, vm86_context_ref_t context, tb_uint32_t const* inputs, tb_uint32_t* outputs, tb_size_t count, vm86_proc_layout_t const* layout);
 
 /* //////////////////////////////////////////////////////////////////////////////////////
  * extern
@@ -26,6 +26,18 @@
  */
 #include "prefix.h"
 
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * macros
+ */
+
+/* the register value of the given width without switching the width at runtime
+ *
+ * the index must be a register of the same width, e.g. vm86_registers_u8(registers, VM86_REGISTER_EAX | VM86_REGISTER_AH)
+ */
+#define vm86_registers_u8(registers, index)     ((registers)[(index) & VM86_REGISTER_MASK].u8[((index) >> 5) & 1])
+#define vm86_registers_u16(registers, index)    ((registers)[(index) & VM86_REGISTER_MASK].u16[0])
+#define vm86_registers_u32(registers, index)    ((registers)[index].u32)
+
 /* //////////////////////////////////////////////////////////////////////////////////////
  * extern
  */
@@ -121,7 +133,7 @@ static __tb_inline__ tb_void_t vm86_registers_clear(vm86_registers_ref_t registe
     // clear it
     tb_memset(registers, 0, VM86_REGISTER_MAXN * sizeof(vm86_register_t));
 }
-static __tb_inline__ tb_uint32_t vm86_registers_value(vm86_registers_ref_t registers, tb_uint8_t index)
+static __tb_inline_force__ tb_uint32_t vm86_registers_value(vm86_registers_ref_t registers, tb_uint8_t index)
 {
     // check
     tb_assert(registers);
@@ -147,7 +159,7 @@ static __tb_inline__ tb_uint32_t vm86_registers_value(vm86_registers_ref_t regis
     // ok?
     return value;
 }
-static __tb_inline__ tb_void_t vm86_registers_value_set(vm86_registers_ref_t registers, tb_uint8_t index, tb_uint32_t value)
+static __tb_inline_force__ tb_void_t vm86_registers_value_set(vm86_registers_ref_t registers, tb_uint8_t index, tb_uint32_t value)
 {
     // check
     tb_assert(registers);
@@ -169,6 +181,12 @@ static __tb_inline__ tb_void_t vm86_registers_value_set(vm86_registers_ref_t reg
         }
     }
 }
+static __tb_inline__ tb_uint32_t vm86_registers_bits(tb_uint8_t index)
+{
+    // the register bits: 32, 8 (low or high byte), 16
+    static tb_uint8_t const s_bits[] = {32, 8, 8, 16};
+    return s_bits[(index >> 4) & 3];
+}
 static __tb_inline__ tb_char_t const* vm86_registers_cstr(tb_uint8_t index)
 {
     // done
@@ -0,0 +1,278 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        snapshot.c
+ *
+ */
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * trace
+ */
+#define TB_TRACE_MODULE_NAME            "machine_snapshot"
+#define TB_TRACE_MODULE_DEBUG           (0)
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "machine.h"
+#include "impl/snapshot.h"
+#if defined(TB_CONFIG_OS_LINUX) && defined(TB_CONFIG_POSIX_HAVE_MMAP)
+#   include <sys/mman.h>
+#   include <sys/syscall.h>
+#   include <unistd.h>
+#   ifdef __NR_memfd_create
+#       define VM86_SNAPSHOT_HAVE_MEMFD
+#   endif
+#endif
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * private implementation
+ */
+#ifdef VM86_SNAPSHOT_HAVE_MEMFD
+static tb_bool_t vm86_snapshot_file_write(tb_int_t fd, tb_byte_t const* data, tb_size_t size, tb_size_t offset)
+{
+    // write all data
+    while (size)
+    {
+        // write it
+        ssize_t real = pwrite(fd, data, size, (off_t)offset);
+        tb_check_return_val(real > 0, tb_false);
+
+        // next
+        data    += real;
+        size    -= real;
+        offset  += real;
+    }
+
+    // ok
+    return tb_true;
+}
+static tb_int_t vm86_snapshot_file_init(tb_byte_t const* data, tb_size_t data_size, tb_byte_t const* stack, tb_size_t stack_size)
+{
+    // make the memory file, MFD_CLOEXEC
+    tb_int_t fd = (tb_int_t)syscall(__NR_memfd_create, "vm86_snapshot", 1);
+    tb_check_return_val(fd >= 0, -1);
+
+    // save the captured pages to it
+    if (    ftruncate(fd, (off_t)(data_size + stack_size)) != 0
+        ||  !vm86_snapshot_file_write(fd, data, data_size, 0)
+        ||  !vm86_snapshot_file_write(fd, stack, stack_size, data_size))
+    {
+        close(fd);
+        return -1;
+    }
+
+    // ok
+    return fd;
+}
+static tb_bool_t vm86_snapshot_file_map(tb_byte_t* data, tb_size_t size, tb_int_t fd, tb_size_t offset)
+{
+    // no pages?
+    tb_check_return_val(size, tb_true);
+
+    // map the private copy-on-write pages of the memory file to this range
+    return mmap(data, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, (off_t)offset) != MAP_FAILED;
+}
+static tb_void_t vm86_snapshot_file_unmap(tb_byte_t* data, tb_size_t size)
+{
+    // no pages?
+    tb_check_return(size);
+
+    // turn this range back to the anonymous pages
+    if (mmap(data, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0) == MAP_FAILED)
+    {
+        // trace
+        tb_trace_e("unmap the snapshot pages failed: %p, size: %lu", data, size);
+    }
+}
+#endif
+static tb_void_t vm86_snapshot_pages_restore(tb_byte_t* data, tb_byte_t const* copy, tb_size_t size)
+{
+    // only copy back the dirty pages
+    tb_size_t offset = 0;
+    for (offset = 0; offset < size; offset += VM86_MEMORY_PAGE_SIZE)
+    {
+        if (tb_memcmp(data + offset, copy + offset, VM86_MEMORY_PAGE_SIZE))
+            tb_memcpy(data + offset, copy + offset, VM86_MEMORY_PAGE_SIZE);
+    }
+}
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * implementation
+ */
+tb_void_t vm86_snapshot_init(vm86_snapshot_t* snapshot)
+{
+    // check
+    tb_assert_and_check_return(snapshot);
+
+    // init it
+    tb_memset(snapshot, 0, sizeof(vm86_snapshot_t));
+    snapshot->fd = -1;
+}
+tb_bool_t vm86_snapshot_capture(vm86_snapshot_t* snapshot, vm86_context_t* context, vm86_data_t* data)
+{
+    // check
+    tb_assert_and_check_return_val(snapshot && context && data && data->data && context->stack.data, tb_false);
+
+    // the used .data pages
+    tb_byte_t*  data_pages  = data->data;
+    tb_size_t   data_size   = tb_align(data->base, VM86_MEMORY_PAGE_SIZE);
+
+    // the used stack pages, from the page of esp to the stack top
+    tb_byte_t*  stack_top   = (tb_byte_t*)(context->stack.data + context->stack.size);
+    tb_byte_t*  stack_pages = (tb_byte_t*)vm86_memory_ptr(context->registers[VM86_REGISTER_ESP].u32);
+    stack_pages = (tb_byte_t*)((tb_size_t)stack_pages & ~((tb_size_t)VM86_MEMORY_PAGE_SIZE - 1));
+    tb_assert_and_check_return_val(stack_pages >= (tb_byte_t*)context->stack.data && stack_pages <= stack_top, tb_false);
+    tb_size_t   stack_size  = stack_top - stack_pages;
+
+    // done
+    tb_bool_t ok = tb_false;
+    do
+    {
+#ifdef VM86_SNAPSHOT_HAVE_MEMFD
+        // save the captured pages to a new memory file
+        tb_int_t fd = vm86_snapshot_file_init(data_pages, data_size, stack_pages, stack_size);
+        if (fd >= 0)
+        {
+            // exit the previous snapshot
+            vm86_snapshot_exit(snapshot);
+
+            // map the copy-on-write pages, the contents are not changed
+            if (    !vm86_snapshot_file_map(data_pages, data_size, fd, 0)
+                ||  !vm86_snapshot_file_map(stack_pages, stack_size, fd, data_size))
+            {
+                // trace
+                tb_trace_e("map the snapshot pages failed!");
+                close(fd);
+                break;
+            }
+
+            // save the memory file
+            snapshot->fd = fd;
+        }
+        else
+#endif
+        {
+            // copy the captured pages
+            tb_byte_t* pages = (tb_byte_t*)tb_malloc((data_size + stack_size) ? (data_size + stack_size) : 1);
+            tb_assert_and_check_break(pages);
+            if (data_size) tb_memcpy(pages, data_pages, data_size);
+            if (stack_size) tb_memcpy(pages + data_size, stack_pages, stack_size);
+
+            // exit the previous snapshot
+            tb_bool_t cow = snapshot->fd >= 0;
+            vm86_snapshot_exit(snapshot);
+
+            // the previous copy-on-write pages have been turned back to the zeroed anonymous pages? copy the contents back
+            if (cow)
+            {
+                if (data_size) tb_memcpy(data_pages, pages, data_size);
+                if (stack_size) tb_memcpy(stack_pages, pages + data_size, stack_size);
+            }
+
+            // save the copies
+            snapshot->pages = pages;
+        }
+
+        // save the registers and the lazy flags
+        tb_memcpy(snapshot->registers, context->registers, sizeof(vm86_registers_t));
+        tb_memcpy(&snapshot->flags, &context->flags, sizeof(vm86_flags_t));
+
+        // save the captured ranges
+        snapshot->data          = data_pages;
+        snapshot->data_size     = data_size;
+        snapshot->data_base     = data->base;
+        snapshot->stack         = stack_pages;
+        snapshot->stack_size    = stack_size;
+        snapshot->captured      = tb_true;
+
+        // trace
+        tb_trace_d("capture: data: %lu, stack: %lu, cow: %d", data_size, stack_size, snapshot->fd >= 0);
+
+        // ok
+        ok = tb_true;
+
+    } while (0);
+
+    // ok?
+    return ok;
+}
+tb_bool_t vm86_snapshot_restore(vm86_snapshot_t* snapshot, vm86_context_t* context, vm86_data_t* data)
+{
+    // check
+    tb_assert_and_check_return_val(snapshot && context && data, tb_false);
+
+    // no snapshot?
+    tb_check_return_val(snapshot->captured, tb_false);
+
+    // the .data has been changed after capturing? we need capture it again
+    if (data->base != snapshot->data_base || data->data != snapshot->data)
+    {
+        // trace
+        tb_trace_e("the .data has been changed after capturing the snapshot!");
+        return tb_false;
+    }
+
+#ifdef VM86_SNAPSHOT_HAVE_MEMFD
+    if (snapshot->fd >= 0)
+    {
+        // drop the dirty private pages, the clean pages of the memory file will be mapped when they are touched again
+        if (snapshot->data_size) madvise(snapshot->data, snapshot->data_size, MADV_DONTNEED);
+        if (snapshot->stack_size) madvise(snapshot->stack, snapshot->stack_size, MADV_DONTNEED);
+    }
+    else
+#endif
+    {
+        // copy back the dirty pages
+        vm86_snapshot_pages_restore(snapshot->data, snapshot->pages, snapshot->data_size);
+        vm86_snapshot_pages_restore(snapshot->stack, snapshot->pages + snapshot->data_size, snapshot->stack_size);
+    }
+
+    // discard the stack pages below the captured pages
+    tb_byte_t* stack_base = (tb_byte_t*)context->stack.data;
+    if (snapshot->stack > stack_base) vm86_memory_discard(stack_base, snapshot->stack - stack_base);
+
+    // restore the registers and the lazy flags
+    tb_memcpy(context->registers, snapshot->registers, sizeof(vm86_registers_t));
+    tb_memcpy(&context->flags, &snapshot->flags, sizeof(vm86_flags_t));
+
+    // ok
+    return tb_true;
+}
+tb_void_t vm86_snapshot_exit(vm86_snapshot_t* snapshot)
+{
+    // check
+    tb_assert_and_check_return(snapshot);
+
+#ifdef VM86_SNAPSHOT_HAVE_MEMFD
+    // exit the memory file
+    if (snapshot->fd >= 0)
+    {
+        // turn the captured pages back to the anonymous pages
+        vm86_snapshot_file_unmap(snapshot->data, snapshot->data_size);
+        vm86_snapshot_file_unmap(snapshot->stack, snapshot->stack_size);
+
+        // close it
+        close(snapshot->fd);
+    }
+#endif
+
+    // exit the copies
+    if (snapshot->pages) tb_free(snapshot->pages);
+
+    // clear it
+    vm86_snapshot_init(snapshot);
+}
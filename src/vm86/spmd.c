@@ -0,0 +1,556 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        spmd.c
+ *
+ */
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * trace
+ */
+#define TB_TRACE_MODULE_NAME            "machine_spmd"
+#define TB_TRACE_MODULE_DEBUG           (0)
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "machine.h"
+#include "impl/spmd.h"
+#include "impl/context.h"
+
+#ifdef __vm_spmd__
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * macros
+ */
+
+// the finished lane
+#define VM86_SPMD_PC_END                (0xffffffff)
+
+// broadcast the value to all lanes
+#define vm86_spmd_splat(x)              (((vm86_spmd_vector_t){0}) + (tb_uint32_t)(x))
+
+// select a for the lanes in mask and b for the others
+#define vm86_spmd_select(m, a, b)       (((a) & (m)) | ((b) & ~(m)))
+
+// the lanes mask of the comparison
+#define vm86_spmd_mask(cmp)             ((vm86_spmd_vector_t)(cmp))
+
+/* the spmd executor is cloned for avx2 and selected at runtime if the default target has no avx2,
+ * the lanes count is not changed and the vector operations are only compiled to the wider instructions.
+ */
+#if defined(TB_ARCH_x64) && defined(TB_CONFIG_OS_LINUX) && defined(TB_COMPILER_IS_GCC) && !defined(TB_COMPILER_IS_CLANG) && !defined(__AVX2__)
+#   define __vm_spmd_clones__           __attribute__((target_clones("avx2", "default")))
+#else
+#   define __vm_spmd_clones__
+#endif
+
+/* the vectors are only passed to the static functions and they are always inlined,
+ * so the abi is not changed for the other modules and the avx2 clone of vm86_spmd_exec().
+ */
+#if defined(TB_COMPILER_IS_GCC) && !defined(TB_COMPILER_IS_CLANG)
+#   pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+// the vector of all lanes
+typedef tb_uint32_t                     vm86_spmd_vector_t __attribute__((vector_size(VM86_SPMD_LANES * sizeof(tb_uint32_t))));
+
+// the signed vector of all lanes
+typedef tb_sint32_t                     vm86_spmd_svector_t __attribute__((vector_size(VM86_SPMD_LANES * sizeof(tb_sint32_t))));
+
+// the spmd lanes type
+typedef struct __vm86_spmd_t
+{
+    // the registers of all lanes
+    vm86_spmd_vector_t                  registers[VM86_REGISTER_MAXN];
+
+    // the lazy flags of all lanes, the diverged lanes may have the different operations
+    vm86_spmd_vector_t                  flags_op;
+    vm86_spmd_vector_t                  flags_bits;
+    vm86_spmd_vector_t                  flags_dst;
+    vm86_spmd_vector_t                  flags_src;
+    vm86_spmd_vector_t                  flags_result;
+
+    // the instruction index of all lanes, VM86_SPMD_PC_END if it is finished
+    vm86_spmd_vector_t                  pcs;
+
+}vm86_spmd_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * private implementation
+ */
+static tb_uint8_t vm86_spmd_opcode(tb_uint8_t opcode)
+{
+    // the generic opcode of the width-specialized or flag-free opcode or the first opcode of the fused pair
+#define VM86_SPMD_WIDTH_CASE(op, o, n, r)           case VM86_OPCODE_##o##_8: case VM86_OPCODE_##o##_16: case VM86_OPCODE_##o##_32: return VM86_OPCODE_##o;
+#define VM86_SPMD_FUSED_CASE(op, o0, n0, o1, n1)    case VM86_OPCODE_##o0##_##o1: return vm86_spmd_opcode(VM86_OPCODE_##o0);
+#define VM86_SPMD_NOFLAGS_CASE(op, o, n)            case VM86_OPCODE_##o##_8_NF: case VM86_OPCODE_##o##_16_NF: case VM86_OPCODE_##o##_32_NF: return VM86_OPCODE_##o;
+    switch (opcode)
+    {
+    VM86_OPCODE_WIDTH_LIST(op, VM86_SPMD_WIDTH_CASE)
+    VM86_OPCODE_FUSED_LIST(op, VM86_SPMD_FUSED_CASE)
+    VM86_OPCODE_NOFLAGS_LIST(op, VM86_SPMD_NOFLAGS_CASE)
+    default: break;
+    }
+#undef VM86_SPMD_WIDTH_CASE
+#undef VM86_SPMD_FUSED_CASE
+#undef VM86_SPMD_NOFLAGS_CASE
+
+    // the generic opcode
+    return opcode;
+}
+static __tb_inline_force__ vm86_spmd_vector_t vm86_spmd_value(vm86_spmd_t* spmd, tb_uint8_t index)
+{
+    // get the register of all lanes
+    vm86_spmd_vector_t r = spmd->registers[index & VM86_REGISTER_MASK];
+
+    // done
+    switch ((index >> 4) & 3)
+    {
+    case 1:     return r & 0xff;
+    case 2:     return (r >> 8) & 0xff;
+    case 3:     return r & 0xffff;
+    default:    return r;
+    }
+}
+static __tb_inline_force__ tb_void_t vm86_spmd_value_set(vm86_spmd_t* spmd, tb_uint8_t index, vm86_spmd_vector_t value, vm86_spmd_vector_t mask)
+{
+    // get the register of all lanes
+    vm86_spmd_vector_t* r = &spmd->registers[index & VM86_REGISTER_MASK];
+
+    // merge the value to the register
+    switch ((index >> 4) & 3)
+    {
+    case 1:     value = (*r & ~0xff) | (value & 0xff);          break;
+    case 2:     value = (*r & ~0xff00) | ((value & 0xff) << 8); break;
+    case 3:     value = (*r & ~0xffff) | (value & 0xffff);      break;
+    default:    break;
+    }
+
+    // only update the active lanes
+    *r = vm86_spmd_select(mask, value, *r);
+}
+static __tb_inline_force__ vm86_spmd_vector_t vm86_spmd_sext(vm86_spmd_vector_t value, tb_uint32_t bits)
+{
+    return bits < 32? (vm86_spmd_vector_t)((vm86_spmd_svector_t)(value << (32 - bits)) >> (32 - bits)) : value;
+}
+static __tb_inline_force__ tb_void_t vm86_spmd_flags_set(vm86_spmd_t* spmd, tb_uint32_t op, tb_uint32_t bits, vm86_spmd_vector_t dst, vm86_spmd_vector_t src, vm86_spmd_vector_t result, vm86_spmd_vector_t mask)
+{
+    spmd->flags_op      = vm86_spmd_select(mask, vm86_spmd_splat(op), spmd->flags_op);
+    spmd->flags_bits    = vm86_spmd_select(mask, vm86_spmd_splat(bits), spmd->flags_bits);
+    spmd->flags_dst     = vm86_spmd_select(mask, dst, spmd->flags_dst);
+    spmd->flags_src     = vm86_spmd_select(mask, src, spmd->flags_src);
+    spmd->flags_result  = vm86_spmd_select(mask, result, spmd->flags_result);
+}
+static __tb_inline__ tb_void_t vm86_spmd_flags_lane(vm86_spmd_t* spmd, tb_size_t lane, vm86_flags_t* flags)
+{
+    flags->op       = spmd->flags_op[lane];
+    flags->bits     = spmd->flags_bits[lane];
+    flags->dst      = spmd->flags_dst[lane];
+    flags->src      = spmd->flags_src[lane];
+    flags->result   = spmd->flags_result[lane];
+}
+static __tb_inline_force__ vm86_spmd_vector_t vm86_spmd_cond(vm86_spmd_t* spmd, tb_size_t cond, vm86_spmd_vector_t mask)
+{
+    // jmp?
+    if (cond == VM86_FLAGS_COND_ALWAYS) return mask;
+
+    // all active lanes have the flags of cmp or sub with the same bits?
+    tb_size_t   lane = 0;
+    tb_uint32_t bits = 0;
+    for (lane = 0; lane < VM86_SPMD_LANES; lane++)
+    {
+        if (!mask[lane]) continue ;
+        if (spmd->flags_op[lane] != VM86_FLAGS_OP_SUB || (bits && spmd->flags_bits[lane] != bits))
+        {
+            bits = 0;
+            break;
+        }
+        bits = spmd->flags_bits[lane];
+    }
+
+    // compare the operands of all lanes directly
+    if (bits)
+    {
+        vm86_spmd_vector_t m    = vm86_spmd_splat(bits < 32? ((1u << bits) - 1) : 0xffffffff);
+        vm86_spmd_vector_t dst  = spmd->flags_dst & m;
+        vm86_spmd_vector_t src  = spmd->flags_src & m;
+        switch (cond)
+        {
+        case VM86_FLAGS_COND_B:     return mask & vm86_spmd_mask(dst < src);
+        case VM86_FLAGS_COND_NB:    return mask & vm86_spmd_mask(dst >= src);
+        case VM86_FLAGS_COND_Z:     return mask & vm86_spmd_mask(dst == src);
+        case VM86_FLAGS_COND_NZ:    return mask & vm86_spmd_mask(dst != src);
+        case VM86_FLAGS_COND_BE:    return mask & vm86_spmd_mask(dst <= src);
+        case VM86_FLAGS_COND_A:     return mask & vm86_spmd_mask(dst > src);
+        case VM86_FLAGS_COND_L:     return mask & vm86_spmd_mask((vm86_spmd_svector_t)vm86_spmd_sext(dst, bits) < (vm86_spmd_svector_t)vm86_spmd_sext(src, bits));
+        case VM86_FLAGS_COND_GE:    return mask & vm86_spmd_mask((vm86_spmd_svector_t)vm86_spmd_sext(dst, bits) >= (vm86_spmd_svector_t)vm86_spmd_sext(src, bits));
+        case VM86_FLAGS_COND_LE:    return mask & vm86_spmd_mask((vm86_spmd_svector_t)vm86_spmd_sext(dst, bits) <= (vm86_spmd_svector_t)vm86_spmd_sext(src, bits));
+        case VM86_FLAGS_COND_G:     return mask & vm86_spmd_mask((vm86_spmd_svector_t)vm86_spmd_sext(dst, bits) > (vm86_spmd_svector_t)vm86_spmd_sext(src, bits));
+        default:                    break;
+        }
+    }
+
+    // test the lazy flags of each active lane
+    vm86_spmd_vector_t taken = vm86_spmd_splat(0);
+    for (lane = 0; lane < VM86_SPMD_LANES; lane++)
+    {
+        // active?
+        if (!mask[lane]) continue ;
+
+        // test it and save the computed eflags
+        vm86_flags_t    flags;
+        tb_uint32_t     eflags = spmd->registers[VM86_REGISTER_EFLAGS][lane];
+        vm86_spmd_flags_lane(spmd, lane, &flags);
+        if (vm86_flags_cond(&flags, &eflags, cond)) taken[lane] = 0xffffffff;
+        spmd->registers[VM86_REGISTER_EFLAGS][lane] = eflags;
+        spmd->flags_op[lane] = flags.op;
+    }
+
+    // ok
+    return taken;
+}
+static __vm_spmd_clones__ tb_void_t vm86_spmd_exec(vm86_spmd_t* spmd, vm86_instruction_ref_t instructions, tb_size_t count)
+{
+    // done
+    while (1)
+    {
+        // the minimum instruction index of the unfinished lanes
+        tb_size_t   lane = 0;
+        tb_uint32_t pc = VM86_SPMD_PC_END;
+        for (lane = 0; lane < VM86_SPMD_LANES; lane++)
+        {
+            if (spmd->pcs[lane] < pc) pc = spmd->pcs[lane];
+        }
+
+        /* all lanes are finished?
+         *
+         * vm86_spmd_check() has rejected the proc which falls through its end,
+         * but never read the instruction after the end even if the lanes get there.
+         */
+        tb_check_break(pc < count);
+
+        // execute the lanes at this instruction, the others are waiting for them
+        vm86_instruction_ref_t  instruction = instructions + pc;
+        vm86_spmd_vector_t      mask = vm86_spmd_mask(spmd->pcs == pc);
+        vm86_spmd_vector_t      next = vm86_spmd_splat(pc + 1);
+        tb_uint8_t              r0 = instruction->r0;
+        tb_uint8_t              r1 = instruction->r1;
+        tb_uint32_t             bits = vm86_registers_bits(r0);
+        switch (vm86_spmd_opcode(instruction->opcode))
+        {
+        case VM86_OPCODE_RETN:
+            {
+                // pop the return address and finish these lanes
+                spmd->registers[VM86_REGISTER_ESP] += mask & 4;
+                next = vm86_spmd_splat(VM86_SPMD_PC_END);
+            }
+            break;
+        case VM86_OPCODE_MOV_R0_R1:
+        case VM86_OPCODE_MOVZX_R0_R1:
+            vm86_spmd_value_set(spmd, r0, vm86_spmd_value(spmd, r1), mask);
+            break;
+        case VM86_OPCODE_MOV_R0_V0:
+            vm86_spmd_value_set(spmd, r0, vm86_spmd_splat(instruction->v0.u32), mask);
+            break;
+        case VM86_OPCODE_NOT_R0:
+            vm86_spmd_value_set(spmd, r0, ~vm86_spmd_value(spmd, r0), mask);
+            break;
+        case VM86_OPCODE_LEA_R0_$R1_ADD_R2_OP_V0$:
+            {
+                vm86_spmd_vector_t a = vm86_spmd_value(spmd, r1);
+                vm86_spmd_vector_t b = vm86_spmd_value(spmd, instruction->r2);
+                vm86_spmd_value_set(spmd, r0, instruction->op == '+'? (a + b + instruction->v0.u32) : (a + b * instruction->v0.u32), mask);
+            }
+            break;
+        case VM86_OPCODE_ADD_R0_R1:
+        case VM86_OPCODE_ADD_R0_V0:
+        case VM86_OPCODE_SUB_R0_R1:
+        case VM86_OPCODE_SUB_R0_V0:
+        case VM86_OPCODE_CMP_R0_R1:
+        case VM86_OPCODE_CMP_R0_V0:
+        case VM86_OPCODE_AND_R0_R1:
+        case VM86_OPCODE_AND_R0_V0:
+        case VM86_OPCODE_XOR_R0_R1:
+        case VM86_OPCODE_XOR_R0_V0:
+        case VM86_OPCODE_OR_R0_V0:
+            {
+                // the operands
+                tb_uint8_t          opcode = vm86_spmd_opcode(instruction->opcode);
+                vm86_spmd_vector_t  dst = vm86_spmd_value(spmd, r0);
+                vm86_spmd_vector_t  src;
+                if (    opcode == VM86_OPCODE_ADD_R0_R1 || opcode == VM86_OPCODE_SUB_R0_R1 || opcode == VM86_OPCODE_CMP_R0_R1
+                    ||  opcode == VM86_OPCODE_AND_R0_R1 || opcode == VM86_OPCODE_XOR_R0_R1)
+                    src = vm86_spmd_value(spmd, r1);
+                else src = vm86_spmd_splat(instruction->v0.u32);
+
+                // compute it
+                tb_uint32_t         op = VM86_FLAGS_OP_LOGIC;
+                vm86_spmd_vector_t  result;
+                switch (opcode)
+                {
+                case VM86_OPCODE_ADD_R0_R1:
+                case VM86_OPCODE_ADD_R0_V0: result = dst + src; op = VM86_FLAGS_OP_ADD;     break;
+                case VM86_OPCODE_AND_R0_R1:
+                case VM86_OPCODE_AND_R0_V0: result = dst & src;                             break;
+                case VM86_OPCODE_XOR_R0_R1:
+                case VM86_OPCODE_XOR_R0_V0: result = dst ^ src;                             break;
+                case VM86_OPCODE_OR_R0_V0:  result = dst | src;                             break;
+                default:                    result = dst - src; op = VM86_FLAGS_OP_SUB;     break;
+                }
+
+                // set r0, cmp only updates the flags
+                if (opcode != VM86_OPCODE_CMP_R0_R1 && opcode != VM86_OPCODE_CMP_R0_V0) vm86_spmd_value_set(spmd, r0, result, mask);
+
+                // update flags lazily
+                vm86_spmd_flags_set(spmd, op, bits, dst, src, result, mask);
+            }
+            break;
+        case VM86_OPCODE_SHR_R0_R1:
+        case VM86_OPCODE_SHR_R0_V0:
+        case VM86_OPCODE_SHL_R0_R1:
+        case VM86_OPCODE_SHL_R0_V0:
+        case VM86_OPCODE_SAR_R0_R1:
+        case VM86_OPCODE_SAR_R0_V0:
+            {
+                // the count, only the low 5 bits are used
+                tb_uint8_t          opcode = vm86_spmd_opcode(instruction->opcode);
+                vm86_spmd_vector_t  count;
+                if (opcode == VM86_OPCODE_SHR_R0_R1 || opcode == VM86_OPCODE_SHL_R0_R1 || opcode == VM86_OPCODE_SAR_R0_R1)
+                    count = vm86_spmd_value(spmd, r1) & 0x1f;
+                else count = vm86_spmd_splat(instruction->v0.u32 & 0x1f);
+
+                // the flags and r0 are not affected if the count is zero
+                vm86_spmd_vector_t live = mask & vm86_spmd_mask(count != 0);
+
+                // compute it
+                tb_uint32_t         op;
+                vm86_spmd_vector_t  dst = vm86_spmd_value(spmd, r0);
+                vm86_spmd_vector_t  result;
+                switch (opcode)
+                {
+                case VM86_OPCODE_SHR_R0_R1:
+                case VM86_OPCODE_SHR_R0_V0: result = dst >> count; op = VM86_FLAGS_OP_SHR; break;
+                case VM86_OPCODE_SHL_R0_R1:
+                case VM86_OPCODE_SHL_R0_V0: result = dst << count; op = VM86_FLAGS_OP_SHL; break;
+                default:                    result = (vm86_spmd_vector_t)((vm86_spmd_svector_t)vm86_spmd_sext(dst, bits) >> (vm86_spmd_svector_t)count); op = VM86_FLAGS_OP_SAR; break;
+                }
+
+                // set r0
+                vm86_spmd_value_set(spmd, r0, result, live);
+
+                // update flags lazily
+                vm86_spmd_flags_set(spmd, op, bits, dst, count, result, live);
+            }
+            break;
+        case VM86_OPCODE_SHRD_R0_R1_R2:
+            {
+                // the operands
+                vm86_spmd_vector_t  dst = vm86_spmd_value(spmd, r0);
+                vm86_spmd_vector_t  src = vm86_spmd_value(spmd, r1);
+                vm86_spmd_vector_t  count = vm86_spmd_value(spmd, instruction->r2) & 0x1f;
+
+                // the flags and r0 are not affected if the count is zero
+                vm86_spmd_vector_t  live = mask & vm86_spmd_mask(count != 0);
+
+                // shift r0 right and fill the high bits from r1
+                vm86_spmd_vector_t  result = (dst >> count) | (src << ((32 - count) & 0x1f));
+
+                // set r0
+                vm86_spmd_value_set(spmd, r0, result, live);
+
+                // update flags lazily
+                vm86_spmd_flags_set(spmd, VM86_FLAGS_OP_SHRD, 32, dst, count, result, live);
+            }
+            break;
+        case VM86_OPCODE_JXX_V0:
+            {
+                // the target in this proc
+                tb_uint32_t target = (tb_uint32_t)((vm86_instruction_ref_t)vm86_memory_ptr(instruction->v0.u32) - instructions);
+                tb_assert(target < count);
+
+                // go to the target for the taken lanes
+                next = vm86_spmd_select(vm86_spmd_cond(spmd, instruction->cond, mask), vm86_spmd_splat(target), next);
+            }
+            break;
+        default:
+            {
+                // it has been checked by vm86_spmd_check()
+                tb_assert(0);
+                next = vm86_spmd_splat(VM86_SPMD_PC_END);
+            }
+            break;
+        }
+
+        // go to the next instructions
+        spmd->pcs = vm86_spmd_select(mask, next, spmd->pcs);
+    }
+}
+#endif
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * implementation
+ */
+tb_size_t vm86_spmd_check(vm86_instruction_ref_t instructions, tb_size_t count)
+{
+    // check
+    tb_assert_and_check_return_val(instructions && count, VM86_SPMD_STATE_UNSUPPORTED);
+
+#ifdef __vm_spmd__
+    // done
+    tb_size_t i = 0;
+    for (i = 0; i < count; i++)
+    {
+        vm86_instruction_ref_t instruction = instructions + i;
+        switch (vm86_spmd_opcode(instruction->opcode))
+        {
+        case VM86_OPCODE_RETN:
+        case VM86_OPCODE_MOV_R0_R1:
+        case VM86_OPCODE_MOV_R0_V0:
+        case VM86_OPCODE_MOVZX_R0_R1:
+        case VM86_OPCODE_NOT_R0:
+        case VM86_OPCODE_LEA_R0_$R1_ADD_R2_OP_V0$:
+        case VM86_OPCODE_ADD_R0_R1:
+        case VM86_OPCODE_ADD_R0_V0:
+        case VM86_OPCODE_SUB_R0_R1:
+        case VM86_OPCODE_SUB_R0_V0:
+        case VM86_OPCODE_CMP_R0_R1:
+        case VM86_OPCODE_CMP_R0_V0:
+        case VM86_OPCODE_AND_R0_R1:
+        case VM86_OPCODE_AND_R0_V0:
+        case VM86_OPCODE_XOR_R0_R1:
+        case VM86_OPCODE_XOR_R0_V0:
+        case VM86_OPCODE_OR_R0_V0:
+        case VM86_OPCODE_SHR_R0_R1:
+        case VM86_OPCODE_SHR_R0_V0:
+        case VM86_OPCODE_SHL_R0_R1:
+        case VM86_OPCODE_SHL_R0_V0:
+        case VM86_OPCODE_SAR_R0_R1:
+        case VM86_OPCODE_SAR_R0_V0:
+        case VM86_OPCODE_SHRD_R0_R1_R2:
+            break;
+        case VM86_OPCODE_JXX_V0:
+            {
+                // only the direct jump in this proc
+                vm86_instruction_ref_t target = instruction->v0.u32? (vm86_instruction_ref_t)vm86_memory_ptr(instruction->v0.u32) : tb_null;
+                if (!target || target < instructions || target >= instructions + count) return VM86_SPMD_STATE_UNSUPPORTED;
+            }
+            break;
+        default:
+            // the memory, stack, call and indirect jump instructions
+            return VM86_SPMD_STATE_UNSUPPORTED;
+        }
+    }
+
+    // the last instruction cannot fall through the end of this proc
+    vm86_instruction_ref_t last = instructions + count - 1;
+    tb_size_t opcode = vm86_spmd_opcode(last->opcode);
+    if (opcode != VM86_OPCODE_RETN && !(opcode == VM86_OPCODE_JXX_V0 && last->cond == VM86_FLAGS_COND_ALWAYS))
+        return VM86_SPMD_STATE_UNSUPPORTED;
+
+    // ok
+    return VM86_SPMD_STATE_SUPPORTED;
+#else
+    return VM86_SPMD_STATE_UNSUPPORTED;
+#endif
+}
+tb_void_t vm86_spmd_done(vm86_instruction_ref_t instructions, tb_size_t count, vm86_context_ref_t self, tb_uint32_t const* inputs, tb_uint32_t* outputs, tb_size_t n, vm86_proc_layout_t const* layout)
+{
+    // check
+    vm86_context_t* context = (vm86_context_t*)self;
+    tb_assert_and_check_return(instructions && count && context && layout);
+
+#ifdef __vm_spmd__
+    // the registers and flags of the context
+    vm86_registers_ref_t    registers = context->registers;
+    vm86_flags_t*           flags = &context->flags;
+
+    // done
+    tb_size_t   i = 0;
+    tb_size_t   j = 0;
+    tb_size_t   lane = 0;
+    tb_size_t   lanes = 0;
+    vm86_spmd_t spmd;
+    for (i = 0; i < n; i += lanes)
+    {
+        // the lanes count of this group
+        lanes = tb_min(n - i, VM86_SPMD_LANES);
+
+        // all lanes start from the registers and flags of the context
+        for (j = 0; j < VM86_REGISTER_MAXN; j++) spmd.registers[j] = vm86_spmd_splat(registers[j].u32);
+        spmd.flags_op       = vm86_spmd_splat(flags->op);
+        spmd.flags_bits     = vm86_spmd_splat(flags->bits);
+        spmd.flags_dst      = vm86_spmd_splat(flags->dst);
+        spmd.flags_src      = vm86_spmd_splat(flags->src);
+        spmd.flags_result   = vm86_spmd_splat(flags->result);
+
+        // push the stub return address, it need not be written because there is no memory access
+        spmd.registers[VM86_REGISTER_ESP] -= 4;
+
+        // the unused lanes are finished
+        for (lane = 0; lane < VM86_SPMD_LANES; lane++) spmd.pcs[lane] = lane < lanes? 0 : VM86_SPMD_PC_END;
+
+        // set the inputs
+        vm86_spmd_vector_t mask = vm86_spmd_splat(0xffffffff);
+        for (j = 0; j < layout->inputs_count; j++)
+        {
+            vm86_spmd_vector_t value = vm86_spmd_splat(0);
+            for (lane = 0; lane < lanes; lane++) value[lane] = inputs[(i + lane) * layout->inputs_count + j];
+            vm86_spmd_value_set(&spmd, layout->inputs[j].index, value, mask);
+        }
+
+        // execute all lanes
+        vm86_spmd_exec(&spmd, instructions, count);
+
+        // get the outputs
+        for (j = 0; j < layout->outputs_count; j++)
+        {
+            // the eflags? compute the lazy flags of each lane
+            tb_uint8_t index = layout->outputs[j].index;
+            if (index == VM86_REGISTER_EFLAGS)
+            {
+                for (lane = 0; lane < lanes; lane++)
+                {
+                    vm86_flags_t    lane_flags;
+                    tb_uint32_t     eflags = spmd.registers[VM86_REGISTER_EFLAGS][lane];
+                    vm86_spmd_flags_lane(&spmd, lane, &lane_flags);
+                    outputs[(i + lane) * layout->outputs_count + j] = vm86_flags_eflags(&lane_flags, &eflags);
+                }
+            }
+            else
+            {
+                vm86_spmd_vector_t value = vm86_spmd_value(&spmd, index);
+                for (lane = 0; lane < lanes; lane++) outputs[(i + lane) * layout->outputs_count + j] = value[lane];
+            }
+        }
+    }
+
+    // save the registers and flags of the last call to the context
+    if (lanes)
+    {
+        lane = lanes - 1;
+        for (j = 0; j < VM86_REGISTER_MAXN; j++) registers[j].u32 = spmd.registers[j][lane];
+        vm86_spmd_flags_lane(&spmd, lane, flags);
+        vm86_flags_eflags(flags, &registers[VM86_REGISTER_EFLAGS].u32);
+    }
+#else
+    // check
+    tb_assert(0);
+#endif
+}
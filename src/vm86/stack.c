@@ -28,24 +28,7 @@
  * includes
  */
 #include "machine.h"
-
-/* //////////////////////////////////////////////////////////////////////////////////////
- * types
- */
-
-// the machine stack stack type
-typedef struct __vm86_stack_t
-{
-    // the data
-    tb_uint32_t*    data;
-
-    // the size
-    tb_size_t       size;
-
-    // the top
-    tb_uint32_t**   top;
-
-}vm86_stack_t;
+#include "impl/stack.h"
 
 /* //////////////////////////////////////////////////////////////////////////////////////
  * implementation
@@ -55,41 +38,51 @@ vm86_stack_ref_t vm86_stack_init(tb_size_t size, tb_uint32_t* esp)
     // check
     tb_assert_and_check_return_val(size && esp, tb_null);
 
-    // done
-    tb_bool_t       ok = tb_false;
-    vm86_stack_t*   stack = tb_null;
-    do
+    // make stack
+    vm86_stack_t* stack = tb_malloc0_type(vm86_stack_t);
+    tb_assert_and_check_return_val(stack, tb_null);
+
+    // attach stack and reserve its pages
+    if (!vm86_stack_attach(stack, size, esp))
     {
-        // make stack
-        stack = tb_malloc0_type(vm86_stack_t);
-        tb_assert_and_check_break(stack);
+        tb_free(stack);
+        return tb_null;
+    }
 
-        // make data
-        stack->data = tb_nalloc0_type(size, tb_uint32_t);
-        tb_assert_and_check_break(stack->data);
+    // ok
+    return (vm86_stack_ref_t)stack;
+}
+tb_bool_t vm86_stack_attach(vm86_stack_t* stack, tb_size_t size, tb_uint32_t* esp)
+{
+    // check
+    tb_assert_and_check_return_val(stack && size && esp, tb_false);
 
-        // init stack
-        stack->size  = size;
+    // reserve pages, the stack grows down and only the touched pages at the top will be committed
+    size = tb_align(tb_max(size, VM86_STACK_MAXN) * sizeof(tb_uint32_t), VM86_MEMORY_PAGE_SIZE) / sizeof(tb_uint32_t);
+    stack->data = (tb_uint32_t*)vm86_memory_reserve(size * sizeof(tb_uint32_t));
+    tb_assert_and_check_return_val(stack->data, tb_false);
 
-        // init top
-        stack->top   = (tb_uint32_t**)esp;
-        *stack->top  = stack->data + size;
-    
-        // ok
-        ok = tb_true;
+    // init stack
+    stack->size  = size;
 
-    } while (0);
+    // init esp
+    stack->esp   = esp;
+    *stack->esp  = vm86_memory_addr(stack->data + size);
 
-    // failed?
-    if (!ok)
-    {
-        // exit it
-        if (stack) vm86_stack_exit((vm86_stack_ref_t)stack);
-        stack = tb_null;
-    }
+    // ok
+    return tb_true;
+}
+tb_void_t vm86_stack_detach(vm86_stack_t* stack)
+{
+    // check
+    tb_assert_and_check_return(stack);
 
-    // ok?
-    return (vm86_stack_ref_t)stack;
+    // release pages
+    if (stack->data) vm86_memory_release(stack->data, stack->size * sizeof(tb_uint32_t));
+
+    // clear stack
+    stack->data = tb_null;
+    stack->size = 0;
 }
 tb_void_t vm86_stack_exit(vm86_stack_ref_t self)
 {
@@ -97,9 +90,8 @@ tb_void_t vm86_stack_exit(vm86_stack_ref_t self)
     vm86_stack_t* stack = (vm86_stack_t*)self;
     tb_assert_and_check_return(stack);
 
-    // exit data
-    if (stack->data) tb_free(stack->data);
-    stack->data = tb_null;
+    // detach stack and release its pages
+    vm86_stack_detach(stack);
 
     // exit it
     tb_free(stack);
@@ -108,13 +100,13 @@ tb_void_t vm86_stack_clear(vm86_stack_ref_t self)
 {
     // check
     vm86_stack_t* stack = (vm86_stack_t*)self;
-    tb_assert_and_check_return(stack && stack->top && stack->data && stack->size);
+    tb_assert_and_check_return(stack && stack->esp && stack->data && stack->size);
 
-    // clear data
-    tb_memset(stack->data, 0, stack->size * sizeof(tb_uint32_t));
+    // clear data, the committed pages will be discarded
+    vm86_memory_discard(stack->data, stack->size * sizeof(tb_uint32_t));
 
     // reset it
-    *stack->top = stack->data + stack->size;
+    *stack->esp = vm86_memory_addr(stack->data + stack->size);
 }
 tb_void_t vm86_stack_top(vm86_stack_ref_t self, tb_uint32_t* pdata, tb_size_t index)
 {
@@ -122,12 +114,12 @@ tb_void_t vm86_stack_top(vm86_stack_ref_t self, tb_uint32_t* pdata, tb_size_t in
     vm86_stack_t* stack = (vm86_stack_t*)self;
     tb_assert_and_check_return(stack && pdata);
 
-    // check
-    tb_assert(stack->top && *stack->top);
-    tb_assert(*stack->top + index < stack->data + stack->size);
+    // the top
+    tb_uint32_t* top = (tb_uint32_t*)vm86_memory_ptr(*stack->esp);
+    tb_assert(top && top + index < stack->data + stack->size);
 
     // save data
-    *pdata = (*stack->top)[index];
+    *pdata = top[index];
 }
 tb_void_t vm86_stack_push(vm86_stack_ref_t self, tb_uint32_t data)
 {
@@ -135,12 +127,8 @@ tb_void_t vm86_stack_push(vm86_stack_ref_t self, tb_uint32_t data)
     vm86_stack_t* stack = (vm86_stack_t*)self;
     tb_assert_and_check_return(stack);
 
-    // check
-    tb_assert(stack->top && *stack->top);
-    tb_assert(*stack->top > stack->data);
-
     // push it
-    *--(*stack->top) = data;
+    vm86_stack_push_inline(stack, data);
 }
 tb_void_t vm86_stack_pop(vm86_stack_ref_t self, tb_uint32_t* pdata)
 {
@@ -148,15 +136,8 @@ tb_void_t vm86_stack_pop(vm86_stack_ref_t self, tb_uint32_t* pdata)
     vm86_stack_t* stack = (vm86_stack_t*)self;
     tb_assert_and_check_return(stack);
 
-    // check
-    tb_assert(stack->top && *stack->top);
-    tb_assert(*stack->top < stack->data + stack->size);
-
-    // save data
-    if (pdata) *pdata = **stack->top;
-
     // pop it
-    (*stack->top)++;
+    vm86_stack_pop_inline(stack, pdata);
 }
 #ifdef __vm_debug__
 tb_void_t vm86_stack_dump(vm86_stack_ref_t self)
@@ -170,7 +151,7 @@ tb_void_t vm86_stack_dump(vm86_stack_ref_t self)
     tb_trace_i("stack: ");
 
     // done
-    tb_uint32_t* top = (*stack->top);
+    tb_uint32_t* top = (tb_uint32_t*)vm86_memory_ptr(*stack->esp);
     tb_uint32_t* end = stack->data + stack->size;
     while (top < end)
     {
@@ -18,25 +18,80 @@
  * @file        text.c
  *
  */
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * trace
+ */
+#define TB_TRACE_MODULE_NAME            "machine_text"
+#define TB_TRACE_MODULE_DEBUG           (0)
+
 /* //////////////////////////////////////////////////////////////////////////////////////
  * includes
  */
 #include "machine.h"
+#include "impl/text.h"
+#include "impl/hash.h"
+#ifdef TB_CONFIG_POSIX_HAVE_MMAP
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
+#ifdef __SSE2__
+#   include <emmintrin.h>
+#endif
 
 /* //////////////////////////////////////////////////////////////////////////////////////
  * types
  */
 
-// the machine text text type
-typedef struct __vm86_text_t
+/* the compile cache entry type
+ *
+ * the code is compared on hit, the different code with the same hash is compiled again.
+ */
+typedef struct __vm86_text_cache_t
+{
+    // the proc
+    vm86_proc_ref_t         proc;
+
+    // the code size
+    tb_size_t               size;
+
+    // the code, it is null if the proc is loaded from the image
+    tb_char_t const*        code;
+
+}vm86_text_cache_t;
+
+// the proc compiling job of the file
+typedef struct __vm86_text_job_t
 {
     // the machine
     vm86_machine_ref_t      machine;
 
-    // the procs
-    tb_hash_map_ref_t       procs;
+    // the proc code, from the line of "xxx proc near" to the line of "xxx endp"
+    tb_char_t const*        code;
 
-}vm86_text_t;
+    // the proc code size
+    tb_size_t               size;
+
+    // the line number of "xxx proc near" in the file
+    tb_size_t               lineno;
+
+    // the code hash
+    tb_uint64_t             hash;
+
+    // has the .data segment?
+    tb_bool_t               has_data;
+
+    // is cached?
+    tb_bool_t               cached;
+
+    // the compiled proc
+    vm86_proc_ref_t         proc;
+
+    // the semaphore to notify the finished job
+    tb_semaphore_ref_t      semaphore;
+
+}vm86_text_job_t;
 
 /* //////////////////////////////////////////////////////////////////////////////////////
  * private implementation
@@ -53,6 +108,310 @@ static tb_void_t vm86_text_proc_exit(tb_element_ref_t func, tb_pointer_t buff)
     // exit it
     vm86_proc_exit(proc);
 }
+static tb_void_t vm86_text_cache_exit(tb_element_ref_t func, tb_pointer_t buff)
+{
+    // check
+    tb_assert_and_check_return(buff);
+
+    // exit the entry, the code is allocated with it and the proc is owned by the procs map
+    vm86_text_cache_t* entry = *((vm86_text_cache_t**)buff);
+    if (entry) tb_free(entry);
+}
+static tb_bool_t vm86_text_cache_name_is(tb_char_t const* code, tb_size_t size, tb_char_t const* name)
+{
+    // check
+    tb_assert(code && name);
+
+    // find "xxx proc near" like the compiler
+    tb_char_t const* p = tb_strnistr(code, size, "proc");
+    tb_check_return_val(p, tb_false);
+
+    // seek the name tail
+    tb_char_t const* t = p - 1;
+    while (t >= code && tb_isspace(*t)) t--;
+    tb_check_return_val(t >= code, tb_false);
+    t++;
+
+    // seek the name head
+    tb_char_t const* h = t - 1;
+    while (h >= code && !tb_isspace(*h)) h--;
+    h++;
+
+    // is this name?
+    tb_size_t n = tb_strlen(name);
+    return (tb_size_t)(t - h) == n && !tb_strncmp(h, name, n);
+}
+static vm86_proc_ref_t vm86_text_cache_get(vm86_text_t* text, tb_uint64_t hash, tb_char_t const* code, tb_size_t size)
+{
+    // check
+    tb_assert(text && text->cache && code);
+
+    // hit the hash?
+    vm86_text_cache_t const* entry = (vm86_text_cache_t const*)tb_hash_map_get(text->cache, &hash);
+    tb_check_return_val(entry && entry->proc && entry->size == size, tb_null);
+
+    // compare the code, or the proc name if the code is loaded from the image
+    if (entry->code) return !tb_memcmp(entry->code, code, size)? entry->proc : tb_null;
+    return vm86_text_cache_name_is(code, size, vm86_proc_name(entry->proc))? entry->proc : tb_null;
+}
+static tb_char_t const* vm86_text_file_map(tb_char_t const* path, tb_size_t* psize, tb_bool_t* pmapped)
+{
+    // check
+    tb_assert(path && psize && pmapped);
+
+#ifdef TB_CONFIG_POSIX_HAVE_MMAP
+    // open file
+    tb_pointer_t    data = MAP_FAILED;
+    tb_int_t        fd = open(path, O_RDONLY);
+    if (fd >= 0)
+    {
+        // map it, the procs are compiled from the mapped pages directly
+        struct stat st;
+        if (!fstat(fd, &st) && st.st_size > 0)
+        {
+            data = mmap(tb_null, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) *psize = (tb_size_t)st.st_size;
+        }
+
+        // close file
+        close(fd);
+    }
+    if (data != MAP_FAILED)
+    {
+        *pmapped = tb_true;
+        return (tb_char_t const*)data;
+    }
+#endif
+
+    // read the whole file
+    tb_byte_t*      data_read = tb_null;
+    tb_file_ref_t   file = tb_file_init(path, TB_FILE_MODE_RO | TB_FILE_MODE_BINARY);
+    do
+    {
+        // check
+        tb_check_break(file);
+
+        // the file size
+        tb_size_t size = (tb_size_t)tb_file_size(file);
+        tb_check_break(size);
+
+        // make data
+        data_read = tb_malloc_bytes(size);
+        tb_assert_and_check_break(data_read);
+
+        // read data
+        tb_size_t read = 0;
+        while (read < size)
+        {
+            tb_long_t real = tb_file_read(file, data_read + read, size - read);
+            if (real > 0) read += real;
+            else break;
+        }
+        if (read != size)
+        {
+            tb_free(data_read);
+            data_read = tb_null;
+            break;
+        }
+
+        // save size
+        *psize = size;
+
+    } while (0);
+
+    // exit file
+    if (file) tb_file_exit(file);
+    file = tb_null;
+
+    // ok?
+    *pmapped = tb_false;
+    return (tb_char_t const*)data_read;
+}
+static tb_void_t vm86_text_file_unmap(tb_char_t const* data, tb_size_t size, tb_bool_t mapped)
+{
+    // check
+    tb_assert_and_check_return(data);
+
+#ifdef TB_CONFIG_POSIX_HAVE_MMAP
+    if (mapped) munmap((tb_pointer_t)data, size);
+    else
+#endif
+    tb_free((tb_pointer_t)data);
+}
+static __tb_inline__ tb_char_t const* vm86_text_file_line(tb_char_t const* p, tb_char_t const* e)
+{
+#ifdef __SSE2__
+    // find '\n' in 16 bytes at once, the most lines of the ida export are short
+    __m128i const lf = _mm_set1_epi8('\n');
+    while (p + 16 <= e)
+    {
+        tb_int_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i const*)p), lf));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 16;
+    }
+#endif
+
+    // find '\n' in the left bytes
+    while (p < e && *p != '\n') p++;
+    return p;
+}
+static __tb_inline__ tb_char_t const* vm86_text_file_candidate(tb_char_t const* p, tb_char_t const* e, tb_size_t* plines)
+{
+    /* find the next candidate of "proc", "endp" and ".data"
+     *
+     * only the first and the fourth characters of the tokens are compared in the lower case,
+     * and '\n' before the candidate is counted for the line number.
+     */
+#ifdef __SSE2__
+    // compare 16 positions at once, the candidates are rare in the instruction lines
+    __m128i const lf    = _mm_set1_epi8('\n');
+    __m128i const lower = _mm_set1_epi8(0x20);
+    while (p + 19 <= e)
+    {
+        __m128i     c0      = _mm_loadu_si128((__m128i const*)p);
+        __m128i     l0      = _mm_or_si128(c0, lower);
+        __m128i     l3      = _mm_or_si128(_mm_loadu_si128((__m128i const*)(p + 3)), lower);
+        __m128i     proc    = _mm_and_si128(_mm_cmpeq_epi8(l0, _mm_set1_epi8('p')), _mm_cmpeq_epi8(l3, _mm_set1_epi8('c')));
+        __m128i     endp    = _mm_and_si128(_mm_cmpeq_epi8(l0, _mm_set1_epi8('e')), _mm_cmpeq_epi8(l3, _mm_set1_epi8('p')));
+        __m128i     data    = _mm_and_si128(_mm_cmpeq_epi8(c0, _mm_set1_epi8('.')), _mm_cmpeq_epi8(l3, _mm_set1_epi8('t')));
+        tb_uint32_t mask    = (tb_uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(proc, endp), data));
+        tb_uint32_t lines   = (tb_uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(c0, lf));
+        if (mask)
+        {
+            // count the lines before the candidate
+            tb_size_t n = __builtin_ctz(mask);
+            *plines += __builtin_popcount(lines & ((1u << n) - 1));
+            return p + n;
+        }
+        *plines += __builtin_popcount(lines);
+        p += 16;
+    }
+#endif
+
+    // find it in the left bytes
+    for (; p + 4 <= e; p++)
+    {
+        tb_char_t c0 = *p | 0x20;
+        tb_char_t c3 = p[3] | 0x20;
+        if ((c0 == 'p' && c3 == 'c') || (c0 == 'e' && c3 == 'p') || (*p == '.' && c3 == 't')) return p;
+        if (*p == '\n') (*plines)++;
+    }
+
+    // no more candidates
+    return e;
+}
+static __tb_inline__ tb_bool_t vm86_text_file_token(tb_char_t const* p, tb_char_t const* e, tb_char_t const* token, tb_size_t size)
+{
+    // the token is the whole word?
+    return (tb_size_t)(e - p) == size && !tb_strnicmp(p, token, size);
+}
+static tb_size_t vm86_text_file_scan(tb_char_t const* code, tb_size_t size, tb_vector_ref_t jobs)
+{
+    // check
+    tb_assert_and_check_return_val(code && size && jobs, 0);
+
+    /* scan the boundaries of the procs
+     *
+     * the proc starts from the line of "xxx proc near" and ends at the line of "xxx endp",
+     * the text between the procs (e.g. the comments of ida) is skipped.
+     *
+     * only the lines of the candidate tokens are parsed, the other lines are skipped by the vector scanning.
+     */
+    vm86_text_job_t     job = {0};
+    tb_char_t const*    p = code;
+    tb_char_t const*    e = code + size;
+    tb_size_t           lines = 0;
+    while (p < e)
+    {
+        // the next candidate
+        tb_char_t const* c = vm86_text_file_candidate(p, e, &lines);
+        tb_check_break(c < e);
+
+        // the line of this candidate, the left candidates of this line are skipped
+        tb_char_t const* b = c;
+        while (b > code && b[-1] != '\n') b--;
+        tb_char_t const* q = vm86_text_file_line(c, e);
+        p = q;
+
+        // the first token
+        while (b < q && tb_isspace(*b)) b++;
+        tb_char_t const* t0 = b;
+        while (b < q && !tb_isspace(*b) && *b != ';') b++;
+        tb_char_t const* t0_end = b;
+        tb_check_continue(t0 < t0_end);
+
+        // the second token
+        while (b < q && tb_isspace(*b)) b++;
+        tb_char_t const* t1 = b;
+        while (b < q && !tb_isspace(*b) && *b != ';') b++;
+        tb_char_t const* t1_end = b;
+
+        // the proc head? "xxx proc near"
+        if (!job.code)
+        {
+            if (vm86_text_file_token(t1, t1_end, "proc", 4))
+            {
+                job.code    = t0;
+                job.lineno  = lines + 1;
+            }
+        }
+        // the proc tail? "xxx endp" or "endp"
+        else if (vm86_text_file_token(t0, t0_end, "endp", 4) || vm86_text_file_token(t1, t1_end, "endp", 4))
+        {
+            // save job
+            job.size = (q < e? q + 1 : q) - job.code;
+            tb_vector_insert_tail(jobs, &job);
+
+            // next proc
+            tb_memset(&job, 0, sizeof(vm86_text_job_t));
+        }
+        // the .data segment?
+        else if (vm86_text_file_token(t0, t0_end, ".data", 5)) job.has_data = tb_true;
+    }
+
+    // the last proc without "endp"
+    if (job.code)
+    {
+        job.size = e - job.code;
+        tb_vector_insert_tail(jobs, &job);
+    }
+
+    // the procs count
+    return tb_vector_size(jobs);
+}
+static tb_void_t vm86_text_job_done(vm86_text_job_t* job)
+{
+    // check
+    tb_assert(job && job->machine && job->code && job->size);
+
+    // compile it
+    job->proc = vm86_proc_init(job->machine, job->code, job->size);
+
+    // trace
+    if (!job->proc) tb_trace_e("compile proc failed at line %lu: %.*s", job->lineno, (tb_int_t)tb_min(job->size, 64), job->code);
+}
+static tb_void_t vm86_text_job_task(tb_thread_pool_worker_ref_t worker, tb_cpointer_t priv)
+{
+    // the job
+    vm86_text_job_t* job = (vm86_text_job_t*)priv;
+    tb_assert_and_check_return(job && job->semaphore);
+
+    // compile it
+    vm86_text_job_done(job);
+
+    // notify it
+    tb_semaphore_post(job->semaphore, 1);
+}
+static tb_long_t vm86_text_job_comp(tb_iterator_ref_t iterator, tb_cpointer_t ltem, tb_cpointer_t rtem)
+{
+    // check
+    tb_assert(ltem && rtem);
+
+    // the larger proc is compiled first
+    tb_size_t lsize = ((vm86_text_job_t const*)ltem)->size;
+    tb_size_t rsize = ((vm86_text_job_t const*)rtem)->size;
+    return lsize > rsize? -1 : (lsize < rsize);
+}
 
 /* //////////////////////////////////////////////////////////////////////////////////////
  * implementation
@@ -78,6 +437,10 @@ vm86_text_ref_t vm86_text_init(vm86_machine_ref_t machine)
         text->procs = tb_hash_map_init(8, tb_element_str(tb_true), tb_element_ptr(vm86_text_proc_exit, tb_null));
         tb_assert_and_check_break(text->procs);
 
+        // init cache, the procs are owned by the procs map
+        text->cache = tb_hash_map_init(8, tb_element_mem(sizeof(tb_uint64_t), tb_null, tb_null), tb_element_ptr(vm86_text_cache_exit, tb_null));
+        tb_assert_and_check_break(text->cache);
+
         // ok
         ok = tb_true;
 
@@ -100,6 +463,10 @@ tb_void_t vm86_text_exit(vm86_text_ref_t self)
     vm86_text_t* text = (vm86_text_t*)self;
     tb_assert_and_check_return(text);
 
+    // exit cache
+    if (text->cache) tb_hash_map_exit(text->cache);
+    text->cache = tb_null;
+
     // exit procs
     if (text->procs) tb_hash_map_exit(text->procs);
     text->procs = tb_null;
@@ -111,23 +478,32 @@ vm86_proc_ref_t vm86_text_compile(vm86_text_ref_t self, tb_char_t const* code, t
 {
     // check
     vm86_text_t* text = (vm86_text_t*)self;
-    tb_assert_and_check_return_val(text && text->machine && text->procs && code && size, tb_null);
+    tb_assert_and_check_return_val(text && text->machine && text->procs && text->cache && code && size, tb_null);
+
+    // the code hash, the proc name is a part of the code
+    tb_uint64_t hash = vm86_hash_fnv64((tb_byte_t const*)code, size);
+
+    // hit the cache with the same code? return the compiled proc directly
+    vm86_proc_ref_t proc = vm86_text_cache_get(text, hash, code, size);
+    if (proc)
+    {
+        text->cache_hits++;
+        return proc;
+    }
+
+    // miss
+    text->cache_misses++;
 
     // done
-    tb_bool_t       ok = tb_false;
-    vm86_proc_ref_t proc = tb_null;
+    tb_bool_t ok = tb_false;
     do
     {
         // make proc
         proc = vm86_proc_init(text->machine, code, size);
         tb_assert_and_check_break(proc);
 
-        // the proc name
-        tb_char_t const* name = vm86_proc_name(proc);
-        tb_assert_and_check_break(name);
-
         // save proc
-        tb_hash_map_insert(text->procs, name, proc);
+        if (!vm86_text_insert(text, proc, code, size)) break;
 
         // ok
         ok = tb_true;
@@ -145,6 +521,193 @@ vm86_proc_ref_t vm86_text_compile(vm86_text_ref_t self, tb_char_t const* code, t
     // ok?
     return proc;
 }
+tb_bool_t vm86_text_compile_file(vm86_text_ref_t self, tb_char_t const* path)
+{
+    // check
+    vm86_text_t* text = (vm86_text_t*)self;
+    tb_assert_and_check_return_val(text && text->machine && text->procs && text->cache && path, tb_false);
+
+    // done
+    tb_bool_t               ok = tb_false;
+    tb_char_t const*        code = tb_null;
+    tb_size_t               size = 0;
+    tb_bool_t               mapped = tb_false;
+    tb_vector_ref_t         jobs = tb_null;
+    vm86_text_job_t**       tasks = tb_null;
+    tb_semaphore_ref_t      semaphore = tb_null;
+    tb_thread_pool_ref_t    pool = tb_null;
+    do
+    {
+        // map the file
+        code = vm86_text_file_map(path, &size, &mapped);
+        if (!code)
+        {
+            tb_trace_e("open %s failed!", path);
+            break;
+        }
+
+        // init jobs
+        jobs = tb_vector_init(0, tb_element_mem(sizeof(vm86_text_job_t), tb_null, tb_null));
+        tb_assert_and_check_break(jobs);
+
+        // scan the procs
+        tb_size_t count = vm86_text_file_scan(code, size, jobs);
+        tb_check_break(count);
+
+        // init semaphore
+        semaphore = tb_semaphore_init(0);
+        tb_assert_and_check_break(semaphore);
+
+        // init tasks
+        tasks = tb_nalloc0_type(count, vm86_text_job_t*);
+        tb_assert_and_check_break(tasks);
+
+        /* compile the procs with the .data segment in order first
+         *
+         * the .data chunks are added in the order of the file, so the layout of the .data is deterministic,
+         * and the other procs only read the .data names after it, so they can be compiled in parallel.
+         */
+        tb_size_t           i = 0;
+        tb_size_t           tasks_count = 0;
+        vm86_text_job_t*    items = (vm86_text_job_t*)tb_vector_data(jobs);
+        for (i = 0; i < count; i++)
+        {
+            // init job
+            vm86_text_job_t* job = &items[i];
+            job->machine    = text->machine;
+            job->semaphore  = semaphore;
+            job->hash       = vm86_hash_fnv64((tb_byte_t const*)job->code, job->size);
+
+            // hit the cache with the same code? use the compiled proc directly
+            job->proc = vm86_text_cache_get(text, job->hash, job->code, job->size);
+            if (job->proc)
+            {
+                text->cache_hits++;
+                job->cached = tb_true;
+                continue ;
+            }
+
+            // miss
+            text->cache_misses++;
+
+            // compile it now if it has the .data segment, otherwise compile it later in parallel
+            if (job->has_data) vm86_text_job_done(job);
+            else tasks[tasks_count++] = job;
+        }
+
+        // compile the larger procs first, the wall time is close to the time of the largest proc
+        tb_array_iterator_t array_iterator;
+        tb_sort_all(tb_array_iterator_init_ptr(&array_iterator, (tb_pointer_t*)tasks, tasks_count), vm86_text_job_comp);
+
+        /* init the private thread pool
+         *
+         * the global thread pool is not used, because we may be called from its worker,
+         * and the posted tasks will never be run if all workers are waiting for them.
+         */
+        if (tasks_count > 1) pool = tb_thread_pool_init(0, 0);
+
+        // post the tasks to the thread pool, the last task is compiled on the current thread
+        tb_size_t posted = 0;
+        for (i = 0; i < tasks_count; i++)
+        {
+            if (pool && i + 1 < tasks_count && tb_thread_pool_task_post(pool, "vm86_text_compile", vm86_text_job_task, tb_null, tasks[i], tb_false)) 
+                posted++;
+            else vm86_text_job_done(tasks[i]);
+        }
+
+        // wait the posted tasks
+        while (posted && tb_semaphore_wait(semaphore, -1) > 0) posted--;
+        tb_assert_and_check_break(!posted);
+
+        // save the procs in order, the proc with the same name is replaced by the last one
+        ok = tb_true;
+        for (i = 0; i < count; i++)
+        {
+            // the job
+            vm86_text_job_t* job = &items[i];
+            if (job->cached) continue ;
+
+            // failed?
+            if (!job->proc || !vm86_text_insert(text, job->proc, job->code, job->size))
+            {
+                if (job->proc) vm86_proc_exit(job->proc);
+                ok = tb_false;
+            }
+            job->proc = tb_null;
+        }
+
+    } while (0);
+
+    // exit the procs which are not saved
+    if (jobs)
+    {
+        tb_for_all_if (vm86_text_job_t*, job, jobs, job)
+        {
+            if (job->proc && !job->cached) vm86_proc_exit(job->proc);
+        }
+        tb_vector_exit(jobs);
+    }
+    jobs = tb_null;
+
+    // exit tasks
+    if (tasks) tb_free(tasks);
+    tasks = tb_null;
+
+    // exit the thread pool
+    if (pool) tb_thread_pool_exit(pool);
+    pool = tb_null;
+
+    // exit semaphore
+    if (semaphore) tb_semaphore_exit(semaphore);
+    semaphore = tb_null;
+
+    // unmap the file
+    if (code) vm86_text_file_unmap(code, size, mapped);
+    code = tb_null;
+
+    // ok?
+    return ok;
+}
+tb_bool_t vm86_text_insert(vm86_text_t* text, vm86_proc_ref_t proc, tb_char_t const* code, tb_size_t size)
+{
+    // check
+    tb_assert_and_check_return_val(text && text->procs && text->cache && proc, tb_false);
+
+    // the proc name
+    tb_char_t const* name = vm86_proc_name(proc);
+    tb_assert_and_check_return_val(name, tb_false);
+
+    // make the cache entry with the copied code
+    vm86_text_cache_t* entry = (vm86_text_cache_t*)tb_malloc_bytes(sizeof(vm86_text_cache_t) + (code? size : 0));
+    tb_assert_and_check_return_val(entry, tb_false);
+    entry->proc = proc;
+    entry->size = size;
+    entry->code = tb_null;
+    if (code)
+    {
+        tb_memcpy(entry + 1, code, size);
+        entry->code = (tb_char_t const*)(entry + 1);
+    }
+
+    // the proc with the same name will be replaced, remove it from the cache first if the entry is its own
+    vm86_proc_ref_t proc_old = (vm86_proc_ref_t)tb_hash_map_get(text->procs, name);
+    if (proc_old)
+    {
+        tb_uint64_t                 hash_old = vm86_proc_hash(proc_old);
+        vm86_text_cache_t const*    entry_old = (vm86_text_cache_t const*)tb_hash_map_get(text->cache, &hash_old);
+        if (entry_old && entry_old->proc == proc_old) tb_hash_map_remove(text->cache, &hash_old);
+    }
+
+    // save proc
+    tb_hash_map_insert(text->procs, name, proc);
+
+    // save it to the cache, the entry of the other code with the same hash is replaced
+    tb_uint64_t hash = vm86_proc_hash(proc);
+    tb_hash_map_insert(text->cache, &hash, entry);
+
+    // ok
+    return tb_true;
+}
 vm86_proc_ref_t vm86_text_proc(vm86_text_ref_t self, tb_char_t const* name)
 {
     // check
@@ -154,4 +717,14 @@ vm86_proc_ref_t vm86_text_proc(vm86_text_ref_t self, tb_char_t const* name)
     // find proc
     return (vm86_proc_ref_t)tb_hash_map_get(text->procs, name);
 }
+tb_void_t vm86_text_cache_stat(vm86_text_ref_t self, tb_size_t* hits, tb_size_t* misses)
+{
+    // check
+    vm86_text_t* text = (vm86_text_t*)self;
+    tb_assert_and_check_return(text);
+
+    // save the hits and misses
+    if (hits) *hits = text->cache_hits;
+    if (misses) *misses = text->cache_misses;
+}
 
@@ -57,14 +57,38 @@ vm86_text_ref_t             vm86_text_init(vm86_machine_ref_t machine);
 tb_void_t                   vm86_text_exit(vm86_text_ref_t text);
 
 /*! compile proc 
+ *
+ * the compiled procs are cached by the hash of the code (including the proc name),
+ * so compiling the same code again will return the cached proc directly without parsing it.
  *
  * @param text              the text
  * @param code              the proc code
+ * @param size              the proc code size
  *
  * @return                  the proc 
  */
 vm86_proc_ref_t             vm86_text_compile(vm86_text_ref_t text, tb_char_t const* code, tb_size_t size);
 
+/*! compile all procs of the given file
+ *
+ * the file is mapped and the procs from the line of "xxx proc near" to the line of "xxx endp" are compiled,
+ * e.g. the export of idc/export_func.idc which concatenates hundreds of procs.
+ *
+ * the procs with the .data segment are compiled in the order of the file first, so the layout of the .data is deterministic,
+ * and the other procs are compiled in parallel on a private thread pool, the larger procs are compiled first.
+ * it can be called from the worker of the global thread pool, because it never waits for the tasks of the global thread pool.
+ * the compiled procs are saved in the order of the file, so the proc with the same name is replaced by the last one.
+ *
+ * @note the machine should be locked as vm86_text_compile(),
+ * the compiled procs may be executed meanwhile because the function slots are added under their own lock and never moved.
+ *
+ * @param text              the text
+ * @param path              the file path
+ *
+ * @return                  tb_true if all procs are compiled, the compiled procs are saved even if some procs are failed
+ */
+tb_bool_t                   vm86_text_compile_file(vm86_text_ref_t text, tb_char_t const* path);
+
 /*! get the compiled proc 
  *
  * @param text              the text
@@ -74,6 +98,14 @@ vm86_proc_ref_t             vm86_text_compile(vm86_text_ref_t text, tb_char_t co
  */
 vm86_proc_ref_t             vm86_text_proc(vm86_text_ref_t text, tb_char_t const* name);
 
+/*! get the statistics of the compile cache
+ *
+ * @param text              the text
+ * @param hits              the cache hits, optional
+ * @param misses            the cache misses, optional
+ */
+tb_void_t                   vm86_text_cache_stat(vm86_text_ref_t text, tb_size_t* hits, tb_size_t* misses);
+
 /* //////////////////////////////////////////////////////////////////////////////////////
  * extern
  */
@@ -0,0 +1,195 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        trace.c
+ *
+ */
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * trace
+ */
+#define TB_TRACE_MODULE_NAME            "context_trace"
+#define TB_TRACE_MODULE_DEBUG           (0)
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "impl/trace.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * private implementation
+ */
+static tb_bool_t vm86_trace_writ(tb_file_ref_t file, tb_byte_t const* data, tb_size_t size)
+{
+    // write all data
+    tb_byte_t const*    p = data;
+    tb_byte_t const*    e = data + size;
+    while (p < e)
+    {
+        tb_long_t real = tb_file_writ(file, p, e - p);
+        if (real > 0) p += real;
+        else break;
+    }
+
+    // ok?
+    return p == e;
+}
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * implementation
+ */
+vm86_trace_t* vm86_trace_init(tb_size_t maxn)
+{
+    // check
+    tb_assert_and_check_return_val(maxn, tb_null);
+
+    // align the records count to the power of 2
+    tb_size_t count = 1;
+    while (count < maxn) count <<= 1;
+
+    // done
+    tb_bool_t       ok = tb_false;
+    vm86_trace_t*   trace = tb_null;
+    do
+    {
+        // make trace
+        trace = tb_malloc0_type(vm86_trace_t);
+        tb_assert_and_check_break(trace);
+
+        // make records
+        trace->records = tb_nalloc0_type(count, vm86_trace_record_t);
+        tb_assert_and_check_break(trace->records);
+
+        // init mask
+        trace->mask = count - 1;
+
+        // init head
+        tb_atomic_set(&trace->head, 0);
+
+        // ok
+        ok = tb_true;
+
+    } while (0);
+
+    // failed?
+    if (!ok)
+    {
+        // exit it
+        if (trace) vm86_trace_exit(trace);
+        trace = tb_null;
+    }
+
+    // ok?
+    return trace;
+}
+tb_void_t vm86_trace_exit(vm86_trace_t* trace)
+{
+    // check
+    tb_assert_and_check_return(trace);
+
+    // exit records
+    if (trace->records) tb_free(trace->records);
+    trace->records = tb_null;
+
+    // exit it
+    tb_free(trace);
+}
+tb_size_t vm86_trace_read(vm86_trace_t* trace, vm86_trace_record_t* records, tb_size_t maxn)
+{
+    // check
+    tb_assert_and_check_return_val(trace && trace->records && records, 0);
+
+    // the newest records range
+    tb_size_t size  = trace->mask + 1;
+    tb_size_t head  = (tb_size_t)tb_atomic_get(&trace->head);
+    tb_size_t count = tb_min(head, size);
+    if (count > maxn) count = maxn;
+    tb_check_return_val(count, 0);
+
+    // copy the records
+    tb_size_t start = head - count;
+    tb_size_t index = 0;
+    for (index = 0; index < count; index++)
+        records[index] = trace->records[(start + index) & trace->mask];
+
+    // drop the records which may be overwritten by the writer while copying
+    head = (tb_size_t)tb_atomic_get(&trace->head);
+    if (head > size && head - size > start)
+    {
+        // the dropped count
+        tb_size_t drop = head - size - start;
+        if (drop >= count) return 0;
+
+        // move the left records
+        tb_memmov(records, records + drop, (count - drop) * sizeof(vm86_trace_record_t));
+        count -= drop;
+    }
+
+    // ok
+    return count;
+}
+tb_bool_t vm86_trace_save(vm86_trace_t* trace, tb_char_t const* path)
+{
+    // check
+    tb_assert_and_check_return_val(trace && path, tb_false);
+
+    // done
+    tb_bool_t               ok = tb_false;
+    tb_file_ref_t           file = tb_null;
+    vm86_trace_record_t*    records = tb_null;
+    do
+    {
+        // read the newest records
+        records = tb_nalloc_type(trace->mask + 1, vm86_trace_record_t);
+        tb_assert_and_check_break(records);
+
+        tb_size_t count = vm86_trace_read(trace, records, trace->mask + 1);
+
+        // init header
+        vm86_trace_header_t header;
+        tb_memset(&header, 0, sizeof(header));
+        tb_strlcpy(header.magic, VM86_TRACE_MAGIC, sizeof(header.magic));
+        header.version  = VM86_TRACE_VERSION;
+        header.count    = (tb_uint32_t)count;
+
+        // write header
+        file = tb_file_init(path, TB_FILE_MODE_WO | TB_FILE_MODE_CREAT | TB_FILE_MODE_TRUNC | TB_FILE_MODE_BINARY);
+        tb_assert_and_check_break(file);
+
+        if (!vm86_trace_writ(file, (tb_byte_t const*)&header, sizeof(header))) break;
+
+        // write records
+        if (count && !vm86_trace_writ(file, (tb_byte_t const*)records, count * sizeof(vm86_trace_record_t))) break;
+
+        // trace
+        tb_trace_d("save: %s, records: %lu", path, count);
+
+        // ok
+        ok = tb_true;
+
+    } while (0);
+
+    // exit file
+    if (file) tb_file_exit(file);
+    file = tb_null;
+
+    // exit records
+    if (records) tb_free(records);
+    records = tb_null;
+
+    // ok?
+    return ok;
+}
@@ -0,0 +1,121 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        trace.h
+ *
+ */
+#ifndef VM86_TRACE_H
+#define VM86_TRACE_H
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "prefix.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_enter__
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * macros
+ */
+
+/// the magic of the trace file
+#define VM86_TRACE_MAGIC            "vm86trc"
+
+/// the version of the trace file
+#define VM86_TRACE_VERSION          (1)
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+/// the control flow after executing the traced instruction
+typedef enum __vm86_trace_flow_e
+{
+    VM86_TRACE_FLOW_NEXT        = 0     //!< go to the next instruction
+,   VM86_TRACE_FLOW_JUMP        = 1     //!< jump to the other instruction of this proc
+,   VM86_TRACE_FLOW_END         = 2     //!< end or leave this proc
+
+}vm86_trace_flow_e;
+
+/*! the trace record type, 32 bytes
+ *
+ * the register values are read after executing the instruction,
+ * so value0 is the result of the most instructions which write r0.
+ */
+typedef struct __vm86_trace_record_t
+{
+    /// the proc id, the low 32-bits of the fnv64 hash of the proc name
+    tb_uint32_t             proc;
+
+    /// the instruction index in the proc
+    tb_uint32_t             index;
+
+    /// the opcode
+    tb_uint8_t              opcode;
+
+    /// the control flow, vm86_trace_flow_e
+    tb_uint8_t              flow;
+
+    /// the register index of r0
+    tb_uint8_t              r0;
+
+    /// the register index of r1
+    tb_uint8_t              r1;
+
+    /// the value of r0
+    tb_uint32_t             value0;
+
+    /// the value of r1
+    tb_uint32_t             value1;
+
+    /// the value of esp
+    tb_uint32_t             esp;
+
+    /// the value of eax
+    tb_uint32_t             eax;
+
+    /// the value of edx
+    tb_uint32_t             edx;
+
+}vm86_trace_record_t, *vm86_trace_record_ref_t;
+
+/*! the trace file header type
+ *
+ * the records follow the header from the oldest to the newest, in the host byte order.
+ */
+typedef struct __vm86_trace_header_t
+{
+    /// the magic, VM86_TRACE_MAGIC
+    tb_char_t               magic[8];
+
+    /// the version, VM86_TRACE_VERSION
+    tb_uint32_t             version;
+
+    /// the records count
+    tb_uint32_t             count;
+
+}vm86_trace_header_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * extern
+ */
+__tb_extern_c_leave__
+
+#endif
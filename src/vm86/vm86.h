@@ -24,7 +24,11 @@
 /* //////////////////////////////////////////////////////////////////////////////////////
  * includes
  */
+#include "context.h"
+#include "memory.h"
 #include "machine.h"
+#include "machine_pool.h"
+#include "image.h"
 
 #endif
 
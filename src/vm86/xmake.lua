@@ -19,6 +19,12 @@ target("vm86")
     add_headerfiles("../(vm86/**.h)|**/impl/**.h")
     add_headerfiles("$(buildir)/$(plat)/$(arch)/$(mode)/vm86.config.h", {prefixdir = "vm86"})
 
+    -- the lazy flags are used by the c code translated by vm86c
+    add_headerfiles("../(vm86/impl/flags.h)")
+
+    -- add options
+    add_options("hugepage", "jit", "profile")
+
     -- add packages
     add_packages("tbox")
 
@@ -0,0 +1,1307 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        main.c
+ *
+ */
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * trace
+ */
+#define TB_TRACE_MODULE_NAME            "vm86c"
+#define TB_TRACE_MODULE_DEBUG           (0)
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "vm86/vm86.h"
+#include "vm86/instruction.h"
+#include "vm86/impl/proc.h"
+#include "vm86/impl/data.h"
+#include "vm86/impl/flags.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * macros
+ */
+
+/* the code address of the translated proc
+ *
+ * the instruction addresses are replaced by ((proc + 1) << 20) | index in the translated code and .data,
+ * so the indirect jumps can be dispatched by switch and the proc cannot be larger than 1M instructions.
+ */
+#define VM86C_CODE(proc, index)         ((((tb_uint32_t)(proc) + 1) << 20) | (tb_uint32_t)(index))
+
+// the maximum instructions count of the proc
+#define VM86C_INDEX_MAXN                (1 << 20)
+
+// the maximum procs count
+#define VM86C_PROCS_MAXN                (4095)
+
+// the instruction is the target of the direct jump
+#define VM86C_MARK_TARGET               (1)
+
+// the instruction address is taken by the .data or the instruction value
+#define VM86C_MARK_ADDRESS              (2)
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+// the translator type
+typedef struct __vm86c_t
+{
+    // the machine
+    vm86_machine_ref_t      machine;
+
+    // the .data
+    vm86_data_t*            data;
+
+    // the compiled procs in order
+    tb_vector_ref_t         procs;
+
+    // the module name
+    tb_char_t               module[256];
+
+    // the output source
+    tb_buffer_t             source;
+
+    // the output header
+    tb_buffer_t             header;
+
+    // the body of the current proc
+    tb_buffer_t             body;
+
+    // the label marks of the current proc
+    tb_byte_t*              marks;
+
+    // the called functions of the current proc, name => the index of the slot variable
+    tb_hash_map_ref_t       callees;
+
+    // the slot variables of the called functions of the current proc
+    tb_buffer_t             slots;
+
+    // the current proc uses the .data base?
+    tb_bool_t               uses_data;
+
+    // the current proc uses the machine?
+    tb_bool_t               uses_machine;
+
+    // the current proc uses the end label?
+    tb_bool_t               uses_end;
+
+    // the current proc has the indirect jumps?
+    tb_bool_t               has_indirect;
+
+}vm86c_t;
+
+// the .data chunk type
+typedef struct __vm86c_chunk_t
+{
+    // the name
+    tb_char_t const*        name;
+
+    // the offset
+    tb_uint32_t             offset;
+
+    // the size
+    tb_uint32_t             size;
+
+}vm86c_chunk_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * globals
+ */
+
+// the opcode names, index: opcode
+#define VM86C_OPCODE_NAME(o, n)         ,   #n
+static tb_char_t const* g_opcode_names[] =
+{
+    "none"
+    VM86_OPCODE_LIST(VM86C_OPCODE_NAME)
+};
+#undef VM86C_OPCODE_NAME
+
+// the prelude of the translated source
+static tb_char_t const g_prelude[] =
+    "/* //////////////////////////////////////////////////////////////////////////////////////\n"
+    " * macros\n"
+    " */\n"
+    "\n"
+    "// the guest memory of the given address\n"
+    "#define VM86C_U32(addr)                 (*((tb_uint32_t*)vm86_memory_ptr(addr)))\n"
+    "\n"
+    "// the code address of the translated proc\n"
+    "#define VM86C_CODE(proc, index)         ((((tb_uint32_t)(proc) + 1) << 20) | (tb_uint32_t)(index))\n"
+    "\n"
+    "// the esp register\n"
+    "#define VM86C_ESP                       (registers[VM86_REGISTER_ESP].u32)\n"
+    "\n"
+    "// the eflags register\n"
+    "#define VM86C_EFLAGS                    (registers[VM86_REGISTER_EFLAGS].u32)\n"
+    "\n"
+    "// push the value to the guest stack\n"
+    "#define VM86C_PUSH(value)               do { tb_uint32_t __v = (value); VM86C_ESP -= 4; VM86C_U32(VM86C_ESP) = __v; } while (0)\n"
+    "\n"
+    "// pop the value from the guest stack\n"
+    "#define VM86C_POP(value)                do { tb_uint32_t __v = VM86C_U32(VM86C_ESP); VM86C_ESP += 4; (value) = __v; } while (0)\n"
+    "\n"
+    "// test the condition code\n"
+    "#define VM86C_COND(cond)                vm86_flags_cond(&flags, &VM86C_EFLAGS, cond)\n"
+    "\n"
+    "/* call the host function of the given slot\n"
+    " *\n"
+    " * the slot is resolved once at the proc entry and the function is loaded from it at each call,\n"
+    " * so it can be bound or replaced after registering without looking up the name again,\n"
+    " * and the registers and the eflags are saved to the context because the function may read or modify them.\n"
+    " */\n"
+    "#define VM86C_CALL(slot) \\\n"
+    "do \\\n"
+    "{ \\\n"
+    "    vm86_machine_func_t __func = vm86_machine_function_at((vm86_machine_t*)machine, slot); \\\n"
+    "    tb_assert(__func); \\\n"
+    "    vm86_flags_eflags(&flags, &VM86C_EFLAGS); \\\n"
+    "    tb_memcpy(vm86_context_registers(context), registers, sizeof(registers)); \\\n"
+    "    __func(context); \\\n"
+    "    tb_memcpy(registers, vm86_context_registers(context), sizeof(registers)); \\\n"
+    "\\\n"
+    "} while (0)\n"
+    "\n";
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * private implementation
+ */
+static tb_void_t vm86c_printf(tb_buffer_ref_t buffer, tb_char_t const* format, ...)
+{
+    // format it
+    tb_char_t   line[8192];
+    tb_va_list_t args;
+    tb_va_start(args, format);
+    tb_long_t   size = tb_vsnprintf(line, sizeof(line), format, args);
+    tb_va_end(args);
+
+    // append it
+    if (size > 0) tb_buffer_memncat(buffer, (tb_byte_t const*)line, tb_min((tb_size_t)size, sizeof(line) - 1));
+}
+static tb_byte_t* vm86c_file_read(tb_char_t const* path, tb_size_t* psize)
+{
+    // done
+    tb_bool_t       ok = tb_false;
+    tb_byte_t*      data = tb_null;
+    tb_file_ref_t   file = tb_file_init(path, TB_FILE_MODE_RO | TB_FILE_MODE_BINARY);
+    do
+    {
+        // check
+        tb_check_break(file);
+
+        // the file size
+        tb_size_t size = (tb_size_t)tb_file_size(file);
+        tb_check_break(size);
+
+        // make data
+        data = tb_malloc_bytes(size);
+        tb_assert_and_check_break(data);
+
+        // read data
+        tb_size_t read = 0;
+        while (read < size)
+        {
+            tb_long_t real = tb_file_read(file, data + read, size - read);
+            if (real > 0) read += real;
+            else break;
+        }
+        tb_check_break(read == size);
+
+        // save size
+        *psize = size;
+
+        // ok
+        ok = tb_true;
+
+    } while (0);
+
+    // failed? exit data
+    if (!ok && data)
+    {
+        tb_free(data);
+        data = tb_null;
+    }
+
+    // exit file
+    if (file) tb_file_exit(file);
+    file = tb_null;
+
+    // ok?
+    return data;
+}
+static tb_bool_t vm86c_file_writ(tb_char_t const* path, tb_buffer_ref_t buffer)
+{
+    // init file
+    tb_file_ref_t file = tb_file_init(path, TB_FILE_MODE_WO | TB_FILE_MODE_CREAT | TB_FILE_MODE_TRUNC | TB_FILE_MODE_BINARY);
+    tb_check_return_val(file, tb_false);
+
+    // write it
+    tb_byte_t const*    p = tb_buffer_data(buffer);
+    tb_byte_t const*    e = p + tb_buffer_size(buffer);
+    while (p < e)
+    {
+        tb_long_t real = tb_file_writ(file, p, e - p);
+        if (real > 0) p += real;
+        else break;
+    }
+
+    // exit file
+    tb_file_exit(file);
+
+    // ok?
+    return p == e;
+}
+static tb_void_t vm86c_name(tb_char_t* name, tb_size_t maxn, tb_char_t const* cstr)
+{
+    // make the c identifier, the other characters are replaced by '_'
+    tb_size_t i = 0;
+    for (i = 0; i + 1 < maxn && cstr[i]; i++) name[i] = tb_isalpha(cstr[i]) || tb_isdigit(cstr[i])? cstr[i] : '_';
+    name[i] = '\0';
+}
+static tb_bool_t vm86c_compile(vm86c_t* c, tb_char_t const* code, tb_size_t size)
+{
+    // the text
+    vm86_text_ref_t text = vm86_machine_text(c->machine);
+    tb_assert_and_check_return_val(text, tb_false);
+
+    /* compile the procs one by one
+     *
+     * the proc starts from the line of "xxx proc near" and ends at the line of "xxx endp"
+     */
+    tb_bool_t           ok = tb_true;
+    tb_char_t const*    head = tb_null;
+    tb_char_t const*    p = code;
+    tb_char_t const*    e = code + size;
+    while (p < e && ok)
+    {
+        // the line
+        tb_char_t const* line = p;
+        while (p < e && *p != '\n') p++;
+        if (p < e) p++;
+
+        // the proc head?
+        if (!head)
+        {
+            tb_char_t const* proc = tb_strnistr(line, p - line, "proc");
+            if (proc && tb_strnistr(proc, p - proc, "near")) head = line;
+        }
+        // the proc tail?
+        else if (tb_strnistr(line, p - line, "endp"))
+        {
+            // compile it
+            vm86_proc_t* proc = (vm86_proc_t*)vm86_text_compile(text, head, p - head);
+            if (proc && proc->instructions_count < VM86C_INDEX_MAXN && tb_vector_size(c->procs) < VM86C_PROCS_MAXN)
+            {
+                // trace
+                tb_trace_d("compile: %s, instructions: %lu", proc->name, proc->instructions_count);
+
+                // save it
+                tb_vector_insert_tail(c->procs, proc);
+            }
+            else
+            {
+                // trace
+                tb_trace_e("compile proc failed at: %.*s", (tb_int_t)(p - head > 64? 64 : p - head), head);
+                ok = tb_false;
+            }
+
+            // next proc
+            head = tb_null;
+        }
+    }
+
+    // ok?
+    return ok;
+}
+static tb_bool_t vm86c_code(vm86c_t* c, tb_uint32_t addr, tb_size_t* pproc, tb_size_t* pindex)
+{
+    // find the proc of this instruction address
+    tb_size_t index = 0;
+    tb_for_all_if (vm86_proc_t*, proc, c->procs, proc)
+    {
+        // in this proc?
+        tb_uint32_t offset = addr - vm86_memory_addr(proc->instructions);
+        if (offset < proc->instructions_count * sizeof(vm86_instruction_t) && !(offset % sizeof(vm86_instruction_t)))
+        {
+            if (pproc) *pproc = index;
+            if (pindex) *pindex = offset / sizeof(vm86_instruction_t);
+            return tb_true;
+        }
+        index++;
+    }
+
+    // not found
+    return tb_false;
+}
+static tb_char_t const* vm86c_value(vm86c_t* c, tb_uint32_t value, tb_size_t reloc, tb_char_t* data, tb_size_t maxn)
+{
+    // the relocation
+    tb_size_t proc = 0;
+    tb_size_t index = 0;
+    tb_uint32_t base = vm86_memory_addr(c->data->data);
+    if (reloc == VM86_RELOC_DATA && value >= base && value < base + c->data->base)
+    {
+        // the .data address: data + offset
+        tb_snprintf(data, maxn, "(data + %#xU)", value - base);
+        c->uses_data = tb_true;
+    }
+    else if (reloc == VM86_RELOC_CODE && vm86c_code(c, value, &proc, &index))
+    {
+        // the code address
+        tb_snprintf(data, maxn, "VM86C_CODE(%lu, %lu)", proc, index);
+    }
+    else
+    {
+        // trace
+        if (reloc != VM86_RELOC_NONE) tb_trace_w("unknown address: %#x", value);
+
+        // the number
+        tb_snprintf(data, maxn, "%#xU", value);
+    }
+
+    // ok
+    return data;
+}
+static tb_size_t vm86c_opcode(vm86_instruction_ref_t instruction)
+{
+    // the head of the superinstruction executes the same as the original instruction, the others are kept in place
+#define VM86C_UNFUSE(op, o0, n0, o1, n1) case VM86_OPCODE_##o0##_##o1: return VM86_OPCODE_##o0;
+#define VM86C_NOFLAGS(op, o, n) case VM86_OPCODE_##o##_8_NF: return VM86_OPCODE_##o##_8; case VM86_OPCODE_##o##_16_NF: return VM86_OPCODE_##o##_16; case VM86_OPCODE_##o##_32_NF: return VM86_OPCODE_##o##_32;
+    switch (instruction->opcode)
+    {
+    case VM86_OPCODE_PUSH_EBP_MOV_EBP_ESP:      return VM86_OPCODE_PUSH_R0;
+    case VM86_OPCODE_MOV_ESP_EBP_POP_EBP_RETN:  return VM86_OPCODE_MOV_R0_R1_32;
+    case VM86_OPCODE_PUSH_R0_CALL:              return VM86_OPCODE_PUSH_R0;
+    case VM86_OPCODE_PUSH_V0_CALL:              return VM86_OPCODE_PUSH_V0;
+    case VM86_OPCODE_JXX_TABLE_R0:              return VM86_OPCODE_JXX_V0$R0_MUL_V1$;
+    VM86_OPCODE_FUSED_LIST(_, VM86C_UNFUSE)
+    VM86_OPCODE_NOFLAGS_LIST(_, VM86C_NOFLAGS)
+    default:                                    return instruction->opcode;
+    }
+#undef VM86C_UNFUSE
+#undef VM86C_NOFLAGS
+}
+static tb_bool_t vm86c_noflags(vm86_instruction_ref_t instruction)
+{
+    // is the flag-free variant? the lazy flags are not recorded
+#define VM86C_NOFLAGS(op, o, n) case VM86_OPCODE_##o##_8_NF: case VM86_OPCODE_##o##_16_NF: case VM86_OPCODE_##o##_32_NF: return tb_true;
+    switch (instruction->opcode)
+    {
+    VM86_OPCODE_NOFLAGS_LIST(_, VM86C_NOFLAGS)
+    default: return tb_false;
+    }
+#undef VM86C_NOFLAGS
+}
+static tb_size_t vm86c_width(tb_size_t opcode, tb_size_t opcode_8)
+{
+    // the width of the width-specialized opcode, the 8, 16 and 32-bit variants are adjacent
+    if (opcode == opcode_8) return 8;
+    else if (opcode == opcode_8 + 1) return 16;
+    else if (opcode == opcode_8 + 2) return 32;
+    return 0;
+}
+static tb_void_t vm86c_mark(vm86c_t* c, vm86_proc_t* proc, tb_size_t proc_index)
+{
+    // clear marks
+    tb_memset(c->marks, 0, proc->instructions_count);
+    c->has_indirect = tb_false;
+
+    // mark the targets of the direct jumps and the indirect jumps
+    tb_size_t   i = 0;
+    tb_size_t   index = 0;
+    tb_size_t   owner = 0;
+    for (i = 0; i < proc->instructions_count; i++)
+    {
+        vm86_instruction_ref_t instruction = proc->instructions + i;
+        switch (vm86c_opcode(instruction))
+        {
+        case VM86_OPCODE_JXX_V0:
+            if (vm86c_code(c, instruction->v0.u32, &owner, &index) && owner == proc_index) c->marks[index] |= VM86C_MARK_TARGET;
+            break;
+        case VM86_OPCODE_JXX_R0:
+        case VM86_OPCODE_JXX_V0$R0_MUL_V1$:
+            c->has_indirect = tb_true;
+            break;
+        default:
+            break;
+        }
+    }
+
+    // mark the code addresses taken by the instruction values of all procs
+    tb_for_all_if (vm86_proc_t*, item, c->procs, item)
+    {
+        for (i = 0; i < item->instructions_count; i++)
+        {
+            vm86_instruction_ref_t instruction = item->instructions + i;
+            if (instruction->v0_reloc == VM86_RELOC_CODE && vm86c_code(c, instruction->v0.u32, &owner, &index) && owner == proc_index)
+                c->marks[index] |= VM86C_MARK_ADDRESS;
+            if (instruction->v1_reloc == VM86_RELOC_CODE && vm86c_code(c, instruction->v1.u32, &owner, &index) && owner == proc_index)
+                c->marks[index] |= VM86C_MARK_ADDRESS;
+        }
+    }
+
+    // mark the code addresses taken by the .data, e.g. the jump tables
+    tb_for_all_if (vm86_data_reloc_ref_t, reloc, c->data->relocs, reloc && reloc->type == VM86_RELOC_CODE)
+    {
+        tb_uint32_t addr = tb_bits_get_u32_ne(c->data->data + reloc->offset);
+        if (vm86c_code(c, addr, &owner, &index) && owner == proc_index) c->marks[index] |= VM86C_MARK_ADDRESS;
+    }
+}
+static tb_void_t vm86c_emit_jump(vm86c_t* c, vm86_proc_t* proc, tb_size_t proc_index, tb_char_t const* target)
+{
+    // dispatch the code address to the labels, the addresses out of this proc finish it like the interpreter
+    tb_buffer_ref_t body = &c->body;
+    vm86c_printf(body, "        switch (%s)\n", target);
+    vm86c_printf(body, "        {\n");
+    tb_size_t i = 0;
+    for (i = 0; i < proc->instructions_count; i++)
+    {
+        if (c->marks[i] & VM86C_MARK_ADDRESS) vm86c_printf(body, "        case VM86C_CODE(%lu, %lu): goto label_%lu;\n", proc_index, i, i);
+    }
+    vm86c_printf(body, "        default: goto end;\n");
+    vm86c_printf(body, "        }\n");
+    c->uses_end = tb_true;
+}
+static tb_void_t vm86c_emit_alu(vm86c_t* c, tb_char_t const* dst, tb_char_t const* src, tb_char_t const* op, tb_char_t const* fop, tb_size_t bits, tb_char_t const* save)
+{
+    /* xxx dst, src
+     *
+     * the result is saved to the lvalue of save if it is not null,
+     * and the lazy flags are recorded as the interpreter if fop is not null.
+     */
+    tb_buffer_ref_t body = &c->body;
+    vm86c_printf(body, "    {\n");
+    vm86c_printf(body, "        tb_uint32_t dst = %s;\n", dst);
+    vm86c_printf(body, "        tb_uint32_t src = %s;\n", src);
+    vm86c_printf(body, "        tb_uint32_t result = dst %s src;\n", op);
+    if (save) vm86c_printf(body, save, "result");
+    if (fop) vm86c_printf(body, "        vm86_flags_set(&flags, %s, %lu, dst, src, result);\n", fop, bits);
+    vm86c_printf(body, "    }\n");
+}
+static tb_void_t vm86c_emit_shift(vm86c_t* c, tb_char_t const* dst, tb_char_t const* count, tb_char_t const* expr, tb_char_t const* fop, tb_size_t bits, tb_char_t const* save)
+{
+    // the flags are not affected if the count is zero
+    tb_buffer_ref_t body = &c->body;
+    vm86c_printf(body, "    {\n");
+    vm86c_printf(body, "        tb_uint32_t count = (%s) & 0x1f;\n", count);
+    vm86c_printf(body, "        if (count)\n");
+    vm86c_printf(body, "        {\n");
+    vm86c_printf(body, "            tb_uint32_t dst = %s;\n", dst);
+    vm86c_printf(body, "            tb_uint32_t result = %s;\n", expr);
+    vm86c_printf(body, "    ");
+    vm86c_printf(body, save, "result");
+    if (fop) vm86c_printf(body, "            vm86_flags_set(&flags, %s, %lu, dst, count, result);\n", fop, bits);
+    vm86c_printf(body, "        }\n");
+    vm86c_printf(body, "    }\n");
+}
+static tb_bool_t vm86c_emit_instruction(vm86c_t* c, vm86_proc_t* proc, tb_size_t proc_index, tb_size_t index)
+{
+    // the instruction
+    vm86_instruction_ref_t instruction = proc->instructions + index;
+    tb_buffer_ref_t body = &c->body;
+
+    // the opcode
+    tb_size_t opcode = vm86c_opcode(instruction);
+    tb_assert_and_check_return_val(opcode && opcode < VM86_OPCODE_MAXN, tb_false);
+
+    // the operands
+    tb_char_t v0[64];
+    tb_char_t v1[64];
+    tb_char_t r0[64];
+    tb_char_t r1[64];
+    tb_char_t r2[64];
+    tb_char_t set[256];
+    tb_char_t dst[128];
+    tb_char_t expr[256];
+    vm86c_value(c, instruction->v0.u32, instruction->v0_reloc, v0, sizeof(v0));
+    vm86c_value(c, instruction->v1.u32, instruction->v1_reloc, v1, sizeof(v1));
+    tb_snprintf(r0, sizeof(r0), "vm86_registers_value(registers, %#x)", instruction->r0);
+    tb_snprintf(r1, sizeof(r1), "vm86_registers_value(registers, %#x)", instruction->r1);
+    tb_snprintf(r2, sizeof(r2), "vm86_registers_value(registers, %#x)", instruction->r2);
+    tb_snprintf(set, sizeof(set), "        vm86_registers_value_set(registers, %#x, %%s);\n", instruction->r0);
+
+    // the register bits of r0
+    tb_size_t bits = vm86_registers_bits(instruction->r0);
+
+    // the label
+    if (c->marks[index] & VM86C_MARK_TARGET || (c->has_indirect && (c->marks[index] & VM86C_MARK_ADDRESS)))
+        vm86c_printf(body, "label_%lu:\n", index);
+
+    // the comment
+    vm86c_printf(body, "    // %s", g_opcode_names[opcode]);
+    if (opcode == VM86_OPCODE_CALL && instruction->is_cstr) vm86c_printf(body, " %s", instruction->v0.cstr);
+    vm86c_printf(body, "\n");
+
+    // the width-specialized opcode?
+    tb_size_t width = 0;
+    tb_char_t const* name = tb_null;
+    tb_char_t const* fop = tb_null;
+    tb_char_t const* op = tb_null;
+#define VM86C_WIDTH(o, n, f, x) \
+    if (!width && (width = vm86c_width(opcode, VM86_OPCODE_##o##_8))) { name = #n; fop = #f; op = x; }
+    VM86C_WIDTH(ADD_R0_R1,  add_r0_r1,  VM86_FLAGS_OP_ADD,      "+")
+    VM86C_WIDTH(AND_R0_R1,  and_r0_r1,  VM86_FLAGS_OP_LOGIC,    "&")
+    VM86C_WIDTH(CMP_R0_R1,  cmp_r0_r1,  VM86_FLAGS_OP_SUB,      "-")
+    VM86C_WIDTH(MOV_R0_R1,  mov_r0_r1,  VM86_FLAGS_OP_NONE,     tb_null)
+    VM86C_WIDTH(SUB_R0_R1,  sub_r0_r1,  VM86_FLAGS_OP_SUB,      "-")
+    VM86C_WIDTH(XOR_R0_R1,  xor_r0_r1,  VM86_FLAGS_OP_LOGIC,    "^")
+    VM86C_WIDTH(ADD_R0_V0,  add_r0_v0,  VM86_FLAGS_OP_ADD,      "+")
+    VM86C_WIDTH(AND_R0_V0,  and_r0_v0,  VM86_FLAGS_OP_LOGIC,    "&")
+    VM86C_WIDTH(CMP_R0_V0,  cmp_r0_v0,  VM86_FLAGS_OP_SUB,      "-")
+    VM86C_WIDTH(MOV_R0_V0,  mov_r0_v0,  VM86_FLAGS_OP_NONE,     tb_null)
+    VM86C_WIDTH(OR_R0_V0,   or_r0_v0,   VM86_FLAGS_OP_LOGIC,    "|")
+    VM86C_WIDTH(SAR_R0_V0,  sar_r0_v0,  VM86_FLAGS_OP_SAR,      tb_null)
+    VM86C_WIDTH(SHL_R0_V0,  shl_r0_v0,  VM86_FLAGS_OP_SHL,      "<<")
+    VM86C_WIDTH(SHR_R0_V0,  shr_r0_v0,  VM86_FLAGS_OP_SHR,      ">>")
+    VM86C_WIDTH(SUB_R0_V0,  sub_r0_v0,  VM86_FLAGS_OP_SUB,      "-")
+    VM86C_WIDTH(XOR_R0_V0,  xor_r0_v0,  VM86_FLAGS_OP_LOGIC,    "^")
+#undef VM86C_WIDTH
+    if (width)
+    {
+        // the flags will not be read?
+        if (vm86c_noflags(instruction)) fop = tb_null;
+
+        // the register operands of the given width
+        tb_char_t src[128];
+        tb_snprintf(dst, sizeof(dst), "vm86_registers_u%lu(registers, %#x)", width, instruction->r0);
+        if (tb_strstr(name, "_r1")) tb_snprintf(src, sizeof(src), "vm86_registers_u%lu(registers, %#x)", width, instruction->r1);
+        else tb_strlcpy(src, v0, sizeof(src));
+        tb_snprintf(set, sizeof(set), "        %s = (tb_uint%lu_t)%%s;\n", dst, width);
+
+        // mov?
+        if (!tb_strncmp(name, "mov", 3)) vm86c_printf(body, set + 4, src);
+        // shift?
+        else if (!tb_strncmp(name, "sa", 2) || !tb_strncmp(name, "sh", 2))
+        {
+            if (!(instruction->v0.u32 & 0x1f)) vm86c_printf(body, "    // the count is zero\n");
+            else
+            {
+                if (op) tb_snprintf(expr, sizeof(expr), "dst %s count", op);
+                else tb_snprintf(expr, sizeof(expr), "(tb_uint32_t)(vm86_flags_sext(dst, %lu) >> count)", width);
+                vm86c_emit_shift(c, dst, src, expr, fop, width, set);
+            }
+        }
+        // cmp?
+        else if (!tb_strncmp(name, "cmp", 3)) vm86c_emit_alu(c, dst, src, op, fop, width, tb_null);
+        // the others
+        else vm86c_emit_alu(c, dst, src, op, fop, width, set);
+        return tb_true;
+    }
+
+    // done
+    tb_bool_t ok = tb_true;
+    switch (opcode)
+    {
+    case VM86_OPCODE_LEAVE:
+        // mov esp, ebp; pop ebp and finish it, the popped value is dropped like the interpreter
+        vm86c_printf(body, "    VM86C_ESP = registers[VM86_REGISTER_EBP].u32 + 4;\n");
+        vm86c_printf(body, "    goto end;\n");
+        c->uses_end = tb_true;
+        break;
+    case VM86_OPCODE_RETN:
+        // pop the stub return address and finish it
+        vm86c_printf(body, "    tb_assert(VM86C_U32(VM86C_ESP) == 0xbeaf);\n");
+        vm86c_printf(body, "    VM86C_ESP += 4;\n");
+        vm86c_printf(body, "    goto end;\n");
+        c->uses_end = tb_true;
+        break;
+    case VM86_OPCODE_CALL:
+        if (!instruction->is_cstr || !instruction->v0.cstr)
+        {
+            ok = tb_false;
+            break;
+        }
+        {
+            // the slot variable of this function, it is resolved once at the proc entry
+            tb_size_t slot = tb_hash_map_size(c->callees);
+            tb_size_t itor = tb_hash_map_find(c->callees, instruction->v0.cstr);
+            if (itor != tb_iterator_tail(c->callees))
+            {
+                tb_hash_map_item_ref_t item = (tb_hash_map_item_ref_t)tb_iterator_item(c->callees, itor);
+                slot = tb_p2u32(item->data);
+            }
+            else
+            {
+                tb_hash_map_insert(c->callees, instruction->v0.cstr, tb_u2p(slot));
+                vm86c_printf(&c->slots, "    tb_size_t const slot_%lu = vm86_machine_function_slot((vm86_machine_t*)machine, \"%s\");\n", slot, instruction->v0.cstr);
+                vm86c_printf(&c->slots, "    tb_assert_and_check_return(slot_%lu != (tb_size_t)-1);\n", slot);
+            }
+            vm86c_printf(body, "    VM86C_CALL(slot_%lu);\n", slot);
+            c->uses_machine = tb_true;
+        }
+        break;
+    case VM86_OPCODE_PUSH_R0:
+        vm86c_printf(body, "    VM86C_PUSH(%s);\n", r0);
+        break;
+    case VM86_OPCODE_PUSH_V0:
+        vm86c_printf(body, "    VM86C_PUSH(%s);\n", v0);
+        break;
+    case VM86_OPCODE_POP_R0:
+        vm86c_printf(body, "    {\n");
+        vm86c_printf(body, "        tb_uint32_t value;\n");
+        vm86c_printf(body, "        VM86C_POP(value);\n");
+        vm86c_printf(body, set, "value");
+        vm86c_printf(body, "    }\n");
+        break;
+    case VM86_OPCODE_MOV_R0_R1:
+    case VM86_OPCODE_MOVZX_R0_R1:
+        vm86c_printf(body, set + 4, r1);
+        break;
+    case VM86_OPCODE_MOV_R0_V0:
+        vm86c_printf(body, set + 4, v0);
+        break;
+    case VM86_OPCODE_MOV_R0_$R1_ADD_V0$:
+        tb_snprintf(expr, sizeof(expr), "VM86C_U32(%s + %s)", r1, v0);
+        vm86c_printf(body, set + 4, expr);
+        break;
+    case VM86_OPCODE_MOV_$R0_ADD_V0$_R1:
+        vm86c_printf(body, "    VM86C_U32(%s + %s) = %s;\n", r0, v0, r1);
+        break;
+    case VM86_OPCODE_MOV_$R0_ADD_V0$_V1:
+        vm86c_printf(body, "    VM86C_U32(%s + %s) = %s;\n", r0, v0, v1);
+        break;
+    case VM86_OPCODE_ADD_R0_R1:
+        vm86c_emit_alu(c, r0, r1, "+", "VM86_FLAGS_OP_ADD", bits, set);
+        break;
+    case VM86_OPCODE_ADD_R0_V0:
+        vm86c_emit_alu(c, r0, v0, "+", "VM86_FLAGS_OP_ADD", bits, set);
+        break;
+    case VM86_OPCODE_ADD_R0_$R1_ADD_V0$:
+        tb_snprintf(expr, sizeof(expr), "VM86C_U32(%s + %s)", r1, v0);
+        vm86c_emit_alu(c, r0, expr, "+", "VM86_FLAGS_OP_ADD", bits, set);
+        break;
+    case VM86_OPCODE_SUB_R0_R1:
+        vm86c_emit_alu(c, r0, r1, "-", "VM86_FLAGS_OP_SUB", bits, set);
+        break;
+    case VM86_OPCODE_SUB_R0_V0:
+        vm86c_emit_alu(c, r0, v0, "-", "VM86_FLAGS_OP_SUB", bits, set);
+        break;
+    case VM86_OPCODE_SUB_R0_$R1_ADD_V0$:
+        tb_snprintf(expr, sizeof(expr), "VM86C_U32(%s + %s)", r1, v0);
+        vm86c_emit_alu(c, r0, expr, "-", "VM86_FLAGS_OP_SUB", bits, set);
+        break;
+    case VM86_OPCODE_LEA_R0_$R1_ADD_R2_OP_V0$:
+        if (instruction->op != '+' && instruction->op != '*')
+        {
+            ok = tb_false;
+            break;
+        }
+        tb_snprintf(expr, sizeof(expr), "%s + %s %c %s", r1, r2, instruction->op, v0);
+        vm86c_printf(body, set + 4, expr);
+        break;
+    case VM86_OPCODE_JXX_R0:
+        vm86c_printf(body, "    if (VM86C_COND(%u))\n", instruction->cond);
+        vm86c_printf(body, "    {\n");
+        vm86c_emit_jump(c, proc, proc_index, r0);
+        vm86c_printf(body, "    }\n");
+        break;
+    case VM86_OPCODE_JXX_V0:
+        {
+            // the target
+            tb_size_t owner = 0;
+            tb_size_t target = 0;
+            if (!vm86c_code(c, instruction->v0.u32, &owner, &target) || owner != proc_index)
+            {
+                // trace
+                tb_trace_w("%s: the jump target is out of this proc at %lu, finish it like the interpreter", proc->name, index);
+
+                // finish it
+                tb_snprintf(expr, sizeof(expr), "end");
+                c->uses_end = tb_true;
+            }
+            else tb_snprintf(expr, sizeof(expr), "label_%lu", target);
+
+            // jump to the label
+            if (instruction->cond == VM86_FLAGS_COND_ALWAYS) vm86c_printf(body, "    goto %s;\n", expr);
+            else vm86c_printf(body, "    if (VM86C_COND(%u)) goto %s;\n", instruction->cond, expr);
+        }
+        break;
+    case VM86_OPCODE_JXX_V0$R0_MUL_V1$:
+        // the jump table in the .data is read by the c code, v1 is the dispatch table of the interpreter
+        if (instruction->opcode == VM86_OPCODE_JXX_TABLE_R0) tb_strlcpy(v1, "4", sizeof(v1));
+        tb_snprintf(expr, sizeof(expr), "VM86C_U32(%s + %s * %s)", v0, r0, v1);
+        vm86c_printf(body, "    if (VM86C_COND(%u))\n", instruction->cond);
+        vm86c_printf(body, "    {\n");
+        vm86c_emit_jump(c, proc, proc_index, expr);
+        vm86c_printf(body, "    }\n");
+        break;
+    case VM86_OPCODE_CMP_R0_R1:
+        vm86c_emit_alu(c, r0, r1, "-", "VM86_FLAGS_OP_SUB", bits, tb_null);
+        break;
+    case VM86_OPCODE_CMP_R0_V0:
+        vm86c_emit_alu(c, r0, v0, "-", "VM86_FLAGS_OP_SUB", bits, tb_null);
+        break;
+    case VM86_OPCODE_CMP_R0_$R1_ADD_V0$:
+        tb_snprintf(expr, sizeof(expr), "VM86C_U32(%s + %s)", r1, v0);
+        vm86c_emit_alu(c, r0, expr, "-", "VM86_FLAGS_OP_SUB", bits, tb_null);
+        break;
+    case VM86_OPCODE_CMP_$R0_ADD_V0$_R1:
+        tb_snprintf(expr, sizeof(expr), "VM86C_U32(%s + %s)", r0, v0);
+        vm86c_emit_alu(c, expr, r1, "-", "VM86_FLAGS_OP_SUB", 32, tb_null);
+        break;
+    case VM86_OPCODE_CMP_$R0_ADD_V0$_V1:
+        tb_snprintf(expr, sizeof(expr), "VM86C_U32(%s + %s)", r0, v0);
+        vm86c_emit_alu(c, expr, v1, "-", "VM86_FLAGS_OP_SUB", 32, tb_null);
+        break;
+    case VM86_OPCODE_SHRD_R0_R1_R2:
+        tb_snprintf(expr, sizeof(expr), "(dst >> count) | (%s << (32 - count))", r1);
+        vm86c_emit_shift(c, r0, r2, expr, "VM86_FLAGS_OP_SHRD", 32, set);
+        break;
+    case VM86_OPCODE_SHR_R0_R1:
+        vm86c_emit_shift(c, r0, r1, "dst >> count", "VM86_FLAGS_OP_SHR", bits, set);
+        break;
+    case VM86_OPCODE_SHR_R0_V0:
+        vm86c_emit_shift(c, r0, v0, "dst >> count", "VM86_FLAGS_OP_SHR", bits, set);
+        break;
+    case VM86_OPCODE_SHL_R0_R1:
+        vm86c_emit_shift(c, r0, r1, "dst << count", "VM86_FLAGS_OP_SHL", bits, set);
+        break;
+    case VM86_OPCODE_SHL_R0_V0:
+        vm86c_emit_shift(c, r0, v0, "dst << count", "VM86_FLAGS_OP_SHL", bits, set);
+        break;
+    case VM86_OPCODE_SAR_R0_R1:
+    case VM86_OPCODE_SAR_R0_V0:
+        tb_snprintf(expr, sizeof(expr), "(tb_uint32_t)(vm86_flags_sext(dst, %lu) >> count)", bits);
+        vm86c_emit_shift(c, r0, opcode == VM86_OPCODE_SAR_R0_R1? r1 : v0, expr, "VM86_FLAGS_OP_SAR", bits, set);
+        break;
+    case VM86_OPCODE_AND_R0_R1:
+        vm86c_emit_alu(c, r0, r1, "&", "VM86_FLAGS_OP_LOGIC", bits, set);
+        break;
+    case VM86_OPCODE_AND_R0_V0:
+        vm86c_emit_alu(c, r0, v0, "&", "VM86_FLAGS_OP_LOGIC", bits, set);
+        break;
+    case VM86_OPCODE_AND_R0_$R1_ADD_V0$:
+        tb_snprintf(expr, sizeof(expr), "VM86C_U32(%s + %s)", r1, v0);
+        vm86c_emit_alu(c, r0, expr, "&", "VM86_FLAGS_OP_LOGIC", bits, set);
+        break;
+    case VM86_OPCODE_XOR_R0_R1:
+        vm86c_emit_alu(c, r0, r1, "^", "VM86_FLAGS_OP_LOGIC", bits, set);
+        break;
+    case VM86_OPCODE_XOR_R0_V0:
+        vm86c_emit_alu(c, r0, v0, "^", "VM86_FLAGS_OP_LOGIC", bits, set);
+        break;
+    case VM86_OPCODE_XOR_R0_$R1_ADD_V0$:
+        tb_snprintf(expr, sizeof(expr), "VM86C_U32(%s + %s)", r1, v0);
+        vm86c_emit_alu(c, r0, expr, "^", "VM86_FLAGS_OP_LOGIC", bits, set);
+        break;
+    case VM86_OPCODE_OR_R0_V0:
+        vm86c_emit_alu(c, r0, v0, "|", "VM86_FLAGS_OP_LOGIC", bits, set);
+        break;
+    case VM86_OPCODE_OR_R0_$R1_ADD_V0$:
+        tb_snprintf(expr, sizeof(expr), "VM86C_U32(%s + %s)", r1, v0);
+        vm86c_emit_alu(c, r0, expr, "|", "VM86_FLAGS_OP_LOGIC", bits, set);
+        break;
+    case VM86_OPCODE_NOT_R0:
+        tb_snprintf(expr, sizeof(expr), "~%s", r0);
+        vm86c_printf(body, set + 4, expr);
+        break;
+    case VM86_OPCODE_MUL_$R0_ADD_V0$:
+        vm86c_printf(body, "    {\n");
+        vm86c_printf(body, "        tb_uint32_t multiplicand = registers[VM86_REGISTER_EAX].u32;\n");
+        vm86c_printf(body, "        tb_uint32_t multiplier = VM86C_U32(%s + %s);\n", r0, v0);
+        vm86c_printf(body, "        tb_uint64_t result = (tb_uint64_t)multiplicand * multiplier;\n");
+        vm86c_printf(body, "        registers[VM86_REGISTER_EAX].u32 = (tb_uint32_t)result;\n");
+        vm86c_printf(body, "        registers[VM86_REGISTER_EDX].u32 = (tb_uint32_t)(result >> 32);\n");
+        vm86c_printf(body, "        vm86_flags_set(&flags, VM86_FLAGS_OP_MUL, 32, multiplicand, (result >> 32) != 0, (tb_uint32_t)result);\n");
+        vm86c_printf(body, "    }\n");
+        break;
+    case VM86_OPCODE_IMUL_R0_$R1_ADD_V0$:
+        vm86c_printf(body, "    {\n");
+        vm86c_printf(body, "        tb_uint32_t multiplicand = %s;\n", r0);
+        vm86c_printf(body, "        tb_uint32_t multiplier = VM86C_U32(%s + %s);\n", r1, v0);
+        vm86c_printf(body, "        tb_sint64_t result = (tb_sint64_t)(tb_sint32_t)multiplicand * (tb_sint32_t)multiplier;\n");
+        vm86c_printf(body, set, "(tb_uint32_t)result");
+        vm86c_printf(body, "        vm86_flags_set(&flags, VM86_FLAGS_OP_MUL, 32, multiplicand, result != (tb_sint32_t)result, (tb_uint32_t)result);\n");
+        vm86c_printf(body, "    }\n");
+        break;
+    case VM86_OPCODE_DIV_$R0_ADD_V0$:
+        vm86c_printf(body, "    {\n");
+        vm86c_printf(body, "        tb_uint64_t dividend = ((tb_uint64_t)registers[VM86_REGISTER_EDX].u32 << 32) | registers[VM86_REGISTER_EAX].u32;\n");
+        vm86c_printf(body, "        tb_uint32_t divisor = VM86C_U32(%s + %s);\n", r0, v0);
+        vm86c_printf(body, "        registers[VM86_REGISTER_EAX].u32 = (tb_uint32_t)(dividend / divisor);\n");
+        vm86c_printf(body, "        registers[VM86_REGISTER_EDX].u32 = (tb_uint32_t)(dividend %% divisor);\n");
+        vm86c_printf(body, "    }\n");
+        break;
+    default:
+        ok = tb_false;
+        break;
+    }
+
+    // trace
+    if (!ok) tb_trace_e("%s: unknown opcode: %lu at %lu", proc->name, opcode, index);
+
+    // ok?
+    return ok;
+}
+static tb_bool_t vm86c_emit_proc(vm86c_t* c, vm86_proc_t* proc, tb_size_t proc_index, tb_char_t const* data_name)
+{
+    // mark the labels
+    vm86c_mark(c, proc, proc_index);
+
+    // translate the instructions to the body
+    tb_buffer_clear(&c->body);
+    tb_buffer_clear(&c->slots);
+    tb_hash_map_clear(c->callees);
+    c->uses_data    = tb_false;
+    c->uses_machine = tb_false;
+    c->uses_end     = tb_false;
+    tb_size_t i = 0;
+    for (i = 0; i < proc->instructions_count; i++)
+    {
+        if (!vm86c_emit_instruction(c, proc, proc_index, i)) return tb_false;
+    }
+
+    // the function name
+    tb_char_t name[512];
+    vm86c_name(name, sizeof(name), proc->name);
+
+    // the function head
+    tb_buffer_ref_t source = &c->source;
+    vm86c_printf(source, "tb_void_t %s_%s(vm86_context_ref_t context)\n", c->module, name);
+    vm86c_printf(source, "{\n");
+    vm86c_printf(source, "    // check\n");
+    vm86c_printf(source, "    tb_assert_and_check_return(context);\n");
+    vm86c_printf(source, "\n");
+    if (c->uses_machine)
+    {
+        vm86c_printf(source, "    // the machine\n");
+        vm86c_printf(source, "    vm86_machine_ref_t machine = vm86_context_machine(context);\n");
+        vm86c_printf(source, "\n");
+        vm86c_printf(source, "    // the slots of the called functions\n");
+        tb_buffer_memncat(source, tb_buffer_data(&c->slots), tb_buffer_size(&c->slots));
+        vm86c_printf(source, "\n");
+    }
+    if (c->uses_data)
+    {
+        tb_assert_and_check_return_val(data_name, tb_false);
+        vm86c_printf(source, "    // the .data base of this module\n");
+        vm86c_printf(source, "    tb_uint32_t data = vm86_data_get(vm86_machine_data(vm86_context_machine(context)), \"%s\", tb_null);\n", data_name);
+        vm86c_printf(source, "\n");
+    }
+    vm86c_printf(source, "    // the registers, they are kept in the locals and the eflags is up-to-date\n");
+    vm86c_printf(source, "    vm86_registers_t registers;\n");
+    vm86c_printf(source, "    vm86_context_eflags(context);\n");
+    vm86c_printf(source, "    tb_memcpy(registers, vm86_context_registers(context), sizeof(registers));\n");
+    vm86c_printf(source, "\n");
+    vm86c_printf(source, "    // the lazy flags\n");
+    vm86c_printf(source, "    vm86_flags_t flags;\n");
+    vm86c_printf(source, "    flags.op = VM86_FLAGS_OP_NONE;\n");
+    vm86c_printf(source, "\n");
+    vm86c_printf(source, "    // push the stub return address\n");
+    vm86c_printf(source, "    VM86C_PUSH(0xbeaf);\n");
+    vm86c_printf(source, "\n");
+
+    // the function body
+    tb_buffer_memncat(source, tb_buffer_data(&c->body), tb_buffer_size(&c->body));
+
+    // the function tail
+    vm86c_printf(source, "\n");
+    if (c->uses_end) vm86c_printf(source, "end:\n");
+    vm86c_printf(source, "    // compute the lazy flags and save the registers\n");
+    vm86c_printf(source, "    vm86_flags_eflags(&flags, &VM86C_EFLAGS);\n");
+    vm86c_printf(source, "    tb_memcpy(vm86_context_registers(context), registers, sizeof(registers));\n");
+    vm86c_printf(source, "}\n");
+
+    // declare it
+    vm86c_printf(&c->header, "/*! the translated proc: %s\n", proc->name);
+    vm86c_printf(&c->header, " *\n");
+    vm86c_printf(&c->header, " * @param context           the context\n");
+    vm86c_printf(&c->header, " */\n");
+    vm86c_printf(&c->header, "tb_void_t                   %s_%s(vm86_context_ref_t context);\n\n", c->module, name);
+
+    // ok
+    return tb_true;
+}
+static tb_size_t vm86c_chunks(vm86c_t* c, vm86c_chunk_t** pchunks)
+{
+    // the chunks count
+    tb_size_t count = tb_hash_map_size(c->data->labels);
+    tb_check_return_val(count, 0);
+
+    // make chunks
+    vm86c_chunk_t* chunks = tb_nalloc0_type(count, vm86c_chunk_t);
+    tb_assert_and_check_return_val(chunks, 0);
+
+    // sort them by the offset, they are contiguous because the .data only grows at the tail
+    tb_size_t n = 0;
+    tb_for_all_if (tb_hash_map_item_t*, item, c->data->labels, item && item->data)
+    {
+        // the chunk
+        vm86_data_chunk_ref_t chunk = (vm86_data_chunk_ref_t)item->data;
+
+        // insert it
+        tb_size_t i = n++;
+        while (i && chunks[i - 1].offset > chunk->offset)
+        {
+            chunks[i] = chunks[i - 1];
+            i--;
+        }
+        chunks[i].name      = (tb_char_t const*)item->name;
+        chunks[i].offset    = chunk->offset;
+        chunks[i].size      = chunk->size;
+    }
+
+    // ok
+    *pchunks = chunks;
+    return n;
+}
+static tb_bool_t vm86c_emit_data(vm86c_t* c, vm86c_chunk_t const* chunks, tb_size_t count)
+{
+    // no .data?
+    tb_uint32_t size = c->data->base;
+    tb_buffer_ref_t source = &c->source;
+    tb_check_return_val(count && size, tb_true);
+
+    // copy the .data
+    tb_byte_t* data = tb_malloc_bytes(size);
+    tb_assert_and_check_return_val(data, tb_false);
+    tb_memcpy(data, c->data->data, size);
+
+    // the relocated .data addresses will be relocated again when the module is registered
+    tb_buffer_t relocs;
+    tb_buffer_init(&relocs);
+
+    // relocate addresses
+    tb_bool_t ok = tb_true;
+    tb_size_t proc = 0;
+    tb_size_t index = 0;
+    tb_uint32_t base = vm86_memory_addr(c->data->data);
+    tb_for_all_if (vm86_data_reloc_ref_t, reloc, c->data->relocs, reloc && ok)
+    {
+        tb_uint32_t address = tb_bits_get_u32_ne(data + reloc->offset);
+        if (reloc->type == VM86_RELOC_CODE && vm86c_code(c, address, &proc, &index))
+            tb_bits_set_u32_ne(data + reloc->offset, VM86C_CODE(proc, index));
+        else if (reloc->type == VM86_RELOC_DATA && address >= base && address < base + size)
+        {
+            tb_bits_set_u32_ne(data + reloc->offset, address - base);
+            vm86c_printf(&relocs, "%s%#x", tb_buffer_size(&relocs)? ", " : "", reloc->offset);
+        }
+        else
+        {
+            // trace
+            tb_trace_e("invalid .data address: %#x at %u", address, reloc->offset);
+            ok = tb_false;
+        }
+    }
+
+    // emit the .data
+    if (ok)
+    {
+        tb_uint32_t i = 0;
+        vm86c_printf(source, "// the .data\n");
+        vm86c_printf(source, "static tb_byte_t const g_data[] =\n");
+        vm86c_printf(source, "{\n");
+        for (i = 0; i < size; i++)
+            vm86c_printf(source, "%s%#04x%s", (i & 15)? "" : "    ", data[i], i + 1 == size? "\n" : ((i & 15) == 15? ",\n" : ", "));
+        vm86c_printf(source, "};\n\n");
+
+        // emit the chunks
+        vm86c_printf(source, "// the .data chunks in order\n");
+        vm86c_printf(source, "static struct\n");
+        vm86c_printf(source, "{\n");
+        vm86c_printf(source, "    tb_char_t const*    name;\n");
+        vm86c_printf(source, "    tb_uint32_t         offset;\n");
+        vm86c_printf(source, "    tb_uint32_t         size;\n");
+        vm86c_printf(source, "\n");
+        vm86c_printf(source, "}const g_chunks[] =\n");
+        vm86c_printf(source, "{\n");
+        for (i = 0; i < count; i++)
+            vm86c_printf(source, "    %s{ \"%s\", %#x, %#x }\n", i? ", " : "  ", chunks[i].name, chunks[i].offset, chunks[i].size);
+        vm86c_printf(source, "};\n\n");
+
+        // emit the relocations
+        vm86c_printf(source, "// the offsets of the .data addresses in the .data\n");
+        vm86c_printf(source, "static tb_uint32_t const g_relocs[] =\n");
+        vm86c_printf(source, "{\n");
+        vm86c_printf(source, "    0");
+        if (tb_buffer_size(&relocs))
+        {
+            vm86c_printf(source, ", ");
+            tb_buffer_memncat(source, tb_buffer_data(&relocs), tb_buffer_size(&relocs));
+        }
+        vm86c_printf(source, "\n};\n\n");
+    }
+
+    // exit data
+    tb_buffer_exit(&relocs);
+    tb_free(data);
+
+    // ok?
+    return ok;
+}
+static tb_bool_t vm86c_emit_register(vm86c_t* c, tb_bool_t has_data)
+{
+    // the register function
+    tb_buffer_ref_t source = &c->source;
+    vm86c_printf(source, "tb_bool_t %s_register(vm86_machine_ref_t machine)\n", c->module);
+    vm86c_printf(source, "{\n");
+    vm86c_printf(source, "    // check\n");
+    vm86c_printf(source, "    tb_assert_and_check_return_val(machine, tb_false);\n");
+    vm86c_printf(source, "\n");
+    if (has_data)
+    {
+        vm86c_printf(source, "    // the .data\n");
+        vm86c_printf(source, "    vm86_data_ref_t data = vm86_machine_data(machine);\n");
+        vm86c_printf(source, "    tb_assert_and_check_return_val(data, tb_false);\n");
+        vm86c_printf(source, "\n");
+        vm86c_printf(source, "    // load the .data once, the chunks are added in order and they are contiguous\n");
+        vm86c_printf(source, "    if (!vm86_data_is(data, g_chunks[0].name))\n");
+        vm86c_printf(source, "    {\n");
+        vm86c_printf(source, "        // add chunks\n");
+        vm86c_printf(source, "        tb_size_t i = 0;\n");
+        vm86c_printf(source, "        for (i = 0; i < tb_arrayn(g_chunks); i++)\n");
+        vm86c_printf(source, "        {\n");
+        vm86c_printf(source, "            tb_assert_and_check_return_val(!vm86_data_is(data, g_chunks[i].name), tb_false);\n");
+        vm86c_printf(source, "            vm86_data_add(data, g_chunks[i].name, g_data + g_chunks[i].offset, g_chunks[i].size);\n");
+        vm86c_printf(source, "        }\n");
+        vm86c_printf(source, "\n");
+        vm86c_printf(source, "        // relocate the .data addresses, the first item is a placeholder\n");
+        vm86c_printf(source, "        tb_uint32_t base = vm86_data_get(data, g_chunks[0].name, tb_null);\n");
+        vm86c_printf(source, "        for (i = 1; i < tb_arrayn(g_relocs); i++) VM86C_U32(base + g_relocs[i]) += base;\n");
+        vm86c_printf(source, "    }\n");
+        vm86c_printf(source, "\n");
+    }
+    vm86c_printf(source, "    // register the translated procs as the host functions\n");
+    tb_for_all_if (vm86_proc_t*, proc, c->procs, proc)
+    {
+        tb_char_t name[512];
+        vm86c_name(name, sizeof(name), proc->name);
+        vm86c_printf(source, "    vm86_machine_function_set(machine, \"%s\", %s_%s);\n", proc->name, c->module, name);
+    }
+    vm86c_printf(source, "\n");
+    vm86c_printf(source, "    // ok\n");
+    vm86c_printf(source, "    return tb_true;\n");
+    vm86c_printf(source, "}\n");
+
+    // declare it
+    vm86c_printf(&c->header, "/*! register the translated procs and load the .data of this module\n");
+    vm86c_printf(&c->header, " *\n");
+    vm86c_printf(&c->header, " * the procs are registered as the host functions of the given names,\n");
+    vm86c_printf(&c->header, " * so they can be called by the host or the guest code like the interpreted procs.\n");
+    vm86c_printf(&c->header, " *\n");
+    vm86c_printf(&c->header, " * the .data is loaded at the first time, the machine should not compile the same procs again.\n");
+    vm86c_printf(&c->header, " *\n");
+    vm86c_printf(&c->header, " * @param machine           the machine\n");
+    vm86c_printf(&c->header, " *\n");
+    vm86c_printf(&c->header, " * @return                  tb_true or tb_false\n");
+    vm86c_printf(&c->header, " */\n");
+    vm86c_printf(&c->header, "tb_bool_t                   %s_register(vm86_machine_ref_t machine);\n\n", c->module);
+
+    // ok
+    return tb_true;
+}
+static tb_bool_t vm86c_emit(vm86c_t* c, tb_char_t const* output)
+{
+    // the file name
+    tb_char_t const* file = output + tb_strlen(output);
+    while (file > output && file[-1] != '/' && file[-1] != '\\') file--;
+
+    // the header guard
+    tb_char_t guard[256];
+    vm86c_name(guard, sizeof(guard), c->module);
+    tb_size_t i = 0;
+    for (i = 0; guard[i]; i++) guard[i] = tb_toupper(guard[i]);
+
+    // the header head
+    vm86c_printf(&c->header, "/* translated by vm86c, do not edit it */\n");
+    vm86c_printf(&c->header, "#ifndef VM86C_%s_H\n", guard);
+    vm86c_printf(&c->header, "#define VM86C_%s_H\n\n", guard);
+    vm86c_printf(&c->header, "/* //////////////////////////////////////////////////////////////////////////////////////\n");
+    vm86c_printf(&c->header, " * includes\n");
+    vm86c_printf(&c->header, " */\n");
+    vm86c_printf(&c->header, "#include \"vm86/vm86.h\"\n\n");
+    vm86c_printf(&c->header, "/* //////////////////////////////////////////////////////////////////////////////////////\n");
+    vm86c_printf(&c->header, " * extern\n");
+    vm86c_printf(&c->header, " */\n");
+    vm86c_printf(&c->header, "__tb_extern_c_enter__\n\n");
+    vm86c_printf(&c->header, "/* //////////////////////////////////////////////////////////////////////////////////////\n");
+    vm86c_printf(&c->header, " * interfaces\n");
+    vm86c_printf(&c->header, " */\n\n");
+
+    // the source head
+    vm86c_printf(&c->source, "/* translated by vm86c, do not edit it */\n\n");
+    vm86c_printf(&c->source, "/* //////////////////////////////////////////////////////////////////////////////////////\n");
+    vm86c_printf(&c->source, " * includes\n");
+    vm86c_printf(&c->source, " */\n");
+    vm86c_printf(&c->source, "#include \"%s.h\"\n", file);
+    vm86c_printf(&c->source, "#include \"vm86/impl/flags.h\"\n");
+    vm86c_printf(&c->source, "#include \"vm86/impl/machine.h\"\n\n");
+    tb_buffer_memncat(&c->source, (tb_byte_t const*)g_prelude, sizeof(g_prelude) - 1);
+
+    // done
+    tb_bool_t       ok = tb_false;
+    vm86c_chunk_t*  chunks = tb_null;
+    tb_size_t       count = 0;
+    do
+    {
+        // emit the .data
+        count = vm86c_chunks(c, &chunks);
+        if (count)
+        {
+            vm86c_printf(&c->source, "/* //////////////////////////////////////////////////////////////////////////////////////\n");
+            vm86c_printf(&c->source, " * globals\n");
+            vm86c_printf(&c->source, " */\n\n");
+            if (!vm86c_emit_data(c, chunks, count)) break;
+        }
+
+        // make marks
+        tb_size_t maxn = 1;
+        tb_for_all_if (vm86_proc_t*, item, c->procs, item) maxn = tb_max(maxn, item->instructions_count);
+        c->marks = tb_malloc0_bytes(maxn);
+        tb_assert_and_check_break(c->marks);
+
+        // emit the procs
+        vm86c_printf(&c->source, "/* //////////////////////////////////////////////////////////////////////////////////////\n");
+        vm86c_printf(&c->source, " * implementation\n");
+        vm86c_printf(&c->source, " */\n");
+        tb_size_t index = 0;
+        tb_for_all_if (vm86_proc_t*, proc, c->procs, proc)
+        {
+            if (!vm86c_emit_proc(c, proc, index, count? chunks[0].name : tb_null)) break;
+            index++;
+        }
+        tb_check_break(index == tb_vector_size(c->procs));
+
+        // emit the register function
+        if (!vm86c_emit_register(c, count != 0)) break;
+
+        // the header tail
+        vm86c_printf(&c->header, "/* //////////////////////////////////////////////////////////////////////////////////////\n");
+        vm86c_printf(&c->header, " * extern\n");
+        vm86c_printf(&c->header, " */\n");
+        vm86c_printf(&c->header, "__tb_extern_c_leave__\n\n");
+        vm86c_printf(&c->header, "#endif\n");
+
+        // write files
+        tb_char_t path[TB_PATH_MAXN];
+        tb_snprintf(path, sizeof(path), "%s.h", output);
+        if (!vm86c_file_writ(path, &c->header)) break;
+        tb_snprintf(path, sizeof(path), "%s.c", output);
+        if (!vm86c_file_writ(path, &c->source)) break;
+
+        // ok
+        ok = tb_true;
+
+    } while (0);
+
+    // exit chunks
+    if (chunks) tb_free(chunks);
+    chunks = tb_null;
+
+    // ok?
+    return ok;
+}
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * main
+ */
+tb_int_t main(tb_int_t argc, tb_char_t** argv)
+{
+    // check
+    if (argc < 3)
+    {
+        tb_printf("usage: vm86c output input.asm [input2.asm ...]\n");
+        tb_printf("    translate the procs of the ida assembly files to output.c and output.h\n");
+        return -1;
+    }
+
+    // init tbox
+    if (!tb_init(tb_null, tb_null)) return -1;
+
+    // init translator
+    vm86c_t c;
+    tb_memset(&c, 0, sizeof(c));
+    tb_buffer_init(&c.source);
+    tb_buffer_init(&c.header);
+    tb_buffer_init(&c.body);
+    tb_buffer_init(&c.slots);
+
+    // done
+    tb_bool_t ok = tb_false;
+    do
+    {
+        // the machine
+        c.machine = vm86_machine();
+        tb_assert_and_check_break(c.machine);
+
+        // the .data
+        c.data = (vm86_data_t*)vm86_machine_data(c.machine);
+        tb_assert_and_check_break(c.data);
+
+        // init procs
+        c.procs = tb_vector_init(0, tb_element_ptr(tb_null, tb_null));
+        tb_assert_and_check_break(c.procs);
+
+        // init the called functions
+        c.callees = tb_hash_map_init(8, tb_element_str(tb_true), tb_element_uint32());
+        tb_assert_and_check_break(c.callees);
+
+        // the module name is the file name of the output
+        tb_char_t const* output = argv[1];
+        tb_char_t const* module = output + tb_strlen(output);
+        while (module > output && module[-1] != '/' && module[-1] != '\\') module--;
+        vm86c_name(c.module, sizeof(c.module), module);
+
+        // compile the inputs
+        tb_int_t i = 0;
+        for (i = 2; i < argc; i++)
+        {
+            // read it
+            tb_size_t size = 0;
+            tb_byte_t* code = vm86c_file_read(argv[i], &size);
+            if (!code)
+            {
+                tb_trace_e("read %s failed!", argv[i]);
+                break;
+            }
+
+            // compile it
+            tb_bool_t compiled = vm86c_compile(&c, (tb_char_t const*)code, size);
+            tb_free(code);
+            if (!compiled) break;
+        }
+        tb_check_break(i == argc);
+
+        // translate them
+        if (!vm86c_emit(&c, output)) break;
+
+        // trace
+        tb_trace_i("translate %lu procs to %s.c", tb_vector_size(c.procs), output);
+
+        // ok
+        ok = tb_true;
+
+    } while (0);
+
+    // exit translator
+    if (c.marks) tb_free(c.marks);
+    if (c.callees) tb_hash_map_exit(c.callees);
+    if (c.procs) tb_vector_exit(c.procs);
+    tb_buffer_exit(&c.slots);
+    tb_buffer_exit(&c.body);
+    tb_buffer_exit(&c.header);
+    tb_buffer_exit(&c.source);
+
+    // exit tbox
+    tb_exit();
+
+    // ok?
+    return ok? 0 : -1;
+}
@@ -0,0 +1,18 @@
+-- add target
+target("vm86c")
+
+    -- add the dependent target
+    add_deps("vm86")
+
+    -- make as a binary
+    set_kind("binary")
+
+    -- add defines
+    add_defines("__tb_prefix__=\"vm86c\"")
+
+    -- add packages
+    add_packages("tbox")
+
+    -- add the source files
+    add_files("*.c") 
+
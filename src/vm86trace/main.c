@@ -0,0 +1,387 @@
+/*!The x86 Script Instruction Virtual Machine
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Copyright (C) 2014 - 2017, TBOOX Open Source Group.
+ *
+ * @author      ruki
+ * @file        main.c
+ *
+ */
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * trace
+ */
+#define TB_TRACE_MODULE_NAME            "vm86trace"
+#define TB_TRACE_MODULE_DEBUG           (0)
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * includes
+ */
+#include "vm86/vm86.h"
+#include "vm86/instruction.h"
+#include "vm86/impl/hash.h"
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * types
+ */
+
+// the decoded proc type
+typedef struct __vm86trace_proc_t
+{
+    // the compiled proc
+    vm86_proc_ref_t         proc;
+
+    // the proc code, starts from the line of "xxx proc near"
+    tb_char_t*              code;
+
+    // the proc code size
+    tb_size_t               size;
+
+}vm86trace_proc_t;
+
+// the decoder type
+typedef struct __vm86trace_t
+{
+    // the machine
+    vm86_machine_ref_t      machine;
+
+    // the procs, id => vm86trace_proc_t*
+    tb_hash_map_ref_t       procs;
+
+}vm86trace_t;
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * globals
+ */
+
+// the opcode names, index: opcode
+#define VM86TRACE_OPCODE_NAME(o, n)     ,   #n
+static tb_char_t const* g_opcode_names[] =
+{
+    "none"
+    VM86_OPCODE_LIST(VM86TRACE_OPCODE_NAME)
+};
+#undef VM86TRACE_OPCODE_NAME
+
+// the flow names, index: vm86_trace_flow_e
+static tb_char_t const* g_flow_names[] =
+{
+    ""
+,   "jump"
+,   "end"
+};
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * private implementation
+ */
+static tb_byte_t* vm86trace_file_read(tb_char_t const* path, tb_size_t* psize)
+{
+    // done
+    tb_bool_t       ok = tb_false;
+    tb_byte_t*      data = tb_null;
+    tb_file_ref_t   file = tb_file_init(path, TB_FILE_MODE_RO | TB_FILE_MODE_BINARY);
+    do
+    {
+        // check
+        tb_check_break(file);
+
+        // the file size
+        tb_size_t size = (tb_size_t)tb_file_size(file);
+        tb_check_break(size);
+
+        // make data
+        data = tb_malloc_bytes(size);
+        tb_assert_and_check_break(data);
+
+        // read data
+        tb_size_t read = 0;
+        while (read < size)
+        {
+            tb_long_t real = tb_file_read(file, data + read, size - read);
+            if (real > 0) read += real;
+            else break;
+        }
+        tb_check_break(read == size);
+
+        // save size
+        *psize = size;
+
+        // ok
+        ok = tb_true;
+
+    } while (0);
+
+    // failed? exit data
+    if (!ok && data)
+    {
+        tb_free(data);
+        data = tb_null;
+    }
+
+    // exit file
+    if (file) tb_file_exit(file);
+    file = tb_null;
+
+    // ok?
+    return data;
+}
+static tb_bool_t vm86trace_compile(vm86trace_t* t, tb_char_t const* code, tb_size_t size)
+{
+    // the text
+    vm86_text_ref_t text = vm86_machine_text(t->machine);
+    tb_assert_and_check_return_val(text, tb_false);
+
+    /* compile the procs one by one
+     *
+     * the proc starts from the line of "xxx proc near" and ends at the line of "xxx endp"
+     */
+    tb_bool_t           ok = tb_true;
+    tb_char_t const*    head = tb_null;
+    tb_char_t const*    p = code;
+    tb_char_t const*    e = code + size;
+    while (p < e && ok)
+    {
+        // the line
+        tb_char_t const* line = p;
+        while (p < e && *p != '\n') p++;
+        if (p < e) p++;
+
+        // the proc head?
+        if (!head)
+        {
+            tb_char_t const* proc = tb_strnistr(line, p - line, "proc");
+            if (proc && tb_strnistr(proc, p - proc, "near")) head = line;
+        }
+        // the proc tail?
+        else if (tb_strnistr(line, p - line, "endp"))
+        {
+            // compile it
+            vm86_proc_ref_t proc = vm86_text_compile(text, head, p - head);
+            if (proc)
+            {
+                // make the decoded proc
+                vm86trace_proc_t* item = tb_malloc0_type(vm86trace_proc_t);
+                if (!item)
+                {
+                    ok = tb_false;
+                    break;
+                }
+
+                // save it, the code is kept for rendering the source lines
+                item->proc = proc;
+                item->code = tb_strndup(head, p - head);
+                item->size = p - head;
+
+                // the proc id is the low 32-bits of the fnv64 hash of the proc name
+                tb_char_t const* name = vm86_proc_name(proc);
+                tb_uint32_t id = (tb_uint32_t)vm86_hash_fnv64((tb_byte_t const*)name, tb_strlen(name));
+
+                // the same proc is compiled again? replace it
+                vm86trace_proc_t* prev = (vm86trace_proc_t*)tb_hash_map_get(t->procs, tb_u2p(id));
+                if (prev)
+                {
+                    if (prev->code) tb_free(prev->code);
+                    tb_free(prev);
+                }
+                tb_hash_map_insert(t->procs, tb_u2p(id), item);
+
+                // trace
+                tb_trace_d("compile: %s, id: %#x", name, id);
+            }
+            else
+            {
+                // trace
+                tb_trace_e("compile proc failed at: %.*s", (tb_int_t)(p - head > 64? 64 : p - head), head);
+                ok = tb_false;
+            }
+
+            // next proc
+            head = tb_null;
+        }
+    }
+
+    // ok?
+    return ok;
+}
+static tb_char_t const* vm86trace_line(vm86trace_proc_t* item, tb_size_t lineno, tb_char_t* line, tb_size_t maxn)
+{
+    // unknown line?
+    tb_check_return_val(lineno && item->code, tb_null);
+
+    // seek to the line
+    tb_char_t const* p = item->code;
+    tb_char_t const* e = item->code + item->size;
+    while (p < e && --lineno)
+    {
+        while (p < e && *p != '\n') p++;
+        if (p < e) p++;
+    }
+    tb_check_return_val(p < e, tb_null);
+
+    // skip the leading spaces
+    while (p < e && (*p == ' ' || *p == '\t')) p++;
+
+    // copy the line without the comment
+    tb_size_t size = 0;
+    while (p < e && *p != '\n' && *p != '\r' && *p != ';' && size + 1 < maxn) line[size++] = *p++;
+
+    // strip the trailing spaces
+    while (size && (line[size - 1] == ' ' || line[size - 1] == '\t')) size--;
+    line[size] = '\0';
+
+    // ok
+    return line;
+}
+static tb_void_t vm86trace_dump(vm86trace_t* t, vm86_trace_record_t const* records, tb_size_t count)
+{
+    // dump records from the oldest to the newest
+    tb_size_t i = 0;
+    for (i = 0; i < count; i++)
+    {
+        // the record
+        vm86_trace_record_t const* record = &records[i];
+
+        // the proc
+        vm86trace_proc_t* item = (vm86trace_proc_t*)tb_hash_map_get(t->procs, tb_u2p(record->proc));
+
+        // the source line, uses the opcode name if the proc is not found
+        tb_char_t           data[8192];
+        tb_char_t const*    line = item? vm86trace_line(item, vm86_proc_line(item->proc, record->index), data, sizeof(data)) : tb_null;
+        if (!line) line = record->opcode < tb_arrayn(g_opcode_names)? g_opcode_names[record->opcode] : "unknown";
+
+        // the proc name
+        tb_char_t           name[256];
+        if (item) tb_snprintf(name, sizeof(name), "%s", vm86_proc_name(item->proc));
+        else tb_snprintf(name, sizeof(name), "%#x", record->proc);
+
+        // dump it
+        tb_printf("%8lu %s+%-4u %-48s %s=%08x %s=%08x eax=%08x edx=%08x esp=%08x %s\n"
+                  , i
+                  , name
+                  , record->index
+                  , line
+                  , vm86_registers_cstr(record->r0)
+                  , record->value0
+                  , vm86_registers_cstr(record->r1)
+                  , record->value1
+                  , record->eax
+                  , record->edx
+                  , record->esp
+                  , record->flow < tb_arrayn(g_flow_names)? g_flow_names[record->flow] : "?");
+    }
+}
+
+/* //////////////////////////////////////////////////////////////////////////////////////
+ * main
+ */
+tb_int_t main(tb_int_t argc, tb_char_t** argv)
+{
+    // check
+    if (argc < 3)
+    {
+        tb_printf("usage: vm86trace trace.bin input.asm [input2.asm ...]\n");
+        tb_printf("    decode the trace file saved by vm86_context_trace_save() with the procs of the ida assembly files\n");
+        return -1;
+    }
+
+    // init tbox
+    if (!tb_init(tb_null, tb_null)) return -1;
+
+    // init decoder
+    vm86trace_t t;
+    tb_memset(&t, 0, sizeof(t));
+
+    // done
+    tb_bool_t   ok = tb_false;
+    tb_byte_t*  trace = tb_null;
+    do
+    {
+        // the machine
+        t.machine = vm86_machine();
+        tb_assert_and_check_break(t.machine);
+
+        // init procs
+        t.procs = tb_hash_map_init(0, tb_element_uint32(), tb_element_ptr(tb_null, tb_null));
+        tb_assert_and_check_break(t.procs);
+
+        // read the trace file
+        tb_size_t size = 0;
+        trace = vm86trace_file_read(argv[1], &size);
+        if (!trace)
+        {
+            tb_trace_e("read %s failed!", argv[1]);
+            break;
+        }
+
+        // check the header
+        vm86_trace_header_t const* header = (vm86_trace_header_t const*)trace;
+        if (    size < sizeof(vm86_trace_header_t)
+            ||  tb_strncmp(header->magic, VM86_TRACE_MAGIC, sizeof(header->magic))
+            ||  header->version != VM86_TRACE_VERSION
+            ||  header->count > (size - sizeof(vm86_trace_header_t)) / sizeof(vm86_trace_record_t))
+        {
+            tb_trace_e("invalid trace file: %s", argv[1]);
+            break;
+        }
+
+        // compile the inputs
+        tb_int_t i = 0;
+        for (i = 2; i < argc; i++)
+        {
+            // read it
+            tb_size_t   code_size = 0;
+            tb_byte_t*  code = vm86trace_file_read(argv[i], &code_size);
+            if (!code)
+            {
+                tb_trace_e("read %s failed!", argv[i]);
+                break;
+            }
+
+            // compile it
+            tb_bool_t compiled = vm86trace_compile(&t, (tb_char_t const*)code, code_size);
+            tb_free(code);
+            if (!compiled) break;
+        }
+        tb_check_break(i == argc);
+
+        // dump records
+        vm86trace_dump(&t, (vm86_trace_record_t const*)(header + 1), header->count);
+
+        // ok
+        ok = tb_true;
+
+    } while (0);
+
+    // exit procs
+    if (t.procs)
+    {
+        tb_for_all_if (tb_hash_map_item_t*, item, t.procs, item && item->data)
+        {
+            vm86trace_proc_t* proc = (vm86trace_proc_t*)item->data;
+            if (proc->code) tb_free(proc->code);
+            tb_free(proc);
+        }
+        tb_hash_map_exit(t.procs);
+    }
+    t.procs = tb_null;
+
+    // exit trace
+    if (trace) tb_free(trace);
+    trace = tb_null;
+
+    // exit tbox
+    tb_exit();
+
+    // ok?
+    return ok? 0 : -1;
+}
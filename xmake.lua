@@ -14,13 +14,11 @@ set_languages("c99", "cxx11")
 -- disable some compiler errors
 add_cxflags("-Wno-error=deprecated-declarations", "-fno-strict-aliasing", "-Wno-error=nullability-completeness")
 
--- set the default architecture, only support 32bits now
+-- set the default architecture, the 64bits host is only supported on linux and macosx (mmap the guest space)
 if is_host("windows") then
     set_config("arch", "x86")
 elseif is_plat("iphoneos") then
     set_config("arch", "armv7")
-else
-    set_config("arch", "i386")
 end
 
 -- apply debug and release modes
@@ -51,9 +49,63 @@ option("demo")
     set_description("Enable or disable the demo module")
 option_end()
 
+-- add option: vm86c
+option("vm86c")
+    set_default(true)
+    set_showmenu(true)
+    set_category("option")
+    set_description("Enable or disable the vm86c translator of the assembly procs to the c code")
+option_end()
+
+-- add option: vm86trace
+option("vm86trace")
+    set_default(true)
+    set_showmenu(true)
+    set_category("option")
+    set_description("Enable or disable the vm86trace decoder of the binary execution trace files")
+option_end()
+
+-- add option: bench
+option("bench")
+    set_default(false)
+    set_showmenu(true)
+    set_category("option")
+    set_description("Enable or disable the vm86_bench module of the execution microbenchmarks")
+option_end()
+
+-- add option: hugepage
+option("hugepage")
+    set_default(false)
+    set_showmenu(true)
+    set_category("option")
+    set_description("Enable or disable the transparent huge pages for the large .data chunks")
+    add_defines("VM86_CONFIG_HUGEPAGE")
+option_end()
+
+-- add option: jit
+option("jit")
+    set_default(false)
+    set_showmenu(true)
+    set_category("option")
+    set_description("Enable or disable the native x86-64 code for the hot procs")
+    add_defines("VM86_CONFIG_JIT")
+option_end()
+
+-- add option: profile
+option("profile")
+    set_default(false)
+    set_showmenu(true)
+    set_category("option")
+    set_description("Enable or disable the per-instruction execution counters of the profiled procs")
+    add_defines("VM86_CONFIG_PROFILE")
+option_end()
+
 -- add requires
 add_requires("tbox 1.6.6")
 
 -- add projects
 includes("src/vm86") 
 if has_config("demo") then includes("src/demo") end
+if has_config("vm86c") then includes("src/vm86c") end
+if has_config("vm86trace") then includes("src/vm86trace") end
+if has_config("bench") then includes("src/bench") end